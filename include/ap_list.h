@@ -0,0 +1,127 @@
+/**
+ * ElderGuard - Known Access Point List
+ *
+ * Prioritized list of WiFi networks the device may join, with the BSSID
+ * and channel of the last good connection to each so a reconnect can skip
+ * the channel scan. Picks the network to join from scan results (usable
+ * signal first, then priority, then RSSI) and decides when a stronger
+ * access point is worth roaming to. The whole list is one plain blob for
+ * storing in NVS. No Arduino or FreeRTOS dependencies; single owner.
+ */
+
+#ifndef AP_LIST_H
+#define AP_LIST_H
+
+#include <stdint.h>
+
+#define AP_LIST_MAX 8                    // Networks remembered
+#define AP_SSID_MAX 33                   // 32 characters and the terminator
+#define AP_PASSWORD_MAX 65               // 64 characters and the terminator
+#define AP_USABLE_RSSI -80               // Weaker networks are only picked if nothing else is in range
+
+typedef struct {
+    char ssid[AP_SSID_MAX];
+    char password[AP_PASSWORD_MAX];
+    int8_t priority;                     // Higher is preferred
+    bool cached;                         // bssid and channel are from the last good connection
+    uint8_t bssid[6];
+    uint8_t channel;
+} KnownAccessPoint;
+
+// One network seen by a scan
+typedef struct {
+    char ssid[AP_SSID_MAX];
+    uint8_t bssid[6];
+    uint8_t channel;
+    int8_t rssi;
+} ApScanResult;
+
+class AccessPointList {
+public:
+    AccessPointList();
+
+    /**
+     * Add a network, or update the password and priority of a known one
+     *
+     * @return false if the SSID is too long or the list is full
+     */
+    bool add(const char *ssid, const char *password, int priority);
+
+    /**
+     * @return false if the network was not known
+     */
+    bool remove(const char *ssid);
+
+    int getCount() const { return stored.count; }
+    const KnownAccessPoint &get(int index) const { return stored.aps[index]; }
+
+    /**
+     * Indices shift when a network is removed; look one up again by name
+     * after any change to the list
+     *
+     * @return Index of the network, or -1 if it is not known
+     */
+    int find(const char *ssid) const;
+
+    /**
+     * @return Index of the network to try first without a scan (the last
+     *         one joined, if its BSSID is still cached), or -1
+     */
+    int getFastConnect() const;
+
+    /**
+     * Pick the network to join from a scan
+     *
+     * @param results Scan results
+     * @param count Number of results
+     * @param resultIndex Receives the index of the chosen result
+     * @return Index of the known network, or -1 if none was seen
+     */
+    int selectBest(const ApScanResult *results, int count, int *resultIndex) const;
+
+    /**
+     * Pick an access point of a known network clearly stronger than the
+     * current one
+     *
+     * @param results Scan results
+     * @param count Number of results
+     * @param currentBssid BSSID of the access point in use
+     * @param currentRssi Its signal
+     * @param hysteresisDb How much stronger a target must be
+     * @param resultIndex Receives the index of the chosen result
+     * @return Index of the known network, or -1 to stay
+     */
+    int selectRoamTarget(const ApScanResult *results, int count, const uint8_t *currentBssid,
+                         int currentRssi, int hysteresisDb, int *resultIndex) const;
+
+    /**
+     * Cache the access point of a successful connection
+     *
+     * @return true if the list changed and should be stored again
+     */
+    bool remember(int index, const uint8_t *bssid, int channel);
+
+    /**
+     * Drop a network's cached access point after a failed fast connect
+     *
+     * @return true if the list changed and should be stored again
+     */
+    bool forget(int index);
+
+    // The list as one blob; restore() refuses blobs of another layout
+    const void *getBlob() const { return &stored; }
+    int getBlobSize() const { return sizeof(stored); }
+    bool restore(const void *blob, int length);
+
+private:
+    struct Stored {
+        uint32_t version;
+        int8_t count;
+        int8_t lastJoined;               // Network of the last good connection, or -1
+        KnownAccessPoint aps[AP_LIST_MAX];
+    };
+
+    Stored stored;
+};
+
+#endif // AP_LIST_H
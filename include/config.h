@@ -39,14 +39,78 @@
 // ------------------------------
 
 // Task Frequencies
-#define ECG_SAMPLE_FREQUENCY_HZ 50     // 50Hz sampling rate for ECG
 #define GPS_UPDATE_INTERVAL_MS 1000     // GPS update every 1 second
 #define MQTT_PUBLISH_INTERVAL_MS 1000   // MQTT publishing every 1 second
 #define HTTP_PUBLISH_INTERVAL_MS 30000  // HTTP publishing every 30 seconds
-#define FALL_DETECTION_SAMPLE_RATE_HZ 50 // 50Hz sampling for accelerometer
+#define FALL_DETECTION_SAMPLE_RATE_HZ 100 // IMU sample rate, a divisor of 1000 (50Hz polled, 100, 125 or 200Hz FIFO)
+
+// Task Stack Sizes (bytes, as passed to xTaskCreatePinnedToCore and diagnosticsAddTask)
+#define WIFI_TASK_STACK 8192
+#define TIME_TASK_STACK 4096
+#define MQTT_TASK_STACK 8192
+#define HTTP_TASK_STACK 16384           // TLS, request arena and JSON documents
+#define FIRMWARE_UPDATE_TASK_STACK 8192 // OTA update
+#define FALL_DETECTION_TASK_STACK 8192  // 4096 overflowed
+#define ECG_TASK_STACK 4096
+#define GPS_TASK_STACK 4096
+#define AUDIO_TASK_STACK 4096
+#define SCREEN_TASK_STACK 4096
+#define MEDICATION_TASK_STACK 4096
+
+// Power Management (see power_manager.h)
+#define POWER_MODE_PERFORMANCE 0        // Fixed 240MHz clock, WiFi radio always on, 20ms MQTT loop
+#define POWER_MODE_SAVE 1               // Frequency scaling, WiFi modem sleep, tasks block until needed
+#define POWER_MODE POWER_MODE_SAVE
+#define POWER_CPU_MIN_MHZ 80            // Clock while no task holds the transmit lock
+#define POWER_CPU_MAX_MHZ 240
+#define POWER_REPORT_INTERVAL_MS 60000  // Idle and lock time printed over serial
+#define DIAG_PUBLISH_INTERVAL_MS 60000  // Task diagnostics on the MQTT status topic (see diagnostics.h)
+#if POWER_MODE == POWER_MODE_SAVE
+#define MQTT_LOOP_INTERVAL_MS 250       // Longest MQTT wait when no data arrives (keepalive, PUBACKs)
+#else
+#define MQTT_LOOP_INTERVAL_MS 20
+#endif
+
+// ECG Capture Settings
+#define ECG_CAPTURE_POLLED 0            // One adc1_get_raw() per scheduler tick (legacy)
+#define ECG_CAPTURE_DMA 1               // ADC driven by I2S0 in continuous mode, DMA double buffer
+#define ECG_CAPTURE_MODE ECG_CAPTURE_DMA
+#define ECG_SAMPLE_RATE_HZ 250          // ECG output sample rate (250-500Hz)
+#define ECG_BLOCK_SIZE 25               // Samples processed per ECG task wakeup (100ms at 250Hz)
+#define ECG_ADC_OVERSAMPLE 32           // DMA conversions averaged into one ECG sample
+#define ECG_DETECTOR_MODE ECG_DETECTOR_PAN_TOMPKINS // ECG_DETECTOR_LEGACY or ECG_DETECTOR_PAN_TOMPKINS
+#define ECG_BENCHMARK_ON_BOOT 0         // 1 = print detector cycles per sample before capture starts
+
+// ECG Upload Settings
+#define ECG_UPLOAD_SNAPSHOT 0           // Newest 10 samples inside each sensor-data JSON post (legacy)
+#define ECG_UPLOAD_STREAM 1             // Every sample, in delta-encoded blocks (see ecg_stream.h)
+#define ECG_UPLOAD_MODE ECG_UPLOAD_STREAM
+#define ECG_UPLOAD_BLOCK_SAMPLES 250    // Samples per stream block (1s at 250Hz)
+#define ECG_UPLOAD_MAX_BLOCKS 4         // Blocks batched into one POST
+#define ECG_UPLOAD_INTERVAL_MS 2000     // Time between stream POSTs
+#define ECG_UPLOAD_BASE64 0             // 1 = base64 blocks in a JSON body, 0 = raw binary body
+#define MQTT_ECG_JSON 0                 // Newest 10 samples in a JSON message per ECG update (legacy)
+#define MQTT_ECG_FRAMES 1               // Every sample in fixed-period binary frames (see mqtt_task.h)
+#define MQTT_ECG_MODE MQTT_ECG_FRAMES
+#define MQTT_ECG_FRAME_MS 1000          // ECG frame period (40-2000ms at 250Hz, at most 1260ms with QoS 1)
+#define MQTT_REALTIME_QOS 1             // 0 = fire and forget, 1 = acknowledged and resent (see mqtt_inflight.h)
+#define MQTT_QOS1_RETRY_MS 10000        // Resend a QoS 1 message not acknowledged after this long
+#define HRV_WINDOW_MS 300000            // HRV window over RR intervals (60000-300000ms)
+#define HRV_MIN_INTERVALS 30            // RR intervals required before HRV is reported
+
+// Fall Detection Capture Settings
+#define FALL_CAPTURE_POLLED 0           // One mpu.getEvent() per scheduler tick (legacy)
+#define FALL_CAPTURE_FIFO 1             // MPU6050 FIFO burst reads, woken through MPU_INT_PIN
+#define FALL_CAPTURE_MODE FALL_CAPTURE_FIFO
+#define MPU_FIFO_BATCH 10               // Samples burst-read per wakeup (100ms at 100Hz)
+#define IMPACT_PRE_MS 2000              // IMU window kept before a fall's impact
+#define IMPACT_POST_MS 3000             // IMU window recorded after a fall's impact
+#define IMPACT_UPLOAD_DEADLINE_MS 600000 // HTTP and MQTT give up on a capture this long after receiving it
+#define FALL_BENCHMARK_ON_BOOT 0        // 1 = print orientation filter cost and accuracy before capture starts
 
 // Audio Settings
 #define AUDIO_MAX_VOLUME 30             // Maximum volume level (0-30)
+#define AUDIO_FALL_VOLUME 24            // First fall alert; escalations play at AUDIO_MAX_VOLUME
 
 // Audio File Mappings (on SD card)
 #define AUDIO_WELCOME 7
@@ -57,6 +121,9 @@
 // API Configuration
 // ------------------------------
 #define PATIENT_ID 1                          // Patient identifier for API communication
+#define CONFIG_STRINGIFY_(x) #x
+#define CONFIG_STRINGIFY(x) CONFIG_STRINGIFY_(x)
+#define PATIENT_ID_TEXT CONFIG_STRINGIFY(PATIENT_ID) // The same, for compile-time URLs and headers
 #define MAX_MEDICATIONS 20                    // Maximum number of medications to track
 #define MEDICATION_FETCH_INTERVAL_MS 900000   // Fetch medication schedule every 15 minutes (900000ms)
 #define MEDICATION_API_URL "https://elderguard.codecommerce.info/api/medications" // API endpoint for medication schedules
@@ -72,11 +139,17 @@
 
 // WiFi and Time Management Constants
 // ------------------------------
-#define WIFI_SSID "AVIV"        // Default SSID
+#define WIFI_SSID "AVIV"        // Default SSID, added to the known networks in NVS
 #define WIFI_PASSWORD "$$$$$$$$M"      // Default password
-#define WIFI_CONNECT_TIMEOUT_MS 30000         // WiFi connection timeout (30 sec)
-#define WIFI_RECONNECT_INTERVAL_MS 60000      // Attempt reconnection every minute
-#define WIFI_TASK_INTERVAL_MS 5000            // Check WiFi status every 5 seconds
+#define WIFI_CONNECT_TIMEOUT_MS 30000         // Give up on an attempt with no result (30 sec)
+#define WIFI_BACKOFF_MIN_MS 1000              // Wait after the first failed attempt; doubles per failure
+#define WIFI_BACKOFF_MAX_MS 60000             // Longest wait between attempts
+#define WIFI_TASK_INTERVAL_MS 5000            // Refresh RSSI and IP every 5 seconds
+#define WIFI_SCAN_MS_PER_CHANNEL 120          // Active scan dwell per channel
+#define WIFI_SCAN_RESULTS_MAX 16              // Scan results looked at
+#define WIFI_ROAM_RSSI_DBM -72                // Look for a stronger access point below this signal
+#define WIFI_ROAM_HYSTERESIS_DB 8             // Roam only to an access point this much stronger
+#define WIFI_ROAM_SCAN_INTERVAL_MS 60000      // Between roaming scans while the signal stays weak
 
 #define NTP_SERVER "pool.ntp.org"             // Primary NTP server
 #define NTP_FALLBACK_SERVER "time.google.com" // Fallback NTP server
@@ -93,6 +166,10 @@ typedef struct {
     int rawValue;
     int heartRate;
     bool validSignal;
+    float sdnn;            // HRV: standard deviation of RR intervals (ms)
+    float rmssd;           // HRV: root mean square of successive differences (ms)
+    float pnn50;           // HRV: successive differences over 50ms (%)
+    int hrvIntervals;      // RR intervals in the HRV window, 0 if HRV not yet valid
     unsigned long timestamp;
 } EcgData;
 
@@ -136,9 +213,15 @@ typedef struct {
     bool connected;
     int rssi;
     char ip[16];
+    char ssid[33];                       // Network joined
+    int channel;
     unsigned long lastConnectAttempt;
     int failureCount;
     unsigned long lastStatusCheck;
+    unsigned long lastConnectMs;         // Attempt start to IP address, last connection
+    unsigned long worstConnectMs;
+    bool fastConnect;                    // Last connection used the cached BSSID, no scan
+    uint32_t roamCount;                  // Moves to a stronger access point
 } WiFiStatus;
 
 // Time Synchronization Structure
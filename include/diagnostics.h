@@ -0,0 +1,104 @@
+/**
+ * ElderGuard - Task Diagnostics
+ *
+ * Stack headroom and CPU share of every application task, and period
+ * histograms for the sensor loops. The Arduino SDK is built without
+ * FreeRTOS run-time stats, so CPU share is sampled the same way as idle
+ * time in power_manager: on every scheduler tick each core records which
+ * registered task it is running.
+ *
+ * A report holds counters since boot; a consumer keeps the previous one
+ * to turn them into rates over its own interval.
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdint.h>
+#include <ArduinoJson.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config.h"
+#include "period_histogram.h"
+
+#define DIAG_TASKS_MAX 12
+
+typedef enum {
+    DIAG_LOOP_ECG,               // One wakeup per ECG block (or sample, polled)
+    DIAG_LOOP_FALL,              // One wakeup per IMU FIFO batch (or sample, polled)
+    DIAG_LOOP_COUNT
+} DiagLoop;
+
+typedef struct {
+    const char *name;
+    uint32_t stackSize;          // Bytes, as passed to xTaskCreate
+    uint32_t stackFree;          // Least free stack so far, bytes
+    uint32_t ticks;              // Ticks that found this task running
+    bool running;                // False once the task has deleted itself
+} DiagTask;
+
+typedef struct {
+    uint32_t uptimeMs;
+    uint32_t sampledTicks;       // Ticks sampled on each core
+    int taskCount;
+    DiagTask tasks[DIAG_TASKS_MAX];
+    PeriodHistogram loops[DIAG_LOOP_COUNT];
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;        // Lowest free heap since boot
+    uint32_t largestFreeBlock;   // Largest single allocation possible now
+} DiagReport;
+
+/**
+ * Start the CPU sampler. Call once from setup(), before the tasks start.
+ */
+void setupDiagnostics();
+
+/**
+ * Watch a task created with xTaskCreate
+ *
+ * @param task Its handle
+ * @param stackSize Stack size it was created with, in bytes
+ */
+void diagnosticsAddTask(TaskHandle_t task, uint32_t stackSize);
+
+/**
+ * Stop watching the calling task; call before it deletes itself
+ */
+void diagnosticsTaskExit();
+
+/**
+ * @param loop Loop to time
+ * @param periodUs Nominal time between its wakeups
+ */
+void diagnosticsSetLoopPeriod(DiagLoop loop, uint32_t periodUs);
+
+/**
+ * The loop was woken by new data or its timer
+ */
+void diagnosticsLoopWake(DiagLoop loop);
+
+/**
+ * The loop is done and about to block again
+ */
+void diagnosticsLoopWait(DiagLoop loop);
+
+/**
+ * @param report Receives the counters since boot
+ */
+void getDiagnostics(DiagReport *report);
+
+/**
+ * Fill a JSON document with the report, rates taken since previous
+ *
+ * @param doc Document to fill
+ * @param report Current counters
+ * @param previous Counters at the start of the interval
+ */
+void writeDiagnosticsJson(JsonDocument &doc, const DiagReport &report, const DiagReport &previous);
+
+/**
+ * Print the report over serial, with CPU share since the last call
+ */
+void printDiagnostics();
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,81 @@
+/**
+ * ElderGuard - ECG Block Pipeline
+ *
+ * The ECG task's processing of one captured block: publish the raw samples
+ * to the sample ring, run QRS detection, feed RR intervals to the HRV
+ * window and watch for a significant heart rate drop. Live capture and
+ * replays of recorded blocks go through the same processBlock(), and all
+ * timing comes from the sample clock. Delivering an alert is left to the
+ * caller. No Arduino or FreeRTOS dependencies.
+ */
+
+#ifndef ECG_PIPELINE_H
+#define ECG_PIPELINE_H
+
+#include <stdint.h>
+#include "ecg_processor.h"
+#include "ecg_ring.h"
+#include "hrv_engine.h"
+
+// Heart rate drop detection parameters
+#define HEART_RATE_DROP_THRESHOLD 20     // Consider drop of 20 BPM or more as significant
+#define HEART_RATE_MIN_VALID 40          // Minimum valid heart rate
+#define HEART_RATE_ALERT_COOLDOWN 60000  // Cooldown period between alerts (60 seconds)
+#define HEART_RATE_STABLE_MS 10000       // A drop is measured against the rate up to this long ago
+
+// A significant heart rate drop
+typedef struct {
+    int previousBpm;       // Stable heart rate before the drop
+    int currentBpm;        // Heart rate after the beat that showed it
+    uint32_t timeMs;       // Time of that beat on the sample clock
+} HeartRateDrop;
+
+class EcgPipeline {
+public:
+    /**
+     * @param ring Receives every sample, processed or not
+     * @param processor QRS detector and heart rate tracker
+     * @param hrv HRV window fed with the processor's RR intervals
+     */
+    EcgPipeline(EcgSampleRing &ring, EcgProcessor &processor, HrvEngine &hrv);
+
+    /**
+     * Process a block captured with the leads connected
+     *
+     * @param samples Raw 12-bit ADC samples, oldest first
+     * @param count Number of samples in the block
+     * @param beats Output array for detected beats, as EcgProcessor::processBlock()
+     * @param maxBeats Capacity of the beats array
+     * @return Number of beats written to beats
+     */
+    int processBlock(const int *samples, int count, EcgBeat *beats, int maxBeats);
+
+    /**
+     * Pass a block captured with the leads off: the samples still go to the
+     * ring and the sample clock runs on, but nothing is detected
+     *
+     * @return true if this cleared the heart rate
+     */
+    bool leadsOff(const int *samples, int count);
+
+    /**
+     * @param drop Receives the drop found since the last call
+     * @return false if there was none
+     */
+    bool takeHeartRateDrop(HeartRateDrop *drop);
+
+private:
+    EcgSampleRing &ring;
+    EcgProcessor &processor;
+    HrvEngine &hrv;
+
+    int stableHeartRate;             // 0 until the first valid reading
+    uint32_t stableSinceMs;
+    uint32_t lastAlertMs;
+    bool dropPending;
+    HeartRateDrop drop;
+
+    void checkHeartRateDrop(int heartRate, uint32_t timeMs);
+};
+
+#endif // ECG_PIPELINE_H
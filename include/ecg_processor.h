@@ -0,0 +1,120 @@
+/**
+ * ElderGuard - ECG QRS Detector
+ *
+ * This file declares the block-oriented ECG processor that detects QRS
+ * complexes and tracks heart rate. It has no Arduino or FreeRTOS
+ * dependencies so it can be built and exercised on a host machine.
+ */
+
+#ifndef ECG_PROCESSOR_H
+#define ECG_PROCESSOR_H
+
+#include <stdint.h>
+#include "pan_tompkins.h"
+
+// QRS detector selection
+typedef enum {
+    ECG_DETECTOR_LEGACY,        // Moving average, slow baseline and adaptive amplitude threshold
+    ECG_DETECTOR_PAN_TOMPKINS   // Fixed-point Pan-Tompkins chain
+} EcgDetectorMode;
+
+// Maximum number of beats reported from a single block
+#define ECG_MAX_BEATS_PER_BLOCK 8
+
+// A detected heartbeat
+typedef struct {
+    uint32_t timeMs;       // Time of the beat on the sample clock (ms)
+    uint32_t rrInterval;   // Interval to the previous beat in ms, 0 if not physiologically valid
+    int amplitude;         // QRS peak amplitude above baseline
+    int heartRate;         // Smoothed heart rate after this beat (BPM)
+} EcgBeat;
+
+class EcgProcessor {
+public:
+    /**
+     * @param sampleRateHz Rate of the samples passed to processBlock()
+     * @param mode QRS detector to run
+     */
+    EcgProcessor(int sampleRateHz, EcgDetectorMode mode);
+
+    /**
+     * Reset all detector state and the sample clock
+     */
+    void reset();
+
+    /**
+     * Run the detector over a block of raw ECG samples
+     *
+     * @param samples Raw 12-bit ADC samples, oldest first
+     * @param count Number of samples in the block
+     * @param beats Output array for detected beats (may be NULL if maxBeats is 0)
+     * @param maxBeats Capacity of the beats array
+     * @return Number of beats written to beats
+     */
+    int processBlock(const int *samples, int count, EcgBeat *beats, int maxBeats);
+
+    /**
+     * Advance the sample clock without processing (e.g. while leads are off)
+     *
+     * @param count Number of samples skipped
+     */
+    void skipSamples(int count);
+
+    /**
+     * Drop the current heart rate estimate, keeping the detector state
+     */
+    void clearHeartRate();
+
+    int getHeartRate() const { return heartRate; }
+    int getBaseline() const { return baseline; }
+    int getThreshold() const;
+    int getAverageAmplitude() const { return averageAmplitude; }
+    uint32_t getSampleTimeMs() const;
+
+private:
+    static const int FILTER_TAPS = 5;
+    static const int RR_BUFFER_SIZE = 8;
+    static const int AMPLITUDE_BUFFER_SIZE = 5;
+
+    int sampleRateHz;
+    EcgDetectorMode mode;
+    uint32_t sampleCount;
+
+    PanTompkinsDetector panTompkins;
+
+    // Moving average history
+    int filterHistory[FILTER_TAPS];
+    int filterIndex;
+    int filterSum;
+
+    // Baseline and threshold tracking
+    int baseline;
+    int adaptiveThreshold;
+
+    // QRS detection state
+    bool inQRS;
+    uint32_t qrsStartTime;
+    int qrsPeak;
+
+    // Amplitude tracking
+    int recentAmplitudes[AMPLITUDE_BUFFER_SIZE];
+    int amplitudeIndex;
+    int averageAmplitude;
+
+    // RR interval storage
+    uint32_t rrIntervals[RR_BUFFER_SIZE];
+    int rrIndex;
+    bool havePeak;
+    uint32_t lastPeakTime;
+
+    // Heart rate
+    int heartRate;
+    uint32_t lastHeartRateChangeTime;
+
+    int processLegacy(const int *samples, int count, EcgBeat *beats, int maxBeats);
+    int processPanTompkins(const int *samples, int count, EcgBeat *beats, int maxBeats);
+    void trackAmplitude(int peakAmplitude);
+    void registerBeat(uint32_t beatTime, int peakAmplitude, EcgBeat *beat);
+};
+
+#endif // ECG_PROCESSOR_H
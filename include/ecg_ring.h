@@ -0,0 +1,81 @@
+/**
+ * ElderGuard - ECG Sample Ring
+ *
+ * Single-producer/multi-consumer ring of ECG samples addressed by a 32-bit
+ * sequence number. The ECG task writes without waiting on anyone; each
+ * consumer keeps its own cursor and gets gap-free, non-duplicated ranges.
+ * A consumer that falls more than the ring capacity behind skips ahead and
+ * the skipped samples are counted. Samples overwritten while a reader is
+ * copying them are detected and discarded, so reads are never torn.
+ */
+
+#ifndef ECG_RING_H
+#define ECG_RING_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define ECG_RING_CAPACITY 2048           // Samples held (power of two), ~8s at 250Hz
+
+// Per-consumer read position
+typedef struct {
+    uint32_t next;         // Sequence number of the next sample to read
+    uint32_t dropped;      // Samples lost because the consumer fell behind
+} EcgRingCursor;
+
+class EcgSampleRing {
+public:
+    EcgSampleRing();
+
+    /**
+     * Append samples (producer only, never blocks)
+     *
+     * @param values Samples, oldest first
+     * @param count Number of samples
+     */
+    void write(const int *values, int count);
+
+    /**
+     * @return Sequence number one past the newest published sample
+     */
+    uint32_t getHead() const { return head.load(std::memory_order_acquire); }
+
+    /**
+     * Position a cursor at the current head so it only sees new samples
+     */
+    void initCursor(EcgRingCursor *cursor) const;
+
+    /**
+     * Read the next samples for a consumer and advance its cursor
+     *
+     * @param cursor Consumer cursor
+     * @param out Output buffer
+     * @param maxCount Capacity of out
+     * @return Number of samples written to out, oldest first
+     */
+    int read(EcgRingCursor *cursor, int *out, int maxCount) const;
+
+    /**
+     * Read only the newest unread samples and move the cursor to the head.
+     * For consumers that want a preview rather than the full stream; older
+     * unread samples are skipped on purpose and not counted as dropped.
+     *
+     * @param cursor Consumer cursor
+     * @param out Output buffer
+     * @param count Maximum number of samples wanted
+     * @return Number of samples written to out, oldest first
+     */
+    int readNewest(EcgRingCursor *cursor, int *out, int count) const;
+
+private:
+    static const uint32_t MASK = ECG_RING_CAPACITY - 1;
+    static_assert((ECG_RING_CAPACITY & MASK) == 0, "ECG_RING_CAPACITY must be a power of two");
+
+    std::atomic<int16_t> samples[ECG_RING_CAPACITY];
+    std::atomic<uint32_t> head;       // Published: samples before this are complete
+    std::atomic<uint32_t> reserved;   // Samples before this may be being written
+
+    int copyRange(uint32_t start, uint32_t end, int *out) const;
+};
+
+#endif // ECG_RING_H
@@ -0,0 +1,109 @@
+/**
+ * ElderGuard - ECG Block Stream
+ *
+ * Turns the ECG sample ring into a continuous upload stream. Every sample
+ * is kept: the stream reads through its own ring cursor and cuts the
+ * samples into fixed-size blocks, each delta encoded with zigzag varints
+ * like the impact capture. Block and sample sequence numbers let the
+ * backend detect anything lost on the device or in transit. Nothing is
+ * allocated after construction. No Arduino or FreeRTOS dependencies.
+ *
+ * Block layout (little-endian):
+ *   0  "EGEB"                   magic
+ *   4  uint8  version (1)
+ *   5  uint8  reserved (0)
+ *   6  uint16 sample rate (Hz)
+ *   8  uint16 samples in the block
+ *   10 uint16 reserved (0)
+ *   12 uint32 block sequence number, +1 per block
+ *   16 uint32 ring sequence number of the first sample
+ *   20 uint32 samples lost on the device since the previous block
+ *   24 int16 first sample, then the difference of every later sample to
+ *      the previous one as a zigzag LEB128 varint
+ */
+
+#ifndef ECG_STREAM_H
+#define ECG_STREAM_H
+
+#include <stdint.h>
+#include "ecg_ring.h"
+
+#define ECG_STREAM_MAX_BLOCK_SAMPLES 500 // Upper bound for the block size (2s at 250Hz)
+#define ECG_STREAM_HEADER_BYTES 24
+#define ECG_STREAM_MAX_DELTA_BYTES 3     // A 17-bit zigzag delta needs at most three varint bytes
+
+/**
+ * @param samples Samples per block
+ * @return Worst-case encoded size of one block in bytes
+ */
+constexpr int ecgStreamBlockMaxBytes(int samples) {
+    return ECG_STREAM_HEADER_BYTES + 2 + (samples - 1) * ECG_STREAM_MAX_DELTA_BYTES;
+}
+
+/**
+ * @param length Bytes to encode
+ * @return Base64 length of that many bytes, without a terminator
+ */
+constexpr int base64EncodedLength(int length) {
+    return (length + 2) / 3 * 4;
+}
+
+class EcgBlockStream {
+public:
+    /**
+     * @param sampleRateHz Rate of the samples in the ring
+     * @param blockSamples Samples per block (at most ECG_STREAM_MAX_BLOCK_SAMPLES)
+     */
+    EcgBlockStream(int sampleRateHz, int blockSamples);
+
+    /**
+     * Start streaming at the current ring head
+     */
+    void begin(const EcgSampleRing &ring);
+
+    /**
+     * Pull new samples from the ring and encode every block they complete
+     *
+     * @param ring Ring written by the ECG task
+     * @param out Output buffer; whole blocks are appended back to back
+     * @param maxLength Capacity of out
+     * @param maxBlocks Most blocks to encode in this call
+     * @param blocks Receives the number of blocks encoded
+     * @return Bytes written to out
+     */
+    int readBlocks(const EcgSampleRing &ring, uint8_t *out, int maxLength, int maxBlocks, int *blocks);
+
+    int getBlockSamples() const { return blockSamples; }
+
+    // Blocks encoded, and samples lost on the device so far
+    uint32_t getBlockCount() const { return blockSequence; }
+    uint32_t getDroppedCount() const { return totalDropped; }
+
+private:
+    int sampleRateHz;
+    int blockSamples;
+    EcgRingCursor cursor;
+
+    // Block being filled
+    int block[ECG_STREAM_MAX_BLOCK_SAMPLES];
+    int filled;
+    uint32_t blockStart;
+
+    uint32_t blockSequence;
+    uint32_t droppedSinceBlock;
+    uint32_t totalDropped;
+
+    int encodeBlock(uint8_t *out);
+};
+
+/**
+ * Base64 (RFC 4648, padded) for sending blocks inside a JSON body
+ *
+ * @param in Bytes to encode
+ * @param length Number of bytes
+ * @param out Output, at least base64EncodedLength(length) + 1 chars
+ * @return Characters written, not counting the terminating NUL
+ */
+int base64Encode(const uint8_t *in, int length, char *out);
+
+#endif // ECG_STREAM_H
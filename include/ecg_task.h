@@ -11,17 +11,15 @@
 #include <Arduino.h>
 #include "config.h"
 #include "globals.h"
-
-// Define ECG buffer size
-#define ECG_BUFFER_SIZE 250
+#include "ecg_ring.h"
 
 // Function prototypes
 void ecgTask(void *pvParameters);
+void processEcgBlock(const int *samples, int count);
 int calculateHeartRate(int *samples, int count);
 bool isValidEcgSignal();
 
-// External buffer declarations
-extern int ecgBuffer[];
-extern int bufferIndex;
+// Raw ECG samples for all consumers (written only by the ECG task)
+extern EcgSampleRing ecgRing;
 
 #endif // ECG_TASK_H
\ No newline at end of file
@@ -0,0 +1,227 @@
+/**
+ * ElderGuard - Typed Event Bus
+ *
+ * Each EventTopic<T> carries one message type between tasks. A publisher
+ * copies its message once into a free slot; every subscriber then receives
+ * the slot index through its own FreeRTOS queue and reads the message in
+ * place, so each subscriber sees every update exactly once and no consumer
+ * can steal another's notification. A subscriber may also ask for a task
+ * notification bit so one task can wait on several topics at once.
+ *
+ * When a subscriber's queue is full the oldest undelivered message is
+ * dropped for that subscriber only, so a stalled consumer never blocks a
+ * producer. Publishing never waits. A topic sized with eventTopicSlots()
+ * never runs out of slots; subscribe() refuses a subscriber that would
+ * break that.
+ */
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+/**
+ * Slots a topic needs so publish() always finds a free one: every
+ * subscriber's queue full, one message in use by each subscriber, and the
+ * message being published
+ *
+ * @param totalDepth Sum of the subscribers' queue depths
+ * @param subscribers Number of subscribers
+ */
+constexpr int eventTopicSlots(int totalDepth, int subscribers) {
+    return totalDepth + subscribers + 1;
+}
+
+template <typename T, int SLOTS, int MAX_SUBSCRIBERS>
+class EventTopic {
+public:
+    EventTopic() : subscriberCount(0), reservedSlots(1), dropped(0) {
+        for (int i = 0; i < SLOTS; i++) {
+            refs[i] = 0;
+        }
+    }
+
+    /**
+     * Register the calling task as a subscriber
+     *
+     * @param depth Messages queued for this subscriber before the oldest is dropped
+     * @param notifyBits Task notification bits set on the calling task for each
+     *                   message, or 0 to only deliver through the queue
+     * @return Subscriber id for receive(), or -1 if the topic is full or
+     *         has too few slots left for this depth
+     */
+    int subscribe(int depth, uint32_t notifyBits = 0) {
+        QueueHandle_t queue = xQueueCreate(depth, sizeof(uint8_t));
+        if (queue == NULL) {
+            return -1;
+        }
+
+        int id = -1;
+        taskENTER_CRITICAL(&spinlock);
+        if (subscriberCount < MAX_SUBSCRIBERS && reservedSlots + depth + 1 <= SLOTS) {
+            reservedSlots += depth + 1;
+            id = subscriberCount;
+            subscribers[id].queue = queue;
+            subscribers[id].task = notifyBits ? xTaskGetCurrentTaskHandle() : NULL;
+            subscribers[id].notifyBits = notifyBits;
+            subscriberCount++;
+        }
+        taskEXIT_CRITICAL(&spinlock);
+
+        if (id < 0) {
+            vQueueDelete(queue);
+        }
+        return id;
+    }
+
+    /**
+     * Deliver a copy of value to every subscriber (never blocks)
+     *
+     * @return false if no slot was free and the message was dropped
+     */
+    bool publish(const T &value) {
+        int slot = -1;
+        int count;
+
+        taskENTER_CRITICAL(&spinlock);
+        for (int i = 0; i < SLOTS; i++) {
+            if (refs[i] == 0) {
+                slot = i;
+                break;
+            }
+        }
+        count = subscriberCount;
+        if (slot >= 0) {
+            // One reference per subscriber plus one held while delivering
+            refs[slot] = count + 1;
+        } else {
+            dropped++;
+        }
+        taskEXIT_CRITICAL(&spinlock);
+
+        if (slot < 0) {
+            return false;
+        }
+
+        slots[slot] = value;
+
+        uint8_t index = (uint8_t)slot;
+        for (int s = 0; s < count; s++) {
+            Subscriber &sub = subscribers[s];
+            if (xQueueSend(sub.queue, &index, 0) != pdTRUE) {
+                // Subscriber is behind: drop its oldest message and retry once
+                uint8_t oldest;
+                if (xQueueReceive(sub.queue, &oldest, 0) == pdTRUE) {
+                    releaseIndex(oldest);
+                }
+                if (xQueueSend(sub.queue, &index, 0) != pdTRUE) {
+                    releaseIndex(index);
+                    continue;
+                }
+            }
+            if (sub.task != NULL) {
+                xTaskNotify(sub.task, sub.notifyBits, eSetBits);
+            }
+        }
+
+        releaseIndex(index);
+        return true;
+    }
+
+    /**
+     * Take the next message for a subscriber. The message stays valid until
+     * it is passed to release().
+     *
+     * @param subscriber Id returned by subscribe()
+     * @param wait Ticks to wait for a message
+     * @return Pointer to the message, or NULL if none arrived
+     */
+    const T *receive(int subscriber, TickType_t wait = 0) {
+        if (subscriber < 0) {
+            return NULL;
+        }
+        uint8_t index;
+        if (xQueueReceive(subscribers[subscriber].queue, &index, wait) != pdTRUE) {
+            return NULL;
+        }
+        return &slots[index];
+    }
+
+    /**
+     * Return a message obtained from receive() to the topic
+     */
+    void release(const T *message) {
+        releaseIndex((uint8_t)(message - slots));
+    }
+
+    /**
+     * Drain a subscriber's queue, keeping only the newest message
+     *
+     * @param subscriber Id returned by subscribe()
+     * @param out Receives a copy of the newest message
+     * @return true if at least one message was pending
+     */
+    bool receiveLatest(int subscriber, T *out) {
+        bool received = false;
+        const T *message;
+        while ((message = receive(subscriber)) != NULL) {
+            *out = *message;
+            release(message);
+            received = true;
+        }
+        return received;
+    }
+
+    /**
+     * @return Number of registered subscribers
+     */
+    int getSubscriberCount() const { return subscriberCount; }
+
+    /**
+     * @return Messages dropped because every slot was in use
+     */
+    uint32_t getDropped() const { return dropped; }
+
+private:
+    typedef struct {
+        QueueHandle_t queue;
+        TaskHandle_t task;
+        uint32_t notifyBits;
+    } Subscriber;
+
+    static_assert(SLOTS <= 256, "Slot indices are queued as uint8_t");
+    static_assert(SLOTS >= eventTopicSlots(MAX_SUBSCRIBERS, MAX_SUBSCRIBERS),
+                  "Too few slots for MAX_SUBSCRIBERS subscribers of depth 1; size topics with eventTopicSlots()");
+
+    T slots[SLOTS];
+    uint8_t refs[SLOTS];
+    Subscriber subscribers[MAX_SUBSCRIBERS];
+    volatile int subscriberCount;
+    int reservedSlots;                   // Slots the subscribers can hold at once, plus one to publish
+    uint32_t dropped;
+    portMUX_TYPE spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+    void releaseIndex(uint8_t index) {
+        taskENTER_CRITICAL(&spinlock);
+        if (refs[index] > 0) {
+            refs[index]--;
+        }
+        taskEXIT_CRITICAL(&spinlock);
+    }
+};
+
+/**
+ * Wait for any of the requested notification bits on the calling task
+ *
+ * @param timeout Ticks to wait
+ * @return Bits that were set (0 on timeout)
+ */
+static inline uint32_t waitForEvents(TickType_t timeout) {
+    uint32_t bits = 0;
+    xTaskNotifyWait(0, 0xFFFFFFFF, &bits, timeout);
+    return bits;
+}
+
+#endif // EVENT_BUS_H
@@ -0,0 +1,40 @@
+/**
+ * ElderGuard - Fall Classifier
+ *
+ * Second-stage check run on every fall candidate that passed the impact
+ * rules. Four features of the impact window are quantized to int8 and
+ * scored by a logistic model with int8 weights (fall_classifier_model.h).
+ * The logit sign is the decision, so no sigmoid is evaluated. No Arduino
+ * or FreeRTOS dependencies.
+ */
+
+#ifndef FALL_CLASSIFIER_H
+#define FALL_CLASSIFIER_H
+
+#include <stdint.h>
+
+#define FALL_CLASSIFIER_FEATURES 4
+
+// Features of one fall candidate, in the order the model expects
+typedef struct {
+    float sma;              // Signal magnitude area: mean |ax|+|ay|+|az| over the window (g)
+    float jerk;             // Peak change of |a| between samples (g/s)
+    float stillness;        // Standard deviation of |a| after the impact settles (g)
+    float orientationDelta; // Angle between resting and final gravity direction (degrees)
+} FallFeatures;
+
+/**
+ * Quantize features to the model's int8 inputs
+ *
+ * @param features Features of the candidate
+ * @param quantized Receives FALL_CLASSIFIER_FEATURES values
+ */
+void quantizeFallFeatures(const FallFeatures &features, int8_t *quantized);
+
+/**
+ * @param features Features of the candidate
+ * @return Integer logit; the candidate is a fall when it is >= 0
+ */
+int32_t scoreFall(const FallFeatures &features);
+
+#endif // FALL_CLASSIFIER_H
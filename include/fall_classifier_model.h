@@ -0,0 +1,24 @@
+/**
+ * ElderGuard - Fall Classifier Model
+ *
+ * Generated by tools/train_fall_classifier.py; regenerate rather than edit.
+ * Only included by fall_classifier.cpp and its native test.
+ *
+ * Initial weights set by hand from the expected separation between falls
+ * (large orientation change, lying still afterwards, sharp jerk) and
+ * sitting down hard (upright afterwards, still moving).
+ */
+
+#ifndef FALL_CLASSIFIER_MODEL_H
+#define FALL_CLASSIFIER_MODEL_H
+
+#include <stdint.h>
+
+// Quantized input = round(feature * scale), clamped to int8
+static constexpr float FALL_FEATURE_SCALES[4] = { 32.0f, 0.5f, 256.0f, 1.0f };
+
+// sma, jerk, stillness, orientationDelta
+static constexpr int8_t FALL_CLASSIFIER_WEIGHTS[4] = { -1, 1, -3, 4 };
+static constexpr int32_t FALL_CLASSIFIER_BIAS = -120;
+
+#endif // FALL_CLASSIFIER_MODEL_H
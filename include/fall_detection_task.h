@@ -12,15 +12,21 @@
 #include <Adafruit_Sensor.h>
 #include "config.h"
 #include "globals.h"
+#include "fall_detector.h"
+#include "impact_recorder.h"
+
+// Pre/post-impact IMU capture, read by the uploaders after an ImpactCapture event
+extern ImpactRecorder impactRecorder;
 
 // Function prototypes
 void fallDetectionTask(void *pvParameters);
 bool detectFall(float *acceleration, float *orientation);
 int assessFallSeverity(float impact);
 void calibrateAccelerometer();
-void updateOrientation(sensors_event_t accel, sensors_event_t gyro);
-void processFallDetection(sensors_event_t accel, sensors_event_t gyro);
-void reportFallEvent(float pitchChange, float rollChange);
-float calculateAccelerationMagnitude(float x, float y, float z);
+void recordImpactSample(const sensors_event_t &accel, const sensors_event_t &gyro);
+void processFallDetection(sensors_event_t accel, sensors_event_t gyro, unsigned long currentTime);
+void reportFallEvent(const FallDetection &detection);
+void reportFallEscalation();
+void reportFallRecovery();
 
 #endif // FALL_DETECTION_TASK_H
\ No newline at end of file
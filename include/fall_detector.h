@@ -0,0 +1,187 @@
+/**
+ * ElderGuard - Fall Detector
+ *
+ * This file declares the per-sample fall detection state machine: free
+ * fall, impact, pattern check, classification and tracking the person
+ * after a confirmed fall until they are upright again. It
+ * owns its orientation filter and takes all timing from the caller's
+ * sample clock, so it has no Arduino or FreeRTOS dependencies and gives
+ * the same decisions for live data and a replayed IMU trace.
+ */
+
+#ifndef FALL_DETECTOR_H
+#define FALL_DETECTOR_H
+
+#include <stdint.h>
+#include "orientation_filter.h"
+#include "fall_classifier.h"
+
+// Tunable thresholds
+typedef struct {
+    // Fall detection thresholds
+    float freefallThreshold;           // m/s² - below this starts a potential fall
+    float impactThreshold;             // m/s² - above this after free fall is an impact
+    float orientationChangeThreshold;  // degrees - tilt from baseline that counts as a direction
+
+    // Fall detection options
+    bool requireOrientationChange;     // Require the tilt change to confirm a fall
+    bool requireConsistentAcceleration; // Require the acceleration pattern check
+
+    // Timing parameters
+    uint32_t minFreefallDuration;      // ms of free fall before an impact is accepted
+    uint32_t maxFreefallWindow;        // ms to wait for an impact after free fall starts
+
+    // Consecutive confirmations needed
+    int requiredConsecutiveImpacts;
+
+    // Second stage: classify the impact window before confirming
+    bool useClassifier;
+    uint32_t verifyWindow;             // ms after the impact the classifier looks at
+
+    // After a confirmed fall
+    float uprightAngle;                // degrees from the resting gravity direction that count as upright
+    uint32_t recoveryTime;             // ms continuously upright before the fall is cancelled
+    uint32_t escalationTime;           // ms down before each escalation
+    uint32_t motionlessEscalationTime; // ms without movement before the first escalation
+    int maxEscalations;                // Escalations before the detector stops repeating
+} FallDetectorConfig;
+
+// Detector state
+typedef enum {
+    FALL_MONITORING,
+    FALL_POTENTIAL,
+    FALL_IMPACT_DETECTED,
+    FALL_VERIFYING,                    // Impact rules passed, collecting the classifier window
+    FALL_CONFIRMED                     // Fall raised; watching for recovery or a long lie
+} FallDetectorState;
+
+// What a sample changed
+typedef enum {
+    FALL_RESULT_NONE,
+    FALL_RESULT_FALL,                  // A fall was confirmed on this sample
+    FALL_RESULT_REJECTED,              // The classifier rejected a candidate on this sample
+    FALL_RESULT_ESCALATE,              // Still down after a fall; raise the alert again
+    FALL_RESULT_RECOVERED              // Upright again after a fall; cancel the alert
+} FallDetectorResult;
+
+// Details of a confirmed fall
+typedef struct {
+    float peakAcceleration;            // m/s² since free fall started
+    float pitch, roll, yaw;            // Angles at confirmation (degrees)
+    float pitchChange, rollChange;     // Change from the calibrated baseline (degrees)
+    uint32_t samplesSinceImpact;       // Samples between the impact and confirmation
+    FallFeatures features;             // Classifier inputs (zero if the classifier is off)
+    int32_t classifierScore;           // Classifier logit, >= 0 for a fall
+} FallDetection;
+
+// Where the person is after a confirmed fall
+typedef struct {
+    uint32_t downMs;                   // Time since the fall was confirmed
+    uint32_t motionlessMs;             // Time since the last movement
+    int escalations;                   // Escalations raised so far
+    bool upright;                      // Currently within uprightAngle of resting
+} PostFallStatus;
+
+class FallDetector {
+public:
+    /**
+     * @param sampleRateHz Rate of the samples passed to processSample()
+     */
+    explicit FallDetector(int sampleRateHz);
+
+    /**
+     * @return The thresholds the detector ships with
+     */
+    static FallDetectorConfig defaultConfig();
+
+    void setConfig(const FallDetectorConfig &config);
+    const FallDetectorConfig &getConfig() const { return config; }
+
+    /**
+     * Return to monitoring and clear all state except the calibration
+     */
+    void reset();
+
+    /**
+     * Set the resting attitude and gyro offset from averaged samples at rest
+     *
+     * @param ax, ay, az Mean acceleration (m/s^2)
+     * @param gx, gy, gz Mean angular rate (rad/s)
+     */
+    void calibrate(float ax, float ay, float az, float gx, float gy, float gz);
+
+    /**
+     * Feed one IMU sample
+     *
+     * @param ax, ay, az Acceleration (m/s^2)
+     * @param gx, gy, gz Angular rate (rad/s)
+     * @param timeMs Time of the sample on the sample clock
+     * @param detection Filled in when a fall is confirmed or rejected (may be NULL)
+     * @return What this sample changed
+     */
+    FallDetectorResult processSample(float ax, float ay, float az,
+                                     float gx, float gy, float gz,
+                                     uint32_t timeMs, FallDetection *detection);
+
+    /**
+     * @param status Filled with the post-fall tracking state (only
+     *               meaningful in FALL_CONFIRMED)
+     */
+    void getPostFallStatus(PostFallStatus *status) const;
+
+    FallDetectorState getState() const { return state; }
+    const OrientationFilter &getOrientationFilter() const { return orientationFilter; }
+
+private:
+    int sampleRateHz;
+    FallDetectorConfig config;
+    OrientationFilter orientationFilter;
+
+    // Calibrated resting angles and gravity direction
+    float baselinePitch;
+    float baselineRoll;
+    float baselineGravity[3];
+
+    FallDetectorState state;
+    uint32_t stateStartTime;
+    uint32_t fallDetectedTime;
+    uint32_t sampleCount;
+    uint32_t impactSample;
+    uint32_t impactTime;
+
+    float peakAcceleration;
+    float minAcceleration;
+    float accelerationIntegral;
+    int consecutiveImpacts;
+
+    // Classifier feature accumulators over the candidate window
+    float previousAccMagnitude;
+    float smaSum;
+    uint32_t windowSamples;
+    float peakJerk;
+    float stillSum;
+    float stillSumSquares;
+    uint32_t stillSamples;
+
+    // Post-fall tracking
+    float uprightCos;                  // cos(uprightAngle), so no trig per sample
+    uint32_t lastSampleTime;
+    bool upright;
+    uint32_t uprightSince;
+    uint32_t lastMovementTime;
+    uint32_t lastEscalationTime;
+    int escalations;
+    float motionSum;
+    float motionSumSquares;
+    uint32_t motionSamples;
+    uint32_t motionBlockStart;
+
+    void startFeatureWindow();
+    void computeFeatures(FallFeatures *features) const;
+    void fillDetection(FallDetection *detection, const FallFeatures &features, int32_t score) const;
+    void startFreefall(uint32_t timeMs, float accMagnitude);
+    void confirmFall(uint32_t timeMs);
+    FallDetectorResult trackPostFall(float accMagnitude, uint32_t timeMs);
+};
+
+#endif // FALL_DETECTOR_H
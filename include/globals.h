@@ -1,7 +1,7 @@
 /**
- * ElderGuard - Global Variables and Semaphores
+ * ElderGuard - Global Variables and Event Topics
  * 
- * This file contains all global variables and semaphores used for
+ * This file contains the shared state snapshots and event topics used for
  * communication between tasks in the ElderGuard system.
  */
 
@@ -9,31 +9,18 @@
 #define GLOBALS_H
 
 #include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
 #include "config.h"
+#include "event_bus.h"
+#include "seqlock.h"
 
-// Semaphores for task synchronization
-extern SemaphoreHandle_t displayMutex;
-extern SemaphoreHandle_t ecgDataSemaphore;
-extern SemaphoreHandle_t gpsDataSemaphore;
-extern SemaphoreHandle_t fallDetectionSemaphore;
-extern SemaphoreHandle_t medicationSemaphore;
-extern SemaphoreHandle_t audioCommandSemaphore;
-extern SemaphoreHandle_t wifiStatusSemaphore;
-extern SemaphoreHandle_t timeStatusSemaphore;
-extern SemaphoreHandle_t telegramAlertSemaphore; // New semaphore for Telegram alerts
-
-// Shared ECG Data
-extern volatile EcgData currentEcgData;
-extern volatile bool ecgDataUpdated;
-
-// Shared GPS Data
-extern volatile GpsData currentGpsData;
-extern volatile bool gpsDataUpdated;
-
-// Shared Fall Detection Data
-extern volatile FallEvent currentFallEvent;
-extern volatile bool fallDetectionUpdated;
+// Latest-value snapshots for readers that need current state on demand.
+// Each has a single writer (the owning task) and never blocks it.
+// Changes are announced through the topics further down.
+extern SeqLock<EcgData> currentEcgData;        // Written by the ECG task
+extern SeqLock<GpsData> currentGpsData;        // Written by the GPS task
+extern SeqLock<FallEvent> currentFallEvent;    // Written by the fall detection task
+extern SeqLock<WiFiStatus> currentWiFiStatus;  // Written by the WiFi task
+extern SeqLock<TimeStatus> currentTimeStatus;  // Written by the time task
 
 // Upcoming Medication Information
 typedef struct {
@@ -42,34 +29,81 @@ typedef struct {
     bool available;        // Whether there is an upcoming medication
 } UpcomingMedication;
 
+// What an alert is about; decides how urgently the HTTP task delivers it
+typedef enum {
+    ALERT_FALL,            // Fall detected, escalated or cancelled
+    ALERT_HEALTH,          // Abnormal heart rate
+    ALERT_NOTICE           // Medication reminders and other notices
+} AlertKind;
+
 // Telegram Alert Structure
 typedef struct {
     char message[256];     // Message text
     bool hasFallLocation;  // Whether to include location data with message
-    bool pending;          // Whether the message needs to be sent
+    AlertKind kind;
 } TelegramAlert;
 
-// Shared Telegram Alert Data
-extern volatile TelegramAlert currentTelegramAlert;
-extern volatile bool telegramAlertUpdated;
+// A finished pre/post-impact IMU capture. The blob itself stays in
+// impactRecorder; each subscriber must call impactRecorder.releaseBlob()
+// once it is done with it.
+typedef struct {
+    uint32_t captureId;    // Matches the id in the blob header
+    unsigned long timestamp; // Timestamp of the fall event it belongs to
+    int length;            // Blob length in bytes
+} ImpactCapture;
 
-// Shared Medication Data
-extern volatile MedicationReminder currentMedicationReminder;
-extern volatile bool medicationReminderUpdated;
-extern volatile UpcomingMedication upcomingMedication;
-extern volatile bool upcomingMedicationUpdated;
+// Task notification bits set by the topics below
+#define EVENT_ECG_DATA            (1 << 0)
+#define EVENT_GPS_DATA            (1 << 1)
+#define EVENT_FALL                (1 << 2)
+#define EVENT_TELEGRAM_ALERT      (1 << 3)
+#define EVENT_MEDICATION          (1 << 4)
+#define EVENT_UPCOMING_MEDICATION (1 << 5)
+#define EVENT_WIFI_STATUS         (1 << 6)
+#define EVENT_IMPACT_CAPTURE      (1 << 7)
 
-// Shared Audio Command Data
-extern volatile AudioCommand currentAudioCommand;
-extern volatile bool audioCommandUpdated;
+// Queue depth of each subscriber, by topic. Subscribers pass these to
+// subscribe(); the topics below are sized from them.
+#define ECG_QUEUE_SCREEN 1
+#define ECG_QUEUE_HTTP 2
+#define ECG_QUEUE_MQTT 4
+#define GPS_QUEUE_SCREEN 1
+#define GPS_QUEUE_HTTP 2
+#define GPS_QUEUE_MQTT 4
+#define FALL_QUEUE_SCREEN 2
+#define TELEGRAM_QUEUE_HTTP 6
+#define MEDICATION_QUEUE_SCREEN 2
+#define UPCOMING_MEDICATION_QUEUE_SCREEN 1
+#define AUDIO_QUEUE_AUDIO 4
+#define WIFI_QUEUE_SCREEN 1
+#define WIFI_QUEUE_TIME 1
+#define WIFI_QUEUE_HTTP 1
+#define WIFI_QUEUE_MQTT 1
+#define IMPACT_QUEUE_HTTP 2
+#define IMPACT_QUEUE_MQTT 2
 
-// Shared WiFi Status Data
-extern volatile WiFiStatus currentWiFiStatus;
-extern volatile bool wifiStatusUpdated;
+// Event topics: EventTopic<message, slots, max subscribers>. Slots come from
+// eventTopicSlots() over the depths above, and max subscribers is exactly
+// the subscribers counted, so publish() always finds a free slot.
+typedef EventTopic<EcgData, eventTopicSlots(ECG_QUEUE_SCREEN + ECG_QUEUE_HTTP + ECG_QUEUE_MQTT, 3), 3> EcgTopic;
+typedef EventTopic<GpsData, eventTopicSlots(GPS_QUEUE_SCREEN + GPS_QUEUE_HTTP + GPS_QUEUE_MQTT, 3), 3> GpsTopic;
+typedef EventTopic<FallEvent, eventTopicSlots(FALL_QUEUE_SCREEN, 1), 1> FallTopic;
+typedef EventTopic<TelegramAlert, eventTopicSlots(TELEGRAM_QUEUE_HTTP, 1), 1> TelegramAlertTopic;
+typedef EventTopic<MedicationReminder, eventTopicSlots(MEDICATION_QUEUE_SCREEN, 1), 1> MedicationTopic;
+typedef EventTopic<UpcomingMedication, eventTopicSlots(UPCOMING_MEDICATION_QUEUE_SCREEN, 1), 1> UpcomingMedicationTopic;
+typedef EventTopic<AudioCommand, eventTopicSlots(AUDIO_QUEUE_AUDIO, 1), 1> AudioCommandTopic;
+typedef EventTopic<WiFiStatus, eventTopicSlots(WIFI_QUEUE_SCREEN + WIFI_QUEUE_TIME + WIFI_QUEUE_HTTP + WIFI_QUEUE_MQTT, 4), 4> WiFiStatusTopic;
+typedef EventTopic<ImpactCapture, eventTopicSlots(IMPACT_QUEUE_HTTP + IMPACT_QUEUE_MQTT, 2), 2> ImpactCaptureTopic;
 
-// Shared Time Status Data
-extern volatile TimeStatus currentTimeStatus;
-extern volatile bool timeStatusUpdated;
+extern EcgTopic ecgTopic;                             // ECG task -> MQTT, HTTP, screen
+extern GpsTopic gpsTopic;                             // GPS task -> MQTT, HTTP, screen
+extern FallTopic fallTopic;                           // Fall detection -> screen
+extern TelegramAlertTopic telegramAlertTopic;         // Fall detection, ECG, medication -> HTTP
+extern MedicationTopic medicationTopic;               // Medication -> screen
+extern UpcomingMedicationTopic upcomingMedicationTopic; // Medication -> screen
+extern AudioCommandTopic audioCommandTopic;           // Fall detection, medication -> audio
+extern WiFiStatusTopic wifiStatusTopic;               // WiFi -> screen, MQTT, HTTP, time
+extern ImpactCaptureTopic impactCaptureTopic;         // Fall detection -> MQTT, HTTP
 
 // Flag for display update requests
 extern volatile bool needsDisplayUpdate;
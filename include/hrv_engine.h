@@ -0,0 +1,81 @@
+/**
+ * ElderGuard - Heart Rate Variability Engine
+ *
+ * Time-domain HRV (SDNN, RMSSD, pNN50) over a sliding window of RR
+ * intervals. Exact integer running sums are updated as intervals enter and
+ * leave the window, so every update is O(1). No Arduino or FreeRTOS
+ * dependencies.
+ */
+
+#ifndef HRV_ENGINE_H
+#define HRV_ENGINE_H
+
+#include <stdint.h>
+
+#define HRV_MIN_WINDOW_MS 60000          // Shortest supported window (1 minute)
+#define HRV_MAX_WINDOW_MS 300000         // Longest supported window (5 minutes)
+#define HRV_MAX_INTERVALS 1000           // 5 minutes at the 300ms minimum RR interval
+
+// HRV metrics for the current window
+typedef struct {
+    float sdnn;            // Standard deviation of RR intervals (ms)
+    float rmssd;           // Root mean square of successive differences (ms)
+    float pnn50;           // Percentage of successive differences over 50ms
+    int intervals;         // RR intervals in the window
+} HrvMetrics;
+
+class HrvEngine {
+public:
+    /**
+     * @param windowMs Window length, clamped to 1-5 minutes
+     */
+    explicit HrvEngine(uint32_t windowMs);
+
+    /**
+     * Drop all intervals
+     */
+    void reset();
+
+    /**
+     * Add a validated RR interval
+     *
+     * @param beatTimeMs Time of the beat that ends the interval
+     * @param rrInterval Interval to the previous beat in ms
+     */
+    void addInterval(uint32_t beatTimeMs, uint32_t rrInterval);
+
+    /**
+     * Evict intervals older than the window
+     *
+     * @param nowMs Current time on the same clock as the beat times
+     */
+    void expire(uint32_t nowMs);
+
+    /**
+     * @param metrics Filled with the metrics for the current window
+     */
+    void getMetrics(HrvMetrics *metrics) const;
+
+    int getIntervalCount() const { return count; }
+
+private:
+    uint32_t windowMs;
+
+    // Ring of intervals, oldest at head
+    uint32_t beatTimes[HRV_MAX_INTERVALS];
+    uint16_t rrIntervals[HRV_MAX_INTERVALS];
+    bool followsPrevious[HRV_MAX_INTERVALS];   // Interval directly follows the one before it
+    int head;
+    int count;
+
+    // Running sums
+    uint32_t sumRR;
+    uint64_t sumSquaresRR;
+    uint64_t sumSquaredDiffs;
+    int diffCount;
+    int nn50Count;
+
+    void evictOldest();
+};
+
+#endif // HRV_ENGINE_H
@@ -0,0 +1,58 @@
+/**
+ * ElderGuard - HTTP/1.1 Request Framing
+ *
+ * Builds a POST request in one fixed arena. The body slot follows the head
+ * slot and the head is formatted against the start of the body, so head
+ * and body go out in one write: one TLS record, one segment. A body built
+ * elsewhere is copied in when it fits; a larger one follows the head in a
+ * second write. Nothing is allocated. No Arduino or FreeRTOS dependencies.
+ */
+
+#ifndef HTTP_REQUEST_H
+#define HTTP_REQUEST_H
+
+#include <stdint.h>
+
+#define HTTP_REQUEST_HEAD_MAX 384        // Request line and headers
+#define HTTP_REQUEST_BODY_MAX 768        // JSON bodies, and smaller bodies copied in
+
+class HttpRequest {
+public:
+    HttpRequest();
+
+    /**
+     * @return The body slot, for building a body in place
+     */
+    char *getBody() { return &arena[HTTP_REQUEST_HEAD_MAX]; }
+
+    /**
+     * Frame a POST request
+     *
+     * @param host Host header
+     * @param path Path on that host
+     * @param contentType Content-Type of the body
+     * @param extraHeaders Further header lines, each ending in CRLF, or NULL
+     * @param body Request body, in the body slot or anywhere else
+     * @param length Bytes in body
+     * @return false if the headers do not fit in HTTP_REQUEST_HEAD_MAX
+     */
+    bool frame(const char *host, const char *path, const char *contentType,
+               const char *extraHeaders, const uint8_t *body, int length);
+
+    // First write: the head, and the body with it when it is in the arena
+    const uint8_t *getData() const { return data; }
+    int getDataLength() const { return dataLength; }
+
+    // Second write: a body too large for the arena, or NULL
+    const uint8_t *getTail() const { return tail; }
+    int getTailLength() const { return tailLength; }
+
+private:
+    char arena[HTTP_REQUEST_HEAD_MAX + HTTP_REQUEST_BODY_MAX];
+    const uint8_t *data;
+    int dataLength;
+    const uint8_t *tail;
+    int tailLength;
+};
+
+#endif // HTTP_REQUEST_H
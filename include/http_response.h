@@ -0,0 +1,88 @@
+/**
+ * ElderGuard - HTTP/1.1 Response Parser
+ *
+ * Follows a response as it is read from a kept-alive connection: the status
+ * line, the headers that decide framing and reuse (Content-Length,
+ * Transfer-Encoding: chunked, Connection), and the body, of which the start
+ * is kept in a caller's buffer for logging. Works on fixed buffers only, so
+ * a request allocates nothing. No Arduino or FreeRTOS dependencies.
+ */
+
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <stdint.h>
+
+#define HTTP_LINE_MAX 96                 // Longer header lines are cut; only short ones are read
+
+class HttpResponseParser {
+public:
+    HttpResponseParser();
+
+    /**
+     * Start on a new response
+     *
+     * @param body Receives the start of the body, always terminated
+     * @param bodyCapacity Size of body
+     */
+    void begin(char *body, int bodyCapacity);
+
+    /**
+     * Follow bytes read from the connection
+     *
+     * @param data Bytes in the order they were read
+     * @param length Number of bytes
+     * @return Bytes used; fewer than length if the response ended first
+     */
+    int feed(const uint8_t *data, int length);
+
+    /**
+     * The server closed the connection. This ends a body that runs until
+     * close; anywhere else the response is incomplete.
+     */
+    void closed();
+
+    bool isDone() const { return state == STATE_DONE; }
+    bool hasError() const { return state == STATE_ERROR; }
+
+    int getStatus() const { return status; }
+
+    /**
+     * @return Whether the connection can carry another request
+     */
+    bool isKeepAlive() const { return keepAlive; }
+
+private:
+    enum State {
+        STATE_STATUS_LINE,
+        STATE_HEADERS,
+        STATE_BODY,                      // contentLength bytes
+        STATE_BODY_UNTIL_CLOSE,
+        STATE_CHUNK_SIZE,
+        STATE_CHUNK_DATA,
+        STATE_CHUNK_END,                 // CRLF after a chunk's data
+        STATE_TRAILERS,
+        STATE_DONE,
+        STATE_ERROR
+    };
+
+    State state;
+    int status;
+    bool keepAlive;
+    bool chunked;
+    long contentLength;                  // -1 when not given
+    long remaining;                      // Body or chunk bytes still to come
+
+    char line[HTTP_LINE_MAX];
+    int lineLength;
+
+    char *body;
+    int bodyCapacity;
+    int bodyLength;
+
+    void handleLine();
+    void endHeaders();
+    void keepBody(const uint8_t *data, int length);
+};
+
+#endif // HTTP_RESPONSE_H
@@ -12,13 +12,35 @@
 #include "config.h"
 #include "globals.h"
 
+// Connection reuse counters for one host
+typedef struct {
+    uint32_t requests;           // Requests started on the host
+    uint32_t handshakes;         // Successful TLS handshakes
+    uint32_t handshakeFailures;  // Connection attempts that failed
+    unsigned long lastHandshakeMs;
+    unsigned long worstHandshakeMs;
+    unsigned long totalHandshakeMs;
+} HttpConnectionStats;
+
 // Main HTTP task function
 void httpTask(void *pvParameters);
 
 // Data sending functions
-void sendSensorData();
-void sendHeartRateAlert(int heartRate);
-void sendLocationData();
-void sendTelegramMessage(const char* message);  // Added declaration for Telegram function
+// One attempt each; false means the request should be retried
+bool sendSensorData();
+bool sendHeartRateAlert(int heartRate, uint32_t recordedAt); // recordedAt: unix time raised, 0 = now
+bool sendLocationData();
+bool sendTelegramMessage(const char* message);  // Added declaration for Telegram function
+
+/**
+ * @param host 0 for the ElderGuard backend, 1 for the Telegram API
+ * @param stats Filled with that host's connection counters
+ */
+void getHttpConnectionStats(int host, HttpConnectionStats *stats);
+
+/**
+ * Print each host's connection counters and the outbox counters
+ */
+void printHttpDiagnostics();
 
 #endif // HTTP_TASK_H
\ No newline at end of file
@@ -0,0 +1,129 @@
+/**
+ * ElderGuard - Impact Recorder
+ *
+ * Keeps the most recent IMU samples in a fixed ring. When a fall is
+ * confirmed the window from preMs before the impact to postMs after it is
+ * frozen and, once the post-impact samples are in, delta encoded into a
+ * preallocated blob for upload. Nothing is allocated after construction.
+ * No Arduino or FreeRTOS dependencies.
+ *
+ * Blob layout (little-endian):
+ *   0  "EGIC"                   magic
+ *   4  uint8  version (1)
+ *   5  uint8  axes (6: accel x/y/z, gyro x/y/z)
+ *   6  uint16 sample rate (Hz)
+ *   8  uint16 samples in the window
+ *   10 uint16 index of the impact sample
+ *   12 uint16 accelerometer LSB per g
+ *   14 uint16 gyro LSB per 10 deg/s
+ *   16 uint32 fall timestamp (ms, matches FallEvent.timestamp)
+ *   20 uint32 capture id
+ *   24 int16 x 6 first sample, then for every later sample and axis the
+ *      difference to the previous sample as a zigzag LEB128 varint
+ */
+
+#ifndef IMPACT_RECORDER_H
+#define IMPACT_RECORDER_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define IMPACT_AXES 6
+#define IMPACT_RING_CAPACITY 1024        // Samples held (power of two), 5.12s at 200Hz
+#define IMPACT_HEADER_BYTES 24
+#define IMPACT_MAX_DELTA_BYTES 3         // A 17-bit zigzag delta needs at most three varint bytes
+#define IMPACT_BLOB_MAX_BYTES (IMPACT_HEADER_BYTES + IMPACT_AXES * 2 + \
+                               (IMPACT_RING_CAPACITY - 1) * IMPACT_AXES * IMPACT_MAX_DELTA_BYTES)
+
+// One IMU sample in raw sensor counts: accel x/y/z, gyro x/y/z
+typedef struct {
+    int16_t axes[IMPACT_AXES];
+} ImpactSample;
+
+class ImpactRecorder {
+public:
+    /**
+     * @param sampleRateHz Rate of the samples passed to addSample()
+     * @param preMs Window kept before the impact
+     * @param postMs Window recorded after the impact
+     * @param accelLsbPerG Accelerometer scale, stored in the blob header
+     * @param gyroLsbPer10Dps Gyro scale, stored in the blob header
+     */
+    ImpactRecorder(int sampleRateHz, int preMs, int postMs,
+                   uint16_t accelLsbPerG, uint16_t gyroLsbPer10Dps);
+
+    /**
+     * Append one sample (recording task only)
+     *
+     * @return true if this sample completed a capture and the blob is ready
+     */
+    bool addSample(const ImpactSample &sample);
+
+    /**
+     * @return Number of samples added so far; used to mark the impact
+     */
+    uint32_t getSampleCount() const { return head; }
+
+    /**
+     * Freeze the window around an impact (recording task only)
+     *
+     * @param impactSample Index of the impact sample (getSampleCount() - 1 right after adding it)
+     * @param timestampMs Fall timestamp written to the blob header
+     * @return false if a capture is already running or the last blob is still held
+     */
+    bool trigger(uint32_t impactSample, uint32_t timestampMs);
+
+    /**
+     * Hand the finished blob to readers. It is not overwritten until every
+     * reader has called releaseBlob().
+     *
+     * @param readers Number of releaseBlob() calls expected
+     */
+    void holdBlob(int readers);
+
+    /**
+     * @param length Receives the blob length in bytes
+     * @return The finished blob; only valid between holdBlob() and the
+     *         reader's releaseBlob()
+     */
+    const uint8_t *getBlob(int *length) const;
+
+    /**
+     * Give up one reader's hold on the blob
+     */
+    void releaseBlob();
+
+    // Captures completed, and triggers ignored because one was running or held
+    uint32_t getCaptureCount() const { return captureId; }
+    uint32_t getMissedCount() const { return missed; }
+
+private:
+    static const uint32_t MASK = IMPACT_RING_CAPACITY - 1;
+    static_assert((IMPACT_RING_CAPACITY & MASK) == 0, "IMPACT_RING_CAPACITY must be a power of two");
+
+    ImpactSample ring[IMPACT_RING_CAPACITY];
+    uint32_t head;
+
+    int sampleRateHz;
+    uint32_t preSamples;
+    uint32_t postSamples;
+    uint16_t accelLsbPerG;
+    uint16_t gyroLsbPer10Dps;
+
+    // Capture in progress
+    bool capturing;
+    uint32_t windowStart;
+    uint32_t windowEnd;
+    uint32_t impactIndex;
+    uint32_t timestampMs;
+
+    uint8_t blob[IMPACT_BLOB_MAX_BYTES];
+    int blobLength;
+    std::atomic<int> holders;
+    uint32_t captureId;
+    uint32_t missed;
+
+    void encode();
+};
+
+#endif // IMPACT_RECORDER_H
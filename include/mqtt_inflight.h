@@ -0,0 +1,125 @@
+/**
+ * ElderGuard - MQTT QoS 1 In-Flight Window
+ *
+ * Keeps QoS 1 PUBLISH packets until the broker acknowledges them, for an
+ * MQTT client that only speaks QoS 0 itself. Packets are encoded here and
+ * written to the socket by the caller; every byte read from the socket is
+ * fed back through receive(), which follows the packet framing and picks
+ * out the PUBACKs. Unacknowledged packets are sent again with the DUP flag
+ * after a reconnect (with a persistent session) or after retryMs. The
+ * window is bounded: when it is full add() refuses, it never waits. A
+ * message too large for MQTT_INFLIGHT_MAX_PACKET is refused separately,
+ * since waiting for a free slot will not help it. No Arduino or FreeRTOS
+ * dependencies.
+ */
+
+#ifndef MQTT_INFLIGHT_H
+#define MQTT_INFLIGHT_H
+
+#include <stdint.h>
+
+#define MQTT_INFLIGHT_WINDOW 4           // Unacknowledged packets at most
+#define MQTT_INFLIGHT_MAX_PACKET 1024    // Encoded PUBLISH size limit (header, topic, payload)
+
+/**
+ * @param topicLength Topic name bytes
+ * @param payloadLength Payload bytes
+ * @return Encoded size of a QoS 1 PUBLISH: fixed header, topic, packet id and payload
+ */
+constexpr int mqttPublishPacketBytes(int topicLength, int payloadLength) {
+    return 1 + (4 + topicLength + payloadLength < 128 ? 1 : 4 + topicLength + payloadLength < 16384 ? 2 : 3) +
+           4 + topicLength + payloadLength;
+}
+
+// Outcome of MqttInflightWindow::add()
+typedef enum {
+    MQTT_INFLIGHT_ADDED,
+    MQTT_INFLIGHT_FULL,                  // No free slot until a PUBACK arrives; try again later
+    MQTT_INFLIGHT_TOO_LARGE              // Can never fit MQTT_INFLIGHT_MAX_PACKET; drop or split it
+} MqttInflightResult;
+
+class MqttInflightWindow {
+public:
+    /**
+     * @param retryMs Time without a PUBACK after which a packet is sent again
+     */
+    MqttInflightWindow(uint32_t retryMs);
+
+    /**
+     * Encode a QoS 1 PUBLISH into a free slot. The caller writes it out.
+     *
+     * @param topic Topic name
+     * @param payload Message payload
+     * @param length Payload bytes
+     * @param nowMs Current time
+     * @param packet Receives the packet when it was added
+     * @param packetLength Receives the encoded length
+     * @return MQTT_INFLIGHT_ADDED, or why it was not
+     */
+    MqttInflightResult add(const char *topic, const uint8_t *payload, int length, uint32_t nowMs,
+                           const uint8_t **packet, int *packetLength);
+
+    /**
+     * Take the next packet that has to be sent again, with DUP set
+     *
+     * @param nowMs Current time
+     * @param packetLength Receives the packet length
+     * @return The packet, or NULL if none is due
+     */
+    const uint8_t *nextRetransmit(uint32_t nowMs, int *packetLength);
+
+    /**
+     * Start of a new connection: every unacknowledged packet is due again
+     * and the incoming packet framing restarts
+     */
+    void reconnected();
+
+    /**
+     * Follow bytes received from the broker
+     *
+     * @param data Bytes in the order they were read
+     * @param length Number of bytes
+     * @param nowMs Current time
+     */
+    void receive(const uint8_t *data, int length, uint32_t nowMs);
+
+    bool isFull() const { return count == MQTT_INFLIGHT_WINDOW; }
+    int getCount() const { return count; }
+
+    // Packets acknowledged and sent again; slowest PUBACK after the first send
+    uint32_t getAckedCount() const { return acked; }
+    uint32_t getRetransmitCount() const { return retransmits; }
+    uint32_t getWorstAckMs() const { return worstAckMs; }
+
+private:
+    struct Slot {
+        bool used;
+        bool due;                        // Send again at the next nextRetransmit()
+        uint16_t packetId;
+        uint32_t firstSentMs;
+        uint32_t lastSentMs;
+        int length;
+        uint8_t packet[MQTT_INFLIGHT_MAX_PACKET];
+    };
+
+    Slot slots[MQTT_INFLIGHT_WINDOW];
+    int count;
+    uint32_t retryMs;
+    uint16_t nextPacketId;
+
+    // Incoming packet framing
+    uint8_t packetType;
+    uint32_t remaining;
+    int lengthShift;
+    int state;
+    uint8_t body[2];
+    int bodyFill;
+
+    uint32_t acked;
+    uint32_t retransmits;
+    uint32_t worstAckMs;
+
+    void acknowledge(uint16_t packetId, uint32_t nowMs);
+};
+
+#endif // MQTT_INFLIGHT_H
@@ -3,6 +3,19 @@
  * 
  * Defines the MQTT task and related functions for sending telemetry
  * data to the cloud.
+ *
+ * With MQTT_ECG_FRAMES the ECG goes to the realtime topic as binary frames,
+ * one every MQTT_ECG_FRAME_MS. JSON messages on the topic start with '{',
+ * frames with their type byte. Frame layout (little-endian):
+ *   0  uint8  frame type (1 = ECG)
+ *   1  uint8  flags: bit 0 set if the signal is valid
+ *   2  uint16 heart rate (BPM)
+ *   4  uint32 time the frame was sent (Unix seconds)
+ *   8  uint16 SDNN (0.1 ms)
+ *   10 uint16 RMSSD (0.1 ms)
+ *   12 uint16 pNN50 (0.1 %)
+ *   14 uint16 RR intervals behind the HRV values
+ *   16 one ECG stream block of the frame's samples (see ecg_stream.h)
  */
 
 #ifndef MQTT_TASK_H
@@ -10,6 +23,22 @@
 
 #include <Arduino.h>
 
+// Counters for the realtime topic
+typedef struct {
+    uint32_t published;          // Messages sent
+    uint32_t failed;             // Publish calls that failed
+    uint32_t bytes;              // Payload bytes sent
+    uint32_t frames;             // ECG frames encoded, sent or not
+    uint32_t acked;              // QoS 1 messages acknowledged by the broker
+    uint32_t retransmits;        // QoS 1 messages sent again
+    int inflight;                // QoS 1 messages awaiting a PUBACK
+    uint32_t worstAckMs;         // Slowest PUBACK after the first send
+    uint32_t oversize;           // QoS 1 messages dropped as too large for a packet
+    unsigned long lastPublishMs; // Time spent in the last publish call
+    unsigned long worstPublishMs;
+    unsigned long totalPublishMs;
+} MqttPublishStats;
+
 // Function prototypes
 void mqttTask(void *pvParameters);
 void setupMqtt();
@@ -18,5 +47,12 @@ void publishStatusUpdate(bool forceUpdate);
 void publishEcgData();
 void publishGpsData();
 void publishFallData();
+void publishImpactCapture();
+void replayMqttOutbox();
+
+/**
+ * @param stats Filled with the realtime topic counters
+ */
+void getMqttPublishStats(MqttPublishStats *stats);
 
 #endif // MQTT_TASK_H
\ No newline at end of file
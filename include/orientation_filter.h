@@ -0,0 +1,85 @@
+/**
+ * ElderGuard - IMU Orientation Filter
+ *
+ * Madgwick gradient-descent fusion of gyroscope and accelerometer into a
+ * unit quaternion. The gyro is integrated every sample; the accelerometer
+ * only pulls the estimate back towards gravity while its magnitude is close
+ * to 1 g, so free fall and impacts do not corrupt the attitude. The update
+ * uses a fast inverse square root and no trigonometry; angles are derived
+ * from the quaternion only when asked for. No Arduino or FreeRTOS
+ * dependencies.
+ */
+
+#ifndef ORIENTATION_FILTER_H
+#define ORIENTATION_FILTER_H
+
+#include <stdint.h>
+
+#define ORIENTATION_DEFAULT_BETA 0.1f    // Accelerometer correction gain (rad/s)
+#define ORIENTATION_ACCEL_GATE 0.25f     // Accelerometer trusted within 1 g +/- this fraction
+
+// Tilt angles in degrees, same conventions as the accelerometer-only angles
+typedef struct {
+    float pitch;           // atan2(x, sqrt(y^2 + z^2)) of the gravity direction
+    float roll;            // atan2(y, sqrt(x^2 + z^2)) of the gravity direction
+    float yaw;             // Angle between the sensor z axis and vertical
+} OrientationAngles;
+
+class OrientationFilter {
+public:
+    /**
+     * @param sampleRateHz Rate of the samples passed to update()
+     * @param beta Accelerometer correction gain
+     */
+    explicit OrientationFilter(int sampleRateHz, float beta = ORIENTATION_DEFAULT_BETA);
+
+    /**
+     * Align the estimate with a gravity reading, with zero heading
+     *
+     * @param ax, ay, az Accelerometer reading at rest (any units)
+     */
+    void reset(float ax, float ay, float az);
+
+    /**
+     * @param bx, by, bz Gyro offset subtracted from every sample (rad/s)
+     */
+    void setGyroBias(float bx, float by, float bz);
+
+    /**
+     * Fuse one IMU sample
+     *
+     * @param gx, gy, gz Angular rate (rad/s)
+     * @param ax, ay, az Acceleration (m/s^2)
+     */
+    void update(float gx, float gy, float gz, float ax, float ay, float az);
+
+    /**
+     * @param angles Filled with the tilt angles of the current estimate
+     */
+    void getAngles(OrientationAngles *angles) const;
+
+    /**
+     * @param gx, gy, gz Receive the unit gravity direction in the sensor frame
+     */
+    void getGravity(float *gx, float *gy, float *gz) const;
+
+    /**
+     * @return Samples where the accelerometer was outside the gate and only
+     *         the gyro was integrated
+     */
+    uint32_t getGyroOnlySamples() const { return gyroOnlySamples; }
+
+    float getQ0() const { return q0; }
+    float getQ1() const { return q1; }
+    float getQ2() const { return q2; }
+    float getQ3() const { return q3; }
+
+private:
+    float samplePeriod;
+    float beta;
+    float q0, q1, q2, q3;
+    float biasX, biasY, biasZ;
+    uint32_t gyroOnlySamples;
+};
+
+#endif // ORIENTATION_FILTER_H
@@ -0,0 +1,164 @@
+/**
+ * ElderGuard - Store-and-Forward Outbox
+ *
+ * Append-only log of records that could not be sent, kept on flash until
+ * they can be replayed. The log is a series of segment files named
+ * <prefix><8 hex digits>; a full segment is closed and a new one started,
+ * and once replayed a segment is deleted whole, so no file is ever
+ * rewritten. When the log reaches its size cap the oldest segment is
+ * dropped. Records are collected in a RAM page and written a full page at
+ * a time; append(durable) and seal() pad out and write a partial page.
+ *
+ * Only sealed segments are replayed. Replay is at-least-once: records are
+ * read, sent, then committed; after a reboot the oldest segment is read
+ * again from its start.
+ *
+ * Uses C stdio on a VFS mount (SPIFFS at /spiffs on the device), so there
+ * are no Arduino or FreeRTOS dependencies. Single owner; not thread-safe.
+ *
+ * Every record carries the time it was appended, on a clock chosen by the
+ * caller, so a replay can tell how stale it is.
+ *
+ * Record layout (little-endian):
+ *   0  uint8  marker (0xA6); 0xFF marks padding to the next page
+ *   1  uint8  type (caller defined, 0-254)
+ *   2  uint16 payload length
+ *   4  uint32 CRC-32 of type, length, creation time and payload
+ *   8  uint32 creation time (0 = unknown)
+ *   12 payload
+ *
+ * Records with marker 0xA5, written before the creation time was added,
+ * have an 8-byte header without it and are read back with time 0.
+ */
+
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define OUTBOX_PAGE_BYTES 256            // SPIFFS logical page
+#define OUTBOX_RECORD_HEADER_BYTES 12
+#define OUTBOX_PATH_MAX 48
+
+class Outbox {
+public:
+    /**
+     * @param directory Mount point to keep the segments in (e.g. "/spiffs")
+     * @param prefix File name prefix, unique per outbox
+     * @param segmentBytes Size at which a segment is closed (multiple of OUTBOX_PAGE_BYTES)
+     * @param maxSegments Segments kept before the oldest is dropped
+     */
+    Outbox(const char *directory, const char *prefix, int segmentBytes, int maxSegments);
+
+    /**
+     * Find segments left by an earlier run. Call once the file system is
+     * mounted.
+     *
+     * @return false if the directory cannot be read
+     */
+    bool begin();
+
+    /**
+     * Append a record
+     *
+     * @param type Record type
+     * @param data Payload
+     * @param length Payload bytes
+     * @param durable Write the partial page now rather than when it fills
+     * @param createdAt Creation time on the caller's clock, 0 if unknown
+     * @return false if the record is too large or the write failed
+     */
+    bool append(uint8_t type, const void *data, int length, bool durable, uint32_t createdAt);
+
+    /**
+     * Write out and close the segment being appended to, making everything
+     * appended so far available to read()
+     */
+    void seal();
+
+    /**
+     * @return true if sealed records are waiting to be replayed
+     */
+    bool hasBacklog();
+
+    /**
+     * @return true if records were appended since the last seal()
+     */
+    bool hasUnsealed() const { return writeFile != NULL; }
+
+    /**
+     * Look at the next sealed record without reading it
+     *
+     * @param type Receives the record type
+     * @return Payload length, or -1 if there is none
+     */
+    int peek(uint8_t *type);
+
+    /**
+     * Read the next sealed record. It stays in the log until commit().
+     *
+     * @param type Receives the record type
+     * @param out Receives the payload
+     * @param maxLength Capacity of out
+     * @return Payload length, -1 if there is none, -2 if it does not fit in out
+     */
+    int read(uint8_t *type, uint8_t *out, int maxLength);
+
+    /**
+     * @return Creation time of the record last returned by read(), 0 if unknown
+     */
+    uint32_t getCreatedAt() const { return readCreatedAt; }
+
+    /**
+     * Drop every record read so far from the log
+     */
+    void commit();
+
+    /**
+     * Forget the reads since the last commit(); they are read again
+     */
+    void rewind();
+
+    // Records appended, records lost to the size cap, corrupt or truncated data skipped
+    uint32_t getAppendedCount() const { return appended; }
+    uint32_t getDroppedSegments() const { return droppedSegments; }
+    uint32_t getCorruptCount() const { return corrupt; }
+
+private:
+    char directory[OUTBOX_PATH_MAX];
+    char prefix[16];
+    int segmentBytes;
+    int maxSegments;
+
+    // Segments [firstSegment, writeSegment) are sealed; writeSegment is open while writeFile is set
+    uint32_t firstSegment;
+    uint32_t writeSegment;
+    FILE *writeFile;
+    int writeOffset;                     // Bytes already in the open segment file
+    uint8_t page[OUTBOX_PAGE_BYTES];
+    int pageFill;
+
+    // Replay position, and the position as of the last commit()
+    uint32_t readSegment;
+    int readOffset;
+    uint32_t commitSegment;
+    int commitOffset;
+    FILE *readFile;
+    int readHeaderBytes;                 // Header size of the record at the read position
+    uint32_t readCreatedAt;
+
+    uint32_t appended;
+    uint32_t droppedSegments;
+    uint32_t corrupt;
+
+    void segmentPath(uint32_t segment, char *path) const;
+    bool openWriteSegment();
+    bool writePage(bool pad);
+    void closeWriteSegment();
+    void deleteSegment(uint32_t segment);
+    int readHeader(uint8_t *type, uint32_t *crc, uint32_t *createdAt);
+    void nextReadSegment();
+};
+
+#endif // OUTBOX_H
@@ -0,0 +1,120 @@
+/**
+ * ElderGuard - Pan-Tompkins QRS Detector
+ *
+ * Fixed-point Pan-Tompkins chain: bandpass (5-15Hz), five-point derivative,
+ * squaring, moving-window integration and dual adaptive thresholds with
+ * T-wave rejection and searchback. The signal path is Q15 (ADC counts centred
+ * and scaled to +/-0.25 full scale); biquad coefficients are Q14 because the
+ * feedback terms exceed 1.0. Delay lines are power-of-two rings indexed with
+ * a mask. No Arduino or FreeRTOS dependencies.
+ */
+
+#ifndef PAN_TOMPKINS_H
+#define PAN_TOMPKINS_H
+
+#include <stdint.h>
+
+// A QRS complex confirmed by the detector
+typedef struct {
+    uint32_t samplesAgo;   // Position of the R wave relative to the current sample
+    int amplitude;         // Bandpass peak amplitude in ADC counts
+} PanTompkinsPeak;
+
+class PanTompkinsDetector {
+public:
+    /**
+     * @param sampleRateHz Rate of the samples passed to processSample()
+     */
+    explicit PanTompkinsDetector(int sampleRateHz);
+
+    /**
+     * Clear all filter and threshold state and restart the learning phase
+     */
+    void reset();
+
+    /**
+     * Feed one raw ECG sample through the chain
+     *
+     * @param sample Raw 12-bit ADC sample
+     * @param peak Filled in when a QRS complex is confirmed
+     * @return true if a QRS complex was confirmed on this sample
+     */
+    bool processSample(int sample, PanTompkinsPeak *peak);
+
+    // Primary integrated-signal threshold (THRESHOLD I1)
+    int32_t getThreshold() const { return thresholdI1; }
+
+private:
+    static const int DERIVATIVE_RING_SIZE = 8;
+    static const int DERIVATIVE_RING_MASK = DERIVATIVE_RING_SIZE - 1;
+    static const int MWI_RING_SIZE = 128;
+    static const int MWI_RING_MASK = MWI_RING_SIZE - 1;
+
+    // Second-order section, Q14 coefficients, direct form I
+    typedef struct {
+        int32_t b0, b1, b2, a1, a2;
+        int32_t x1, x2, y1, y2;
+    } Biquad;
+
+    int sampleRateHz;
+
+    // Durations converted to samples
+    uint32_t mwiWindow;
+    uint32_t rSearchSamples;
+    uint32_t refractorySamples;
+    uint32_t tWaveSamples;
+    uint32_t learningSamples;
+
+    Biquad highPass;
+    Biquad lowPass;
+    bool primed;
+
+    int32_t derivativeRing[DERIVATIVE_RING_SIZE];
+    uint32_t derivativeIndex;
+
+    uint32_t mwiRing[MWI_RING_SIZE];
+    uint32_t mwiIndex;
+    uint32_t mwiSum;
+    uint32_t mwiPrev1;
+    uint32_t mwiPrev2;
+
+    // Centred input samples, to locate the R wave behind an integrator peak
+    int32_t inputRing[MWI_RING_SIZE];
+
+    // Peak envelope of the bandpassed signal and slope since the last peak
+    int32_t bandpassEnvelope;
+    uint32_t maxSlope;
+
+    // Signal/noise peak levels and thresholds for the integrated (I) and
+    // bandpassed (F) signals
+    int32_t spki, npki, thresholdI1, thresholdI2;
+    int32_t spkf, npkf, thresholdF1, thresholdF2;
+
+    // Learning phase accumulators
+    uint32_t sampleCount;
+    uint32_t learnMaxI, learnMaxF;
+    uint64_t learnSumI, learnSumF;
+
+    // Timing relative to the last confirmed QRS
+    bool haveQrs;
+    uint32_t samplesSinceQrs;
+    uint32_t rrAverage;
+    uint32_t lastQrsSlope;
+
+    // Best noise peak since the last QRS, for searchback
+    bool haveCandidate;
+    int32_t candidateI;
+    int32_t candidateF;
+    uint32_t candidateSlope;
+    uint32_t candidateAge;
+    uint32_t candidateLead;
+
+    void initBiquad(Biquad *filter, bool highPassType, float cutoffHz);
+    int32_t runBiquad(Biquad *filter, int32_t x);
+    void updateThresholds();
+    uint32_t findRWaveLead() const;
+    void confirmQrs(int32_t peakF, uint32_t slope, uint32_t samplesAgo, uint32_t lead, PanTompkinsPeak *peak);
+    bool classifyPeak(int32_t peakI, int32_t peakF, uint32_t slope, PanTompkinsPeak *peak);
+};
+
+#endif // PAN_TOMPKINS_H
@@ -0,0 +1,63 @@
+/**
+ * ElderGuard - Loop Period Histogram
+ *
+ * Timing of a periodic task loop: the time between wakeups, binned
+ * relative to the loop's nominal period, and the time spent working
+ * before it waits again. The owning loop calls wake() when it is woken
+ * and wait() before it blocks; either may be skipped on some iterations.
+ * No Arduino or FreeRTOS dependencies; times are microseconds from any
+ * free-running clock that wraps at 32 bits.
+ */
+
+#ifndef PERIOD_HISTOGRAM_H
+#define PERIOD_HISTOGRAM_H
+
+#include <stdint.h>
+
+#define PERIOD_HISTOGRAM_BUCKETS 7       // See getBucketLimitPct() for the bounds
+
+class PeriodHistogram {
+public:
+    PeriodHistogram();
+
+    /**
+     * @param periodUs Nominal time between wakeups
+     */
+    void setPeriod(uint32_t periodUs);
+
+    /**
+     * The loop was woken; records the time since the previous wakeup
+     */
+    void wake(uint32_t nowUs);
+
+    /**
+     * The loop is about to block; records the time since it was woken
+     */
+    void wait(uint32_t nowUs);
+
+    /**
+     * @return Upper bound of a bucket in percent of the nominal period,
+     *         or 0 for the last bucket, which has none
+     */
+    static int getBucketLimitPct(int bucket);
+
+    uint32_t getPeriod() const { return periodUs; }
+    uint32_t getCount(int bucket) const { return counts[bucket]; }
+    uint32_t getWakeups() const { return wakeups; }
+    uint32_t getWorstPeriodUs() const { return worstPeriodUs; }
+    uint32_t getWorstBusyUs() const { return worstBusyUs; }
+    uint64_t getBusyUs() const { return busyUs; }     // Total time working
+
+private:
+    uint32_t periodUs;
+    uint32_t counts[PERIOD_HISTOGRAM_BUCKETS];
+    uint32_t wakeups;
+    uint32_t worstPeriodUs;
+    uint32_t worstBusyUs;
+    uint64_t busyUs;
+    uint32_t lastWakeUs;
+    bool started;                        // lastWakeUs is set
+    bool awake;                          // Woken and not yet waiting
+};
+
+#endif // PERIOD_HISTOGRAM_H
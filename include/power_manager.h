@@ -0,0 +1,63 @@
+/**
+ * ElderGuard - Power Management
+ *
+ * In POWER_MODE_SAVE the CPU clock is scaled between POWER_CPU_MIN_MHZ and
+ * POWER_CPU_MAX_MHZ by the ESP-IDF power manager, and tasks hold a PM lock
+ * only while they need more: full speed for TLS and radio work, no light
+ * sleep while a sensor is being sampled. Light sleep itself is only
+ * enabled when the SDK is built with tickless idle.
+ *
+ * Idle time is measured by sampling, on every scheduler tick, whether each
+ * core is running its idle task. Together with the time each lock was
+ * held this makes a report for comparing power modes.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+#include "config.h"
+
+typedef enum {
+    POWER_LOCK_TRANSMIT,         // TLS handshakes and uploads: CPU at full speed
+    POWER_LOCK_SAMPLING,         // Sensor capture: no light sleep
+    POWER_LOCK_COUNT
+} PowerLock;
+
+typedef struct {
+    uint32_t uptimeMs;
+    uint32_t idleTicks[2];       // Ticks that found the idle task running, per core
+    uint32_t totalTicks[2];      // Ticks sampled, per core
+    uint32_t heldMs[POWER_LOCK_COUNT]; // Time each lock was held by at least one task
+    int cpuMhz;
+    bool scaling;                // Frequency scaling is active
+    bool modemSleep;             // WiFi sleeps between DTIM beacons
+} PowerReport;
+
+/**
+ * Configure frequency scaling and start the idle sampler. Call once from
+ * setup(), before the tasks start.
+ */
+void setupPowerManagement();
+
+/**
+ * Hold a lock; calls nest and may come from any task
+ */
+void powerLockAcquire(PowerLock lock);
+
+/**
+ * Release a lock taken with powerLockAcquire()
+ */
+void powerLockRelease(PowerLock lock);
+
+/**
+ * @param report Receives the counters since boot
+ */
+void getPowerReport(PowerReport *report);
+
+/**
+ * Print the report over serial, with idle and lock time since the last call
+ */
+void printPowerReport();
+
+#endif // POWER_MANAGER_H
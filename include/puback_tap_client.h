@@ -0,0 +1,103 @@
+/**
+ * ElderGuard - PUBACK Tap Client
+ *
+ * Lets QoS 1 packets go past an MQTT client that only publishes QoS 0
+ * (PubSubClient drops PUBACKs). The tap wraps the connection: every byte
+ * the MQTT client reads is also shown to an MqttInflightWindow, which picks
+ * out the PUBACKs, and the window's packets are written straight to the
+ * connection. A new connection makes every unacknowledged packet due
+ * again. Header only; of Arduino it needs just Client, which
+ * test/native_stubs stands in for on the host.
+ */
+
+#ifndef PUBACK_TAP_CLIENT_H
+#define PUBACK_TAP_CLIENT_H
+
+#include <stdint.h>
+#include <Client.h>
+#include "mqtt_inflight.h"
+
+class PubackTapClient : public Client {
+public:
+    /**
+     * @param inner The connection to the broker
+     * @param inflight Window fed with every byte read
+     * @param clockMs Current time in milliseconds
+     */
+    PubackTapClient(Client &inner, MqttInflightWindow &inflight, uint32_t (*clockMs)())
+        : inner(inner), inflight(inflight), clockMs(clockMs) {}
+
+    /**
+     * Write a whole QoS 1 packet. A short write leaves the broker partway
+     * into a packet, so the connection is dropped; the packet stays in the
+     * window and goes out again after the reconnect.
+     *
+     * @return false if the connection was dropped
+     */
+    bool writePacket(const uint8_t *packet, int length) {
+        if (inner.write(packet, length) == (size_t)length) {
+            return true;
+        }
+        inner.stop();
+        return false;
+    }
+
+    /**
+     * Send again every packet that is due: all of them after a reconnect,
+     * otherwise those unacknowledged for the window's retry time
+     *
+     * @return false if a short write dropped the connection
+     */
+    bool resendDue() {
+        int length;
+        const uint8_t *packet;
+        while ((packet = inflight.nextRetransmit(clockMs(), &length)) != NULL) {
+            if (!writePacket(packet, length)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A new connection: everything unacknowledged is sent again
+    int connect(IPAddress ip, uint16_t port) override {
+        inflight.reconnected();
+        return inner.connect(ip, port);
+    }
+    int connect(const char *host, uint16_t port) override {
+        inflight.reconnected();
+        return inner.connect(host, port);
+    }
+
+    int read() override {
+        int value = inner.read();
+        if (value >= 0) {
+            uint8_t byte = (uint8_t)value;
+            inflight.receive(&byte, 1, clockMs());
+        }
+        return value;
+    }
+    int read(uint8_t *buf, size_t size) override {
+        int count = inner.read(buf, size);
+        if (count > 0) {
+            inflight.receive(buf, count, clockMs());
+        }
+        return count;
+    }
+
+    size_t write(uint8_t value) override { return inner.write(value); }
+    size_t write(const uint8_t *buf, size_t size) override { return inner.write(buf, size); }
+    int available() override { return inner.available(); }
+    int peek() override { return inner.peek(); }
+    void flush() override { inner.flush(); }
+    void stop() override { inner.stop(); }
+    uint8_t connected() override { return inner.connected(); }
+    operator bool() override { return static_cast<bool>(inner); }
+
+private:
+    Client &inner;
+    MqttInflightWindow &inflight;
+    uint32_t (*clockMs)();
+};
+
+#endif // PUBACK_TAP_CLIENT_H
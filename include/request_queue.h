@@ -0,0 +1,234 @@
+/**
+ * ElderGuard - Outbound Request Queue
+ *
+ * Fixed-capacity priority queue of requests waiting to go out, owned by a
+ * single task. Lower priority numbers go first, FIFO within a priority.
+ * Each request carries a deadline; a failed attempt is rescheduled with
+ * exponential backoff plus random jitter, and a request that cannot be
+ * retried before its deadline is handed back to the caller instead. When
+ * the queue is full a new request evicts the newest one of a strictly
+ * lower priority, so telemetry never keeps an alert out. No Arduino or
+ * FreeRTOS dependencies.
+ */
+
+#ifndef REQUEST_QUEUE_H
+#define REQUEST_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+template <typename T, int CAPACITY>
+class RequestQueue {
+public:
+    /**
+     * @param backoffBaseMs Delay after the first failed attempt
+     * @param backoffMaxMs Longest delay between attempts
+     */
+    RequestQueue(uint32_t backoffBaseMs, uint32_t backoffMaxMs)
+        : backoffBaseMs(backoffBaseMs), backoffMaxMs(backoffMaxMs),
+          nextSequence(0), random(0x9E3779B9u), evicted(0) {
+        for (int i = 0; i < CAPACITY; i++) {
+            slots[i].used = false;
+        }
+    }
+
+    /**
+     * Queue a request for an immediate first attempt
+     *
+     * @param request Request to copy in
+     * @param priority 0 is the most urgent
+     * @param nowMs Current time
+     * @param timeoutMs Time from now after which the request is abandoned
+     * @param evictedOut Receives the request pushed out to make room (may be NULL)
+     * @return 0 if queued, 1 if queued by evicting a lower-priority request
+     *         into evictedOut, -1 if full of requests at least as urgent
+     */
+    int push(const T &request, int priority, uint32_t nowMs, uint32_t timeoutMs, T *evictedOut) {
+        int result = 0;
+        int slot = freeSlot();
+        if (slot < 0) {
+            // Drop the newest of the least urgent requests, if less urgent than this one
+            int victim = -1;
+            for (int i = 0; i < CAPACITY; i++) {
+                if (victim < 0 || slots[i].priority > slots[victim].priority ||
+                    (slots[i].priority == slots[victim].priority &&
+                     (int32_t)(slots[i].sequence - slots[victim].sequence) > 0)) {
+                    victim = i;
+                }
+            }
+            if (slots[victim].priority <= priority) {
+                return -1;
+            }
+            if (evictedOut != NULL) {
+                *evictedOut = slots[victim].request;
+            }
+            evicted++;
+            slot = victim;
+            result = 1;
+        }
+
+        Slot &entry = slots[slot];
+        entry.request = request;
+        entry.priority = priority;
+        entry.attempts = 0;
+        entry.sequence = nextSequence++;
+        entry.deadline = nowMs + timeoutMs;
+        entry.nextAttempt = nowMs;
+        entry.used = true;
+        return result;
+    }
+
+    /**
+     * @param nowMs Current time
+     * @return The most urgent request due for an attempt, or NULL. It stays
+     *         queued until complete() or retry().
+     */
+    T *next(uint32_t nowMs) {
+        int best = -1;
+        for (int i = 0; i < CAPACITY; i++) {
+            const Slot &entry = slots[i];
+            if (!entry.used || (int32_t)(nowMs - entry.nextAttempt) < 0) {
+                continue;
+            }
+            if (best < 0 || entry.priority < slots[best].priority ||
+                (entry.priority == slots[best].priority &&
+                 (int32_t)(entry.sequence - slots[best].sequence) < 0)) {
+                best = i;
+            }
+        }
+        return best < 0 ? NULL : &slots[best].request;
+    }
+
+    /**
+     * Remove a request returned by next() after it succeeded
+     */
+    void complete(T *request) {
+        slotOf(request)->used = false;
+    }
+
+    /**
+     * Reschedule a request returned by next() after a failed attempt
+     *
+     * @param nowMs Current time
+     * @return false if the next attempt would fall after the deadline; the
+     *         request has then been removed and the caller owns its cleanup
+     */
+    bool retry(T *request, uint32_t nowMs) {
+        Slot *entry = slotOf(request);
+        if (entry->attempts < 31) {
+            entry->attempts++;
+        }
+
+        uint32_t delay = backoffBaseMs;
+        for (int i = 1; i < entry->attempts && delay < backoffMaxMs; i++) {
+            delay *= 2;
+        }
+        if (delay > backoffMaxMs) {
+            delay = backoffMaxMs;
+        }
+        // Up to +50% so requests that failed together do not retry together
+        delay += nextRandom() % (delay / 2 + 1);
+
+        entry->nextAttempt = nowMs + delay;
+        if ((int32_t)(entry->nextAttempt - entry->deadline) > 0) {
+            entry->used = false;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Remove one request whose deadline has passed
+     *
+     * @param nowMs Current time
+     * @param expiredOut Receives the removed request
+     * @return false if no request has expired
+     */
+    bool takeExpired(uint32_t nowMs, T *expiredOut) {
+        for (int i = 0; i < CAPACITY; i++) {
+            if (slots[i].used && (int32_t)(nowMs - slots[i].deadline) > 0) {
+                *expiredOut = slots[i].request;
+                slots[i].used = false;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @param nowMs Current time
+     * @param maxWaitMs Upper bound on the result
+     * @return Time until the next request is due, 0 if one is due now
+     */
+    uint32_t msUntilNext(uint32_t nowMs, uint32_t maxWaitMs) const {
+        uint32_t wait = maxWaitMs;
+        for (int i = 0; i < CAPACITY; i++) {
+            if (!slots[i].used) {
+                continue;
+            }
+            int32_t due = (int32_t)(slots[i].nextAttempt - nowMs);
+            if (due <= 0) {
+                return 0;
+            }
+            if ((uint32_t)due < wait) {
+                wait = (uint32_t)due;
+            }
+        }
+        return wait;
+    }
+
+    /**
+     * @return Attempts already made for a request returned by next()
+     */
+    int getAttempts(const T *request) const { return slotOf(request)->attempts; }
+
+    int getCount() const {
+        int count = 0;
+        for (int i = 0; i < CAPACITY; i++) {
+            count += slots[i].used ? 1 : 0;
+        }
+        return count;
+    }
+
+    uint32_t getEvictedCount() const { return evicted; }
+
+private:
+    struct Slot {
+        T request;                 // First member, so a request pointer is its slot
+        int priority;
+        int attempts;
+        uint32_t sequence;
+        uint32_t deadline;
+        uint32_t nextAttempt;
+        bool used;
+    };
+
+    Slot slots[CAPACITY];
+    uint32_t backoffBaseMs;
+    uint32_t backoffMaxMs;
+    uint32_t nextSequence;
+    uint32_t random;
+    uint32_t evicted;
+
+    int freeSlot() const {
+        for (int i = 0; i < CAPACITY; i++) {
+            if (!slots[i].used) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    Slot *slotOf(T *request) { return reinterpret_cast<Slot *>(request); }
+    const Slot *slotOf(const T *request) const { return reinterpret_cast<const Slot *>(request); }
+
+    // xorshift32; jitter only has to decorrelate retries
+    uint32_t nextRandom() {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    }
+};
+
+#endif // REQUEST_QUEUE_H
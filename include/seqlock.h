@@ -0,0 +1,97 @@
+/**
+ * ElderGuard - Sequence-Locked Snapshot
+ *
+ * Holds the latest value of one record for readers on any task. The single
+ * writer never waits: it bumps the sequence to odd, copies the record and
+ * bumps it back to even. Readers copy without locking and retry if the
+ * sequence was odd or changed while they were copying, so a read is never
+ * torn and never blocks the writer.
+ *
+ * The writer suspends the scheduler on its own core for the duration of the
+ * copy so a higher-priority reader on that core cannot preempt it mid-write
+ * and spin forever; a reader on the other core spins for at most one copy.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+template <typename T>
+class SeqLock {
+public:
+    SeqLock() : sequence(0), retries(0) {
+        for (int i = 0; i < WORDS; i++) {
+            words[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Replace the snapshot (owning task only, never blocks)
+     */
+    void store(const T &value) {
+        uint32_t buffer[WORDS] = {0};
+        memcpy(buffer, &value, sizeof(T));
+
+        vTaskSuspendAll();
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (int i = 0; i < WORDS; i++) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+
+        sequence.store(seq + 2, std::memory_order_release);
+        xTaskResumeAll();
+    }
+
+    /**
+     * Copy the latest complete snapshot
+     *
+     * @param out Receives the snapshot
+     */
+    void load(T *out) const {
+        uint32_t buffer[WORDS];
+        while (true) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                for (int i = 0; i < WORDS; i++) {
+                    buffer[i] = words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before) {
+                    break;
+                }
+            }
+            // Raced with the writer; counted so contention can be measured
+            retries.fetch_add(1, std::memory_order_relaxed);
+        }
+        memcpy(out, buffer, sizeof(T));
+    }
+
+    /**
+     * @return Number of times a reader had to retry because of a concurrent write
+     */
+    uint32_t getRetries() const { return retries.load(std::memory_order_relaxed); }
+
+    /**
+     * @return Number of completed writes
+     */
+    uint32_t getWrites() const { return sequence.load(std::memory_order_relaxed) / 2; }
+
+private:
+    static const int WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock records must be plain structs");
+
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[WORDS];
+    mutable std::atomic<uint32_t> retries;
+};
+
+#endif // SEQLOCK_H
@@ -27,7 +27,7 @@ void timeTask(void *pvParameters);
  * @param status Pointer to time status structure
  * @return true if initialization successful, false otherwise
  */
-bool setupTimeSync(volatile TimeStatus *status);
+bool setupTimeSync(TimeStatus *status);
 
 /**
  * Synchronize system time with NTP servers
@@ -35,14 +35,14 @@ bool setupTimeSync(volatile TimeStatus *status);
  * @param status Pointer to time status structure
  * @return true if sync successful, false otherwise
  */
-bool syncTimeWithNTP(volatile TimeStatus *status);
+bool syncTimeWithNTP(TimeStatus *status);
 
 /**
  * Update current time information in the status structure
  * 
  * @param status Pointer to time status structure
  */
-void updateCurrentTime(volatile TimeStatus *status);
+void updateCurrentTime(TimeStatus *status);
 
 /**
  * Get current time as an epoch timestamp
@@ -51,6 +51,13 @@ void updateCurrentTime(volatile TimeStatus *status);
  */
 time_t getCurrentEpochTime();
 
+/**
+ * Get current time for stamping data that is stored to be sent later
+ * 
+ * @return Current unix time in seconds, or 0 if time is not synchronized yet
+ */
+uint32_t getSynchronizedEpochTime();
+
 /**
  * Get current time as a formatted string
  * 
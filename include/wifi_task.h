@@ -25,30 +25,48 @@ void wifiTask(void *pvParameters);
  * 
  * @param status Pointer to WiFi status structure
  */
-void setupWiFi(volatile WiFiStatus *status);
+void setupWiFi(WiFiStatus *status);
 
 /**
- * Attempt to connect to WiFi network
+ * Start a connection attempt without waiting for it; the result arrives
+ * as a WiFi event
  * 
  * @param status Pointer to WiFi status structure
- * @return true if connection successful, false otherwise
  */
-bool connectToWiFi(volatile WiFiStatus *status);
+void connectToWiFi(WiFiStatus *status);
 
 /**
- * Attempt to reconnect to WiFi if disconnected
+ * Start another connection attempt after a failed one
  * 
  * @param status Pointer to WiFi status structure
- * @return true if reconnection successful, false otherwise
  */
-bool reconnectWiFi(volatile WiFiStatus *status);
+void reconnectWiFi(WiFiStatus *status);
 
 /**
  * Update WiFi status information (RSSI, IP, etc.)
  * 
  * @param status Pointer to WiFi status structure
  */
-void updateWiFiStatus(volatile WiFiStatus *status);
+void updateWiFiStatus(WiFiStatus *status);
+
+/**
+ * Add a network to the known list in NVS, or update its password and
+ * priority. Safe from any task: the change is applied by the WiFi task.
+ * 
+ * @param ssid Network name
+ * @param password Network password
+ * @param priority Higher networks are joined first when several are in range
+ * @return false if the change could not be queued
+ */
+bool addWiFiNetwork(const char *ssid, const char *password, int priority);
+
+/**
+ * Remove a network from the known list in NVS. Safe from any task.
+ * 
+ * @param ssid Network name
+ * @return false if the change could not be queued
+ */
+bool removeWiFiNetwork(const char *ssid);
 
 /**
  * Get current WiFi connection status
@@ -0,0 +1,279 @@
+/**
+ * ElderGuard - Task Diagnostics Implementation
+ */
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_freertos_hooks.h"
+#include "esp_heap_caps.h"
+#include "../include/diagnostics.h"
+
+static const char *LOOP_NAMES[DIAG_LOOP_COUNT] = {"ecg", "fall"};
+
+// Watched tasks. ids identify them; handles are what the sampler and the
+// stack scan use, and are cleared when a task exits.
+static TaskHandle_t ids[DIAG_TASKS_MAX];
+static TaskHandle_t handles[DIAG_TASKS_MAX];
+static char names[DIAG_TASKS_MAX][configMAX_TASK_NAME_LEN];
+static uint32_t stackSizes[DIAG_TASKS_MAX];
+static uint32_t exitStackFree[DIAG_TASKS_MAX];
+static volatile int taskCount = 0;
+
+// CPU sampler, written from the tick interrupt of each core
+static volatile uint32_t taskTicks[DIAG_TASKS_MAX];
+static volatile uint32_t sampledTicks = 0;
+
+// Loop timing, written by the ECG and fall detection tasks
+static PeriodHistogram loops[DIAG_LOOP_COUNT];
+
+// Held while a handle is in use, so an exiting task cannot be freed under it
+static portMUX_TYPE diagSpinlock = portMUX_INITIALIZER_UNLOCKED;
+
+// Scans of each entry's stack in progress outside the lock. A task that
+// exits waits in diagnosticsTaskExit() until they are done.
+static volatile uint8_t scanning[DIAG_TASKS_MAX];
+
+// Counters at the last printDiagnostics()
+static DiagReport lastPrinted;
+
+static inline void IRAM_ATTR sampleCore(int core) {
+  TaskHandle_t running = xTaskGetCurrentTaskHandleForCPU(core);
+  int count = taskCount;
+  for (int i = 0; i < count; i++) {
+    if (handles[i] == running) {
+      taskTicks[i]++;
+      return;
+    }
+  }
+}
+
+static void IRAM_ATTR sampleCore0() {
+  sampledTicks++;
+  sampleCore(0);
+}
+
+static void IRAM_ATTR sampleCore1() {
+  sampleCore(1);
+}
+
+void setupDiagnostics() {
+  esp_register_freertos_tick_hook_for_cpu(sampleCore0, 0);
+  esp_register_freertos_tick_hook_for_cpu(sampleCore1, 1);
+}
+
+/**
+ * Find a task's entry, creating it if there is room. Called with the
+ * spinlock held.
+ */
+static int findTask(TaskHandle_t task, bool *added) {
+  int count = taskCount;
+  for (int i = 0; i < count; i++) {
+    if (ids[i] == task) {
+      *added = false;
+      return i;
+    }
+  }
+  if (count == DIAG_TASKS_MAX) {
+    return -1;
+  }
+  ids[count] = task;
+  strncpy(names[count], pcTaskGetName(task), configMAX_TASK_NAME_LEN - 1);
+  *added = true;
+  return count;
+}
+
+void diagnosticsAddTask(TaskHandle_t task, uint32_t stackSize) {
+  if (task == NULL) {
+    return;
+  }
+  taskENTER_CRITICAL(&diagSpinlock);
+  bool added;
+  int index = findTask(task, &added);
+  if (index >= 0) {
+    stackSizes[index] = stackSize;
+    if (added) {
+      handles[index] = task;
+      // Publish the entry to the tick hooks only once it is complete
+      taskCount = index + 1;
+    }
+  }
+  taskEXIT_CRITICAL(&diagSpinlock);
+}
+
+void diagnosticsTaskExit() {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  uint32_t stackFree = uxTaskGetStackHighWaterMark(NULL);
+  taskENTER_CRITICAL(&diagSpinlock);
+  // A task may exit before setup() gets to add it; keep an entry so the
+  // later diagnosticsAddTask() only matches the handle and never reads it
+  bool added;
+  int index = findTask(self, &added);
+  if (index >= 0) {
+    handles[index] = NULL;
+    exitStackFree[index] = stackFree;
+    if (added) {
+      taskCount = index + 1;
+    }
+  }
+  taskEXIT_CRITICAL(&diagSpinlock);
+
+  // Stay alive until a scan of this stack has finished
+  while (index >= 0 && scanning[index] > 0) {
+    vTaskDelay(1);
+  }
+}
+
+void diagnosticsSetLoopPeriod(DiagLoop loop, uint32_t periodUs) {
+  taskENTER_CRITICAL(&diagSpinlock);
+  loops[loop].setPeriod(periodUs);
+  taskEXIT_CRITICAL(&diagSpinlock);
+}
+
+void diagnosticsLoopWake(DiagLoop loop) {
+  uint32_t now = micros();
+  taskENTER_CRITICAL(&diagSpinlock);
+  loops[loop].wake(now);
+  taskEXIT_CRITICAL(&diagSpinlock);
+}
+
+void diagnosticsLoopWait(DiagLoop loop) {
+  uint32_t now = micros();
+  taskENTER_CRITICAL(&diagSpinlock);
+  loops[loop].wait(now);
+  taskEXIT_CRITICAL(&diagSpinlock);
+}
+
+void getDiagnostics(DiagReport *report) {
+  report->uptimeMs = millis();
+  report->sampledTicks = sampledTicks;
+
+  TaskHandle_t live[DIAG_TASKS_MAX];
+  taskENTER_CRITICAL(&diagSpinlock);
+  report->taskCount = taskCount;
+  for (int i = 0; i < report->taskCount; i++) {
+    DiagTask &task = report->tasks[i];
+    task.name = names[i];
+    task.stackSize = stackSizes[i];
+    task.ticks = taskTicks[i];
+    task.stackFree = exitStackFree[i];
+    live[i] = handles[i];
+  }
+  for (int loop = 0; loop < DIAG_LOOP_COUNT; loop++) {
+    report->loops[loop] = loops[loop];
+  }
+  taskEXIT_CRITICAL(&diagSpinlock);
+
+  // A stack scan reads the whole stack, far too long to hold the lock
+  // with interrupts off; a task that exits meanwhile waits for its scan.
+  // The high-water mark only grows, so a live scan is never stale.
+  for (int i = 0; i < report->taskCount; i++) {
+    DiagTask &task = report->tasks[i];
+    taskENTER_CRITICAL(&diagSpinlock);
+    task.running = live[i] != NULL && handles[i] == live[i];
+    if (task.running) {
+      scanning[i]++;
+    } else {
+      task.stackFree = exitStackFree[i];
+    }
+    taskEXIT_CRITICAL(&diagSpinlock);
+
+    if (task.running) {
+      task.stackFree = uxTaskGetStackHighWaterMark(live[i]);
+      taskENTER_CRITICAL(&diagSpinlock);
+      scanning[i]--;
+      taskEXIT_CRITICAL(&diagSpinlock);
+    }
+  }
+
+  report->freeHeap = ESP.getFreeHeap();
+  report->minFreeHeap = ESP.getMinFreeHeap();
+  report->largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+}
+
+/**
+ * Share of one core a task used between two reports, in percent
+ */
+static float cpuShare(const DiagReport &report, const DiagReport &previous, int task) {
+  uint32_t ticks = report.sampledTicks - previous.sampledTicks;
+  uint32_t before = task < previous.taskCount ? previous.tasks[task].ticks : 0;
+  return ticks > 0 ? 100.0f * (report.tasks[task].ticks - before) / ticks : 0;
+}
+
+/**
+ * Share of the interval a loop spent working, in percent
+ */
+static float busyShare(const DiagReport &report, const DiagReport &previous, int loop) {
+  uint32_t elapsedMs = report.uptimeMs - previous.uptimeMs;
+  uint64_t busyUs = report.loops[loop].getBusyUs() - previous.loops[loop].getBusyUs();
+  return elapsedMs > 0 ? busyUs / (10.0f * elapsedMs) : 0;
+}
+
+void writeDiagnosticsJson(JsonDocument &doc, const DiagReport &report, const DiagReport &previous) {
+  doc["uptime_s"] = report.uptimeMs / 1000;
+  doc["heap_free"] = report.freeHeap;
+  doc["heap_min"] = report.minFreeHeap;
+  doc["heap_largest_block"] = report.largestFreeBlock;
+
+  JsonArray tasks = doc.createNestedArray("tasks");
+  for (int i = 0; i < report.taskCount; i++) {
+    JsonObject task = tasks.createNestedObject();
+    task["name"] = report.tasks[i].name;
+    task["stack"] = report.tasks[i].stackSize;
+    task["stack_free"] = report.tasks[i].stackFree;
+    task["cpu_pct"] = cpuShare(report, previous, i);
+  }
+
+  JsonArray loopsJson = doc.createNestedArray("loops");
+  for (int loop = 0; loop < DIAG_LOOP_COUNT; loop++) {
+    const PeriodHistogram &current = report.loops[loop];
+    const PeriodHistogram &before = previous.loops[loop];
+    JsonObject entry = loopsJson.createNestedObject();
+    entry["name"] = LOOP_NAMES[loop];
+    entry["period_us"] = current.getPeriod();
+    entry["wakeups"] = current.getWakeups() - before.getWakeups();
+    JsonArray hist = entry.createNestedArray("hist");
+    for (int bucket = 0; bucket < PERIOD_HISTOGRAM_BUCKETS; bucket++) {
+      hist.add(current.getCount(bucket) - before.getCount(bucket));
+    }
+    entry["period_us_worst"] = current.getWorstPeriodUs();
+    entry["busy_pct"] = busyShare(report, previous, loop);
+    entry["busy_us_worst"] = current.getWorstBusyUs();
+  }
+}
+
+void printDiagnostics() {
+  DiagReport report;
+  getDiagnostics(&report);
+
+  Serial.printf("Diagnostics: uptime %lu s, heap free %lu, min %lu, largest block %lu\n",
+                (unsigned long)(report.uptimeMs / 1000), (unsigned long)report.freeHeap,
+                (unsigned long)report.minFreeHeap, (unsigned long)report.largestFreeBlock);
+  Serial.println("  Task             Stack   Free    CPU");
+  for (int i = 0; i < report.taskCount; i++) {
+    const DiagTask &task = report.tasks[i];
+    Serial.printf("  %-15s %6lu %6lu %5.1f%%%s\n", task.name, (unsigned long)task.stackSize,
+                  (unsigned long)task.stackFree, cpuShare(report, lastPrinted, i),
+                  task.running ? "" : " (exited)");
+  }
+
+  for (int loop = 0; loop < DIAG_LOOP_COUNT; loop++) {
+    const PeriodHistogram &current = report.loops[loop];
+    const PeriodHistogram &before = lastPrinted.loops[loop];
+    Serial.printf("  Loop %s: nominal %lu us, %lu wakeups, worst period %lu us, busy %.1f%%, worst %lu us\n   ",
+                  LOOP_NAMES[loop], (unsigned long)current.getPeriod(),
+                  (unsigned long)(current.getWakeups() - before.getWakeups()),
+                  (unsigned long)current.getWorstPeriodUs(), busyShare(report, lastPrinted, loop),
+                  (unsigned long)current.getWorstBusyUs());
+    for (int bucket = 0; bucket < PERIOD_HISTOGRAM_BUCKETS; bucket++) {
+      int limit = PeriodHistogram::getBucketLimitPct(bucket);
+      uint32_t count = current.getCount(bucket) - before.getCount(bucket);
+      if (limit > 0) {
+        Serial.printf(" <%d%%: %lu", limit, (unsigned long)count);
+      } else {
+        Serial.printf(" >=%d%%: %lu\n", PeriodHistogram::getBucketLimitPct(bucket - 1), (unsigned long)count);
+      }
+    }
+  }
+  lastPrinted = report;
+}
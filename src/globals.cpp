@@ -1,56 +1,29 @@
 /**
- * ElderGuard - Global Variables and Semaphores Implementation
+ * ElderGuard - Global Variables and Event Topics Implementation
  * 
- * This file implements all global variables and semaphores used for
+ * This file implements the shared state snapshots and event topics used for
  * communication between tasks in the ElderGuard system.
  */
 
 #include "../include/globals.h"
 
-// Semaphores for task synchronization
-SemaphoreHandle_t displayMutex;
-SemaphoreHandle_t ecgDataSemaphore;
-SemaphoreHandle_t gpsDataSemaphore;
-SemaphoreHandle_t fallDetectionSemaphore;
-SemaphoreHandle_t medicationSemaphore;
-SemaphoreHandle_t audioCommandSemaphore;
-SemaphoreHandle_t wifiStatusSemaphore;
-SemaphoreHandle_t timeStatusSemaphore;
-SemaphoreHandle_t telegramAlertSemaphore; // New semaphore for Telegram alerts
-
-// Shared ECG Data
-volatile EcgData currentEcgData;
-volatile bool ecgDataUpdated = false;
-
-// Shared GPS Data
-volatile GpsData currentGpsData;
-volatile bool gpsDataUpdated = false;
-
-// Shared Fall Detection Data
-volatile FallEvent currentFallEvent;
-volatile bool fallDetectionUpdated = false;
-
-// Shared Telegram Alert Data
-volatile TelegramAlert currentTelegramAlert;
-volatile bool telegramAlertUpdated = false;
-
-// Shared Medication Data
-volatile MedicationReminder currentMedicationReminder;
-volatile bool medicationReminderUpdated = false;
-volatile UpcomingMedication upcomingMedication;
-volatile bool upcomingMedicationUpdated = false;
-
-// Shared Audio Command Data
-volatile AudioCommand currentAudioCommand;
-volatile bool audioCommandUpdated = false;
-
-// Shared WiFi Status Data
-volatile WiFiStatus currentWiFiStatus;
-volatile bool wifiStatusUpdated = false;
-
-// Shared Time Status Data
-volatile TimeStatus currentTimeStatus;
-volatile bool timeStatusUpdated = false;
+// Latest-value snapshots
+SeqLock<EcgData> currentEcgData;
+SeqLock<GpsData> currentGpsData;
+SeqLock<FallEvent> currentFallEvent;
+SeqLock<WiFiStatus> currentWiFiStatus;
+SeqLock<TimeStatus> currentTimeStatus;
+
+// Event topics
+EcgTopic ecgTopic;
+GpsTopic gpsTopic;
+FallTopic fallTopic;
+TelegramAlertTopic telegramAlertTopic;
+MedicationTopic medicationTopic;
+UpcomingMedicationTopic upcomingMedicationTopic;
+AudioCommandTopic audioCommandTopic;
+WiFiStatusTopic wifiStatusTopic;
+ImpactCaptureTopic impactCaptureTopic;
 
 // Flag for display update requests
 volatile bool needsDisplayUpdate = false;
\ No newline at end of file
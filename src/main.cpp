@@ -26,6 +26,8 @@
 #include "../include/mqtt_task.h"
 #include "../include/http_task.h"
 #include "../include/firmware_update_task.h"
+#include "../include/power_manager.h"
+#include "../include/diagnostics.h"
 
 // Task handles
 TaskHandle_t ecgTaskHandle = NULL;
@@ -53,26 +55,9 @@ void setup() {
   // Initialize hardware components and pins
   initHardware();
   
-  // Create mutexes and semaphores
-  displayMutex = xSemaphoreCreateMutex();
-  ecgDataSemaphore = xSemaphoreCreateBinary();
-  gpsDataSemaphore = xSemaphoreCreateBinary();
-  fallDetectionSemaphore = xSemaphoreCreateBinary();
-  medicationSemaphore = xSemaphoreCreateBinary();
-  audioCommandSemaphore = xSemaphoreCreateBinary();
-  wifiStatusSemaphore = xSemaphoreCreateBinary();
-  timeStatusSemaphore = xSemaphoreCreateBinary();
-  telegramAlertSemaphore = xSemaphoreCreateBinary(); // Initialize our new semaphore
-  
-  // Give initial values to binary semaphores so they can be taken first time
-  xSemaphoreGive(telegramAlertSemaphore);
-  xSemaphoreGive(ecgDataSemaphore);
-  xSemaphoreGive(gpsDataSemaphore);
-  xSemaphoreGive(fallDetectionSemaphore);
-  xSemaphoreGive(medicationSemaphore);
-  xSemaphoreGive(audioCommandSemaphore);
-  xSemaphoreGive(wifiStatusSemaphore);
-  xSemaphoreGive(timeStatusSemaphore);
+  // Clock scaling and the idle sampler, before any task takes a PM lock
+  setupPowerManagement();
+  setupDiagnostics();
   
   // Do NOT configure Watchdog timer as requested by the user
   // Explicitly disable watchdog timer to prevent auto-restarts
@@ -86,12 +71,13 @@ void setup() {
   xTaskCreatePinnedToCore(
     wifiTask,               // Task function
     "WiFi",                 // Name 
-    8192,                   // Stack size (bytes)
+    WIFI_TASK_STACK,        // Stack size (bytes)
     NULL,                   // Parameters
     10,                     // Priority (highest on core 0)
     &wifiTaskHandle,        // Task handle
     0                       // Core (0=Protocol core is better for network tasks)
   );
+  diagnosticsAddTask(wifiTaskHandle, WIFI_TASK_STACK);
   
   // Give WiFi task time to initialize before starting other network tasks
   vTaskDelay(500 / portTICK_PERIOD_MS);
@@ -100,34 +86,37 @@ void setup() {
   xTaskCreatePinnedToCore(
     timeTask,               // Task function
     "Time",                 // Name 
-    4096,                   // Stack size (bytes)
+    TIME_TASK_STACK,        // Stack size (bytes)
     NULL,                   // Parameters
     8,                      // Priority (high)
     &timeTaskHandle,        // Task handle
     0                       // Core (0=Protocol core)
   );
+  diagnosticsAddTask(timeTaskHandle, TIME_TASK_STACK);
   
   // Create MQTT task for data publishing
   xTaskCreatePinnedToCore(
     mqttTask,               // Task function
     "MQTT",                 // Name 
-    8192,                   // Stack size (bytes)
+    MQTT_TASK_STACK,        // Stack size (bytes)
     NULL,                   // Parameters
     6,                      // Priority (medium-high)
     &mqttTaskHandle,        // Task handle
     0                       // Core (0=Protocol core)
   );
+  diagnosticsAddTask(mqttTaskHandle, MQTT_TASK_STACK);
 
   // Create HTTP task for data uploading to server
   xTaskCreatePinnedToCore(
     httpTask,               // Task function
     "HTTP",                 // Name 
-    16384,                  // Stack size (bytes) - Increased from 8192 to 16384
+    HTTP_TASK_STACK,        // Stack size (bytes)
     NULL,                   // Parameters
     4,                      // Priority (medium)
     &httpTaskHandle,        // Task handle
     0                       // Core (0=Protocol core)
   );
+  diagnosticsAddTask(httpTaskHandle, HTTP_TASK_STACK);
   
   // Firmware update task is temporarily disabled
   /*
@@ -135,7 +124,7 @@ void setup() {
   xTaskCreatePinnedToCore(
     firmwareUpdateTask,     // Task function
     "FirmwareUpdate",       // Name 
-    8192,                   // Stack size (bytes) - needs more for OTA update
+    FIRMWARE_UPDATE_TASK_STACK, // Stack size (bytes)
     NULL,                   // Parameters
     3,                      // Priority (low, as it's not time-critical)
     &firmwareUpdateTaskHandle, // Task handle
@@ -149,67 +138,73 @@ void setup() {
   xTaskCreatePinnedToCore(
     fallDetectionTask,      // Task function
     "FallDetection",        // Name 
-    8192,                   // Stack size (bytes) - Increased from 4096 to 8192 to prevent stack overflow
+    FALL_DETECTION_TASK_STACK, // Stack size (bytes)
     NULL,                   // Parameters
     10,                     // Priority (highest on core 1)
     &fallDetectionTaskHandle, // Task handle
     1                       // Core (1=Application core)
   );
+  diagnosticsAddTask(fallDetectionTaskHandle, FALL_DETECTION_TASK_STACK);
   
   // ECG task has high priority for heart rate monitoring
   xTaskCreatePinnedToCore(
     ecgTask,                // Task function
     "ECG",                  // Name
-    4096,                   // Stack size 
+    ECG_TASK_STACK,         // Stack size (bytes)
     NULL,                   // Parameters
     9,                      // Priority (very high)
     &ecgTaskHandle,         // Task handle
     1                       // Core (1=Application core)
   );
+  diagnosticsAddTask(ecgTaskHandle, ECG_TASK_STACK);
   
   // GPS task has high priority for location services
   xTaskCreatePinnedToCore(
     gpsTask,                // Task function
     "GPS",                  // Name
-    4096,                   // Stack size
+    GPS_TASK_STACK,         // Stack size (bytes)
     NULL,                   // Parameters
     8,                      // Priority (high)
     &gpsTaskHandle,         // Task handle
     1                       // Core (1=Application core)
   );
+  diagnosticsAddTask(gpsTaskHandle, GPS_TASK_STACK);
   
   // Audio task for alerts
   xTaskCreatePinnedToCore(
     audioTask,              // Task function
     "Audio",                // Name
-    4096,                   // Stack size
+    AUDIO_TASK_STACK,       // Stack size (bytes)
     NULL,                   // Parameters
     7,                      // Priority (medium-high)
     &audioTaskHandle,       // Task handle
     1                       // Core (1=Application core)
   );
+  diagnosticsAddTask(audioTaskHandle, AUDIO_TASK_STACK);
   
   // Screen task for display updates
   xTaskCreatePinnedToCore(
     screenTask,             // Task function
     "Screen",               // Name
-    4096,                   // Stack size
+    SCREEN_TASK_STACK,      // Stack size (bytes)
     NULL,                   // Parameters
     5,                      // Priority (medium)
     &screenTaskHandle,      // Task handle
     1                       // Core (1=Application core)
   );
+  diagnosticsAddTask(screenTaskHandle, SCREEN_TASK_STACK);
   
   // Medication task for reminders
   xTaskCreatePinnedToCore(
     medicationTask,         // Task function
     "Medication",           // Name
-    4096,                   // Stack size
+    MEDICATION_TASK_STACK,  // Stack size (bytes)
     NULL,                   // Parameters
     4,                      // Priority (medium-low)
     &medicationTaskHandle,  // Task handle
     1                       // Core (1=Application core)
   );
+  diagnosticsAddTask(medicationTaskHandle, MEDICATION_TASK_STACK);
   
   Serial.println("All tasks started successfully");
   Serial.println("===== ElderGuard System Running =====");
@@ -221,10 +216,14 @@ void initHardware() {
   // I2C Setup for MPU6050 and OLED
   Wire.begin(21, 22);
   
+  // MPU6050 data-ready interrupt (input-only pin, driven push-pull by the MPU)
+  pinMode(MPU_INT_PIN, INPUT);
+  
   // Setup AD8232 (ECG) pin
   pinMode(ECG_PIN, INPUT);
   
-  // GPS UART
+  // GPS UART; room for the NMEA that arrives while the GPS task sleeps
+  Serial2.setRxBufferSize(1024);
   Serial2.begin(9600, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
   
   // MP3 Player UART
@@ -235,6 +234,30 @@ void initHardware() {
 
 void loop() {
   // The main loop remains mostly empty as tasks handle all the work
+  
+  // Serial commands: "diag" prints the task and HTTP diagnostics
+  static char command[16];
+  static int commandLength = 0;
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c == '\n' || c == '\r') {
+      command[commandLength] = '\0';
+      if (strcmp(command, "diag") == 0) {
+        printDiagnostics();
+        printHttpDiagnostics();
+      }
+      commandLength = 0;
+    } else if (commandLength < (int)sizeof(command) - 1) {
+      command[commandLength++] = c;
+    }
+  }
+  
+  static unsigned long lastPowerReport = 0;
+  if (millis() - lastPowerReport >= POWER_REPORT_INTERVAL_MS) {
+    lastPowerReport = millis();
+    printPowerReport();
+  }
+  
   // Just add a small delay to prevent watchdog timer issues
   delay(1000);
 }
\ No newline at end of file
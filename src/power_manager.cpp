@@ -0,0 +1,144 @@
+/**
+ * ElderGuard - Power Management Implementation
+ */
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_pm.h"
+#include "esp_wifi.h"
+#include "esp_freertos_hooks.h"
+#include "../include/power_manager.h"
+
+// Light sleep needs an SDK built with tickless idle
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+#define LIGHT_SLEEP_SUPPORTED 1
+#else
+#define LIGHT_SLEEP_SUPPORTED 0
+#endif
+
+static esp_pm_lock_handle_t locks[POWER_LOCK_COUNT];
+static bool scaling = false;
+
+// Time each lock was held, counting nested holds once
+static int lockDepth[POWER_LOCK_COUNT];
+static unsigned long lockSince[POWER_LOCK_COUNT];
+static uint32_t lockHeldMs[POWER_LOCK_COUNT];
+static portMUX_TYPE lockSpinlock = portMUX_INITIALIZER_UNLOCKED;
+
+// Idle sampler, written from the tick interrupt of each core
+static TaskHandle_t idleTasks[2];
+static volatile uint32_t idleTicks[2];
+static volatile uint32_t totalTicks[2];
+
+// Counters at the last printPowerReport()
+static PowerReport lastPrinted;
+
+static void IRAM_ATTR sampleCore0() {
+  totalTicks[0]++;
+  if (xTaskGetCurrentTaskHandleForCPU(0) == idleTasks[0]) {
+    idleTicks[0]++;
+  }
+}
+
+static void IRAM_ATTR sampleCore1() {
+  totalTicks[1]++;
+  if (xTaskGetCurrentTaskHandleForCPU(1) == idleTasks[1]) {
+    idleTicks[1]++;
+  }
+}
+
+void setupPowerManagement() {
+#if POWER_MODE == POWER_MODE_SAVE
+  esp_pm_config_esp32_t config = {};
+  config.max_freq_mhz = POWER_CPU_MAX_MHZ;
+  config.min_freq_mhz = POWER_CPU_MIN_MHZ;
+  config.light_sleep_enable = LIGHT_SLEEP_SUPPORTED;
+  scaling = esp_pm_configure(&config) == ESP_OK;
+  if (scaling) {
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "transmit", &locks[POWER_LOCK_TRANSMIT]);
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "sampling", &locks[POWER_LOCK_SAMPLING]);
+  }
+#endif
+
+  idleTasks[0] = xTaskGetIdleTaskHandleForCPU(0);
+  idleTasks[1] = xTaskGetIdleTaskHandleForCPU(1);
+  esp_register_freertos_tick_hook_for_cpu(sampleCore0, 0);
+  esp_register_freertos_tick_hook_for_cpu(sampleCore1, 1);
+
+  if (scaling) {
+    Serial.printf("Power: Frequency scaling %d-%d MHz, light sleep %s\n", POWER_CPU_MIN_MHZ, POWER_CPU_MAX_MHZ,
+                  LIGHT_SLEEP_SUPPORTED ? "allowed" : "unavailable in this SDK build");
+  } else {
+    Serial.printf("Power: Fixed clock %d MHz\n", getCpuFrequencyMhz());
+  }
+}
+
+void powerLockAcquire(PowerLock lock) {
+  if (scaling) {
+    esp_pm_lock_acquire(locks[lock]);
+  }
+  taskENTER_CRITICAL(&lockSpinlock);
+  if (lockDepth[lock]++ == 0) {
+    lockSince[lock] = millis();
+  }
+  taskEXIT_CRITICAL(&lockSpinlock);
+}
+
+void powerLockRelease(PowerLock lock) {
+  taskENTER_CRITICAL(&lockSpinlock);
+  if (lockDepth[lock] > 0 && --lockDepth[lock] == 0) {
+    lockHeldMs[lock] += millis() - lockSince[lock];
+  }
+  taskEXIT_CRITICAL(&lockSpinlock);
+  if (scaling) {
+    esp_pm_lock_release(locks[lock]);
+  }
+}
+
+void getPowerReport(PowerReport *report) {
+  unsigned long now = millis();
+  report->uptimeMs = now;
+
+  taskENTER_CRITICAL(&lockSpinlock);
+  for (int i = 0; i < POWER_LOCK_COUNT; i++) {
+    // Include a hold still in progress
+    report->heldMs[i] = lockHeldMs[i] + (lockDepth[i] > 0 ? now - lockSince[i] : 0);
+  }
+  taskEXIT_CRITICAL(&lockSpinlock);
+
+  for (int core = 0; core < 2; core++) {
+    report->idleTicks[core] = idleTicks[core];
+    report->totalTicks[core] = totalTicks[core];
+  }
+
+  wifi_ps_type_t psType = WIFI_PS_NONE;
+  report->modemSleep = esp_wifi_get_ps(&psType) == ESP_OK && psType != WIFI_PS_NONE;
+  report->cpuMhz = getCpuFrequencyMhz();
+  report->scaling = scaling;
+}
+
+void printPowerReport() {
+  PowerReport report;
+  getPowerReport(&report);
+
+  uint32_t elapsed = report.uptimeMs - lastPrinted.uptimeMs;
+  if (elapsed == 0) {
+    return;
+  }
+
+  float idle[2];
+  for (int core = 0; core < 2; core++) {
+    uint32_t ticks = report.totalTicks[core] - lastPrinted.totalTicks[core];
+    idle[core] = ticks > 0 ? 100.0f * (report.idleTicks[core] - lastPrinted.idleTicks[core]) / ticks : 0;
+  }
+
+  Serial.printf("Power: idle core0 %.1f%% core1 %.1f%%, transmit lock %.1f%%, sampling lock %.1f%%, "
+                "%s, modem sleep %s, over %lu s\n",
+                idle[0], idle[1],
+                100.0f * (report.heldMs[POWER_LOCK_TRANSMIT] - lastPrinted.heldMs[POWER_LOCK_TRANSMIT]) / elapsed,
+                100.0f * (report.heldMs[POWER_LOCK_SAMPLING] - lastPrinted.heldMs[POWER_LOCK_SAMPLING]) / elapsed,
+                report.scaling ? "frequency scaling" : "fixed clock", report.modemSleep ? "on" : "off",
+                (unsigned long)(elapsed / 1000));
+  lastPrinted = report;
+}
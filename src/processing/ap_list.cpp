@@ -0,0 +1,172 @@
+/**
+ * ElderGuard - Known Access Point List Implementation
+ */
+
+#include <string.h>
+#include "../include/ap_list.h"
+
+// Bump when the stored layout changes; older blobs are then ignored
+#define AP_LIST_VERSION 0x41500001u
+
+AccessPointList::AccessPointList() {
+  memset(&stored, 0, sizeof(stored));
+  stored.version = AP_LIST_VERSION;
+  stored.lastJoined = -1;
+}
+
+int AccessPointList::find(const char *ssid) const {
+  for (int i = 0; i < stored.count; i++) {
+    if (strcmp(stored.aps[i].ssid, ssid) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool AccessPointList::add(const char *ssid, const char *password, int priority) {
+  if (strlen(ssid) >= AP_SSID_MAX || strlen(password) >= AP_PASSWORD_MAX) {
+    return false;
+  }
+
+  int index = find(ssid);
+  if (index < 0) {
+    if (stored.count == AP_LIST_MAX) {
+      return false;
+    }
+    index = stored.count++;
+    memset(&stored.aps[index], 0, sizeof(KnownAccessPoint));
+    strcpy(stored.aps[index].ssid, ssid);
+  }
+
+  KnownAccessPoint &ap = stored.aps[index];
+  if (strcmp(ap.password, password) != 0) {
+    // A new password may mean a new router as well
+    strcpy(ap.password, password);
+    ap.cached = false;
+  }
+  ap.priority = (int8_t)priority;
+  return true;
+}
+
+bool AccessPointList::remove(const char *ssid) {
+  int index = find(ssid);
+  if (index < 0) {
+    return false;
+  }
+
+  memmove(&stored.aps[index], &stored.aps[index + 1],
+          (stored.count - index - 1) * sizeof(KnownAccessPoint));
+  stored.count--;
+  if (stored.lastJoined == index) {
+    stored.lastJoined = -1;
+  } else if (stored.lastJoined > index) {
+    stored.lastJoined--;
+  }
+  return true;
+}
+
+int AccessPointList::getFastConnect() const {
+  int index = stored.lastJoined;
+  if (index >= 0 && index < stored.count && stored.aps[index].cached) {
+    return index;
+  }
+  return -1;
+}
+
+int AccessPointList::selectBest(const ApScanResult *results, int count, int *resultIndex) const {
+  int best = -1;
+  int bestResult = -1;
+  for (int r = 0; r < count; r++) {
+    int index = find(results[r].ssid);
+    if (index < 0) {
+      continue;
+    }
+    if (best < 0) {
+      best = index;
+      bestResult = r;
+      continue;
+    }
+
+    const ApScanResult &current = results[bestResult];
+    bool usable = results[r].rssi >= AP_USABLE_RSSI;
+    bool currentUsable = current.rssi >= AP_USABLE_RSSI;
+    int priority = stored.aps[index].priority;
+    int currentPriority = stored.aps[best].priority;
+
+    bool better;
+    if (usable != currentUsable) {
+      better = usable;
+    } else if (priority != currentPriority) {
+      better = priority > currentPriority;
+    } else {
+      better = results[r].rssi > current.rssi;
+    }
+    if (better) {
+      best = index;
+      bestResult = r;
+    }
+  }
+
+  *resultIndex = bestResult;
+  return best;
+}
+
+int AccessPointList::selectRoamTarget(const ApScanResult *results, int count, const uint8_t *currentBssid,
+                                      int currentRssi, int hysteresisDb, int *resultIndex) const {
+  int best = -1;
+  int bestResult = -1;
+  int bestRssi = currentRssi + hysteresisDb - 1;
+  for (int r = 0; r < count; r++) {
+    if (memcmp(results[r].bssid, currentBssid, 6) == 0 || results[r].rssi <= bestRssi) {
+      continue;
+    }
+    int index = find(results[r].ssid);
+    if (index >= 0) {
+      best = index;
+      bestResult = r;
+      bestRssi = results[r].rssi;
+    }
+  }
+
+  *resultIndex = bestResult;
+  return best;
+}
+
+bool AccessPointList::remember(int index, const uint8_t *bssid, int channel) {
+  KnownAccessPoint &ap = stored.aps[index];
+  if (ap.cached && stored.lastJoined == index && ap.channel == channel && memcmp(ap.bssid, bssid, 6) == 0) {
+    return false;
+  }
+  memcpy(ap.bssid, bssid, 6);
+  ap.channel = (uint8_t)channel;
+  ap.cached = true;
+  stored.lastJoined = (int8_t)index;
+  return true;
+}
+
+bool AccessPointList::forget(int index) {
+  if (!stored.aps[index].cached) {
+    return false;
+  }
+  stored.aps[index].cached = false;
+  return true;
+}
+
+bool AccessPointList::restore(const void *blob, int length) {
+  if (length != (int)sizeof(stored)) {
+    return false;
+  }
+  Stored loaded;
+  memcpy(&loaded, blob, sizeof(loaded));
+  if (loaded.version != AP_LIST_VERSION || loaded.count < 0 || loaded.count > AP_LIST_MAX ||
+      loaded.lastJoined < -1 || loaded.lastJoined >= loaded.count) {
+    return false;
+  }
+  for (int i = 0; i < loaded.count; i++) {
+    // Never trust a stored string to be terminated
+    loaded.aps[i].ssid[AP_SSID_MAX - 1] = '\0';
+    loaded.aps[i].password[AP_PASSWORD_MAX - 1] = '\0';
+  }
+  stored = loaded;
+  return true;
+}
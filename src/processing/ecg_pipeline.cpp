@@ -0,0 +1,83 @@
+/**
+ * ElderGuard - ECG Block Pipeline Implementation
+ */
+
+#include "../include/ecg_pipeline.h"
+
+EcgPipeline::EcgPipeline(EcgSampleRing &ring, EcgProcessor &processor, HrvEngine &hrv)
+  : ring(ring), processor(processor), hrv(hrv),
+    stableHeartRate(0), stableSinceMs(0), lastAlertMs(0), dropPending(false) {
+  drop.previousBpm = 0;
+  drop.currentBpm = 0;
+  drop.timeMs = 0;
+}
+
+int EcgPipeline::processBlock(const int *samples, int count, EcgBeat *beats, int maxBeats) {
+  // Publish to consumers first; the ring write never blocks
+  ring.write(samples, count);
+
+  int beatCount = processor.processBlock(samples, count, beats, maxBeats);
+  for (int i = 0; i < beatCount; i++) {
+    // Only beats with a plausible RR interval update the heart rate
+    if (beats[i].rrInterval == 0) {
+      continue;
+    }
+    hrv.addInterval(beats[i].timeMs, beats[i].rrInterval);
+    checkHeartRateDrop(beats[i].heartRate, beats[i].timeMs);
+  }
+
+  hrv.expire(processor.getSampleTimeMs());
+  return beatCount;
+}
+
+bool EcgPipeline::leadsOff(const int *samples, int count) {
+  // Keep the ring and sample clock running so consumers still see the raw signal
+  ring.write(samples, count);
+  processor.skipSamples(count);
+  hrv.expire(processor.getSampleTimeMs());
+
+  if (processor.getHeartRate() == 0) {
+    return false;
+  }
+  processor.clearHeartRate();
+  stableHeartRate = 0;
+  return true;
+}
+
+bool EcgPipeline::takeHeartRateDrop(HeartRateDrop *drop) {
+  if (!dropPending) {
+    return false;
+  }
+  *drop = this->drop;
+  dropPending = false;
+  return true;
+}
+
+void EcgPipeline::checkHeartRateDrop(int heartRate, uint32_t timeMs) {
+  if (heartRate < HEART_RATE_MIN_VALID) {
+    return;
+  }
+
+  if (stableHeartRate == 0) {
+    // First valid reading
+    stableHeartRate = heartRate;
+    stableSinceMs = timeMs;
+  } else if (timeMs - stableSinceMs > HEART_RATE_STABLE_MS) {
+    // Compare against a rate at most HEART_RATE_STABLE_MS old, not the last beat's
+    stableHeartRate = heartRate;
+    stableSinceMs = timeMs;
+  }
+
+  if (heartRate < stableHeartRate - HEART_RATE_DROP_THRESHOLD &&
+      timeMs - lastAlertMs > HEART_RATE_ALERT_COOLDOWN) {
+    drop.previousBpm = stableHeartRate;
+    drop.currentBpm = heartRate;
+    drop.timeMs = timeMs;
+    dropPending = true;
+    lastAlertMs = timeMs;
+
+    // Adapt to the new rate
+    stableHeartRate = heartRate;
+    stableSinceMs = timeMs;
+  }
+}
@@ -0,0 +1,261 @@
+/**
+ * ElderGuard - ECG QRS Detector Implementation
+ *
+ * Runs the selected QRS detector (legacy moving-average state machine or
+ * Pan-Tompkins) and the shared RR-interval averaging. All timing is derived
+ * from the number of samples processed, so results are identical whether
+ * samples arrive one at a time, in DMA blocks, or from a recording.
+ */
+
+#include "../include/ecg_processor.h"
+
+// Advanced ECG processing parameters - adjusted for AD8232
+#define PEAK_DETECTION_THRESHOLD 2700    // Initial threshold for R-peak detection - adjusted for AD8232
+#define RR_MIN_LIMIT 300                 // Minimum RR interval (200 BPM max)
+#define RR_MAX_LIMIT 1500                // Maximum RR interval (40 BPM min)
+#define QRS_MIN_WIDTH 10                 // Minimum width of QRS complex in ms
+#define QRS_MAX_WIDTH 150                // Maximum width of QRS complex in ms
+#define THRESHOLD_DECAY_MS 1500          // Lower the threshold after this long without a peak
+#define STARTUP_SETTLE_MS 3000           // Skip QRS width validation while the baseline settles
+#define HEART_RATE_TIMEOUT_MS 8000       // Drop the heart rate after this long without a beat
+
+EcgProcessor::EcgProcessor(int sampleRateHz, EcgDetectorMode mode)
+  : sampleRateHz(sampleRateHz), mode(mode), panTompkins(sampleRateHz) {
+  reset();
+}
+
+void EcgProcessor::reset() {
+  sampleCount = 0;
+  panTompkins.reset();
+
+  for (int i = 0; i < FILTER_TAPS; i++) {
+    filterHistory[i] = 0;
+  }
+  filterIndex = 0;
+  filterSum = 0;
+
+  baseline = 2048; // Start at midpoint
+  adaptiveThreshold = PEAK_DETECTION_THRESHOLD;
+
+  inQRS = false;
+  qrsStartTime = 0;
+  qrsPeak = 0;
+
+  for (int i = 0; i < AMPLITUDE_BUFFER_SIZE; i++) {
+    recentAmplitudes[i] = 0;
+  }
+  amplitudeIndex = 0;
+  averageAmplitude = 500; // Initial guess
+
+  for (int i = 0; i < RR_BUFFER_SIZE; i++) {
+    rrIntervals[i] = 0;
+  }
+  rrIndex = 0;
+  havePeak = false;
+  lastPeakTime = 0;
+
+  heartRate = 0;
+  lastHeartRateChangeTime = 0;
+}
+
+uint32_t EcgProcessor::getSampleTimeMs() const {
+  return (uint32_t)(((uint64_t)sampleCount * 1000ULL) / sampleRateHz);
+}
+
+int EcgProcessor::getThreshold() const {
+  if (mode == ECG_DETECTOR_PAN_TOMPKINS) {
+    return panTompkins.getThreshold();
+  }
+  return adaptiveThreshold;
+}
+
+void EcgProcessor::skipSamples(int count) {
+  sampleCount += count;
+
+  // The bandpass and thresholds are meaningless across a gap, relearn them
+  if (mode == ECG_DETECTOR_PAN_TOMPKINS && count > 0) {
+    panTompkins.reset();
+  }
+}
+
+void EcgProcessor::clearHeartRate() {
+  heartRate = 0;
+}
+
+int EcgProcessor::processBlock(const int *samples, int count, EcgBeat *beats, int maxBeats) {
+  int beatCount;
+  if (mode == ECG_DETECTOR_PAN_TOMPKINS) {
+    beatCount = processPanTompkins(samples, count, beats, maxBeats);
+  } else {
+    beatCount = processLegacy(samples, count, beats, maxBeats);
+  }
+
+  // If we've gone too long without detecting heart rate, reset it
+  if (heartRate > 0 && getSampleTimeMs() - lastHeartRateChangeTime > HEART_RATE_TIMEOUT_MS) {
+    heartRate = 0;
+  }
+
+  return beatCount;
+}
+
+int EcgProcessor::processLegacy(const int *samples, int count, EcgBeat *beats, int maxBeats) {
+  int beatCount = 0;
+
+  for (int n = 0; n < count; n++) {
+    sampleCount++;
+    uint32_t currentTime = getSampleTimeMs();
+
+    // Apply basic filter (5-point moving average)
+    filterSum += samples[n] - filterHistory[filterIndex];
+    filterHistory[filterIndex] = samples[n];
+    filterIndex = (filterIndex + 1) % FILTER_TAPS;
+    int filteredValue = filterSum / FILTER_TAPS;
+
+    // Update baseline with slow tracking (low pass filter)
+    baseline = (baseline * 99 + filteredValue) / 100;
+
+    // Calculate the deviation from baseline
+    int deviation = filteredValue - baseline;
+
+    // If no peaks for a while, reduce threshold to be more sensitive
+    if (currentTime - lastPeakTime > THRESHOLD_DECAY_MS) {
+      adaptiveThreshold = baseline + averageAmplitude / 2;
+    }
+
+    // QRS complex detection - state machine
+    if (!inQRS && deviation > adaptiveThreshold - baseline) {
+      // Entering QRS complex
+      inQRS = true;
+      qrsStartTime = currentTime;
+      qrsPeak = filteredValue;
+    } else if (inQRS) {
+      // In QRS complex - track peak
+      if (filteredValue > qrsPeak) {
+        qrsPeak = filteredValue;
+      }
+
+      // Exit QRS complex if signal drops below threshold or too much time passed
+      if (deviation < (adaptiveThreshold - baseline) / 2 || (currentTime - qrsStartTime > QRS_MAX_WIDTH)) {
+        inQRS = false;
+        uint32_t qrsDuration = currentTime - qrsStartTime;
+
+        // Don't validate QRS width during initial setup
+        if (currentTime < STARTUP_SETTLE_MS || (qrsDuration >= QRS_MIN_WIDTH && qrsDuration <= QRS_MAX_WIDTH)) {
+          int peakAmplitude = qrsPeak - baseline;
+          trackAmplitude(peakAmplitude);
+          // Update adaptive threshold based on amplitude
+          adaptiveThreshold = baseline + averageAmplitude / 2;
+
+          EcgBeat beat;
+          registerBeat(currentTime, peakAmplitude, &beat);
+          if (beatCount < maxBeats) {
+            beats[beatCount++] = beat;
+          }
+        }
+      }
+    }
+  }
+
+  return beatCount;
+}
+
+int EcgProcessor::processPanTompkins(const int *samples, int count, EcgBeat *beats, int maxBeats) {
+  int beatCount = 0;
+
+  for (int n = 0; n < count; n++) {
+    sampleCount++;
+
+    PanTompkinsPeak peak;
+    if (panTompkins.processSample(samples[n], &peak)) {
+      // Beats are timed at the R wave of the input signal
+      uint32_t peakSample = sampleCount - peak.samplesAgo;
+      uint32_t beatTime = (uint32_t)(((uint64_t)peakSample * 1000ULL) / sampleRateHz);
+
+      trackAmplitude(peak.amplitude);
+
+      EcgBeat beat;
+      registerBeat(beatTime, peak.amplitude, &beat);
+      if (beatCount < maxBeats) {
+        beats[beatCount++] = beat;
+      }
+    }
+  }
+
+  return beatCount;
+}
+
+/**
+ * Update the running average of QRS peak amplitudes
+ */
+void EcgProcessor::trackAmplitude(int peakAmplitude) {
+  recentAmplitudes[amplitudeIndex] = peakAmplitude;
+  amplitudeIndex = (amplitudeIndex + 1) % AMPLITUDE_BUFFER_SIZE;
+
+  // Recalculate average amplitude
+  int sumAmplitude = 0;
+  int countAmplitude = 0;
+  for (int i = 0; i < AMPLITUDE_BUFFER_SIZE; i++) {
+    if (recentAmplitudes[i] > 0) {
+      sumAmplitude += recentAmplitudes[i];
+      countAmplitude++;
+    }
+  }
+
+  if (countAmplitude > 0) {
+    averageAmplitude = sumAmplitude / countAmplitude;
+  }
+}
+
+/**
+ * Update RR and heart rate tracking for a detected QRS complex
+ */
+void EcgProcessor::registerBeat(uint32_t beatTime, int peakAmplitude, EcgBeat *beat) {
+  beat->timeMs = beatTime;
+  beat->rrInterval = 0;
+  beat->amplitude = peakAmplitude;
+
+  // Calculate RR interval if we have a previous peak
+  if (havePeak) {
+    uint32_t rrInterval = beatTime - lastPeakTime;
+
+    // Validate RR interval is physiologically plausible
+    if (rrInterval >= RR_MIN_LIMIT && rrInterval <= RR_MAX_LIMIT) {
+      // Store RR interval
+      rrIntervals[rrIndex] = rrInterval;
+      rrIndex = (rrIndex + 1) % RR_BUFFER_SIZE;
+
+      // Calculate heart rate from recent RR intervals
+      uint32_t rrSum = 0;
+      int validRR = 0;
+      for (int i = 0; i < RR_BUFFER_SIZE; i++) {
+        if (rrIntervals[i] > 0) {
+          rrSum += rrIntervals[i];
+          validRR++;
+        }
+      }
+
+      if (validRR > 0) {
+        uint32_t avgRR = rrSum / validRR;
+        int newHeartRate = 60000 / avgRR;
+
+        // Apply smoothing to heart rate
+        if (heartRate == 0) {
+          heartRate = newHeartRate;
+        } else {
+          // Use stronger smoothing for more stable readings. Rounded:
+          // truncating settled up to 4 BPM low when the RR varies.
+          heartRate = (4 * heartRate + newHeartRate + 2) / 5;
+        }
+        lastHeartRateChangeTime = beatTime;
+      }
+
+      beat->rrInterval = rrInterval;
+    }
+  }
+
+  // Update last peak time
+  havePeak = true;
+  lastPeakTime = beatTime;
+
+  beat->heartRate = heartRate;
+}
@@ -0,0 +1,99 @@
+/**
+ * ElderGuard - ECG Sample Ring Implementation
+ *
+ * The writer announces the range it is about to overwrite in "reserved"
+ * before touching the slots and publishes "head" afterwards. A reader
+ * copies, then checks "reserved": any copied sample older than
+ * reserved - capacity may have been overwritten mid-copy and is dropped.
+ */
+
+#include "../include/ecg_ring.h"
+
+EcgSampleRing::EcgSampleRing() : head(0), reserved(0) {
+  for (uint32_t i = 0; i < ECG_RING_CAPACITY; i++) {
+    samples[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void EcgSampleRing::write(const int *values, int count) {
+  uint32_t start = head.load(std::memory_order_relaxed);
+
+  reserved.store(start + count, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (int i = 0; i < count; i++) {
+    samples[(start + i) & MASK].store((int16_t)values[i], std::memory_order_relaxed);
+  }
+
+  head.store(start + count, std::memory_order_release);
+}
+
+void EcgSampleRing::initCursor(EcgRingCursor *cursor) const {
+  cursor->next = getHead();
+  cursor->dropped = 0;
+}
+
+/**
+ * Copy [start, end) and trim anything the writer may have overwritten meanwhile
+ *
+ * @return Number of valid samples; these are the newest part of the range,
+ *         moved to the front of out
+ */
+int EcgSampleRing::copyRange(uint32_t start, uint32_t end, int *out) const {
+  int count = (int)(end - start);
+  for (int i = 0; i < count; i++) {
+    out[i] = samples[(start + i) & MASK].load(std::memory_order_relaxed);
+  }
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint32_t oldestSafe = reserved.load(std::memory_order_relaxed) - ECG_RING_CAPACITY;
+
+  // Sequence numbers wrap, so compare distances rather than values
+  int torn = (int32_t)(oldestSafe - start) > 0 ? (int)(oldestSafe - start) : 0;
+  if (torn >= count) {
+    return 0;
+  }
+  if (torn > 0) {
+    for (int i = torn; i < count; i++) {
+      out[i - torn] = out[i];
+    }
+  }
+  return count - torn;
+}
+
+int EcgSampleRing::read(EcgRingCursor *cursor, int *out, int maxCount) const {
+  uint32_t end = getHead();
+  uint32_t available = end - cursor->next;
+
+  // Fell behind: skip to the oldest sample that is still intact
+  if (available > ECG_RING_CAPACITY) {
+    uint32_t skip = available - ECG_RING_CAPACITY;
+    cursor->next += skip;
+    cursor->dropped += skip;
+    available = ECG_RING_CAPACITY;
+  }
+
+  if (available == 0 || maxCount <= 0) {
+    return 0;
+  }
+  if (available > (uint32_t)maxCount) {
+    end = cursor->next + maxCount;
+  }
+
+  int wanted = (int)(end - cursor->next);
+  int got = copyRange(cursor->next, end, out);
+
+  // Anything trimmed from the front was overwritten before we could copy it
+  cursor->dropped += wanted - got;
+  cursor->next = end;
+  return got;
+}
+
+int EcgSampleRing::readNewest(EcgRingCursor *cursor, int *out, int count) const {
+  uint32_t end = getHead();
+  uint32_t available = end - cursor->next;
+  if (available > (uint32_t)count) {
+    cursor->next = end - count;
+  }
+  return read(cursor, out, count);
+}
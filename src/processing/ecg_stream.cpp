@@ -0,0 +1,141 @@
+/**
+ * ElderGuard - ECG Block Stream Implementation
+ *
+ * A block only ever holds consecutive ring samples. If the ring overruns
+ * the stream's cursor, the partly filled block is abandoned, its samples
+ * are counted as lost and a new block starts at the first intact sample.
+ */
+
+#include <string.h>
+#include "../include/ecg_stream.h"
+
+#define ECG_STREAM_VERSION 1
+
+static void putUint16(uint8_t *out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+static void putUint32(uint8_t *out, uint32_t value) {
+  putUint16(out, (uint16_t)value);
+  putUint16(out + 2, (uint16_t)(value >> 16));
+}
+
+EcgBlockStream::EcgBlockStream(int sampleRateHz, int blockSamples)
+    : sampleRateHz(sampleRateHz), blockSamples(blockSamples), filled(0), blockStart(0),
+      blockSequence(0), droppedSinceBlock(0), totalDropped(0) {
+  if (this->blockSamples > ECG_STREAM_MAX_BLOCK_SAMPLES) {
+    this->blockSamples = ECG_STREAM_MAX_BLOCK_SAMPLES;
+  }
+  if (this->blockSamples < 1) {
+    this->blockSamples = 1;
+  }
+  cursor.next = 0;
+  cursor.dropped = 0;
+}
+
+void EcgBlockStream::begin(const EcgSampleRing &ring) {
+  ring.initCursor(&cursor);
+  filled = 0;
+  blockStart = cursor.next;
+  droppedSinceBlock = 0;
+}
+
+int EcgBlockStream::readBlocks(const EcgSampleRing &ring, uint8_t *out, int maxLength,
+                               int maxBlocks, int *blocks) {
+  int length = 0;
+  *blocks = 0;
+
+  while (*blocks < maxBlocks && length + ecgStreamBlockMaxBytes(blockSamples) <= maxLength) {
+    uint32_t droppedBefore = cursor.dropped;
+    int wanted = blockSamples - filled;
+    int got = ring.read(&cursor, &block[filled], wanted);
+    uint32_t lost = cursor.dropped - droppedBefore;
+
+    if (lost > 0) {
+      // Not contiguous with what is already in the block: start over
+      if (filled > 0) {
+        memmove(block, &block[filled], got * sizeof(block[0]));
+      }
+      droppedSinceBlock += lost + filled;
+      totalDropped += lost + filled;
+      filled = 0;
+      blockStart = cursor.next - got;
+    }
+    filled += got;
+
+    if (filled < blockSamples) {
+      // A restart after a loss read only what fit the old block; the
+      // ring may hold more, so stop only once it is drained
+      if (got < wanted) {
+        break;
+      }
+      continue;
+    }
+
+    length += encodeBlock(out + length);
+    (*blocks)++;
+    filled = 0;
+    blockStart = cursor.next;
+  }
+
+  return length;
+}
+
+int EcgBlockStream::encodeBlock(uint8_t *out) {
+  memcpy(out, "EGEB", 4);
+  out[4] = ECG_STREAM_VERSION;
+  out[5] = 0;
+  putUint16(&out[6], (uint16_t)sampleRateHz);
+  putUint16(&out[8], (uint16_t)blockSamples);
+  putUint16(&out[10], 0);
+  putUint32(&out[12], blockSequence);
+  putUint32(&out[16], blockStart);
+  putUint32(&out[20], droppedSinceBlock);
+
+  int pos = ECG_STREAM_HEADER_BYTES;
+  putUint16(&out[pos], (uint16_t)(int16_t)block[0]);
+  pos += 2;
+
+  for (int i = 1; i < blockSamples; i++) {
+    int32_t delta = (int32_t)(int16_t)block[i] - (int32_t)(int16_t)block[i - 1];
+    uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+    while (zigzag >= 0x80) {
+      out[pos++] = (uint8_t)(zigzag | 0x80);
+      zigzag >>= 7;
+    }
+    out[pos++] = (uint8_t)zigzag;
+  }
+
+  blockSequence++;
+  droppedSinceBlock = 0;
+  return pos;
+}
+
+int base64Encode(const uint8_t *in, int length, char *out) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  int pos = 0;
+  int i = 0;
+
+  for (; i + 2 < length; i += 3) {
+    uint32_t triple = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+    out[pos++] = alphabet[(triple >> 18) & 0x3F];
+    out[pos++] = alphabet[(triple >> 12) & 0x3F];
+    out[pos++] = alphabet[(triple >> 6) & 0x3F];
+    out[pos++] = alphabet[triple & 0x3F];
+  }
+
+  if (i < length) {
+    uint32_t triple = (uint32_t)in[i] << 16;
+    if (i + 1 < length) {
+      triple |= (uint32_t)in[i + 1] << 8;
+    }
+    out[pos++] = alphabet[(triple >> 18) & 0x3F];
+    out[pos++] = alphabet[(triple >> 12) & 0x3F];
+    out[pos++] = i + 1 < length ? alphabet[(triple >> 6) & 0x3F] : '=';
+    out[pos++] = '=';
+  }
+
+  out[pos] = '\0';
+  return pos;
+}
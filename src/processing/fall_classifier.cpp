@@ -0,0 +1,38 @@
+/**
+ * ElderGuard - Fall Classifier Implementation
+ */
+
+#include <math.h>
+#include "../include/fall_classifier.h"
+#include "../include/fall_classifier_model.h"
+
+static_assert(sizeof(FALL_CLASSIFIER_WEIGHTS) == FALL_CLASSIFIER_FEATURES, "Model does not match the feature vector");
+
+static int8_t quantize(float value, float scale) {
+  float scaled = roundf(value * scale);
+  if (scaled > 127.0f) {
+    return 127;
+  }
+  if (scaled < -128.0f) {
+    return -128;
+  }
+  return (int8_t)scaled;
+}
+
+void quantizeFallFeatures(const FallFeatures &features, int8_t *quantized) {
+  quantized[0] = quantize(features.sma, FALL_FEATURE_SCALES[0]);
+  quantized[1] = quantize(features.jerk, FALL_FEATURE_SCALES[1]);
+  quantized[2] = quantize(features.stillness, FALL_FEATURE_SCALES[2]);
+  quantized[3] = quantize(features.orientationDelta, FALL_FEATURE_SCALES[3]);
+}
+
+int32_t scoreFall(const FallFeatures &features) {
+  int8_t inputs[FALL_CLASSIFIER_FEATURES];
+  quantizeFallFeatures(features, inputs);
+
+  int32_t score = FALL_CLASSIFIER_BIAS;
+  for (int i = 0; i < FALL_CLASSIFIER_FEATURES; i++) {
+    score += (int32_t)FALL_CLASSIFIER_WEIGHTS[i] * inputs[i];
+  }
+  return score;
+}
@@ -0,0 +1,366 @@
+/**
+ * ElderGuard - Fall Detector Implementation
+ *
+ * Thresholds were tuned at FALL_REFERENCE_RATE_HZ. The acceleration
+ * integral is scaled to that rate and divided by a fixed reference period,
+ * so the pattern check compares the same time integral at every sample
+ * rate; only the sampling of the impact itself differs.
+ * Classifier features are accumulated per sample from the start of free
+ * fall, so classifying a candidate costs a handful of operations.
+ *
+ * After a fall the detector keeps running at full rate: the person counts
+ * as up again once the filtered gravity direction has stayed close to the
+ * calibrated resting one for recoveryTime, and movement is judged from the
+ * spread of |a| over one-second blocks.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include "../include/fall_detector.h"
+
+#define FALL_REFERENCE_RATE_HZ 50        // Rate the thresholds were tuned at
+#define FALL_REFERENCE_PERIOD_MS (1000 / FALL_REFERENCE_RATE_HZ)
+#define RESTING_ACCELERATION 9.8f        // Initial minimum before any free fall is seen
+#define STANDARD_GRAVITY 9.80665f
+#define RAD_TO_DEGREES 57.29578f
+#define STILLNESS_SETTLE_MS 300          // Impact ringing ignored by the stillness feature
+#define MOTION_BLOCK_MS 1000             // Block over which post-fall movement is judged
+#define MOVEMENT_THRESHOLD_G 0.05f       // Std dev of |a| above this counts as moving
+#define DEGREES_TO_RAD 0.01745329f
+
+FallDetector::FallDetector(int sampleRateHz)
+    : sampleRateHz(sampleRateHz), config(defaultConfig()), orientationFilter(sampleRateHz),
+      baselinePitch(0), baselineRoll(0), sampleCount(0), previousAccMagnitude(RESTING_ACCELERATION) {
+  baselineGravity[0] = 0;
+  baselineGravity[1] = 0;
+  baselineGravity[2] = 1;
+  setConfig(config);
+  reset();
+}
+
+FallDetectorConfig FallDetector::defaultConfig() {
+  FallDetectorConfig config;
+  config.freefallThreshold = 6.0f;             // Increased from 5.0 to be more sensitive
+  config.impactThreshold = 16.0f;              // Reduced from 20.0 to detect lighter impacts
+  config.orientationChangeThreshold = 15.0f;   // Reduced from 25.0 to require less rotation
+  config.requireOrientationChange = false;     // Disabled for easier detection
+  config.requireConsistentAcceleration = true; // Still verifying basic acceleration pattern
+  config.minFreefallDuration = 70;             // Reduced from 100ms for quicker detection
+  config.maxFreefallWindow = 450;              // Increased window for more detection opportunities
+  config.requiredConsecutiveImpacts = 1;       // Reduced from 2 to only require a single impact
+  config.useClassifier = true;                 // Filters out sitting down hard
+  config.verifyWindow = 1000;                  // Long enough to see whether the person is still
+  config.uprightAngle = 30.0f;                 // Standing or sitting, not lying
+  config.recoveryTime = 5000;                  // Sustained, not a failed attempt to get up
+  config.escalationTime = 30000;               // Repeat the alert every 30s while down
+  config.motionlessEscalationTime = 15000;     // Sooner if there is no movement at all
+  config.maxEscalations = 5;
+  return config;
+}
+
+void FallDetector::setConfig(const FallDetectorConfig &config) {
+  this->config = config;
+  uprightCos = cosf(config.uprightAngle * DEGREES_TO_RAD);
+}
+
+void FallDetector::reset() {
+  state = FALL_MONITORING;
+  stateStartTime = 0;
+  fallDetectedTime = 0;
+  impactSample = 0;
+  impactTime = 0;
+  peakAcceleration = 0;
+  minAcceleration = RESTING_ACCELERATION;
+  accelerationIntegral = 0;
+  consecutiveImpacts = 0;
+  startFeatureWindow();
+
+  upright = true;
+  uprightSince = 0;
+  lastMovementTime = 0;
+  lastEscalationTime = 0;
+  escalations = 0;
+  motionSum = 0;
+  motionSumSquares = 0;
+  motionSamples = 0;
+  motionBlockStart = 0;
+}
+
+void FallDetector::calibrate(float ax, float ay, float az, float gx, float gy, float gz) {
+  // Start the filter at the resting attitude so it does not have to converge
+  orientationFilter.setGyroBias(gx, gy, gz);
+  orientationFilter.reset(ax, ay, az);
+
+  OrientationAngles angles;
+  orientationFilter.getAngles(&angles);
+  baselinePitch = angles.pitch;
+  baselineRoll = angles.roll;
+  orientationFilter.getGravity(&baselineGravity[0], &baselineGravity[1], &baselineGravity[2]);
+}
+
+void FallDetector::startFeatureWindow() {
+  smaSum = 0;
+  windowSamples = 0;
+  peakJerk = 0;
+  stillSum = 0;
+  stillSumSquares = 0;
+  stillSamples = 0;
+}
+
+void FallDetector::computeFeatures(FallFeatures *features) const {
+  features->sma = windowSamples > 0 ? smaSum / windowSamples : 0;
+  features->jerk = peakJerk;
+
+  features->stillness = 0;
+  if (stillSamples > 1) {
+    float mean = stillSum / stillSamples;
+    float variance = stillSumSquares / stillSamples - mean * mean;
+    features->stillness = variance > 0 ? sqrtf(variance) : 0;
+  }
+
+  float gx, gy, gz;
+  orientationFilter.getGravity(&gx, &gy, &gz);
+  float dot = gx * baselineGravity[0] + gy * baselineGravity[1] + gz * baselineGravity[2];
+  dot = dot > 1.0f ? 1.0f : (dot < -1.0f ? -1.0f : dot);
+  features->orientationDelta = acosf(dot) * RAD_TO_DEGREES;
+}
+
+void FallDetector::startFreefall(uint32_t timeMs, float accMagnitude) {
+  state = FALL_POTENTIAL;
+  stateStartTime = timeMs;
+  peakAcceleration = 0;
+  minAcceleration = accMagnitude;
+  startFeatureWindow();
+}
+
+void FallDetector::confirmFall(uint32_t timeMs) {
+  state = FALL_CONFIRMED;
+  fallDetectedTime = timeMs;
+  upright = false;
+  lastMovementTime = timeMs;
+  lastEscalationTime = timeMs;
+  escalations = 0;
+  motionSum = 0;
+  motionSumSquares = 0;
+  motionSamples = 0;
+  motionBlockStart = timeMs;
+}
+
+FallDetectorResult FallDetector::trackPostFall(float accMagnitude, uint32_t timeMs) {
+  // Movement over the last block
+  float magnitudeG = accMagnitude / STANDARD_GRAVITY;
+  motionSum += magnitudeG;
+  motionSumSquares += magnitudeG * magnitudeG;
+  motionSamples++;
+  if (timeMs - motionBlockStart >= MOTION_BLOCK_MS) {
+    float mean = motionSum / motionSamples;
+    float variance = motionSumSquares / motionSamples - mean * mean;
+    if (variance > MOVEMENT_THRESHOLD_G * MOVEMENT_THRESHOLD_G) {
+      lastMovementTime = timeMs;
+    }
+    motionSum = 0;
+    motionSumSquares = 0;
+    motionSamples = 0;
+    motionBlockStart = timeMs;
+  }
+
+  // Upright when the gravity direction is back near the resting one
+  float gx, gy, gz;
+  orientationFilter.getGravity(&gx, &gy, &gz);
+  float dot = gx * baselineGravity[0] + gy * baselineGravity[1] + gz * baselineGravity[2];
+  bool nowUpright = dot >= uprightCos;
+  if (nowUpright && !upright) {
+    uprightSince = timeMs;
+  }
+  upright = nowUpright;
+
+  if (upright) {
+    // Falling again after getting up: the first fall is over, the new one starts now
+    if (accMagnitude < config.freefallThreshold) {
+      reset();
+      startFreefall(timeMs, accMagnitude);
+      return FALL_RESULT_RECOVERED;
+    }
+    if (timeMs - uprightSince >= config.recoveryTime) {
+      reset();
+      return FALL_RESULT_RECOVERED;
+    }
+    return FALL_RESULT_NONE;
+  }
+
+  if (escalations >= config.maxEscalations) {
+    return FALL_RESULT_NONE;
+  }
+
+  // Escalate every escalationTime while down, the first one sooner if motionless
+  bool due = timeMs - lastEscalationTime >= config.escalationTime;
+  if (escalations == 0 && timeMs - lastMovementTime >= config.motionlessEscalationTime) {
+    due = true;
+  }
+  if (due) {
+    escalations++;
+    lastEscalationTime = timeMs;
+    return FALL_RESULT_ESCALATE;
+  }
+  return FALL_RESULT_NONE;
+}
+
+void FallDetector::getPostFallStatus(PostFallStatus *status) const {
+  status->downMs = state == FALL_CONFIRMED ? lastSampleTime - fallDetectedTime : 0;
+  status->motionlessMs = state == FALL_CONFIRMED ? lastSampleTime - lastMovementTime : 0;
+  status->escalations = escalations;
+  status->upright = upright;
+}
+
+void FallDetector::fillDetection(FallDetection *detection, const FallFeatures &features, int32_t score) const {
+  OrientationAngles angles;
+  orientationFilter.getAngles(&angles);
+
+  detection->peakAcceleration = peakAcceleration;
+  detection->pitch = angles.pitch;
+  detection->roll = angles.roll;
+  detection->yaw = angles.yaw;
+  detection->pitchChange = angles.pitch - baselinePitch;
+  detection->rollChange = angles.roll - baselineRoll;
+  detection->samplesSinceImpact = sampleCount - impactSample;
+  detection->features = features;
+  detection->classifierScore = score;
+}
+
+FallDetectorResult FallDetector::processSample(float ax, float ay, float az,
+                                               float gx, float gy, float gz,
+                                               uint32_t timeMs, FallDetection *detection) {
+  sampleCount++;
+  lastSampleTime = timeMs;
+  orientationFilter.update(gx, gy, gz, ax, ay, az);
+
+  float accMagnitude = sqrtf(ax * ax + ay * ay + az * az);
+  float jerk = fabsf(accMagnitude - previousAccMagnitude) * sampleRateHz / STANDARD_GRAVITY;
+  previousAccMagnitude = accMagnitude;
+
+  // Update min/max values for analysis
+  if (accMagnitude > peakAcceleration) {
+    peakAcceleration = accMagnitude;
+  }
+  if (accMagnitude < minAcceleration) {
+    minAcceleration = accMagnitude;
+  }
+
+  FallDetectorResult result = FALL_RESULT_NONE;
+
+  switch (state) {
+    case FALL_MONITORING:
+      // Reset counters and integrals when in monitoring state
+      consecutiveImpacts = 0;
+      accelerationIntegral = 0;
+
+      // Look for potential freefall condition
+      if (accMagnitude < config.freefallThreshold) {
+        startFreefall(timeMs, accMagnitude);
+      }
+      break;
+
+    case FALL_POTENTIAL:
+      // Scaled to the reference rate so the pattern threshold is rate independent
+      accelerationIntegral += accMagnitude * ((float)FALL_REFERENCE_RATE_HZ / sampleRateHz);
+
+      // Confirm freefall persists for minimum duration, then look for an impact
+      if (timeMs - stateStartTime >= config.minFreefallDuration &&
+          accMagnitude > config.impactThreshold) {
+        consecutiveImpacts++;
+        if (consecutiveImpacts >= config.requiredConsecutiveImpacts) {
+          state = FALL_IMPACT_DETECTED;
+          stateStartTime = timeMs;
+          impactSample = sampleCount;
+          impactTime = timeMs;
+        }
+      }
+
+      // Reset if no impact detected within window
+      if (timeMs - stateStartTime > config.maxFreefallWindow) {
+        state = FALL_MONITORING;
+        consecutiveImpacts = 0;
+      }
+      break;
+
+    case FALL_IMPACT_DETECTED:
+      {
+        OrientationAngles angles;
+        orientationFilter.getAngles(&angles);
+        float pitchChange = angles.pitch - baselinePitch;
+        float rollChange = angles.roll - baselineRoll;
+
+        bool significantOrientationChange =
+          fabsf(pitchChange) > config.orientationChangeThreshold ||
+          fabsf(rollChange) > config.orientationChangeThreshold;
+
+        // A valid fall should have significant acceleration change over time.
+        // This helps filter out gentle movements and vibrations.
+        bool accelerationPatternValid = true;
+        if (config.requireConsistentAcceleration) {
+          // Tuned at the reference rate, where this check runs one sample
+          // period after the impact; the time elapsed here is shorter at
+          // higher rates, so divide by the reference period at every rate
+          float avgAcceleration = accelerationIntegral / (FALL_REFERENCE_PERIOD_MS + 1);
+          accelerationPatternValid = (avgAcceleration > 3.0f) &&
+                                     (peakAcceleration - minAcceleration > 10.0f);
+        }
+
+        if (!accelerationPatternValid ||
+            (config.requireOrientationChange && !significantOrientationChange)) {
+          state = FALL_MONITORING;
+        } else if (config.useClassifier) {
+          state = FALL_VERIFYING;
+        } else {
+          confirmFall(timeMs);
+          result = FALL_RESULT_FALL;
+          if (detection != NULL) {
+            FallFeatures none = {};
+            fillDetection(detection, none, 0);
+          }
+        }
+      }
+      break;
+
+    case FALL_VERIFYING:
+      if (timeMs - impactTime >= STILLNESS_SETTLE_MS) {
+        float magnitudeG = accMagnitude / STANDARD_GRAVITY;
+        stillSum += magnitudeG;
+        stillSumSquares += magnitudeG * magnitudeG;
+        stillSamples++;
+      }
+
+      if (timeMs - impactTime >= config.verifyWindow) {
+        FallFeatures features;
+        computeFeatures(&features);
+        int32_t score = scoreFall(features);
+
+        if (score >= 0) {
+          confirmFall(timeMs);
+          result = FALL_RESULT_FALL;
+        } else {
+          state = FALL_MONITORING;
+          result = FALL_RESULT_REJECTED;
+        }
+        if (detection != NULL) {
+          fillDetection(detection, features, score);
+        }
+      }
+      break;
+
+    case FALL_CONFIRMED:
+      result = trackPostFall(accMagnitude, timeMs);
+      break;
+  }
+
+  // Features cover the candidate from the start of free fall
+  if (state == FALL_POTENTIAL || state == FALL_IMPACT_DETECTED || state == FALL_VERIFYING) {
+    smaSum += (fabsf(ax) + fabsf(ay) + fabsf(az)) / STANDARD_GRAVITY;
+    windowSamples++;
+    if (jerk > peakJerk) {
+      peakJerk = jerk;
+    }
+  }
+
+  return result;
+}
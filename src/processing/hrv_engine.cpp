@@ -0,0 +1,111 @@
+/**
+ * ElderGuard - Heart Rate Variability Engine Implementation
+ *
+ * Successive differences are only counted between intervals that share a
+ * beat, so gaps from missed or rejected beats do not inflate RMSSD.
+ */
+
+#include <math.h>
+#include "../include/hrv_engine.h"
+
+#define NN50_THRESHOLD_MS 50             // Successive difference counted by pNN50
+
+HrvEngine::HrvEngine(uint32_t windowMs) : windowMs(windowMs) {
+  if (this->windowMs < HRV_MIN_WINDOW_MS) {
+    this->windowMs = HRV_MIN_WINDOW_MS;
+  } else if (this->windowMs > HRV_MAX_WINDOW_MS) {
+    this->windowMs = HRV_MAX_WINDOW_MS;
+  }
+  reset();
+}
+
+void HrvEngine::reset() {
+  head = 0;
+  count = 0;
+  sumRR = 0;
+  sumSquaresRR = 0;
+  sumSquaredDiffs = 0;
+  diffCount = 0;
+  nn50Count = 0;
+}
+
+void HrvEngine::evictOldest() {
+  uint32_t rr = rrIntervals[head];
+  sumRR -= rr;
+  sumSquaresRR -= (uint64_t)rr * rr;
+
+  // The next interval loses its successive difference
+  int next = (head + 1) % HRV_MAX_INTERVALS;
+  if (count > 1 && followsPrevious[next]) {
+    int32_t diff = (int32_t)rrIntervals[next] - (int32_t)rr;
+    uint32_t absDiff = diff < 0 ? -diff : diff;
+    sumSquaredDiffs -= (uint64_t)absDiff * absDiff;
+    diffCount--;
+    if (absDiff > NN50_THRESHOLD_MS) {
+      nn50Count--;
+    }
+    followsPrevious[next] = false;
+  }
+
+  head = next;
+  count--;
+}
+
+void HrvEngine::addInterval(uint32_t beatTimeMs, uint32_t rrInterval) {
+  if (count == HRV_MAX_INTERVALS) {
+    evictOldest();
+  }
+
+  int tail = (head + count) % HRV_MAX_INTERVALS;
+  bool follows = false;
+
+  if (count > 0) {
+    int last = (tail + HRV_MAX_INTERVALS - 1) % HRV_MAX_INTERVALS;
+    // Adjacent intervals share a beat: this interval started where the last one ended
+    follows = (beatTimeMs - rrInterval == beatTimes[last]);
+    if (follows) {
+      int32_t diff = (int32_t)rrInterval - (int32_t)rrIntervals[last];
+      uint32_t absDiff = diff < 0 ? -diff : diff;
+      sumSquaredDiffs += (uint64_t)absDiff * absDiff;
+      diffCount++;
+      if (absDiff > NN50_THRESHOLD_MS) {
+        nn50Count++;
+      }
+    }
+  }
+
+  beatTimes[tail] = beatTimeMs;
+  rrIntervals[tail] = (uint16_t)rrInterval;
+  followsPrevious[tail] = follows;
+  count++;
+
+  sumRR += rrInterval;
+  sumSquaresRR += (uint64_t)rrInterval * rrInterval;
+
+  expire(beatTimeMs);
+}
+
+void HrvEngine::expire(uint32_t nowMs) {
+  while (count > 0 && nowMs - beatTimes[head] > windowMs) {
+    evictOldest();
+  }
+}
+
+void HrvEngine::getMetrics(HrvMetrics *metrics) const {
+  metrics->intervals = count;
+  metrics->sdnn = 0;
+  metrics->rmssd = 0;
+  metrics->pnn50 = 0;
+
+  if (count > 1) {
+    // Sample variance from exact integer sums: (n*sum(x^2) - sum(x)^2) / (n*(n-1))
+    uint64_t n = (uint64_t)count;
+    uint64_t spread = n * sumSquaresRR - (uint64_t)sumRR * sumRR;
+    metrics->sdnn = sqrtf((float)((double)spread / (double)(n * (n - 1))));
+  }
+
+  if (diffCount > 0) {
+    metrics->rmssd = sqrtf((float)((double)sumSquaredDiffs / diffCount));
+    metrics->pnn50 = 100.0f * nn50Count / diffCount;
+  }
+}
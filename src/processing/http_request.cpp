@@ -0,0 +1,54 @@
+/**
+ * ElderGuard - HTTP/1.1 Request Framing Implementation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "../include/http_request.h"
+
+HttpRequest::HttpRequest() : data(NULL), dataLength(0), tail(NULL), tailLength(0) {
+  memset(arena, 0, sizeof(arena));
+}
+
+bool HttpRequest::frame(const char *host, const char *path, const char *contentType,
+                        const char *extraHeaders, const uint8_t *body, int length) {
+  char *bodySlot = getBody();
+  bool inArena = body == (const uint8_t*)bodySlot;
+  if (!inArena && length <= HTTP_REQUEST_BODY_MAX) {
+    memcpy(bodySlot, body, length);
+    inArena = true;
+  }
+
+  int headLength = snprintf(arena, HTTP_REQUEST_HEAD_MAX,
+                            "POST %s HTTP/1.1\r\n"
+                            "Host: %s\r\n"
+                            "User-Agent: ElderGuard\r\n"
+                            "Accept: application/json\r\n"
+                            "Connection: keep-alive\r\n"
+                            "Content-Type: %s\r\n"
+                            "Content-Length: %d\r\n"
+                            "%s\r\n",
+                            path, host, contentType, length, extraHeaders != NULL ? extraHeaders : "");
+  if (headLength < 0 || headLength >= HTTP_REQUEST_HEAD_MAX) {
+    data = NULL;
+    dataLength = 0;
+    tail = NULL;
+    tailLength = 0;
+    return false;
+  }
+
+  // Move the head up against the body
+  char *head = bodySlot - headLength;
+  memmove(head, arena, headLength);
+  data = (const uint8_t*)head;
+  if (inArena) {
+    dataLength = headLength + length;
+    tail = NULL;
+    tailLength = 0;
+  } else {
+    dataLength = headLength;
+    tail = body;
+    tailLength = length;
+  }
+  return true;
+}
@@ -0,0 +1,199 @@
+/**
+ * ElderGuard - HTTP/1.1 Response Parser Implementation
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "../include/http_response.h"
+
+HttpResponseParser::HttpResponseParser() {
+  begin(NULL, 0);
+}
+
+void HttpResponseParser::begin(char *body, int bodyCapacity) {
+  state = STATE_STATUS_LINE;
+  status = 0;
+  keepAlive = false;
+  chunked = false;
+  contentLength = -1;
+  remaining = 0;
+  lineLength = 0;
+  this->body = body;
+  this->bodyCapacity = bodyCapacity;
+  bodyLength = 0;
+  if (body != NULL && bodyCapacity > 0) {
+    body[0] = '\0';
+  }
+}
+
+/**
+ * Whether a header line has the given name, ignoring case
+ *
+ * @return The value with leading spaces skipped, or NULL
+ */
+static const char *headerValue(const char *line, const char *name) {
+  size_t nameLength = strlen(name);
+  if (strncasecmp(line, name, nameLength) != 0 || line[nameLength] != ':') {
+    return NULL;
+  }
+  const char *value = &line[nameLength + 1];
+  while (*value == ' ' || *value == '\t') {
+    value++;
+  }
+  return value;
+}
+
+/**
+ * Whether a header value contains a word, ignoring case
+ */
+static bool hasToken(const char *value, const char *token) {
+  size_t tokenLength = strlen(token);
+  for (; *value != '\0'; value++) {
+    if (strncasecmp(value, token, tokenLength) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void HttpResponseParser::handleLine() {
+  switch (state) {
+    case STATE_STATUS_LINE: {
+      // "HTTP/1.1 200 OK"; HTTP/1.0 closes unless asked to keep alive
+      if (strncmp(line, "HTTP/1.", 7) != 0 || line[8] != ' ') {
+        state = STATE_ERROR;
+        return;
+      }
+      status = atoi(&line[9]);
+      if (status < 100 || status > 999) {
+        state = STATE_ERROR;
+        return;
+      }
+      keepAlive = line[7] == '1';
+      chunked = false;
+      contentLength = -1;
+      state = STATE_HEADERS;
+      break;
+    }
+
+    case STATE_HEADERS: {
+      if (lineLength == 0) {
+        endHeaders();
+        return;
+      }
+      const char *value;
+      if ((value = headerValue(line, "Content-Length")) != NULL) {
+        char *end;
+        contentLength = strtol(value, &end, 10);
+        if (end == value || contentLength < 0) {
+          state = STATE_ERROR;
+        }
+      } else if ((value = headerValue(line, "Transfer-Encoding")) != NULL) {
+        chunked = hasToken(value, "chunked");
+      } else if ((value = headerValue(line, "Connection")) != NULL) {
+        if (hasToken(value, "close")) {
+          keepAlive = false;
+        } else if (hasToken(value, "keep-alive")) {
+          keepAlive = true;
+        }
+      }
+      break;
+    }
+
+    case STATE_CHUNK_SIZE: {
+      // Hex size, maybe followed by ";extensions"
+      char *end;
+      remaining = strtol(line, &end, 16);
+      if (end == line || remaining < 0) {
+        state = STATE_ERROR;
+      } else {
+        state = remaining == 0 ? STATE_TRAILERS : STATE_CHUNK_DATA;
+      }
+      break;
+    }
+
+    case STATE_CHUNK_END:
+      state = lineLength == 0 ? STATE_CHUNK_SIZE : STATE_ERROR;
+      break;
+
+    case STATE_TRAILERS:
+      if (lineLength == 0) {
+        state = STATE_DONE;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+void HttpResponseParser::endHeaders() {
+  if (status < 200) {
+    // Interim response such as 100 Continue: the real one follows
+    state = STATE_STATUS_LINE;
+  } else if (status == 204 || status == 304) {
+    state = STATE_DONE;
+  } else if (chunked) {
+    state = STATE_CHUNK_SIZE;
+  } else if (contentLength >= 0) {
+    remaining = contentLength;
+    state = remaining == 0 ? STATE_DONE : STATE_BODY;
+  } else {
+    // No framing: the body ends when the server closes
+    keepAlive = false;
+    state = STATE_BODY_UNTIL_CLOSE;
+  }
+}
+
+void HttpResponseParser::keepBody(const uint8_t *data, int length) {
+  int room = bodyCapacity - 1 - bodyLength;
+  if (body == NULL || room <= 0) {
+    return;
+  }
+  int n = length < room ? length : room;
+  memcpy(&body[bodyLength], data, n);
+  bodyLength += n;
+  body[bodyLength] = '\0';
+}
+
+int HttpResponseParser::feed(const uint8_t *data, int length) {
+  int used = 0;
+  while (used < length && state != STATE_DONE && state != STATE_ERROR) {
+    if (state == STATE_BODY || state == STATE_CHUNK_DATA || state == STATE_BODY_UNTIL_CLOSE) {
+      int n = length - used;
+      if (state != STATE_BODY_UNTIL_CLOSE && n > remaining) {
+        n = (int)remaining;
+      }
+      keepBody(&data[used], n);
+      used += n;
+      if (state != STATE_BODY_UNTIL_CLOSE) {
+        remaining -= n;
+        if (remaining == 0) {
+          state = state == STATE_BODY ? STATE_DONE : STATE_CHUNK_END;
+        }
+      }
+      continue;
+    }
+
+    // Line-based states: collect up to LF, dropping CR and overflow
+    char c = (char)data[used++];
+    if (c == '\n') {
+      line[lineLength] = '\0';
+      handleLine();
+      lineLength = 0;
+    } else if (c != '\r' && lineLength < HTTP_LINE_MAX - 1) {
+      line[lineLength++] = c;
+    }
+  }
+  return used;
+}
+
+void HttpResponseParser::closed() {
+  if (state == STATE_BODY_UNTIL_CLOSE) {
+    state = STATE_DONE;
+  } else if (state != STATE_DONE) {
+    state = STATE_ERROR;
+  }
+  keepAlive = false;
+}
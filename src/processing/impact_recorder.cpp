@@ -0,0 +1,128 @@
+/**
+ * ElderGuard - Impact Recorder Implementation
+ *
+ * The ring is larger than the capture window, so the frozen samples are
+ * never overwritten before the post-impact part is complete and the ring
+ * can keep running through the capture without a copy.
+ */
+
+#include <string.h>
+#include "../include/impact_recorder.h"
+
+#define IMPACT_BLOB_VERSION 1
+
+static void putUint16(uint8_t *out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+static void putUint32(uint8_t *out, uint32_t value) {
+  putUint16(out, (uint16_t)value);
+  putUint16(out + 2, (uint16_t)(value >> 16));
+}
+
+ImpactRecorder::ImpactRecorder(int sampleRateHz, int preMs, int postMs,
+                               uint16_t accelLsbPerG, uint16_t gyroLsbPer10Dps)
+    : head(0), sampleRateHz(sampleRateHz),
+      accelLsbPerG(accelLsbPerG), gyroLsbPer10Dps(gyroLsbPer10Dps),
+      capturing(false), windowStart(0), windowEnd(0), impactIndex(0), timestampMs(0),
+      blobLength(0), holders(0), captureId(0), missed(0) {
+  memset(ring, 0, sizeof(ring));
+
+  postSamples = (uint32_t)postMs * sampleRateHz / 1000;
+  preSamples = (uint32_t)preMs * sampleRateHz / 1000;
+
+  // The whole window, impact included, has to fit in the ring
+  if (postSamples > IMPACT_RING_CAPACITY - 1) {
+    postSamples = IMPACT_RING_CAPACITY - 1;
+  }
+  if (preSamples + postSamples + 1 > IMPACT_RING_CAPACITY) {
+    preSamples = IMPACT_RING_CAPACITY - 1 - postSamples;
+  }
+}
+
+bool ImpactRecorder::addSample(const ImpactSample &sample) {
+  ring[head & MASK] = sample;
+  head++;
+
+  if (capturing && head == windowEnd) {
+    capturing = false;
+    encode();
+    return true;
+  }
+  return false;
+}
+
+bool ImpactRecorder::trigger(uint32_t impactSample, uint32_t timestampMs) {
+  // An impact whose post-impact window has already gone by cannot be captured
+  if (capturing || holders.load(std::memory_order_acquire) > 0 ||
+      head - impactSample > postSamples) {
+    missed++;
+    return false;
+  }
+
+  // Fewer samples than the pre-impact window right after boot
+  uint32_t available = impactSample < preSamples ? impactSample : preSamples;
+
+  windowStart = impactSample - available;
+  windowEnd = impactSample + postSamples + 1;
+  impactIndex = available;
+  this->timestampMs = timestampMs;
+  capturing = true;
+  return true;
+}
+
+void ImpactRecorder::encode() {
+  uint32_t count = windowEnd - windowStart;
+  captureId++;
+
+  memcpy(blob, "EGIC", 4);
+  blob[4] = IMPACT_BLOB_VERSION;
+  blob[5] = IMPACT_AXES;
+  putUint16(&blob[6], (uint16_t)sampleRateHz);
+  putUint16(&blob[8], (uint16_t)count);
+  putUint16(&blob[10], (uint16_t)impactIndex);
+  putUint16(&blob[12], accelLsbPerG);
+  putUint16(&blob[14], gyroLsbPer10Dps);
+  putUint32(&blob[16], timestampMs);
+  putUint32(&blob[20], captureId);
+
+  int pos = IMPACT_HEADER_BYTES;
+  const ImpactSample &first = ring[windowStart & MASK];
+  for (int axis = 0; axis < IMPACT_AXES; axis++) {
+    putUint16(&blob[pos], (uint16_t)first.axes[axis]);
+    pos += 2;
+  }
+
+  for (uint32_t i = 1; i < count; i++) {
+    const ImpactSample &previous = ring[(windowStart + i - 1) & MASK];
+    const ImpactSample &current = ring[(windowStart + i) & MASK];
+    for (int axis = 0; axis < IMPACT_AXES; axis++) {
+      int32_t delta = (int32_t)current.axes[axis] - (int32_t)previous.axes[axis];
+      uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+      while (zigzag >= 0x80) {
+        blob[pos++] = (uint8_t)(zigzag | 0x80);
+        zigzag >>= 7;
+      }
+      blob[pos++] = (uint8_t)zigzag;
+    }
+  }
+
+  blobLength = pos;
+}
+
+void ImpactRecorder::holdBlob(int readers) {
+  holders.store(readers, std::memory_order_release);
+}
+
+const uint8_t *ImpactRecorder::getBlob(int *length) const {
+  *length = blobLength;
+  return blob;
+}
+
+void ImpactRecorder::releaseBlob() {
+  int current = holders.load(std::memory_order_relaxed);
+  while (current > 0 &&
+         !holders.compare_exchange_weak(current, current - 1, std::memory_order_acq_rel)) {
+  }
+}
@@ -0,0 +1,174 @@
+/**
+ * ElderGuard - MQTT QoS 1 In-Flight Window Implementation
+ *
+ * Incoming bytes are framed as MQTT control packets: one type byte, the
+ * remaining length as a 1-4 byte varint, then the body. Only PUBACK
+ * bodies (the packet id) are kept; everything else is skipped.
+ */
+
+#include <string.h>
+#include "../include/mqtt_inflight.h"
+
+#define MQTT_PUBLISH_QOS1 0x32
+#define MQTT_DUP_FLAG 0x08
+#define MQTT_TYPE_PUBACK 4
+
+#define FRAME_TYPE 0
+#define FRAME_LENGTH 1
+#define FRAME_BODY 2
+
+MqttInflightWindow::MqttInflightWindow(uint32_t retryMs)
+    : count(0), retryMs(retryMs), nextPacketId(1),
+      packetType(0), remaining(0), lengthShift(0), state(FRAME_TYPE), bodyFill(0),
+      acked(0), retransmits(0), worstAckMs(0) {
+  for (int i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    slots[i].used = false;
+  }
+}
+
+MqttInflightResult MqttInflightWindow::add(const char *topic, const uint8_t *payload, int length,
+                                           uint32_t nowMs, const uint8_t **packet, int *packetLength) {
+  int topicLength = strlen(topic);
+  if (length < 0 || mqttPublishPacketBytes(topicLength, length) > MQTT_INFLIGHT_MAX_PACKET) {
+    return MQTT_INFLIGHT_TOO_LARGE;
+  }
+
+  Slot *slot = NULL;
+  for (int i = 0; i < MQTT_INFLIGHT_WINDOW && slot == NULL; i++) {
+    if (!slots[i].used) {
+      slot = &slots[i];
+    }
+  }
+  if (slot == NULL) {
+    return MQTT_INFLIGHT_FULL;
+  }
+
+  uint32_t remainingLength = 2 + topicLength + 2 + length;
+  uint8_t lengthBytes[4];
+  int lengthSize = 0;
+  uint32_t value = remainingLength;
+  do {
+    lengthBytes[lengthSize] = value & 0x7F;
+    value >>= 7;
+    if (value > 0) {
+      lengthBytes[lengthSize] |= 0x80;
+    }
+    lengthSize++;
+  } while (value > 0 && lengthSize < 4);
+
+  // Packet id 0 is not allowed
+  uint16_t packetId = nextPacketId;
+  nextPacketId = nextPacketId == 0xFFFF ? 1 : nextPacketId + 1;
+
+  uint8_t *out = slot->packet;
+  int pos = 0;
+  out[pos++] = MQTT_PUBLISH_QOS1;
+  memcpy(&out[pos], lengthBytes, lengthSize);
+  pos += lengthSize;
+  out[pos++] = (uint8_t)(topicLength >> 8);
+  out[pos++] = (uint8_t)topicLength;
+  memcpy(&out[pos], topic, topicLength);
+  pos += topicLength;
+  out[pos++] = (uint8_t)(packetId >> 8);
+  out[pos++] = (uint8_t)packetId;
+  memcpy(&out[pos], payload, length);
+  pos += length;
+
+  slot->used = true;
+  slot->due = false;
+  slot->packetId = packetId;
+  slot->firstSentMs = nowMs;
+  slot->lastSentMs = nowMs;
+  slot->length = pos;
+  count++;
+
+  *packet = slot->packet;
+  *packetLength = pos;
+  return MQTT_INFLIGHT_ADDED;
+}
+
+const uint8_t *MqttInflightWindow::nextRetransmit(uint32_t nowMs, int *packetLength) {
+  // Oldest first, so the broker sees them in their original order
+  Slot *oldest = NULL;
+  for (int i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    Slot &slot = slots[i];
+    if (!slot.used || !(slot.due || nowMs - slot.lastSentMs >= retryMs)) {
+      continue;
+    }
+    if (oldest == NULL || (int32_t)(slot.firstSentMs - oldest->firstSentMs) < 0) {
+      oldest = &slot;
+    }
+  }
+  if (oldest == NULL) {
+    return NULL;
+  }
+
+  oldest->due = false;
+  oldest->lastSentMs = nowMs;
+  oldest->packet[0] |= MQTT_DUP_FLAG;
+  retransmits++;
+  *packetLength = oldest->length;
+  return oldest->packet;
+}
+
+void MqttInflightWindow::reconnected() {
+  for (int i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    slots[i].due = slots[i].used;
+  }
+  state = FRAME_TYPE;
+}
+
+void MqttInflightWindow::receive(const uint8_t *data, int length, uint32_t nowMs) {
+  for (int i = 0; i < length; i++) {
+    uint8_t byte = data[i];
+    switch (state) {
+      case FRAME_TYPE:
+        packetType = byte >> 4;
+        remaining = 0;
+        lengthShift = 0;
+        bodyFill = 0;
+        state = FRAME_LENGTH;
+        break;
+
+      case FRAME_LENGTH:
+        remaining |= (uint32_t)(byte & 0x7F) << lengthShift;
+        lengthShift += 7;
+        if ((byte & 0x80) == 0) {
+          state = remaining > 0 ? FRAME_BODY : FRAME_TYPE;
+        } else if (lengthShift > 21) {
+          // Not a valid length; resynchronise on the next byte
+          state = FRAME_TYPE;
+        }
+        break;
+
+      case FRAME_BODY:
+        if (packetType == MQTT_TYPE_PUBACK && bodyFill < 2) {
+          body[bodyFill++] = byte;
+        }
+        remaining--;
+        if (remaining == 0) {
+          if (packetType == MQTT_TYPE_PUBACK && bodyFill == 2) {
+            acknowledge(((uint16_t)body[0] << 8) | body[1], nowMs);
+          }
+          state = FRAME_TYPE;
+        }
+        break;
+    }
+  }
+}
+
+void MqttInflightWindow::acknowledge(uint16_t packetId, uint32_t nowMs) {
+  for (int i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    Slot &slot = slots[i];
+    if (slot.used && slot.packetId == packetId) {
+      uint32_t ackMs = nowMs - slot.firstSentMs;
+      if (ackMs > worstAckMs) {
+        worstAckMs = ackMs;
+      }
+      slot.used = false;
+      count--;
+      acked++;
+      return;
+    }
+  }
+}
@@ -0,0 +1,152 @@
+/**
+ * ElderGuard - IMU Orientation Filter Implementation
+ *
+ * The quaternion rotates the earth frame into the sensor frame (Madgwick's
+ * convention), so the gravity direction seen by the sensor is its third
+ * rotation-matrix row. Reporting tilt from that vector keeps the angle
+ * definitions of the old accelerometer-only code and its thresholds.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "../include/orientation_filter.h"
+
+#define STANDARD_GRAVITY 9.80665f
+#define RAD_TO_DEGREES 57.29578f
+
+// Squared accelerometer magnitudes accepted as a gravity reference
+static const float GATE_MIN_SQUARED = (1.0f - ORIENTATION_ACCEL_GATE) * (1.0f - ORIENTATION_ACCEL_GATE) *
+                                      STANDARD_GRAVITY * STANDARD_GRAVITY;
+static const float GATE_MAX_SQUARED = (1.0f + ORIENTATION_ACCEL_GATE) * (1.0f + ORIENTATION_ACCEL_GATE) *
+                                      STANDARD_GRAVITY * STANDARD_GRAVITY;
+
+/**
+ * 1/sqrt(x) from the bit-level initial guess plus two Newton steps
+ * (relative error below 5e-6)
+ */
+static inline float invSqrt(float x) {
+  float half = 0.5f * x;
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  bits = 0x5f3759df - (bits >> 1);
+  float y;
+  memcpy(&y, &bits, sizeof(y));
+  y = y * (1.5f - half * y * y);
+  y = y * (1.5f - half * y * y);
+  return y;
+}
+
+OrientationFilter::OrientationFilter(int sampleRateHz, float beta)
+    : samplePeriod(1.0f / sampleRateHz), beta(beta),
+      biasX(0), biasY(0), biasZ(0), gyroOnlySamples(0) {
+  reset(0, 0, 1);
+}
+
+void OrientationFilter::reset(float ax, float ay, float az) {
+  float norm = ax * ax + ay * ay + az * az;
+  if (norm <= 0) {
+    ax = 0;
+    ay = 0;
+    az = 1;
+  } else {
+    float recipNorm = invSqrt(norm);
+    ax *= recipNorm;
+    ay *= recipNorm;
+    az *= recipNorm;
+  }
+
+  // Shortest rotation taking vertical onto the measured gravity direction
+  if (az < -0.999f) {
+    q0 = 0;
+    q1 = 1;
+    q2 = 0;
+  } else {
+    q0 = sqrtf(0.5f * (1.0f + az));
+    q1 = ay / (2.0f * q0);
+    q2 = -ax / (2.0f * q0);
+  }
+  q3 = 0;
+}
+
+void OrientationFilter::setGyroBias(float bx, float by, float bz) {
+  biasX = bx;
+  biasY = by;
+  biasZ = bz;
+}
+
+void OrientationFilter::update(float gx, float gy, float gz, float ax, float ay, float az) {
+  gx -= biasX;
+  gy -= biasY;
+  gz -= biasZ;
+
+  // Rate of change of the quaternion from the gyro
+  float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+  float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+  float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+  float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+  float accelSquared = ax * ax + ay * ay + az * az;
+  if (accelSquared >= GATE_MIN_SQUARED && accelSquared <= GATE_MAX_SQUARED) {
+    float recipNorm = invSqrt(accelSquared);
+    ax *= recipNorm;
+    ay *= recipNorm;
+    az *= recipNorm;
+
+    float _2q0 = 2.0f * q0;
+    float _2q1 = 2.0f * q1;
+    float _2q2 = 2.0f * q2;
+    float _2q3 = 2.0f * q3;
+    float _4q0 = 4.0f * q0;
+    float _4q1 = 4.0f * q1;
+    float _4q2 = 4.0f * q2;
+    float _8q1 = 8.0f * q1;
+    float _8q2 = 8.0f * q2;
+    float q0q0 = q0 * q0;
+    float q1q1 = q1 * q1;
+    float q2q2 = q2 * q2;
+    float q3q3 = q3 * q3;
+
+    // Gradient of the error between measured and estimated gravity
+    float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+    float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+    float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+    float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+
+    float stepSquared = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+    if (stepSquared > 0) {
+      recipNorm = invSqrt(stepSquared);
+      qDot0 -= beta * s0 * recipNorm;
+      qDot1 -= beta * s1 * recipNorm;
+      qDot2 -= beta * s2 * recipNorm;
+      qDot3 -= beta * s3 * recipNorm;
+    }
+  } else {
+    gyroOnlySamples++;
+  }
+
+  q0 += qDot0 * samplePeriod;
+  q1 += qDot1 * samplePeriod;
+  q2 += qDot2 * samplePeriod;
+  q3 += qDot3 * samplePeriod;
+
+  float recipNorm = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  q0 *= recipNorm;
+  q1 *= recipNorm;
+  q2 *= recipNorm;
+  q3 *= recipNorm;
+}
+
+void OrientationFilter::getGravity(float *gx, float *gy, float *gz) const {
+  *gx = 2.0f * (q1 * q3 - q0 * q2);
+  *gy = 2.0f * (q0 * q1 + q2 * q3);
+  *gz = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+}
+
+void OrientationFilter::getAngles(OrientationAngles *angles) const {
+  float gx, gy, gz;
+  getGravity(&gx, &gy, &gz);
+
+  angles->pitch = atan2f(gx, sqrtf(gy * gy + gz * gz)) * RAD_TO_DEGREES;
+  angles->roll = atan2f(gy, sqrtf(gx * gx + gz * gz)) * RAD_TO_DEGREES;
+  angles->yaw = atan2f(sqrtf(gx * gx + gy * gy), gz) * RAD_TO_DEGREES;
+}
@@ -0,0 +1,353 @@
+/**
+ * ElderGuard - Store-and-Forward Outbox Implementation
+ *
+ * Every write to a segment file is one whole OUTBOX_PAGE_BYTES page, so a
+ * flash page is programmed once and never read back and rewritten. A
+ * record may straddle pages; padding (0xFF, the erased flash value) only
+ * appears where a partial page was forced out.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include "../include/outbox.h"
+
+#define OUTBOX_MARKER 0xA6
+#define OUTBOX_MARKER_UNTIMED 0xA5       // Earlier layout: no creation time
+#define OUTBOX_UNTIMED_HEADER_BYTES 8
+#define OUTBOX_PADDING 0xFF
+#define OUTBOX_MAX_PAYLOAD 0xFFFF
+
+static void putUint16(uint8_t *out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+static void putUint32(uint8_t *out, uint32_t value) {
+  putUint16(out, (uint16_t)value);
+  putUint16(out + 2, (uint16_t)(value >> 16));
+}
+
+static uint32_t getUint32(const uint8_t *in) {
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+/**
+ * CRC-32 (IEEE, reflected) with a 16-entry table
+ */
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, int length) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+  for (int i = 0; i < length; i++) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+  }
+  return crc;
+}
+
+/**
+ * @param timed Include the creation time; records in the earlier layout do not
+ */
+static uint32_t recordCrc(uint8_t type, uint16_t length, bool timed, uint32_t createdAt, const uint8_t *payload) {
+  uint8_t header[7] = { type, (uint8_t)length, (uint8_t)(length >> 8) };
+  putUint32(&header[3], createdAt);
+  uint32_t crc = crc32Update(0xFFFFFFFF, header, timed ? 7 : 3);
+  return ~crc32Update(crc, payload, length);
+}
+
+Outbox::Outbox(const char *directory, const char *prefix, int segmentBytes, int maxSegments)
+    : segmentBytes(segmentBytes), maxSegments(maxSegments),
+      firstSegment(0), writeSegment(0), writeFile(NULL), writeOffset(0), pageFill(0),
+      readSegment(0), readOffset(0), commitSegment(0), commitOffset(0), readFile(NULL),
+      readHeaderBytes(OUTBOX_RECORD_HEADER_BYTES), readCreatedAt(0), appended(0), droppedSegments(0), corrupt(0) {
+  strncpy(this->directory, directory, sizeof(this->directory) - 1);
+  this->directory[sizeof(this->directory) - 1] = '\0';
+  strncpy(this->prefix, prefix, sizeof(this->prefix) - 1);
+  this->prefix[sizeof(this->prefix) - 1] = '\0';
+
+  // Whole pages only, and at least one
+  this->segmentBytes -= this->segmentBytes % OUTBOX_PAGE_BYTES;
+  if (this->segmentBytes < OUTBOX_PAGE_BYTES) {
+    this->segmentBytes = OUTBOX_PAGE_BYTES;
+  }
+  if (this->maxSegments < 2) {
+    this->maxSegments = 2;
+  }
+}
+
+void Outbox::segmentPath(uint32_t segment, char *path) const {
+  snprintf(path, OUTBOX_PATH_MAX + 32, "%s/%s%08lx", directory, prefix, (unsigned long)segment);
+}
+
+bool Outbox::begin() {
+  DIR *dir = opendir(directory);
+  if (dir == NULL) {
+    return false;
+  }
+
+  size_t prefixLength = strlen(prefix);
+  bool found = false;
+  uint32_t lowest = 0;
+  uint32_t highest = 0;
+
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    // SPIFFS has no directories; some builds report the leading slash
+    const char *name = entry->d_name[0] == '/' ? entry->d_name + 1 : entry->d_name;
+    if (strncmp(name, prefix, prefixLength) != 0 || strlen(name) != prefixLength + 8) {
+      continue;
+    }
+    char *end;
+    uint32_t segment = (uint32_t)strtoul(name + prefixLength, &end, 16);
+    if (*end != '\0') {
+      continue;
+    }
+    if (!found || (int32_t)(segment - lowest) < 0) {
+      lowest = segment;
+    }
+    if (!found || (int32_t)(segment - highest) > 0) {
+      highest = segment;
+    }
+    found = true;
+  }
+  closedir(dir);
+
+  // Everything left by an earlier run is sealed; appends start a new segment
+  firstSegment = found ? lowest : 0;
+  writeSegment = found ? highest + 1 : 0;
+  readSegment = firstSegment;
+  readOffset = 0;
+  commitSegment = firstSegment;
+  commitOffset = 0;
+  return true;
+}
+
+bool Outbox::openWriteSegment() {
+  // Make room for the segment about to be opened
+  while ((int)(writeSegment - firstSegment) + 1 > maxSegments) {
+    deleteSegment(firstSegment);
+    droppedSegments++;
+    firstSegment++;
+    if ((int32_t)(readSegment - firstSegment) < 0) {
+      if (readFile != NULL) {
+        fclose(readFile);
+        readFile = NULL;
+      }
+      readSegment = firstSegment;
+      readOffset = 0;
+    }
+    if ((int32_t)(commitSegment - firstSegment) < 0) {
+      commitSegment = firstSegment;
+      commitOffset = 0;
+    }
+  }
+
+  char path[OUTBOX_PATH_MAX + 32];
+  segmentPath(writeSegment, path);
+  writeFile = fopen(path, "wb");
+  writeOffset = 0;
+  pageFill = 0;
+  return writeFile != NULL;
+}
+
+bool Outbox::writePage(bool pad) {
+  if (pad) {
+    memset(&page[pageFill], OUTBOX_PADDING, OUTBOX_PAGE_BYTES - pageFill);
+  }
+  bool ok = fwrite(page, 1, OUTBOX_PAGE_BYTES, writeFile) == OUTBOX_PAGE_BYTES &&
+            fflush(writeFile) == 0;
+  writeOffset += OUTBOX_PAGE_BYTES;
+  pageFill = 0;
+  return ok;
+}
+
+void Outbox::closeWriteSegment() {
+  if (pageFill > 0) {
+    writePage(true);
+  }
+  fclose(writeFile);
+  writeFile = NULL;
+  writeSegment++;
+}
+
+void Outbox::deleteSegment(uint32_t segment) {
+  char path[OUTBOX_PATH_MAX + 32];
+  segmentPath(segment, path);
+  remove(path);
+}
+
+bool Outbox::append(uint8_t type, const void *data, int length, bool durable, uint32_t createdAt) {
+  int size = OUTBOX_RECORD_HEADER_BYTES + length;
+  if (length < 0 || length > OUTBOX_MAX_PAYLOAD || size > segmentBytes) {
+    return false;
+  }
+
+  if (writeFile == NULL && !openWriteSegment()) {
+    return false;
+  }
+  if (writeOffset + pageFill + size > segmentBytes) {
+    closeWriteSegment();
+    if (!openWriteSegment()) {
+      return false;
+    }
+  }
+
+  uint8_t header[OUTBOX_RECORD_HEADER_BYTES];
+  header[0] = OUTBOX_MARKER;
+  header[1] = type;
+  putUint16(&header[2], (uint16_t)length);
+  putUint32(&header[4], recordCrc(type, (uint16_t)length, true, createdAt, (const uint8_t *)data));
+  putUint32(&header[8], createdAt);
+
+  // Header then payload through the page buffer, writing each page as it fills
+  bool ok = true;
+  const uint8_t *parts[2] = { header, (const uint8_t *)data };
+  int partLengths[2] = { OUTBOX_RECORD_HEADER_BYTES, length };
+  for (int part = 0; part < 2; part++) {
+    const uint8_t *source = parts[part];
+    int remaining = partLengths[part];
+    while (remaining > 0) {
+      int chunk = OUTBOX_PAGE_BYTES - pageFill;
+      if (chunk > remaining) {
+        chunk = remaining;
+      }
+      memcpy(&page[pageFill], source, chunk);
+      pageFill += chunk;
+      source += chunk;
+      remaining -= chunk;
+      if (pageFill == OUTBOX_PAGE_BYTES) {
+        ok = writePage(false) && ok;
+      }
+    }
+  }
+
+  if (durable && pageFill > 0) {
+    ok = writePage(true) && ok;
+  }
+  appended++;
+  return ok;
+}
+
+void Outbox::seal() {
+  if (writeFile != NULL) {
+    closeWriteSegment();
+  }
+}
+
+bool Outbox::hasBacklog() {
+  return (int32_t)(writeSegment - readSegment) > 0;
+}
+
+void Outbox::nextReadSegment() {
+  if (readFile != NULL) {
+    fclose(readFile);
+    readFile = NULL;
+  }
+  readSegment++;
+  readOffset = 0;
+}
+
+/**
+ * Position at the next record header, skipping padding and finished
+ * segments, and read it
+ *
+ * @return Payload length, or -1 if no sealed record is left
+ */
+int Outbox::readHeader(uint8_t *type, uint32_t *crc, uint32_t *createdAt) {
+  while ((int32_t)(writeSegment - readSegment) > 0) {
+    if (readFile == NULL) {
+      char path[OUTBOX_PATH_MAX + 32];
+      segmentPath(readSegment, path);
+      readFile = fopen(path, "rb");
+      if (readFile == NULL) {
+        nextReadSegment();
+        continue;
+      }
+    }
+    fseek(readFile, readOffset, SEEK_SET);
+
+    uint8_t header[OUTBOX_RECORD_HEADER_BYTES];
+    size_t got = fread(header, 1, sizeof(header), readFile);
+    if (got == 0) {
+      nextReadSegment();
+      continue;
+    }
+    if (header[0] == OUTBOX_PADDING) {
+      readOffset = (readOffset / OUTBOX_PAGE_BYTES + 1) * OUTBOX_PAGE_BYTES;
+      continue;
+    }
+    bool timed = header[0] == OUTBOX_MARKER;
+    size_t headerBytes = timed ? OUTBOX_RECORD_HEADER_BYTES : OUTBOX_UNTIMED_HEADER_BYTES;
+    if (got < headerBytes || (!timed && header[0] != OUTBOX_MARKER_UNTIMED)) {
+      // Torn write at the end of a segment; nothing after it can be trusted
+      corrupt++;
+      nextReadSegment();
+      continue;
+    }
+
+    // The payload follows the header, wherever that ends
+    fseek(readFile, readOffset + headerBytes, SEEK_SET);
+    readHeaderBytes = (int)headerBytes;
+    *type = header[1];
+    *crc = getUint32(&header[4]);
+    *createdAt = timed ? getUint32(&header[8]) : 0;
+    return header[2] | (header[3] << 8);
+  }
+  return -1;
+}
+
+int Outbox::peek(uint8_t *type) {
+  uint32_t crc, createdAt;
+  return readHeader(type, &crc, &createdAt);
+}
+
+int Outbox::read(uint8_t *type, uint8_t *out, int maxLength) {
+  while (true) {
+    uint32_t crc, createdAt;
+    int length = readHeader(type, &crc, &createdAt);
+    if (length < 0) {
+      return -1;
+    }
+
+    if (length > maxLength) {
+      // Cannot be delivered by this caller; step over it
+      readOffset += readHeaderBytes + length;
+      corrupt++;
+      return -2;
+    }
+
+    bool timed = readHeaderBytes == OUTBOX_RECORD_HEADER_BYTES;
+    if (fread(out, 1, length, readFile) != (size_t)length ||
+        recordCrc(*type, (uint16_t)length, timed, createdAt, out) != crc) {
+      corrupt++;
+      nextReadSegment();
+      continue;
+    }
+
+    readOffset += readHeaderBytes + length;
+    readCreatedAt = createdAt;
+    return length;
+  }
+}
+
+void Outbox::commit() {
+  // Segments before the read position have been read to the end
+  while ((int32_t)(readSegment - firstSegment) > 0) {
+    deleteSegment(firstSegment);
+    firstSegment++;
+  }
+  commitSegment = readSegment;
+  commitOffset = readOffset;
+}
+
+void Outbox::rewind() {
+  if (readFile != NULL) {
+    fclose(readFile);
+    readFile = NULL;
+  }
+  readSegment = commitSegment;
+  readOffset = commitOffset;
+}
@@ -0,0 +1,317 @@
+/**
+ * ElderGuard - Pan-Tompkins QRS Detector Implementation
+ *
+ * Integer-only per-sample path. Floating point is used once in the
+ * constructor to design the bandpass sections for the configured sample rate.
+ */
+
+#include <math.h>
+#include "../include/pan_tompkins.h"
+
+#define ADC_MIDPOINT 2048                // Centre of the 12-bit ADC range
+#define INPUT_SHIFT 2                    // 12-bit centred sample to Q15 (+/-0.25 full scale)
+#define COEFF_SHIFT 14                   // Biquad coefficients are Q14
+#define SQUARE_SHIFT 4                   // Scale squared derivative to keep the integrator in 32 bits
+#define ENVELOPE_DECAY_SHIFT 6           // Bandpass peak envelope decays by 1/64 per sample
+#define HIGH_PASS_HZ 5.0f                // Bandpass lower corner
+#define LOW_PASS_HZ 15.0f                // Bandpass upper corner
+#define MWI_WINDOW_MS 150                // Moving-window integration width
+#define R_SEARCH_MARGIN_MS 30            // Bandpass and derivative delay ahead of the integrator
+#define REFRACTORY_MS 200                // No QRS can follow another within this time
+#define T_WAVE_WINDOW_MS 360             // Peaks this close to a QRS are checked for T-waves
+#define LEARNING_MS 2000                 // Initial threshold learning phase
+
+PanTompkinsDetector::PanTompkinsDetector(int sampleRateHz) : sampleRateHz(sampleRateHz) {
+  mwiWindow = (uint32_t)(sampleRateHz * MWI_WINDOW_MS / 1000);
+  if (mwiWindow < 1) {
+    mwiWindow = 1;
+  } else if (mwiWindow > MWI_RING_SIZE - 1) {
+    mwiWindow = MWI_RING_SIZE - 1;
+  }
+  rSearchSamples = (uint32_t)(sampleRateHz * (MWI_WINDOW_MS + R_SEARCH_MARGIN_MS) / 1000);
+  if (rSearchSamples < 1) {
+    rSearchSamples = 1;
+  } else if (rSearchSamples > MWI_RING_SIZE - 1) {
+    rSearchSamples = MWI_RING_SIZE - 1;
+  }
+  refractorySamples = (uint32_t)(sampleRateHz * REFRACTORY_MS / 1000);
+  tWaveSamples = (uint32_t)(sampleRateHz * T_WAVE_WINDOW_MS / 1000);
+  learningSamples = (uint32_t)(sampleRateHz * LEARNING_MS / 1000);
+
+  initBiquad(&highPass, true, HIGH_PASS_HZ);
+  initBiquad(&lowPass, false, LOW_PASS_HZ);
+
+  reset();
+}
+
+/**
+ * Design a second-order Butterworth section (RBJ cookbook) in Q14
+ */
+void PanTompkinsDetector::initBiquad(Biquad *filter, bool highPassType, float cutoffHz) {
+  const float scale = (float)(1 << COEFF_SHIFT);
+  float w0 = 2.0f * (float)M_PI * cutoffHz / (float)sampleRateHz;
+  float cosW0 = cosf(w0);
+  float alpha = sinf(w0) / (2.0f * 0.70710678f);
+  float a0 = 1.0f + alpha;
+
+  float b0, b1;
+  if (highPassType) {
+    b0 = (1.0f + cosW0) / 2.0f;
+    b1 = -(1.0f + cosW0);
+  } else {
+    b0 = (1.0f - cosW0) / 2.0f;
+    b1 = 1.0f - cosW0;
+  }
+
+  filter->b0 = (int32_t)lroundf(b0 / a0 * scale);
+  filter->b1 = (int32_t)lroundf(b1 / a0 * scale);
+  filter->b2 = filter->b0;
+  filter->a1 = (int32_t)lroundf(-2.0f * cosW0 / a0 * scale);
+  filter->a2 = (int32_t)lroundf((1.0f - alpha) / a0 * scale);
+}
+
+void PanTompkinsDetector::reset() {
+  highPass.x1 = highPass.x2 = highPass.y1 = highPass.y2 = 0;
+  lowPass.x1 = lowPass.x2 = lowPass.y1 = lowPass.y2 = 0;
+  primed = false;
+
+  for (int i = 0; i < DERIVATIVE_RING_SIZE; i++) {
+    derivativeRing[i] = 0;
+  }
+  derivativeIndex = 0;
+
+  for (int i = 0; i < MWI_RING_SIZE; i++) {
+    mwiRing[i] = 0;
+    inputRing[i] = 0;
+  }
+  mwiIndex = 0;
+  mwiSum = 0;
+  mwiPrev1 = 0;
+  mwiPrev2 = 0;
+
+  bandpassEnvelope = 0;
+  maxSlope = 0;
+
+  spki = npki = thresholdI1 = thresholdI2 = 0;
+  spkf = npkf = thresholdF1 = thresholdF2 = 0;
+
+  sampleCount = 0;
+  learnMaxI = learnMaxF = 0;
+  learnSumI = learnSumF = 0;
+
+  haveQrs = false;
+  samplesSinceQrs = 0;
+  rrAverage = 0;
+  lastQrsSlope = 0;
+
+  haveCandidate = false;
+  candidateI = candidateF = 0;
+  candidateSlope = 0;
+  candidateAge = 0;
+  candidateLead = 0;
+}
+
+int32_t PanTompkinsDetector::runBiquad(Biquad *filter, int32_t x) {
+  int32_t acc = filter->b0 * x + filter->b1 * filter->x1 + filter->b2 * filter->x2
+              - filter->a1 * filter->y1 - filter->a2 * filter->y2;
+  // Round rather than truncate so the high-pass feedback does not build a DC bias
+  int32_t y = (acc + (1 << (COEFF_SHIFT - 1))) >> COEFF_SHIFT;
+
+  filter->x2 = filter->x1;
+  filter->x1 = x;
+  filter->y2 = filter->y1;
+  filter->y1 = y;
+  return y;
+}
+
+void PanTompkinsDetector::updateThresholds() {
+  thresholdI1 = npki + ((spki - npki) >> 2);
+  thresholdI2 = thresholdI1 >> 1;
+  thresholdF1 = npkf + ((spkf - npkf) >> 2);
+  thresholdF2 = thresholdF1 >> 1;
+}
+
+/**
+ * Find the R wave behind the integrated-signal peak at the previous sample:
+ * the input sample furthest from the mean of the samples the integration
+ * window covers. The integrator peaks anywhere from the R wave to the end of
+ * the window depending on QRS shape, and the bandpass rings with lobes of
+ * either sign almost as large as the R wave, so neither times beats without
+ * adding jitter to RR. Over one window baseline wander is close to flat.
+ *
+ * @return Samples between the R wave and the integrated-signal peak
+ */
+uint32_t PanTompkinsDetector::findRWaveLead() const {
+  int32_t sum = 0;
+  for (uint32_t ago = 1; ago <= rSearchSamples; ago++) {
+    sum += inputRing[(mwiIndex - 1 - ago) & MWI_RING_MASK];
+  }
+  int32_t mean = sum / (int32_t)rSearchSamples;
+
+  uint32_t best = 1;
+  int32_t bestDeviation = -1;
+  for (uint32_t ago = 1; ago <= rSearchSamples; ago++) {
+    int32_t deviation = inputRing[(mwiIndex - 1 - ago) & MWI_RING_MASK] - mean;
+    if (deviation < 0) {
+      deviation = -deviation;
+    }
+    if (deviation > bestDeviation) {
+      bestDeviation = deviation;
+      best = ago;
+    }
+  }
+  return best - 1;
+}
+
+/**
+ * Record a confirmed QRS complex and report it
+ *
+ * @param samplesAgo Position of its integrated-signal peak, which the
+ *                   refractory, T-wave and searchback timing use
+ * @param lead Samples from the R wave to that peak
+ */
+void PanTompkinsDetector::confirmQrs(int32_t peakF, uint32_t slope, uint32_t samplesAgo, uint32_t lead,
+                                     PanTompkinsPeak *peak) {
+  if (haveQrs) {
+    // Running RR average (1/8 weight) used for the searchback limit
+    int32_t rr = (int32_t)(samplesSinceQrs - samplesAgo);
+    if (rrAverage == 0) {
+      rrAverage = rr;
+    } else {
+      rrAverage = (uint32_t)((int32_t)rrAverage + ((rr - (int32_t)rrAverage) >> 3));
+    }
+  }
+
+  haveQrs = true;
+  samplesSinceQrs = samplesAgo;
+  lastQrsSlope = slope;
+  haveCandidate = false;
+
+  peak->samplesAgo = samplesAgo + lead;
+  peak->amplitude = peakF >> INPUT_SHIFT;
+}
+
+/**
+ * Classify a local maximum of the integrated signal as QRS or noise
+ *
+ * @return true if the peak was confirmed as a QRS complex
+ */
+bool PanTompkinsDetector::classifyPeak(int32_t peakI, int32_t peakF, uint32_t slope, PanTompkinsPeak *peak) {
+  // Peaks inside the refractory period are ripple on the current complex
+  if (haveQrs && samplesSinceQrs < refractorySamples) {
+    return false;
+  }
+
+  if (peakI > thresholdI1 && peakF > thresholdF1) {
+    // A steep-enough peak shortly after a QRS is a QRS; a shallow one is a T-wave
+    bool tWave = haveQrs && samplesSinceQrs < tWaveSamples && slope < (lastQrsSlope >> 1);
+    if (!tWave) {
+      spki += (peakI - spki) >> 3;
+      spkf += (peakF - spkf) >> 3;
+      updateThresholds();
+      confirmQrs(peakF, slope, 1, findRWaveLead(), peak);
+      return true;
+    }
+  }
+
+  npki += (peakI - npki) >> 3;
+  npkf += (peakF - npkf) >> 3;
+  updateThresholds();
+
+  // Remember the largest noise peak for searchback
+  if (!haveCandidate || peakI > candidateI) {
+    haveCandidate = true;
+    candidateI = peakI;
+    candidateF = peakF;
+    candidateSlope = slope;
+    candidateAge = 1;
+    candidateLead = findRWaveLead();
+  }
+  return false;
+}
+
+bool PanTompkinsDetector::processSample(int sample, PanTompkinsPeak *peak) {
+  sampleCount++;
+  samplesSinceQrs++;
+  candidateAge++;
+
+  int32_t x = (int32_t)(sample - ADC_MIDPOINT) << INPUT_SHIFT;
+
+  // Start the high-pass at rest on the first sample to avoid a step transient
+  if (!primed) {
+    highPass.x1 = highPass.x2 = x;
+    primed = true;
+  }
+
+  // Bandpass
+  int32_t bandpass = runBiquad(&lowPass, runBiquad(&highPass, x));
+
+  // Five-point derivative: (2x[n] + x[n-1] - x[n-3] - 2x[n-4]) / 8
+  derivativeRing[derivativeIndex & DERIVATIVE_RING_MASK] = bandpass;
+  int32_t derivative = (2 * bandpass
+                        + derivativeRing[(derivativeIndex - 1) & DERIVATIVE_RING_MASK]
+                        - derivativeRing[(derivativeIndex - 3) & DERIVATIVE_RING_MASK]
+                        - 2 * derivativeRing[(derivativeIndex - 4) & DERIVATIVE_RING_MASK]) >> 3;
+  derivativeIndex++;
+
+  // Squaring
+  uint32_t squared = (uint32_t)(derivative * derivative) >> SQUARE_SHIFT;
+  if (squared > maxSlope) {
+    maxSlope = squared;
+  }
+
+  // Moving-window integration as a running sum
+  mwiSum += squared - mwiRing[(mwiIndex - mwiWindow) & MWI_RING_MASK];
+  mwiRing[mwiIndex & MWI_RING_MASK] = squared;
+  inputRing[mwiIndex & MWI_RING_MASK] = x;
+  mwiIndex++;
+  uint32_t mwi = mwiSum;
+
+  // Decaying peak envelope of the bandpassed signal
+  int32_t magnitude = bandpass < 0 ? -bandpass : bandpass;
+  bandpassEnvelope -= bandpassEnvelope >> ENVELOPE_DECAY_SHIFT;
+  if (magnitude > bandpassEnvelope) {
+    bandpassEnvelope = magnitude;
+  }
+
+  bool detected = false;
+
+  if (sampleCount <= learningSamples) {
+    // Learning phase: initial signal level is 1/3 of the maximum, noise 1/2 of the mean
+    if (mwi > learnMaxI) learnMaxI = mwi;
+    if ((uint32_t)magnitude > learnMaxF) learnMaxF = magnitude;
+    learnSumI += mwi;
+    learnSumF += magnitude;
+
+    if (sampleCount == learningSamples) {
+      spki = (int32_t)(learnMaxI / 3);
+      npki = (int32_t)(learnSumI / learningSamples / 2);
+      spkf = (int32_t)(learnMaxF / 3);
+      npkf = (int32_t)(learnSumF / learningSamples / 2);
+      updateThresholds();
+      haveQrs = false;
+      haveCandidate = false;
+    }
+  } else {
+    // Local maximum of the integrated signal at the previous sample
+    if (mwiPrev1 > mwiPrev2 && mwiPrev1 >= mwi) {
+      detected = classifyPeak((int32_t)mwiPrev1, bandpassEnvelope, maxSlope, peak);
+      maxSlope = 0;
+    }
+
+    // Searchback: no QRS for 166% of the average RR, take the best noise peak above the lower thresholds
+    if (!detected && haveQrs && haveCandidate && rrAverage > 0 &&
+        samplesSinceQrs > rrAverage + ((rrAverage * 2) / 3) &&
+        candidateI > thresholdI2 && candidateF > thresholdF2) {
+      spki += (candidateI - spki) >> 2;
+      spkf += (candidateF - spkf) >> 2;
+      updateThresholds();
+      confirmQrs(candidateF, candidateSlope, candidateAge, candidateLead, peak);
+      detected = true;
+    }
+  }
+
+  mwiPrev2 = mwiPrev1;
+  mwiPrev1 = mwi;
+  return detected;
+}
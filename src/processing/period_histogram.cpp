@@ -0,0 +1,60 @@
+/**
+ * ElderGuard - Loop Period Histogram Implementation
+ */
+
+#include <string.h>
+#include "../include/period_histogram.h"
+
+// Upper bucket bounds in percent of the nominal period
+static const int BUCKET_LIMITS_PCT[PERIOD_HISTOGRAM_BUCKETS - 1] = {50, 90, 110, 150, 200, 400};
+
+PeriodHistogram::PeriodHistogram() {
+  memset(counts, 0, sizeof(counts));
+  periodUs = 0;
+  wakeups = 0;
+  worstPeriodUs = 0;
+  worstBusyUs = 0;
+  busyUs = 0;
+  lastWakeUs = 0;
+  started = false;
+  awake = false;
+}
+
+void PeriodHistogram::setPeriod(uint32_t periodUs) {
+  this->periodUs = periodUs;
+}
+
+void PeriodHistogram::wake(uint32_t nowUs) {
+  if (started && periodUs > 0) {
+    uint32_t elapsed = nowUs - lastWakeUs;
+    uint64_t pct = (uint64_t)elapsed * 100 / periodUs;
+    int bucket = 0;
+    while (bucket < PERIOD_HISTOGRAM_BUCKETS - 1 && pct >= (uint64_t)BUCKET_LIMITS_PCT[bucket]) {
+      bucket++;
+    }
+    counts[bucket]++;
+    wakeups++;
+    if (elapsed > worstPeriodUs) {
+      worstPeriodUs = elapsed;
+    }
+  }
+  lastWakeUs = nowUs;
+  started = true;
+  awake = true;
+}
+
+void PeriodHistogram::wait(uint32_t nowUs) {
+  if (!awake) {
+    return;
+  }
+  uint32_t busy = nowUs - lastWakeUs;
+  busyUs += busy;
+  if (busy > worstBusyUs) {
+    worstBusyUs = busy;
+  }
+  awake = false;
+}
+
+int PeriodHistogram::getBucketLimitPct(int bucket) {
+  return bucket < PERIOD_HISTOGRAM_BUCKETS - 1 ? BUCKET_LIMITS_PCT[bucket] : 0;
+}
@@ -20,6 +20,9 @@ bool mp3PlayerAvailable = false;
 void audioTask(void *pvParameters) {
   Serial.println("Audio Task: Started");
   
+  // Subscribe first so alerts raised while the player boots are queued
+  int audioSubscriber = audioCommandTopic.subscribe(AUDIO_QUEUE_AUDIO);
+  
   // Initialize MP3 player
   mp3PlayerAvailable = initializeMP3Player();
   
@@ -38,45 +41,32 @@ void audioTask(void *pvParameters) {
   
   // Main task loop
   while (true) {
-    // Check for audio commands using semaphore
-    if (xSemaphoreTake(audioCommandSemaphore, pdMS_TO_TICKS(500)) == pdTRUE) {
-      // Audio command was signaled - access the shared data
-      if (xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        // Get audio command data - create a local copy to avoid volatile issues
-        AudioCommand audioCmd;
-        audioCmd.fileNumber = currentAudioCommand.fileNumber;
-        audioCmd.repeatCount = currentAudioCommand.repeatCount;
-        audioCmd.volume = currentAudioCommand.volume;
-        
-        bool audioUpdated = audioCommandUpdated;
-        audioCommandUpdated = false; // Reset the flag
+    // Block until the next audio command; each one is delivered exactly once
+    const AudioCommand *command = audioCommandTopic.receive(audioSubscriber, portMAX_DELAY);
+    if (command != NULL) {
+      // Take a local copy and hand the slot back before playing
+      AudioCommand audioCmd = *command;
+      audioCommandTopic.release(command);
+      
+      // Process the audio command
+      if (mp3PlayerAvailable) {
+        Serial.printf("Audio Task: Playing file #%d for %d times\n", 
+                   audioCmd.fileNumber, audioCmd.repeatCount);
         
-        // Release mutex
-        xSemaphoreGive(displayMutex);
+        // Volume requested by the sender, never above the maximum
+        mp3Player.volume(constrain(audioCmd.volume, 0, AUDIO_MAX_VOLUME));
         
-        // Process the audio command
-        if (audioUpdated && mp3PlayerAvailable) {
-          Serial.printf("Audio Task: Playing file #%d for %d times\n", 
-                     audioCmd.fileNumber, audioCmd.repeatCount);
-          
-          // Always use maximum volume
-          mp3Player.volume(AUDIO_MAX_VOLUME);
-          
-          // Play the sound
-          playAudioFile(audioCmd.fileNumber, audioCmd.repeatCount);
-        } else if (audioUpdated) {
-          // Fallback if MP3 player not available - just print to serial
-          Serial.print("Audio Task: Would play sound file ");
-          Serial.print(audioCmd.fileNumber);
-          Serial.print(" for ");
-          Serial.print(audioCmd.repeatCount);
-          Serial.println(" times");
-        }
+        // Play the sound
+        playAudioFile(audioCmd.fileNumber, audioCmd.repeatCount);
+      } else {
+        // Fallback if MP3 player not available - just print to serial
+        Serial.print("Audio Task: Would play sound file ");
+        Serial.print(audioCmd.fileNumber);
+        Serial.print(" for ");
+        Serial.print(audioCmd.repeatCount);
+        Serial.println(" times");
       }
     }
-    
-    // Small delay to prevent task from hogging CPU
-    vTaskDelay(pdMS_TO_TICKS(100));
   }
 }
 
@@ -2,63 +2,215 @@
  * ElderGuard - ECG & Heart Rate Task Implementation
  * 
  * This file implements the ECG monitoring task using the AD8232 module.
- * It samples ECG data, calculates heart rate, and signals other tasks
- * through semaphores.
+ * It samples ECG data, calculates heart rate, and publishes the results
+ * on the ECG topic.
  */
 
 #include <Arduino.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/adc.h"
+#include "driver/i2s.h"
 #include "esp_adc_cal.h" // Added ESP ADC calibration header
 #include "../include/ecg_task.h"
+#include "../include/ecg_processor.h"
+#include "../include/hrv_engine.h"
+#include "../include/ecg_pipeline.h"
 #include "../include/config.h"
 #include "../include/globals.h"
-#include "../include/mqtt_task.h"
-#include "../include/http_task.h"  // Added for sendTelegramMessage function
+#include "../include/power_manager.h"
+#include "../include/diagnostics.h"
 
 // Constants for ECG processing
-#define ECG_BUFFER_SIZE 250              // 5 seconds at 50Hz
-#define SAMPLE_INTERVAL_MS (1000 / ECG_SAMPLE_FREQUENCY_HZ) // Time between samples
+#define SAMPLE_INTERVAL_MS (1000 / ECG_SAMPLE_RATE_HZ) // Time between samples (polled capture)
+#define ECG_DMA_BUFFER_LEN (ECG_BLOCK_SIZE * ECG_ADC_OVERSAMPLE) // Conversions per DMA buffer
 
-// Advanced ECG processing parameters - adjusted for AD8232
-#define PEAK_DETECTION_THRESHOLD 2700    // Initial threshold for R-peak detection - adjusted for AD8232
-#define RR_MIN_LIMIT 300                 // Minimum RR interval (200 BPM max)
-#define RR_MAX_LIMIT 1500                // Maximum RR interval (40 BPM min)
-#define QRS_MIN_WIDTH 10                 // Minimum width of QRS complex in ms
-#define QRS_MAX_WIDTH 150                // Maximum width of QRS complex in ms
-#define LEARNING_FACTOR 0.2              // For adaptive threshold
+#if ECG_SAMPLE_RATE_HZ < 250 || ECG_SAMPLE_RATE_HZ > 500
+#error "ECG_SAMPLE_RATE_HZ must be between 250 and 500"
+#endif
+#if ECG_DMA_BUFFER_LEN > 1024
+#error "ECG_BLOCK_SIZE * ECG_ADC_OVERSAMPLE exceeds the I2S DMA buffer limit (1024)"
+#endif
 
-// Heart rate drop detection parameters
-#define HEART_RATE_DROP_THRESHOLD 20     // Consider drop of 20 BPM or more as significant
-#define HEART_RATE_MIN_VALID 40          // Minimum valid heart rate
-#define HEART_RATE_ALERT_COOLDOWN 60000  // Cooldown period between alerts (60 seconds)
+// Raw samples shared with MQTT, HTTP and other consumers
+EcgSampleRing ecgRing;
 
-// Make buffer and index accessible to other files
-int ecgBuffer[ECG_BUFFER_SIZE];
-int bufferIndex = 0;
+// QRS detector and heart rate tracker, clocked by the ECG sample rate
+EcgProcessor ecgProcessor(ECG_SAMPLE_RATE_HZ, ECG_DETECTOR_MODE);
 
-// Variables for heart rate calculation
-int heartRate = 0;
-int lastValidHeartRate = 0;
-unsigned long lastPeakTime = 0;
-int adaptiveThreshold = PEAK_DETECTION_THRESHOLD;
-int noiseLevel = 0;
-int signalLevel = 0;
+// Heart rate variability over the last HRV_WINDOW_MS of RR intervals
+HrvEngine hrvEngine(HRV_WINDOW_MS);
 
-// RR interval storage
-#define RR_BUFFER_SIZE 8
-unsigned long rrIntervals[RR_BUFFER_SIZE];
-int rrIndex = 0;
+// Ring writes, detection, HRV and drop detection for each block
+static EcgPipeline ecgPipeline(ecgRing, ecgProcessor, hrvEngine);
 
 // Variable to track lead-off status
 bool leadsConnected = false;
-unsigned long lastHeartRateChangeTime = 0;
 
-// Heart rate drop detection variables
-int previousStableHeartRate = 0;
-unsigned long lastHeartRateDropAlertTime = 0;
-bool heartRateDropDetected = false;
+/**
+ * Raise a Telegram alert for a significant heart rate drop. The alert is
+ * only queued for the HTTP task on core 0; sampling never waits on the
+ * network.
+ *
+ * @param drop Drop reported by the pipeline
+ */
+static void sendHeartRateDropAlert(const HeartRateDrop &drop) {
+  Serial.printf("ECG Task: ⚠️ HEART RATE DROP DETECTED! From %d to %d BPM\n", 
+                drop.previousBpm, drop.currentBpm);
+  
+  // Send Telegram alert with location info if available
+  TelegramAlert alert;
+  alert.kind = ALERT_HEALTH;
+  alert.hasFallLocation = false;
+  
+  GpsData gps;
+  currentGpsData.load(&gps);
+  
+  if (gps.validFix && gps.latitude != 0 && gps.longitude != 0) {
+    // Create Google Maps link with the GPS coordinates
+    char locationLink[128];
+    snprintf(locationLink, sizeof(locationLink), 
+            "https://maps.google.com/maps?q=%.6f,%.6f", 
+            gps.latitude, gps.longitude);
+    
+    // Create the full message with location
+    snprintf(alert.message, sizeof(alert.message), 
+            "⚠️ HEART RATE DROP DETECTED! ⚠️\nPrevious: %d BPM\nCurrent: %d BPM\nDrop: %d BPM\nLocation: %s", 
+            drop.previousBpm, drop.currentBpm, 
+            drop.previousBpm - drop.currentBpm, locationLink);
+  } else {
+    // Create message without location
+    snprintf(alert.message, sizeof(alert.message), 
+            "⚠️ HEART RATE DROP DETECTED! ⚠️\nPrevious: %d BPM\nCurrent: %d BPM\nDrop: %d BPM\nLocation: No GPS signal available", 
+            drop.previousBpm, drop.currentBpm, 
+            drop.previousBpm - drop.currentBpm);
+  }
+  
+  // Queue for the HTTP task; publishing never blocks this task
+  unsigned long postStart = micros();
+  bool queued = telegramAlertTopic.publish(alert);
+  Serial.printf("ECG Task: Heart rate alert %s in %lu us\n", queued ? "queued" : "dropped",
+                micros() - postStart);
+}
+
+/**
+ * Store the latest ECG data in the shared snapshot and deliver it to subscribers
+ */
+static void publishEcgSnapshot(const EcgData &ecgData) {
+  // Update shared ECG snapshot (never blocks)
+  currentEcgData.store(ecgData);
+  
+  // Deliver to MQTT, HTTP and screen
+  ecgTopic.publish(ecgData);
+}
+
+#if ECG_CAPTURE_MODE == ECG_CAPTURE_DMA
+// Raw DMA buffer: one I2S read returns exactly one ECG block worth of conversions
+static uint16_t dmaBuffer[ECG_DMA_BUFFER_LEN];
+
+/**
+ * Start the ADC in continuous mode, clocked by I2S0 with two DMA buffers.
+ * While the task processes one buffer the hardware fills the other.
+ */
+static bool startEcgDmaCapture() {
+  i2s_config_t i2sConfig = {};
+  i2sConfig.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+  i2sConfig.sample_rate = ECG_SAMPLE_RATE_HZ * ECG_ADC_OVERSAMPLE;
+  i2sConfig.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+  i2sConfig.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+  i2sConfig.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+  i2sConfig.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+  i2sConfig.dma_buf_count = 2;                  // Double buffer
+  i2sConfig.dma_buf_len = ECG_DMA_BUFFER_LEN;   // One ECG block per DMA buffer
+  i2sConfig.use_apll = false;
+
+  if (i2s_driver_install(I2S_NUM_0, &i2sConfig, 0, NULL) != ESP_OK) {
+    return false;
+  }
+  if (i2s_set_adc_mode(ADC_UNIT_1, ADC1_CHANNEL_0) != ESP_OK) {
+    i2s_driver_uninstall(I2S_NUM_0);
+    return false;
+  }
+  i2s_adc_enable(I2S_NUM_0);
+  return true;
+}
+#endif
+
+/**
+ * Block until the next block of ECG samples is available.
+ *
+ * @param samples Output buffer of at least ECG_BLOCK_SIZE entries
+ * @param xLastWakeTime Wake reference for polled capture
+ * @return Number of samples written
+ */
+static int captureEcgBlock(int *samples, TickType_t *xLastWakeTime) {
+#if ECG_CAPTURE_MODE == ECG_CAPTURE_DMA
+  size_t bytesRead = 0;
+  i2s_read(I2S_NUM_0, dmaBuffer, sizeof(dmaBuffer), &bytesRead, portMAX_DELAY);
+  int conversions = bytesRead / sizeof(uint16_t);
+  int count = conversions / ECG_ADC_OVERSAMPLE;
+
+  // Decimate: average each group of conversions into one ECG sample.
+  // The upper 4 bits of each I2S word carry the channel number.
+  for (int i = 0; i < count; i++) {
+    uint32_t sum = 0;
+    const uint16_t *group = &dmaBuffer[i * ECG_ADC_OVERSAMPLE];
+    for (int j = 0; j < ECG_ADC_OVERSAMPLE; j++) {
+      sum += group[j] & 0x0FFF;
+    }
+    samples[i] = sum / ECG_ADC_OVERSAMPLE;
+  }
+  return count;
+#else
+  // Polled capture: one conversion per scheduler tick
+  vTaskDelayUntil(xLastWakeTime, pdMS_TO_TICKS(SAMPLE_INTERVAL_MS));
+  samples[0] = adc1_get_raw(ADC1_CHANNEL_0);
+  return 1;
+#endif
+}
+
+#if ECG_BENCHMARK_ON_BOOT
+/**
+ * Time both QRS detectors on a synthetic ECG and print cycles per sample
+ * and the resulting core load at the configured sample rate.
+ */
+static void runDetectorBenchmark() {
+  const int seconds = 10;
+  static int signal[ECG_SAMPLE_RATE_HZ];
+  static EcgProcessor legacy(ECG_SAMPLE_RATE_HZ, ECG_DETECTOR_LEGACY);
+  static EcgProcessor panTompkins(ECG_SAMPLE_RATE_HZ, ECG_DETECTOR_PAN_TOMPKINS);
+  EcgProcessor *detectors[2] = { &legacy, &panTompkins };
+  const char *names[2] = { "Legacy", "Pan-Tompkins" };
+  
+  // One second of signal: 40ms triangular QRS of 800 counts on a 1900 baseline plus noise
+  uint32_t noise = 12345;
+  for (int i = 0; i < ECG_SAMPLE_RATE_HZ; i++) {
+    int ms = i * 1000 / ECG_SAMPLE_RATE_HZ;
+    int qrs = (ms >= 200 && ms < 240) ? 800 - abs(ms - 220) * 40 : 0;
+    noise = noise * 1103515245 + 12345;
+    signal[i] = 1900 + qrs + (int)((noise >> 16) % 41) - 20;
+  }
+  
+  EcgBeat beats[ECG_MAX_BEATS_PER_BLOCK];
+  for (int d = 0; d < 2; d++) {
+    uint32_t cycles = 0;
+    int beatCount = 0;
+    for (int s = 0; s < seconds; s++) {
+      for (int i = 0; i + ECG_BLOCK_SIZE <= ECG_SAMPLE_RATE_HZ; i += ECG_BLOCK_SIZE) {
+        uint32_t start = ESP.getCycleCount();
+        beatCount += detectors[d]->processBlock(&signal[i], ECG_BLOCK_SIZE, beats, ECG_MAX_BEATS_PER_BLOCK);
+        cycles += ESP.getCycleCount() - start;
+      }
+    }
+    
+    uint32_t samples = seconds * (ECG_SAMPLE_RATE_HZ / ECG_BLOCK_SIZE) * ECG_BLOCK_SIZE;
+    uint32_t cyclesPerSample = cycles / samples;
+    float load = 100.0f * cyclesPerSample * ECG_SAMPLE_RATE_HZ / (ESP.getCpuFreqMHz() * 1000000.0f);
+    Serial.printf("ECG Task: Benchmark %s: %lu cycles/sample, %.3f%% of core at %d Hz, %d beats\n",
+                  names[d], (unsigned long)cyclesPerSample, load, ECG_SAMPLE_RATE_HZ, beatCount);
+  }
+}
+#endif
 
 void ecgTask(void *pvParameters) {
   // Setup ADC for ECG input
@@ -70,59 +222,59 @@ void ecgTask(void *pvParameters) {
   pinMode(ECG_LO_POS_PIN, INPUT);
   pinMode(ECG_LO_NEG_PIN, INPUT);
   
-  Serial.println("ECG Task: Started with optimized heart rate detection");
-
-  // Variables for task timing
-  TickType_t xLastWakeTime;
-  const TickType_t xFrequency = pdMS_TO_TICKS(SAMPLE_INTERVAL_MS);
-  xLastWakeTime = xTaskGetTickCount();
-  
-  // Variables for data publishing
-  unsigned long lastDataUpdate = 0;
-  unsigned long lastValidSignalTime = 0;
-  unsigned long stableHeartRateTime = 0;
+#if ECG_BENCHMARK_ON_BOOT
+  runDetectorBenchmark();
+#endif
   
-  // Initialize RR intervals
-  for (int i = 0; i < RR_BUFFER_SIZE; i++) {
-    rrIntervals[i] = 0;
+#if ECG_CAPTURE_MODE == ECG_CAPTURE_DMA
+  if (startEcgDmaCapture()) {
+    Serial.printf("ECG Task: Started DMA capture at %d Hz, %d samples per block\n",
+                  ECG_SAMPLE_RATE_HZ, ECG_BLOCK_SIZE);
+  } else {
+    Serial.println("ECG Task: Failed to start DMA capture");
+    diagnosticsTaskExit();
+    vTaskDelete(NULL);
+    return;
   }
+#else
+  // Light sleep would stall the sample clock; DMA capture holds its own lock in the I2S driver
+  powerLockAcquire(POWER_LOCK_SAMPLING);
+  Serial.printf("ECG Task: Started polled capture at %d Hz\n", ECG_SAMPLE_RATE_HZ);
+#endif
   
-  // QRS detection state variables
-  bool inQRS = false;
-  unsigned long qrsStartTime = 0;
-  int qrsPeak = 0;
+#if ECG_CAPTURE_MODE == ECG_CAPTURE_DMA
+  diagnosticsSetLoopPeriod(DIAG_LOOP_ECG, ECG_BLOCK_SIZE * 1000000UL / ECG_SAMPLE_RATE_HZ);
+#else
+  diagnosticsSetLoopPeriod(DIAG_LOOP_ECG, SAMPLE_INTERVAL_MS * 1000UL);
+#endif
+
+  // Variables for task timing (polled capture only)
+  TickType_t xLastWakeTime = xTaskGetTickCount();
   
-  // Baseline tracking variables
-  int baseline = 2048; // Start at midpoint
+  // Variables for data publishing
+  unsigned long lastDataUpdate = 0;
   
-  // Buffer for tracking peak-to-peak amplitude
-  #define AMPLITUDE_BUFFER_SIZE 5
-  int recentAmplitudes[AMPLITUDE_BUFFER_SIZE] = {0};
-  int amplitudeIndex = 0;
-  int averageAmplitude = 500; // Initial guess
+  int block[ECG_BLOCK_SIZE];
   
-  // Main task loop
+  // Main task loop - one iteration per captured block
   while (true) {
-    // Ensure task runs at consistent frequency
-    vTaskDelayUntil(&xLastWakeTime, xFrequency);
+    diagnosticsLoopWait(DIAG_LOOP_ECG);
+    int count = captureEcgBlock(block, &xLastWakeTime);
+    diagnosticsLoopWake(DIAG_LOOP_ECG);
+    if (count <= 0) {
+      continue;
+    }
     unsigned long currentTime = millis();
-    
-    // Read ECG value
-    int rawEcgValue = adc1_get_raw(ADC1_CHANNEL_0);
-    
-    // Store in circular buffer
-    ecgBuffer[bufferIndex] = rawEcgValue;
-    bufferIndex = (bufferIndex + 1) % ECG_BUFFER_SIZE;
+    int rawEcgValue = block[count - 1];
     
     // Check lead connection status by reading dedicated pins
     leadsConnected = !(digitalRead(ECG_LO_POS_PIN) == HIGH || digitalRead(ECG_LO_NEG_PIN) == HIGH);
     
     // If leads disconnected, reset heart rate
     if (!leadsConnected) {
-      if (heartRate != 0) {
+      // The ring and sample clock keep running so consumers still see the raw signal
+      if (ecgPipeline.leadsOff(block, count)) {
         Serial.println("ECG Task: Leads disconnected, resetting heart rate");
-        heartRate = 0;
-        previousStableHeartRate = 0; // Reset stable heart rate when leads disconnected
       }
       // Skip further processing
       
@@ -130,253 +282,108 @@ void ecgTask(void *pvParameters) {
       if (currentTime - lastDataUpdate >= MQTT_PUBLISH_INTERVAL_MS) {
         lastDataUpdate = currentTime;
         
-        // Take mutex before updating shared variables
-        if (xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-          // Update shared ECG data
-          currentEcgData.rawValue = rawEcgValue;
-          currentEcgData.heartRate = 0;
-          currentEcgData.validSignal = false;
-          currentEcgData.timestamp = currentTime;
-          ecgDataUpdated = true;
-          
-          // Release mutex
-          xSemaphoreGive(displayMutex);
-          
-          // Signal other tasks that ECG data is updated
-          xSemaphoreGive(ecgDataSemaphore);
-        }
+        EcgData ecgData = {};
+        ecgData.rawValue = rawEcgValue;
+        ecgData.heartRate = 0;
+        ecgData.validSignal = false;
+        ecgData.timestamp = currentTime;
+        publishEcgSnapshot(ecgData);
       }
       
-      vTaskDelay(pdMS_TO_TICKS(10)); // Small delay
-      continue; // Skip to next iteration
-    }
-    
-    // Apply basic filter (5-point moving average)
-    int filteredValue = 0;
-    for (int i = 0; i < 5; i++) {
-      int idx = (bufferIndex - i - 1 + ECG_BUFFER_SIZE) % ECG_BUFFER_SIZE;
-      filteredValue += ecgBuffer[idx];
-    }
-    filteredValue /= 5;
-    
-    // Update baseline with slow tracking (low pass filter)
-    baseline = (baseline * 99 + filteredValue) / 100;
-    
-    // Calculate the deviation from baseline
-    int deviation = filteredValue - baseline;
-    
-    // Update adaptive threshold based on recent signal
-    if (currentTime - lastPeakTime > 1500) { // If no peaks for 1.5 seconds
-      // Reduce threshold to be more sensitive
-      adaptiveThreshold = baseline + averageAmplitude / 2;
-    }
-    
-    // QRS complex detection - state machine
-    if (!inQRS && deviation > adaptiveThreshold - baseline) {
-      // Entering QRS complex
-      inQRS = true;
-      qrsStartTime = currentTime;
-      qrsPeak = filteredValue;
-    } else if (inQRS) {
-      // In QRS complex - track peak
-      if (filteredValue > qrsPeak) {
-        qrsPeak = filteredValue;
-      }
-      
-      // Exit QRS complex if signal drops below threshold or too much time passed
-      if (deviation < (adaptiveThreshold - baseline) / 2 || (currentTime - qrsStartTime > QRS_MAX_WIDTH)) {
-        inQRS = false;
-        unsigned long qrsDuration = currentTime - qrsStartTime;
-        
-        // Don't validate QRS width during initial setup
-        if (currentTime < 3000 || (qrsDuration >= QRS_MIN_WIDTH && qrsDuration <= QRS_MAX_WIDTH)) {
-          // Valid QRS complex detected
-          
-          // Update amplitude tracking
-          int peakAmplitude = qrsPeak - baseline;
-          recentAmplitudes[amplitudeIndex] = peakAmplitude;
-          amplitudeIndex = (amplitudeIndex + 1) % AMPLITUDE_BUFFER_SIZE;
-          
-          // Recalculate average amplitude
-          int sumAmplitude = 0;
-          int countAmplitude = 0;
-          for (int i = 0; i < AMPLITUDE_BUFFER_SIZE; i++) {
-            if (recentAmplitudes[i] > 0) {
-              sumAmplitude += recentAmplitudes[i];
-              countAmplitude++;
-            }
-          }
-          
-          if (countAmplitude > 0) {
-            averageAmplitude = sumAmplitude / countAmplitude;
-            // Update adaptive threshold based on amplitude
-            adaptiveThreshold = baseline + averageAmplitude / 2;
-          }
-          
-          // Calculate RR interval if we have a previous peak
-          if (lastPeakTime > 0) {
-            unsigned long rrInterval = currentTime - lastPeakTime;
-            
-            // Validate RR interval is physiologically plausible
-            if (rrInterval >= RR_MIN_LIMIT && rrInterval <= RR_MAX_LIMIT) {
-              // Store RR interval
-              rrIntervals[rrIndex] = rrInterval;
-              rrIndex = (rrIndex + 1) % RR_BUFFER_SIZE;
-              
-              // Calculate heart rate from recent RR intervals
-              unsigned long rrSum = 0;
-              int validRR = 0;
-              
-              for (int i = 0; i < RR_BUFFER_SIZE; i++) {
-                if (rrIntervals[i] > 0) {
-                  rrSum += rrIntervals[i];
-                  validRR++;
-                }
-              }
-              
-              if (validRR > 0) {
-                unsigned long avgRR = rrSum / validRR;
-                int newHeartRate = 60000 / avgRR;
-                
-                // Apply smoothing to heart rate
-                if (heartRate == 0) {
-                  heartRate = newHeartRate;
-                } else {
-                  // Use stronger smoothing for more stable readings
-                  heartRate = (int)(0.8 * heartRate + 0.2 * newHeartRate);
-                }
-                
-                // Store last valid heart rate
-                lastValidHeartRate = heartRate;
-                lastHeartRateChangeTime = currentTime;
-                
-                // Track stable heart rate for drop detection
-                if (heartRate >= HEART_RATE_MIN_VALID) {
-                  if (previousStableHeartRate == 0) {
-                    // First valid reading, initialize stable heart rate
-                    previousStableHeartRate = heartRate;
-                    stableHeartRateTime = currentTime;
-                  } else if (currentTime - stableHeartRateTime > 10000) {
-                    // After 10 seconds of stable readings, update the stable heart rate
-                    previousStableHeartRate = heartRate;
-                  }
-                  
-                  // Heart rate drop detection
-                  if (previousStableHeartRate > 0 && 
-                      heartRate < (previousStableHeartRate - HEART_RATE_DROP_THRESHOLD) &&
-                      currentTime - lastHeartRateDropAlertTime > HEART_RATE_ALERT_COOLDOWN) {
-                      
-                    // Significant heart rate drop detected
-                    Serial.printf("ECG Task: ⚠️ HEART RATE DROP DETECTED! From %d to %d BPM\n", 
-                                  previousStableHeartRate, heartRate);
-                    
-                    // Send Telegram alert with location info if available
-                    char telegramMsg[256];
-                    
-                    if (gpsDataUpdated && currentGpsData.latitude != 0 && currentGpsData.longitude != 0) {
-                      // Create Google Maps link with the GPS coordinates
-                      char locationLink[128];
-                      snprintf(locationLink, sizeof(locationLink), 
-                              "https://maps.google.com/maps?q=%.6f,%.6f", 
-                              currentGpsData.latitude, currentGpsData.longitude);
-                      
-                      // Create the full message with location
-                      snprintf(telegramMsg, sizeof(telegramMsg), 
-                              "⚠️ HEART RATE DROP DETECTED! ⚠️\nPrevious: %d BPM\nCurrent: %d BPM\nDrop: %d BPM\nLocation: %s", 
-                              previousStableHeartRate, heartRate, 
-                              previousStableHeartRate - heartRate, locationLink);
-                    } else {
-                      // Create message without location
-                      snprintf(telegramMsg, sizeof(telegramMsg), 
-                              "⚠️ HEART RATE DROP DETECTED! ⚠️\nPrevious: %d BPM\nCurrent: %d BPM\nDrop: %d BPM\nLocation: No GPS signal available", 
-                              previousStableHeartRate, heartRate, 
-                              previousStableHeartRate - heartRate);
-                    }
-                    
-                    // Send the message
-                    sendTelegramMessage(telegramMsg);
-                    
-                    // Update last alert time
-                    lastHeartRateDropAlertTime = currentTime;
-                    heartRateDropDetected = true;
-                    
-                    // After detecting drop, reset the stable heart rate to adapt to new conditions
-                    previousStableHeartRate = heartRate;
-                    stableHeartRateTime = currentTime;
-                  }
-                }
-                
-                // Debug output only when heart rate changes significantly
-                static int lastReportedHR = 0;
-                if (abs(heartRate - lastReportedHR) >= 3) {
-                  lastReportedHR = heartRate;
-                  Serial.printf("ECG Task: QRS detected - HR: %d BPM, RR: %lu ms, Amp: %d\n", 
-                               heartRate, rrInterval, averageAmplitude);
-                }
-              }
-            }
-          }
-          
-          // Update last peak time
-          lastPeakTime = currentTime;
-          lastValidSignalTime = currentTime;
-        }
-      }
+      continue; // Skip to next block
     }
     
-    // If we've gone too long without detecting heart rate, reset it
-    if (heartRate > 0 && currentTime - lastHeartRateChangeTime > 8000) {
-      Serial.println("ECG Task: No heartbeats detected for 8 seconds, resetting heart rate");
-      heartRate = 0;
-    }
+    // Run the detector over the whole block
+    processEcgBlock(block, count);
     
     // Update shared data periodically
     if (currentTime - lastDataUpdate >= MQTT_PUBLISH_INTERVAL_MS) {
       lastDataUpdate = currentTime;
+      int heartRate = ecgProcessor.getHeartRate();
+      
+      HrvMetrics hrv;
+      hrvEngine.getMetrics(&hrv);
+      bool hrvValid = hrv.intervals >= HRV_MIN_INTERVALS;
       
       // Create a diagnostic string for debugging
       char diagString[80];
       sprintf(diagString, "B:%d, T:%d, R:%d, A:%d", 
-              baseline, adaptiveThreshold, rawEcgValue, averageAmplitude);
+              ecgProcessor.getBaseline(), ecgProcessor.getThreshold(),
+              rawEcgValue, ecgProcessor.getAverageAmplitude());
       
-      // Take mutex before updating shared variables
-      if (xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        // Update shared ECG data
-        currentEcgData.rawValue = rawEcgValue;
-        currentEcgData.heartRate = heartRate;
-        currentEcgData.validSignal = (heartRate > 0);
-        currentEcgData.timestamp = currentTime;
-        ecgDataUpdated = true;
-        
-        // Release mutex
-        xSemaphoreGive(displayMutex);
-        
-        // Signal other tasks that ECG data is updated
-        xSemaphoreGive(ecgDataSemaphore);
-        
-        // Publish ECG data to MQTT - explicitly call with no parameters
-        publishEcgData();
-        
-        // Debug output every 5 seconds
-        static unsigned long lastDebugOutput = 0;
-        if (currentTime - lastDebugOutput >= 5000) {
-          lastDebugOutput = currentTime;
-          Serial.printf("ECG Task: Heart Rate = %d BPM, Signal: %s, %s\n", 
-                       heartRate, 
-                       heartRate > 0 ? "Valid" : "Invalid",
-                       diagString);
+      EcgData ecgData = {};
+      ecgData.rawValue = rawEcgValue;
+      ecgData.heartRate = heartRate;
+      ecgData.validSignal = (heartRate > 0);
+      ecgData.sdnn = hrvValid ? hrv.sdnn : 0;
+      ecgData.rmssd = hrvValid ? hrv.rmssd : 0;
+      ecgData.pnn50 = hrvValid ? hrv.pnn50 : 0;
+      ecgData.hrvIntervals = hrvValid ? hrv.intervals : 0;
+      ecgData.timestamp = currentTime;
+      publishEcgSnapshot(ecgData);
+      
+      // Debug output every 5 seconds
+      static unsigned long lastDebugOutput = 0;
+      if (currentTime - lastDebugOutput >= 5000) {
+        lastDebugOutput = currentTime;
+        Serial.printf("ECG Task: Heart Rate = %d BPM, Signal: %s, %s\n", 
+                     heartRate, 
+                     heartRate > 0 ? "Valid" : "Invalid",
+                     diagString);
+        if (hrvValid) {
+          Serial.printf("ECG Task: HRV over %d intervals - SDNN: %.1f ms, RMSSD: %.1f ms, pNN50: %.1f%%\n",
+                       hrv.intervals, hrv.sdnn, hrv.rmssd, hrv.pnn50);
         }
       }
     }
   }
 }
 
+/**
+ * Run QRS detection and heart rate tracking over a block of raw ECG samples
+ * and deliver any heart rate drop alert. The processing itself is
+ * EcgPipeline::processBlock(), which the replay tests drive on the host.
+ *
+ * @param samples Raw 12-bit ADC samples, oldest first
+ * @param count Number of samples in the block
+ */
+void processEcgBlock(const int *samples, int count) {
+  int previousHeartRate = ecgProcessor.getHeartRate();
+  EcgBeat beats[ECG_MAX_BEATS_PER_BLOCK];
+  int beatCount = ecgPipeline.processBlock(samples, count, beats, ECG_MAX_BEATS_PER_BLOCK);
+  
+  for (int i = 0; i < beatCount; i++) {
+    if (beats[i].rrInterval == 0) {
+      continue;
+    }
+    
+    // Debug output only when heart rate changes significantly
+    static int lastReportedHR = 0;
+    if (abs(beats[i].heartRate - lastReportedHR) >= 3) {
+      lastReportedHR = beats[i].heartRate;
+      Serial.printf("ECG Task: QRS detected - HR: %d BPM, RR: %lu ms, Amp: %d\n", 
+                   beats[i].heartRate, (unsigned long)beats[i].rrInterval,
+                   ecgProcessor.getAverageAmplitude());
+    }
+  }
+  
+  HeartRateDrop drop;
+  if (ecgPipeline.takeHeartRateDrop(&drop)) {
+    sendHeartRateDropAlert(drop);
+  }
+  
+  // If we've gone too long without detecting heart rate, it has been reset
+  if (previousHeartRate > 0 && ecgProcessor.getHeartRate() == 0 && beatCount == 0) {
+    Serial.println("ECG Task: No heartbeats detected for 8 seconds, resetting heart rate");
+  }
+}
+
 bool isValidEcgSignal() {
   // Simply check lead connection
   return leadsConnected;
 }
 
 int calculateHeartRate(int *samples, int count) {
-  // This is now handled in the main task loop
-  return heartRate;
+  // This is now handled by the ECG processor
+  return ecgProcessor.getHeartRate();
 }
\ No newline at end of file
@@ -2,7 +2,8 @@
  * ElderGuard - Fall Detection Task Implementation
  * 
  * This file implements the fall detection task using the MPU6050 accelerometer.
- * It detects falls and signals other tasks immediately through semaphores when a fall is detected.
+ * It detects falls and publishes them to other tasks immediately through the event bus.
+ * Samples are burst-read from the MPU6050 FIFO and processed in batches.
  * This task has the highest priority in the system.
  */
 
@@ -15,65 +16,305 @@
 #include "../include/fall_detection_task.h"
 #include "../include/config.h"
 #include "../include/globals.h"
-#include "../include/http_task.h"  // Added for sendTelegramMessage function
+#include "../include/fall_detector.h"
+#include "../include/impact_recorder.h"
+#include "../include/power_manager.h"
+#include "../include/diagnostics.h"
+
+// Sample period on the IMU sample clock
+#define FALL_SAMPLE_PERIOD_MS (1000 / FALL_DETECTION_SAMPLE_RATE_HZ)
+
+// Rate the accelerometer-only low-pass in the benchmark was tuned at
+#define FALL_REFERENCE_RATE_HZ 50
+
+// Sensor scales for the ranges set in fallDetectionTask()
+#define MPU_ACCEL_LSB_PER_G 4096.0f      // MPU6050_RANGE_8_G
+#define MPU_GYRO_LSB_PER_DPS 65.5f       // MPU6050_RANGE_500_DEG
+
+#if (IMPACT_PRE_MS + IMPACT_POST_MS) * FALL_DETECTION_SAMPLE_RATE_HZ / 1000 >= IMPACT_RING_CAPACITY
+#error "IMPACT_PRE_MS + IMPACT_POST_MS does not fit in the impact recorder ring at this sample rate"
+#endif
+
+// The sample clock advances in whole milliseconds and the MPU6050 divides
+// its 1kHz output rate by an integer, so only divisors of 1000 are exact
+#if 1000 % FALL_DETECTION_SAMPLE_RATE_HZ != 0
+#error "FALL_DETECTION_SAMPLE_RATE_HZ must divide 1000 (50, 100, 125 or 200)"
+#endif
+
+#if FALL_CAPTURE_MODE == FALL_CAPTURE_FIFO
+#if FALL_DETECTION_SAMPLE_RATE_HZ < 100 || FALL_DETECTION_SAMPLE_RATE_HZ > 200
+#error "FALL_DETECTION_SAMPLE_RATE_HZ must be between 100 and 200 for FIFO capture"
+#endif
+#endif
 
 // MPU6050 sensor object
 Adafruit_MPU6050 mpu;
 
-// Configuration parameters
-struct FallConfig {
-  // Fall detection thresholds
-  float freefallThreshold = 6.0;          // m/s² - Increased from 5.0 to be more sensitive
-  float impactThreshold = 16.0;           // m/s² - Reduced from 20.0 to detect lighter impacts
-  float orientationChangeThreshold = 15.0; // degrees - Reduced from 25.0 to require less rotation
-  
-  // Fall detection options
-  bool requireOrientationChange = false;   // Disabled for easier detection
-  bool requireConsistentAcceleration = true; // Still verifying basic acceleration pattern
-  
-  // Timing parameters
-  unsigned long minFreefallDuration = 70;   // ms - Reduced from 100ms for quicker detection
-  unsigned long maxFreefallWindow = 450;    // ms - Increased window for more detection opportunities
-  unsigned long fallResetTime = 40000;      // ms - Time before system resets after fall (increased to 40 seconds)
-  
-  // Consecutive confirmations needed
-  int requiredConsecutiveImpacts = 1;     // Reduced from 2 to only require a single impact
-};
-
-// Orientation tracking structure
-struct Orientation {
-  float pitch = 0.0;
-  float roll = 0.0;
-  float yaw = 0.0;
-  float baselinePitch = 0.0;
-  float baselineRoll = 0.0;
-  float baselineYaw = 0.0;
-};
-
-// Fall state enum
-enum FallState {
-  MONITORING,
-  POTENTIAL_FALL,
-  IMPACT_DETECTED,
-  FALL_CONFIRMED
-};
-
-// Global variables
-FallConfig config;
-Orientation orientation;
-FallState currentState = MONITORING;
-unsigned long stateStartTime = 0;
-unsigned long fallDetectedTime = 0;
-float peakAcceleration = 0.0;
-float minAcceleration = 9.8;
-const float ALPHA = 0.8; // Low-pass filter coefficient
-
-// Impact counter for consecutive readings
-int consecutiveImpacts = 0;
-float previousAccMagnitude = 0;
-float accelerationIntegral = 0; // For tracking consistent acceleration
+// Fall detection state machine, fed on the IMU sample clock
+FallDetector fallDetector(FALL_DETECTION_SAMPLE_RATE_HZ);
+
+// Raw IMU history; a capture around the impact is attached to every fall
+ImpactRecorder impactRecorder(FALL_DETECTION_SAMPLE_RATE_HZ, IMPACT_PRE_MS, IMPACT_POST_MS,
+                              (uint16_t)MPU_ACCEL_LSB_PER_G, (uint16_t)(MPU_GYRO_LSB_PER_DPS * 10));
+
+// Fall timestamp of the capture being recorded
+unsigned long impactCaptureTimestamp = 0;
+
+// Worst-case time spent publishing the fall snapshot and reading GPS (us)
+unsigned long worstSnapshotMicros = 0;
+
+#if FALL_CAPTURE_MODE == FALL_CAPTURE_FIFO
+// MPU6050 registers used for FIFO capture
+#define MPU_I2C_ADDRESS 0x68
+#define MPU_REG_SMPLRT_DIV 0x19
+#define MPU_REG_FIFO_EN 0x23
+#define MPU_REG_INT_PIN_CFG 0x37
+#define MPU_REG_INT_ENABLE 0x38
+#define MPU_REG_USER_CTRL 0x6A
+#define MPU_REG_FIFO_COUNTH 0x72
+#define MPU_REG_FIFO_R_W 0x74
+
+#define MPU_FIFO_ACCEL_GYRO 0x78         // Gyro X/Y/Z and accelerometer into the FIFO (no temperature)
+#define MPU_INT_RD_CLEAR 0x10            // Active high, push-pull, 50us pulse, cleared by any read
+#define MPU_INT_DATA_READY 0x01
+#define MPU_USER_FIFO_ENABLE 0x40
+#define MPU_USER_FIFO_RESET 0x04
+#define MPU_FIFO_SAMPLE_BYTES 12         // Accel X/Y/Z then gyro X/Y/Z, 16-bit big-endian
+#define MPU_FIFO_SIZE 1024
+#define MPU_GYRO_OUTPUT_RATE_HZ 1000     // Gyro output rate with the DLPF enabled
+
+#if MPU_FIFO_BATCH * MPU_FIFO_SAMPLE_BYTES > 128
+#error "MPU_FIFO_BATCH does not fit in one Wire transaction (128 bytes)"
+#endif
+
+// One IMU sample decoded from the FIFO
+typedef struct {
+  sensors_event_t accel;
+  sensors_event_t gyro;
+} ImuSample;
+
+static TaskHandle_t fallTaskHandle = NULL;
+static volatile uint8_t dataReadyCount = 0;
+static uint32_t fifoOverflows = 0;
+
+/**
+ * Data-ready interrupt. The MPU6050 has no FIFO watermark interrupt, so
+ * count data-ready pulses and wake the task once a full batch is waiting.
+ */
+static void IRAM_ATTR mpuDataReadyIsr() {
+  if (++dataReadyCount >= MPU_FIFO_BATCH) {
+    dataReadyCount = 0;
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(fallTaskHandle, &higherPriorityTaskWoken);
+    if (higherPriorityTaskWoken) {
+      portYIELD_FROM_ISR();
+    }
+  }
+}
+
+static bool mpuWriteRegister(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(MPU_I2C_ADDRESS);
+  Wire.write(reg);
+  Wire.write(value);
+  return Wire.endTransmission() == 0;
+}
+
+static int mpuReadRegisters(uint8_t reg, uint8_t *buffer, int length) {
+  Wire.beginTransmission(MPU_I2C_ADDRESS);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) {
+    return 0;
+  }
+  int received = Wire.requestFrom((uint8_t)MPU_I2C_ADDRESS, (uint8_t)length);
+  for (int i = 0; i < received; i++) {
+    buffer[i] = Wire.read();
+  }
+  return received;
+}
+
+static void resetMpuFifo() {
+  mpuWriteRegister(MPU_REG_USER_CTRL, MPU_USER_FIFO_RESET);
+  mpuWriteRegister(MPU_REG_USER_CTRL, MPU_USER_FIFO_ENABLE);
+  dataReadyCount = 0;
+}
+
+/**
+ * Switch the MPU6050 to FIFO capture at FALL_DETECTION_SAMPLE_RATE_HZ and
+ * route its data-ready interrupt to MPU_INT_PIN.
+ */
+static bool startMpuFifoCapture() {
+  fallTaskHandle = xTaskGetCurrentTaskHandle();
+  
+  bool ok = mpuWriteRegister(MPU_REG_SMPLRT_DIV, MPU_GYRO_OUTPUT_RATE_HZ / FALL_DETECTION_SAMPLE_RATE_HZ - 1);
+  ok = ok && mpuWriteRegister(MPU_REG_FIFO_EN, MPU_FIFO_ACCEL_GYRO);
+  ok = ok && mpuWriteRegister(MPU_REG_INT_PIN_CFG, MPU_INT_RD_CLEAR);
+  ok = ok && mpuWriteRegister(MPU_REG_INT_ENABLE, MPU_INT_DATA_READY);
+  if (!ok) {
+    return false;
+  }
+  
+  resetMpuFifo();
+  attachInterrupt(digitalPinToInterrupt(MPU_INT_PIN), mpuDataReadyIsr, RISING);
+  return true;
+}
+
+static float decodeAxis(const uint8_t *bytes) {
+  return (float)(int16_t)((bytes[0] << 8) | bytes[1]);
+}
+
+/**
+ * Burst-read up to maxSamples samples from the FIFO in one I2C transaction
+ *
+ * @param samples Output buffer
+ * @param maxSamples Capacity of samples (at most MPU_FIFO_BATCH)
+ * @return Number of samples decoded, oldest first
+ */
+static int readMpuFifoBatch(ImuSample *samples, int maxSamples) {
+  uint8_t countBytes[2];
+  if (mpuReadRegisters(MPU_REG_FIFO_COUNTH, countBytes, 2) != 2) {
+    return 0;
+  }
+  int fifoBytes = (countBytes[0] << 8) | countBytes[1];
+  
+  // A full FIFO has overflowed and may hold a partial sample: start clean
+  if (fifoBytes >= MPU_FIFO_SIZE || fifoBytes % MPU_FIFO_SAMPLE_BYTES != 0) {
+    fifoOverflows++;
+    Serial.printf("Fall Detection Task: MPU FIFO overflow (%lu), resetting\n", (unsigned long)fifoOverflows);
+    resetMpuFifo();
+    return 0;
+  }
+  
+  int count = fifoBytes / MPU_FIFO_SAMPLE_BYTES;
+  if (count > maxSamples) {
+    count = maxSamples;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  
+  uint8_t raw[MPU_FIFO_BATCH * MPU_FIFO_SAMPLE_BYTES];
+  int length = count * MPU_FIFO_SAMPLE_BYTES;
+  if (mpuReadRegisters(MPU_REG_FIFO_R_W, raw, length) != length) {
+    // A short read leaves the FIFO misaligned
+    resetMpuFifo();
+    return 0;
+  }
+  
+  const float accelScale = SENSORS_GRAVITY_STANDARD / MPU_ACCEL_LSB_PER_G;
+  const float gyroScale = SENSORS_DPS_TO_RADS / MPU_GYRO_LSB_PER_DPS;
+  for (int i = 0; i < count; i++) {
+    const uint8_t *sample = &raw[i * MPU_FIFO_SAMPLE_BYTES];
+    samples[i].accel.acceleration.x = decodeAxis(&sample[0]) * accelScale;
+    samples[i].accel.acceleration.y = decodeAxis(&sample[2]) * accelScale;
+    samples[i].accel.acceleration.z = decodeAxis(&sample[4]) * accelScale;
+    samples[i].gyro.gyro.x = decodeAxis(&sample[6]) * gyroScale;
+    samples[i].gyro.gyro.y = decodeAxis(&sample[8]) * gyroScale;
+    samples[i].gyro.gyro.z = decodeAxis(&sample[10]) * gyroScale;
+  }
+  return count;
+}
+#endif
+
+#if FALL_BENCHMARK_ON_BOOT
+/**
+ * Run the orientation filter and the old accelerometer-only angles over a
+ * synthetic fall and print cycles per sample and roll error against the
+ * true attitude, then the cost of the whole detector and whether it
+ * confirmed the fall. Trace: 1 s standing, a 0.4 s tumble through 80
+ * degrees while the accelerometer reads near free fall, a 50 ms impact
+ * with a sideways shock, then 1.55 s lying still.
+ */
+static void runFallBenchmark() {
+  const int samples = 3 * FALL_DETECTION_SAMPLE_RATE_HZ;
+  const float dt = 1.0f / FALL_DETECTION_SAMPLE_RATE_HZ;
+  const float tumbleRate = 80.0f / 0.4f * DEG_TO_RAD;
+  const float legacyAlpha = powf(0.8f, (float)FALL_REFERENCE_RATE_HZ / FALL_DETECTION_SAMPLE_RATE_HZ);
+  
+  OrientationFilter filter(FALL_DETECTION_SAMPLE_RATE_HZ);
+  filter.reset(0, 0, SENSORS_GRAVITY_STANDARD);
+  static FallDetector detector(FALL_DETECTION_SAMPLE_RATE_HZ);
+  detector.calibrate(0, 0, SENSORS_GRAVITY_STANDARD, 0, 0, 0);
+  int falls = 0;
+  float legacyRoll = 0;
+  float trueRoll = 0;
+  float filterError = 0, legacyError = 0;
+  float worstFilterError = 0, worstLegacyError = 0;
+  uint32_t filterCycles = 0, legacyCycles = 0, detectorCycles = 0;
+  uint32_t noise = 12345;
+  volatile float legacySink;  // Keeps the unused legacy angles from being optimised out
+  
+  for (int i = 0; i < samples; i++) {
+    float t = i * dt;
+    float rate = 0;
+    float ax = 0, ay, az;
+    noise = noise * 1103515245 + 12345;
+    float jitter = ((int)((noise >> 16) % 41) - 20) * 0.005f;
+    
+    if (t >= 1.0f && t < 1.4f) {
+      // Tumbling in free fall: the accelerometer no longer sees gravity
+      rate = tumbleRate;
+      trueRoll += rate * dt;
+      ay = jitter;
+      az = 0.3f * SENSORS_GRAVITY_STANDARD;
+    } else if (t >= 1.4f && t < 1.45f) {
+      // Impact: 3 g along gravity plus a 2 g sideways shock
+      ay = 3.0f * SENSORS_GRAVITY_STANDARD * sinf(trueRoll) + 2.0f * SENSORS_GRAVITY_STANDARD;
+      az = 3.0f * SENSORS_GRAVITY_STANDARD * cosf(trueRoll);
+    } else {
+      ay = SENSORS_GRAVITY_STANDARD * sinf(trueRoll) + jitter;
+      az = SENSORS_GRAVITY_STANDARD * cosf(trueRoll);
+    }
+    
+    uint32_t start = ESP.getCycleCount();
+    filter.update(rate + jitter * 0.1f, 0, 0, ax, ay, az);
+    filterCycles += ESP.getCycleCount() - start;
+    
+    start = ESP.getCycleCount();
+    float newRoll = atan2(ay, sqrt(ax * ax + az * az)) * 180.0 / PI;
+    float newPitch = atan2(ax, sqrt(ay * ay + az * az)) * 180.0 / PI;
+    float newYaw = atan2(sqrt(ax * ax + ay * ay), az) * 180.0 / PI;
+    legacyRoll = legacyAlpha * legacyRoll + (1 - legacyAlpha) * newRoll;
+    legacySink = newPitch + newYaw;
+    legacyCycles += ESP.getCycleCount() - start;
+    
+    start = ESP.getCycleCount();
+    if (detector.processSample(ax, ay, az, rate + jitter * 0.1f, 0, 0, i * 1000 / FALL_DETECTION_SAMPLE_RATE_HZ,
+                               NULL) == FALL_RESULT_FALL) {
+      falls++;
+    }
+    detectorCycles += ESP.getCycleCount() - start;
+    
+    if (t >= 1.0f) {
+      OrientationAngles angles;
+      filter.getAngles(&angles);
+      float truth = trueRoll * RAD_TO_DEG;
+      float fe = fabsf(angles.roll - truth);
+      float le = fabsf(legacyRoll - truth);
+      filterError += fe;
+      legacyError += le;
+      worstFilterError = max(worstFilterError, fe);
+      worstLegacyError = max(worstLegacyError, le);
+    }
+  }
+  
+  int scored = samples - FALL_DETECTION_SAMPLE_RATE_HZ;
+  Serial.printf("Fall Detection Task: Benchmark filter: %lu cycles/sample, roll error mean %.2f max %.2f deg\n",
+                (unsigned long)(filterCycles / samples), filterError / scored, worstFilterError);
+  Serial.printf("Fall Detection Task: Benchmark accel-only: %lu cycles/sample, roll error mean %.2f max %.2f deg\n",
+                (unsigned long)(legacyCycles / samples), legacyError / scored, worstLegacyError);
+  
+  uint32_t cyclesPerSample = detectorCycles / samples;
+  Serial.printf("Fall Detection Task: Benchmark detector: %lu cycles/sample, %lu samples/s per core, %d fall(s) confirmed\n",
+                (unsigned long)cyclesPerSample,
+                (unsigned long)(ESP.getCpuFreqMHz() * 1000000UL / max(cyclesPerSample, (uint32_t)1)), falls);
+}
+#endif
 
 void fallDetectionTask(void *pvParameters) {
+#if FALL_BENCHMARK_ON_BOOT
+  runFallBenchmark();
+#endif
+  
   // Initialize MPU6050
   if (!mpu.begin()) {
     while (1) {
@@ -89,289 +330,276 @@ void fallDetectionTask(void *pvParameters) {
   // Calibrate the accelerometer to establish a baseline
   calibrateAccelerometer();
   
+#if FALL_CAPTURE_MODE == FALL_CAPTURE_FIFO
+  if (startMpuFifoCapture()) {
+    Serial.printf("Fall Detection Task: Started FIFO capture at %d Hz, %d samples per batch\n",
+                  FALL_DETECTION_SAMPLE_RATE_HZ, MPU_FIFO_BATCH);
+  } else {
+    Serial.println("Fall Detection Task: Failed to start FIFO capture");
+    diagnosticsTaskExit();
+    vTaskDelete(NULL);
+    return;
+  }
+  
+  // Wait at most two batch periods so capture continues even if MPU_INT_PIN is not wired
+  const TickType_t batchTimeout = pdMS_TO_TICKS(2 * MPU_FIFO_BATCH * FALL_SAMPLE_PERIOD_MS);
+  
+  // Sample clock: timing in the state machine follows the IMU, not the wakeup
+  unsigned long sampleTime = millis();
+  ImuSample batch[MPU_FIFO_BATCH];
+  
+  diagnosticsSetLoopPeriod(DIAG_LOOP_FALL, MPU_FIFO_BATCH * FALL_SAMPLE_PERIOD_MS * 1000UL);
+  
+  // Main task loop - one iteration per batch
+  while (true) {
+    diagnosticsLoopWait(DIAG_LOOP_FALL);
+    ulTaskNotifyTake(pdTRUE, batchTimeout);
+    diagnosticsLoopWake(DIAG_LOOP_FALL);
+    
+    // Drain the FIFO; a full batch means more samples may be waiting
+    int count;
+    do {
+      count = readMpuFifoBatch(batch, MPU_FIFO_BATCH);
+      for (int i = 0; i < count; i++) {
+        sampleTime += FALL_SAMPLE_PERIOD_MS;
+        recordImpactSample(batch[i].accel, batch[i].gyro);
+        processFallDetection(batch[i].accel, batch[i].gyro, sampleTime);
+      }
+    } while (count == MPU_FIFO_BATCH);
+  }
+#else
+  // Polling needs the CPU awake for every sample; the FIFO buffers through light sleep
+  powerLockAcquire(POWER_LOCK_SAMPLING);
+  
   // Variables for task timing
   TickType_t xLastWakeTime;
-  const TickType_t xFrequency = pdMS_TO_TICKS(1000 / FALL_DETECTION_SAMPLE_RATE_HZ);
+  const TickType_t xFrequency = pdMS_TO_TICKS(FALL_SAMPLE_PERIOD_MS);
   xLastWakeTime = xTaskGetTickCount();
+  diagnosticsSetLoopPeriod(DIAG_LOOP_FALL, FALL_SAMPLE_PERIOD_MS * 1000UL);
   
   // Main task loop
   while (true) {
     // Ensure task runs at consistent frequency
+    diagnosticsLoopWait(DIAG_LOOP_FALL);
     vTaskDelayUntil(&xLastWakeTime, xFrequency);
+    diagnosticsLoopWake(DIAG_LOOP_FALL);
     
     // Read accelerometer and gyroscope data
     sensors_event_t accel, gyro, temp;
     mpu.getEvent(&accel, &gyro, &temp);
     
-    // Update orientation
-    updateOrientation(accel, gyro);
+    // Keep the raw history
+    recordImpactSample(accel, gyro);
     
     // Process fall detection algorithm
-    processFallDetection(accel, gyro);
+    processFallDetection(accel, gyro, millis());
   }
+#endif
 }
 
 void calibrateAccelerometer() {
-  // Take multiple samples for better baseline
+  // Average samples at rest for the gravity direction and the gyro offset
   const int numSamples = 100;
-  float pitchSum = 0, rollSum = 0, yawSum = 0;
+  float accelSum[3] = {0, 0, 0};
+  float gyroSum[3] = {0, 0, 0};
   
   for (int i = 0; i < numSamples; i++) {
     sensors_event_t accel, gyro, temp;
     mpu.getEvent(&accel, &gyro, &temp);
     
-    // Calculate orientation from this sample
-    float ax = accel.acceleration.x;
-    float ay = accel.acceleration.y;
-    float az = accel.acceleration.z;
-    
-    float pitch = atan2(ax, sqrt(ay * ay + az * az)) * 180.0 / PI;
-    float roll = atan2(ay, sqrt(ax * ax + az * az)) * 180.0 / PI;
-    float yaw = atan2(sqrt(ax * ax + ay * ay), az) * 180.0 / PI;
-    
-    pitchSum += pitch;
-    rollSum += roll;
-    yawSum += yaw;
+    accelSum[0] += accel.acceleration.x;
+    accelSum[1] += accel.acceleration.y;
+    accelSum[2] += accel.acceleration.z;
+    gyroSum[0] += gyro.gyro.x;
+    gyroSum[1] += gyro.gyro.y;
+    gyroSum[2] += gyro.gyro.z;
     
     vTaskDelay(pdMS_TO_TICKS(20));
   }
   
-  // Set baseline orientation values
-  orientation.baselinePitch = pitchSum / numSamples;
-  orientation.baselineRoll = rollSum / numSamples;
-  orientation.baselineYaw = yawSum / numSamples;
+  fallDetector.calibrate(accelSum[0] / numSamples, accelSum[1] / numSamples, accelSum[2] / numSamples,
+                         gyroSum[0] / numSamples, gyroSum[1] / numSamples, gyroSum[2] / numSamples);
+}
+
+static int16_t toCounts(float value, float countsPerUnit) {
+  float counts = value * countsPerUnit;
+  counts = constrain(counts, -32768.0f, 32767.0f);
+  return (int16_t)lroundf(counts);
 }
 
-void updateOrientation(sensors_event_t accel, sensors_event_t gyro) {
-  // Calculate raw orientation values
-  float ax = accel.acceleration.x;
-  float ay = accel.acceleration.y;
-  float az = accel.acceleration.z;
+/**
+ * Convert one sample back to sensor counts and append it to impactRecorder.
+ * Publishes the capture when this sample completes its post-impact window.
+ */
+void recordImpactSample(const sensors_event_t &accel, const sensors_event_t &gyro) {
+  const float accelCounts = MPU_ACCEL_LSB_PER_G / SENSORS_GRAVITY_STANDARD;
+  const float gyroCounts = MPU_GYRO_LSB_PER_DPS / SENSORS_DPS_TO_RADS;
   
-  float newPitch = atan2(ax, sqrt(ay * ay + az * az)) * 180.0 / PI;
-  float newRoll = atan2(ay, sqrt(ax * ax + az * az)) * 180.0 / PI;
-  float newYaw = atan2(sqrt(ax * ax + ay * ay), az) * 180.0 / PI;
+  ImpactSample sample;
+  sample.axes[0] = toCounts(accel.acceleration.x, accelCounts);
+  sample.axes[1] = toCounts(accel.acceleration.y, accelCounts);
+  sample.axes[2] = toCounts(accel.acceleration.z, accelCounts);
+  sample.axes[3] = toCounts(gyro.gyro.x, gyroCounts);
+  sample.axes[4] = toCounts(gyro.gyro.y, gyroCounts);
+  sample.axes[5] = toCounts(gyro.gyro.z, gyroCounts);
   
-  // Apply low-pass filter to smooth data
-  orientation.pitch = ALPHA * orientation.pitch + (1 - ALPHA) * newPitch;
-  orientation.roll = ALPHA * orientation.roll + (1 - ALPHA) * newRoll;
-  orientation.yaw = ALPHA * orientation.yaw + (1 - ALPHA) * newYaw;
+  if (impactRecorder.addSample(sample)) {
+    // Capture complete: hand the blob to the uploaders without copying it
+    int length;
+    impactRecorder.getBlob(&length);
+    
+    ImpactCapture capture;
+    capture.captureId = impactRecorder.getCaptureCount();
+    capture.timestamp = impactCaptureTimestamp;
+    capture.length = length;
+    impactRecorder.holdBlob(impactCaptureTopic.getSubscriberCount());
+    if (!impactCaptureTopic.publish(capture)) {
+      // Nobody will read it, so do not keep it from the next fall
+      impactRecorder.holdBlob(0);
+    }
+    
+    Serial.printf("Fall Detection Task: Impact capture %lu ready, %d bytes\n",
+                  (unsigned long)capture.captureId, length);
+  }
 }
 
-float calculateAccelerationMagnitude(float x, float y, float z) {
-  return sqrt(x * x + y * y + z * z);
+void processFallDetection(sensors_event_t accel, sensors_event_t gyro, unsigned long currentTime) {
+  FallDetection detection;
+  FallDetectorResult result = fallDetector.processSample(
+    accel.acceleration.x, accel.acceleration.y, accel.acceleration.z,
+    gyro.gyro.x, gyro.gyro.y, gyro.gyro.z,
+    currentTime, &detection);
+  
+  if (result == FALL_RESULT_FALL || result == FALL_RESULT_REJECTED) {
+    // Logged in the format tools/train_fall_classifier.py reads
+    Serial.printf("Fall Detection Task: Classifier sma=%.3f jerk=%.1f stillness=%.4f orientation=%.1f score=%ld %s\n",
+                  detection.features.sma, detection.features.jerk, detection.features.stillness,
+                  detection.features.orientationDelta, (long)detection.classifierScore,
+                  result == FALL_RESULT_FALL ? "fall" : "rejected");
+  }
+  
+  if (result == FALL_RESULT_FALL) {
+    // Report fall event
+    reportFallEvent(detection);
+    
+    // Trigger audio alert; escalations play louder
+    AudioCommand audioCommand;
+    audioCommand.fileNumber = AUDIO_FALL_DETECTED;
+    audioCommand.repeatCount = 3;
+    audioCommand.volume = AUDIO_FALL_VOLUME;
+    audioCommandTopic.publish(audioCommand);
+  } else if (result == FALL_RESULT_ESCALATE) {
+    reportFallEscalation();
+  } else if (result == FALL_RESULT_RECOVERED) {
+    reportFallRecovery();
+  }
 }
 
-void processFallDetection(sensors_event_t accel, sensors_event_t gyro) {
-  unsigned long currentTime = millis();
+void reportFallEscalation() {
+  PostFallStatus status;
+  fallDetector.getPostFallStatus(&status);
+  Serial.printf("Fall Detection Task: Still down after %lus, no movement for %lus (escalation %d)\n",
+                (unsigned long)(status.downMs / 1000), (unsigned long)(status.motionlessMs / 1000),
+                status.escalations);
   
-  // Calculate acceleration magnitude
-  float accMagnitude = calculateAccelerationMagnitude(
-    accel.acceleration.x, 
-    accel.acceleration.y, 
-    accel.acceleration.z
-  );
+  GpsData gps;
+  currentGpsData.load(&gps);
   
-  // Update min/max values for analysis
-  if (accMagnitude > peakAcceleration) {
-    peakAcceleration = accMagnitude;
-  }
-  if (accMagnitude < minAcceleration) {
-    minAcceleration = accMagnitude;
-  }
+  TelegramAlert alert;
+  alert.kind = ALERT_FALL;
+  snprintf(alert.message, sizeof(alert.message),
+          "🚨 STILL DOWN! 🚨\nNot up %lu s after the fall%s\nAlert %d",
+          (unsigned long)(status.downMs / 1000),
+          status.motionlessMs >= fallDetector.getConfig().motionlessEscalationTime ? ", not moving" : "",
+          status.escalations + 1);
+  alert.hasFallLocation = gps.validFix && (gps.latitude != 0.0f || gps.longitude != 0.0f);
+  telegramAlertTopic.publish(alert);
   
-  // Track acceleration change pattern
-  float accChange = accMagnitude - previousAccMagnitude;
-  previousAccMagnitude = accMagnitude;
-  
-  // Fall detection state machine
-  switch (currentState) {
-    case MONITORING:
-      // Reset counters and integrals when in monitoring state
-      consecutiveImpacts = 0;
-      accelerationIntegral = 0;
-      
-      // Look for potential freefall condition
-      if (accMagnitude < config.freefallThreshold) {
-        currentState = POTENTIAL_FALL;
-        stateStartTime = currentTime;
-        peakAcceleration = 0;
-        minAcceleration = accMagnitude;
-      }
-      break;
-      
-    case POTENTIAL_FALL:
-      // Calculate acceleration integral for pattern recognition
-      accelerationIntegral += accMagnitude;
-      
-      // Confirm freefall persists for minimum duration
-      if (currentTime - stateStartTime >= config.minFreefallDuration) {
-        // Look for impact
-        if (accMagnitude > config.impactThreshold) {
-          // Count this as one impact
-          consecutiveImpacts++;
-          
-          // Check if we have enough consecutive impact readings
-          if (consecutiveImpacts >= config.requiredConsecutiveImpacts) {
-            currentState = IMPACT_DETECTED;
-            stateStartTime = currentTime;
-          }
-        }
-      }
-      
-      // Reset if no impact detected within window
-      if (currentTime - stateStartTime > config.maxFreefallWindow) {
-        currentState = MONITORING;
-        consecutiveImpacts = 0;
-      }
-      break;
-      
-    case IMPACT_DETECTED:
-      {
-        // Determine fall direction from orientation changes
-        float pitchChange = orientation.pitch - orientation.baselinePitch;
-        float rollChange = orientation.roll - orientation.baselineRoll;
-        
-        bool significantOrientationChange = 
-          fabs(pitchChange) > config.orientationChangeThreshold || 
-          fabs(rollChange) > config.orientationChangeThreshold;
-        
-        // Check acceleration pattern consistency
-        bool accelerationPatternValid = true;
-        if (config.requireConsistentAcceleration) {
-          // A valid fall should have significant acceleration change over time
-          // This helps filter out gentle movements and vibrations
-          float avgAcceleration = accelerationIntegral / (currentTime - stateStartTime + 1);
-          accelerationPatternValid = (avgAcceleration > 3.0) && 
-                                    (peakAcceleration - minAcceleration > 10.0);
-        }
-        
-        // Enhanced fall detection with multiple criteria
-        bool fallDetected = accelerationPatternValid && 
-                          (!config.requireOrientationChange || significantOrientationChange);
-        
-        if (fallDetected) {
-          currentState = FALL_CONFIRMED;
-          fallDetectedTime = currentTime;
-          
-          // Report fall event
-          reportFallEvent(pitchChange, rollChange);
-          
-          // Trigger audio alert using global variables and semaphores
-          if (xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            currentAudioCommand.fileNumber = AUDIO_FALL_DETECTED;
-            currentAudioCommand.repeatCount = 3;
-            currentAudioCommand.volume = 30; // Max volume
-            audioCommandUpdated = true;
-            xSemaphoreGive(displayMutex);
-            
-            // Signal audio task
-            xSemaphoreGive(audioCommandSemaphore);
-          }
-        } else {
-          // Not a fall
-          currentState = MONITORING;
-        }
-      }
-      break;
-      
-    case FALL_CONFIRMED:
-      // Wait for the reset time before returning to monitoring
-      if (currentTime - fallDetectedTime > config.fallResetTime) {
-        currentState = MONITORING;
-        peakAcceleration = 0;
-        minAcceleration = 9.8;
-        consecutiveImpacts = 0;
-        accelerationIntegral = 0;
-        
-        // Reset global fall status
-        if (xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-          currentFallEvent.fallDetected = false;
-          fallDetectionUpdated = true;
-          xSemaphoreGive(displayMutex);
-          
-          // Signal other tasks about the reset
-          xSemaphoreGive(fallDetectionSemaphore);
-        }
-      }
-      break;
-  }
+  AudioCommand audioCommand;
+  audioCommand.fileNumber = AUDIO_EMERGENCY;
+  audioCommand.repeatCount = 5;
+  audioCommand.volume = AUDIO_MAX_VOLUME;
+  audioCommandTopic.publish(audioCommand);
 }
 
-void reportFallEvent(float pitchChange, float rollChange) {
-  // Determine fall direction
-  bool forwardFall = pitchChange < -config.orientationChangeThreshold;
-  bool backwardFall = pitchChange > config.orientationChangeThreshold;
-  bool leftFall = rollChange < -config.orientationChangeThreshold;
-  bool rightFall = rollChange > config.orientationChangeThreshold;
-  
-  // Update fall event global structure and signal other tasks
-  if (xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    // Update the global fall event data
-    currentFallEvent.fallDetected = true;
-    currentFallEvent.acceleration = peakAcceleration;
-    currentFallEvent.orientation[0] = orientation.pitch;
-    currentFallEvent.orientation[1] = orientation.roll;
-    currentFallEvent.orientation[2] = orientation.yaw;
-    currentFallEvent.timestamp = millis();
-    currentFallEvent.fallSeverity = map(peakAcceleration, config.impactThreshold, 40.0, 1, 10);
-    fallDetectionUpdated = true;
-    
-    // Release mutex
-    xSemaphoreGive(displayMutex);
+void reportFallRecovery() {
+  Serial.println("Fall Detection Task: Person is upright again, fall alert cancelled");
+  
+  // Reset global fall status
+  FallEvent fallEvent;
+  currentFallEvent.load(&fallEvent);
+  fallEvent.fallDetected = false;
+  currentFallEvent.store(fallEvent);
+  
+  // Tell other tasks about the recovery
+  fallTopic.publish(fallEvent);
+  
+  TelegramAlert alert;
+  alert.kind = ALERT_FALL;
+  snprintf(alert.message, sizeof(alert.message),
+          "✅ Recovered: the person is up again.\nFall alert cancelled.");
+  alert.hasFallLocation = false;
+  telegramAlertTopic.publish(alert);
+}
+
+void reportFallEvent(const FallDetection &detection) {
+  FallEvent fallEvent;
+  fallEvent.fallDetected = true;
+  fallEvent.acceleration = detection.peakAcceleration;
+  fallEvent.orientation[0] = detection.pitch;
+  fallEvent.orientation[1] = detection.roll;
+  fallEvent.orientation[2] = detection.yaw;
+  fallEvent.timestamp = millis();
+  fallEvent.fallSeverity = map(detection.peakAcceleration, fallDetector.getConfig().impactThreshold, 40.0, 1, 10);
+  
+  // Freeze the IMU window around the impact; it is published once the
+  // post-impact samples are in. The newest recorded sample is the one the
+  // fall was confirmed on.
+  uint32_t impactSample = impactRecorder.getSampleCount() - 1 - detection.samplesSinceImpact;
+  if (impactRecorder.trigger(impactSample, fallEvent.timestamp)) {
+    impactCaptureTimestamp = fallEvent.timestamp;
+  } else {
+    Serial.printf("Fall Detection Task: Impact capture skipped, previous capture still pending (%lu missed)\n",
+                  (unsigned long)impactRecorder.getMissedCount());
+  }
+  
+  // Update the global fall event snapshot and read the latest GPS fix.
+  // Neither can wait on another task, so this is bounded by two struct copies.
+  unsigned long snapshotStart = micros();
+  currentFallEvent.store(fallEvent);
+  GpsData gps;
+  currentGpsData.load(&gps);
+  unsigned long snapshotMicros = micros() - snapshotStart;
+  if (snapshotMicros > worstSnapshotMicros) {
+    worstSnapshotMicros = snapshotMicros;
+  }
+  Serial.printf("Fall Detection Task: Snapshot update took %lu us (worst %lu us, GPS read retries %lu)\n",
+                snapshotMicros, worstSnapshotMicros, (unsigned long)currentGpsData.getRetries());
+  
+  bool locationAvailable = gps.validFix && 
+                           (gps.latitude != 0.0f || gps.longitude != 0.0f);
+  
+  // Tell other tasks about the fall
+  fallTopic.publish(fallEvent);
+  
+  // Create alert message for Telegram based on GPS availability
+  TelegramAlert alert;
+  alert.kind = ALERT_FALL;
+  if (locationAvailable) {
+    snprintf(alert.message, sizeof(alert.message),
+            "⚠️ FALL DETECTED! ⚠️\nSeverity: %d/10\nLocation available", 
+            fallEvent.fallSeverity);
     
-    // Signal other tasks that fall event data is updated
-    xSemaphoreGive(fallDetectionSemaphore);
+    // Flag that the HTTP task should follow up with the location
+    alert.hasFallLocation = true;
+  } else {
+    snprintf(alert.message, sizeof(alert.message),
+            "⚠️ FALL DETECTED! ⚠️\nSeverity: %d/10\nLocation: No GPS signal available", 
+            fallEvent.fallSeverity);
     
-    // Prepare Telegram message in a thread-safe manner
-    if (xSemaphoreTake(telegramAlertSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-      // Reset the alert structure
-      memset((void*)&currentTelegramAlert, 0, sizeof(TelegramAlert));
-      
-      // Get fresh GPS data to ensure we have the latest information
-      bool locationAvailable = false;
-      float lat = 0.0f, lng = 0.0f;
-      
-      // Try to get current GPS data with semaphore protection
-      // Using a shorter timeout to prevent blocking too long
-      if (xSemaphoreTake(gpsDataSemaphore, pdMS_TO_TICKS(50)) == pdTRUE) {
-        locationAvailable = currentGpsData.validFix && 
-                           (currentGpsData.latitude != 0.0f || currentGpsData.longitude != 0.0f);
-                           
-        // Store the coordinates locally if they're valid
-        if (locationAvailable) {
-          lat = currentGpsData.latitude;
-          lng = currentGpsData.longitude;
-        }
-        
-        // Always ensure we release the semaphore
-        xSemaphoreGive(gpsDataSemaphore);
-      } else {
-        // If we couldn't take the semaphore, don't block and proceed without GPS data
-        locationAvailable = false;
-      }
-      
-      // Create alert message for Telegram based on GPS availability
-      if (locationAvailable) {
-        snprintf((char*)currentTelegramAlert.message, sizeof(currentTelegramAlert.message),
-                "⚠️ FALL DETECTED! ⚠️\nSeverity: %d/10\nLocation available", 
-                currentFallEvent.fallSeverity);
-        
-        // Flag that we have location data and store the coordinates
-        currentTelegramAlert.hasFallLocation = true;
-      } else {
-        snprintf((char*)currentTelegramAlert.message, sizeof(currentTelegramAlert.message),
-                "⚠️ FALL DETECTED! ⚠️\nSeverity: %d/10\nLocation: No GPS signal available", 
-                currentFallEvent.fallSeverity);
-        
-        currentTelegramAlert.hasFallLocation = false;
-      }
-      
-      // Set the pending flag
-      currentTelegramAlert.pending = true;
-      telegramAlertUpdated = true;
-      
-      xSemaphoreGive(telegramAlertSemaphore);
-    }
+    alert.hasFallLocation = false;
   }
+  
+  // Queue for the HTTP task; publishing never blocks this task
+  telegramAlertTopic.publish(alert);
 }
\ No newline at end of file
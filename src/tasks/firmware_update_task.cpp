@@ -12,6 +12,7 @@
 #include <WiFiClientSecure.h>
 #include <HTTPClient.h>
 #include <Update.h>
+#include <ArduinoJson.h>
 #include "../../include/firmware_update_task.h"
 #include "../../include/config.h"
 #include "../../include/globals.h"
@@ -105,15 +106,15 @@ bool checkFirmwareUpdate() {
   // Set shorter timeout for HTTP operations
   http.setTimeout(15000);  // Increase timeout to 15 seconds
   
-  // Get device ID as string - Convert integer PATIENT_ID to string
-  String deviceId = String(PATIENT_ID);
+  // Device ID as text, formatted at compile time
+  const char *deviceId = PATIENT_ID_TEXT;
   
   // Set headers to identify the device and current version
   http.addHeader("X-Device-ID", deviceId);
   http.addHeader("X-Current-Version", FIRMWARE_VERSION);
   
   Serial.println("Firmware Update Task: Sending request with headers:");
-  Serial.printf("X-Device-ID: %s\n", deviceId.c_str());
+  Serial.printf("X-Device-ID: %s\n", deviceId);
   Serial.printf("X-Current-Version: %s\n", FIRMWARE_VERSION);
   
   // Print the current URL we're using (fixed getURL error)
@@ -312,23 +313,21 @@ void reportUpdateStatus(const char* version, const char* status) {
   http.setTimeout(10000);  // 10 seconds timeout
   http.addHeader("Content-Type", "application/json");
   
-  // Convert integer PATIENT_ID to string
-  String deviceId = String(PATIENT_ID);
+  // Create JSON payload in a fixed buffer; ArduinoJson escapes the strings
+  StaticJsonDocument<128> doc;
+  doc["device_id"] = PATIENT_ID_TEXT;
+  doc["version"] = version;
+  doc["status"] = status;
+  char payload[128];
+  size_t payloadLength = serializeJson(doc, payload);
   
-  // Create JSON payload
-  String payload = "{";
-  payload += "\"device_id\":\"" + deviceId + "\",";
-  payload += "\"version\":\"" + String(version) + "\",";
-  payload += "\"status\":\"" + String(status) + "\"";
-  payload += "}";
-  
-  Serial.printf("Firmware Update Task: Sending payload: %s\n", payload.c_str());
+  Serial.printf("Firmware Update Task: Sending payload: %s\n", payload);
   
   // Yield before making the request to ensure watchdog is fed
   vTaskDelay(pdMS_TO_TICKS(10));
   
   // Send the report
-  int httpCode = http.POST(payload);
+  int httpCode = http.POST((uint8_t*)payload, payloadLength);
   
   // Yield after the request
   vTaskDelay(pdMS_TO_TICKS(10));
@@ -339,12 +338,6 @@ void reportUpdateStatus(const char* version, const char* status) {
     Serial.println("Firmware Update Task: Status reported successfully");
   } else {
     Serial.printf("Firmware Update Task: Status report failed, HTTP code: %d\n", httpCode);
-    
-    // Try to get response content for more details
-    String response = http.getString();
-    if (response.length() > 0) {
-      Serial.printf("Firmware Update Task: Response: %s\n", response.c_str());
-    }
   }
   
   http.end();
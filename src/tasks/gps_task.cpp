@@ -2,7 +2,7 @@
  * ElderGuard - GPS Task Implementation
  * 
  * This file implements the GPS tracking task using the GY-NEO6MV2 module.
- * It retrieves longitude and latitude and signals other tasks through semaphores.
+ * It retrieves longitude and latitude and publishes them on the GPS topic.
  */
 
 #include <Arduino.h>
@@ -12,18 +12,31 @@
 #include "../include/gps_task.h"
 #include "../include/config.h"
 #include "../include/globals.h"
-#include "../include/mqtt_task.h"
 
 // TinyGPS++ object
 TinyGPSPlus gps;
 
+// Latest GPS data owned by this task
+GpsData gpsData = {};
+
 // Variables for data publishing
 unsigned long lastDataUpdate = 0;
 unsigned long lastHttpPublish = 0;
 
+// Notification bit set by the UART when NMEA data arrives
+#define GPS_NOTIFY_UART (1 << 0)
+
+static TaskHandle_t notifyTask = NULL;
+
 void gpsTask(void *pvParameters) {
   Serial.println("GPS Task: Started");
   
+  // Wake on received data instead of polling the UART
+  notifyTask = xTaskGetCurrentTaskHandle();
+  Serial2.onReceive([]() {
+    xTaskNotify(notifyTask, GPS_NOTIFY_UART, eSetBits);
+  });
+  
   // Main task loop
   while (true) {
     // Process GPS data while available
@@ -38,24 +51,17 @@ void gpsTask(void *pvParameters) {
     if (currentTime - lastDataUpdate >= GPS_UPDATE_INTERVAL_MS) {
       lastDataUpdate = currentTime;
       
-      // Update shared GPS data with mutex protection
-      if (xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        // Update shared GPS data structure with latest values
-        updateGpsData(currentTime);
-        gpsDataUpdated = true;
-        
-        // Release mutex
-        xSemaphoreGive(displayMutex);
-        
-        // Signal other tasks that GPS data is updated
-        xSemaphoreGive(gpsDataSemaphore);
-        
-        // Publish GPS data if MQTT is available
-        publishGpsData();
-        
-        // Debug output
-        printGpsDebugInfo();
-      }
+      // Update GPS data structure with latest values
+      updateGpsData(currentTime);
+      
+      // Update shared GPS snapshot (never blocks)
+      currentGpsData.store(gpsData);
+      
+      // Deliver to MQTT, HTTP and screen
+      gpsTopic.publish(gpsData);
+      
+      // Debug output
+      printGpsDebugInfo();
     }
     
     // HTTP publishing (every 40 seconds)
@@ -67,34 +73,35 @@ void gpsTask(void *pvParameters) {
       // This would be replaced with actual HTTP code later
     }
     
-    // Small delay to prevent task from hogging CPU
-    vTaskDelay(pdMS_TO_TICKS(20));
+    // Sleep until more data arrives or the next update is due
+    unsigned long untilUpdate = GPS_UPDATE_INTERVAL_MS - (millis() - lastDataUpdate);
+    waitForEvents(pdMS_TO_TICKS(untilUpdate > GPS_UPDATE_INTERVAL_MS ? 1 : untilUpdate + 1));
   }
 }
 
 void updateGpsData(unsigned long timestamp) {
   // Only update location if we have a valid GPS fix
   if (gps.location.isValid()) {
-    currentGpsData.latitude = gps.location.lat();
-    currentGpsData.longitude = gps.location.lng();
-    currentGpsData.validFix = true;
-    currentGpsData.timestamp = timestamp;
+    gpsData.latitude = gps.location.lat();
+    gpsData.longitude = gps.location.lng();
+    gpsData.validFix = true;
+    gpsData.timestamp = timestamp;
     
     // Update additional data if available
     if (gps.altitude.isValid()) {
-      currentGpsData.altitude = gps.altitude.meters();
+      gpsData.altitude = gps.altitude.meters();
     }
     
     if (gps.speed.isValid()) {
-      currentGpsData.speed = gps.speed.kmph();
+      gpsData.speed = gps.speed.kmph();
     }
     
     if (gps.satellites.isValid()) {
-      currentGpsData.satellites = gps.satellites.value();
+      gpsData.satellites = gps.satellites.value();
     }
   } else {
-    currentGpsData.validFix = false;
-    currentGpsData.timestamp = timestamp;
+    gpsData.validFix = false;
+    gpsData.timestamp = timestamp;
   }
 }
 
@@ -112,17 +119,17 @@ void printGpsDebugInfo() {
   
   // Location information
   Serial.print("Location: ");
-  if (currentGpsData.validFix) {
-    Serial.print(currentGpsData.latitude, 6);
+  if (gpsData.validFix) {
+    Serial.print(gpsData.latitude, 6);
     Serial.print(", ");
-    Serial.println(currentGpsData.longitude, 6);
+    Serial.println(gpsData.longitude, 6);
     
     Serial.print("Altitude: ");
-    Serial.print(currentGpsData.altitude);
+    Serial.print(gpsData.altitude);
     Serial.println(" meters");
     
     Serial.print("Speed: ");
-    Serial.print(currentGpsData.speed);
+    Serial.print(gpsData.speed);
     Serial.println(" km/h");
   } else {
     Serial.println("No valid fix");
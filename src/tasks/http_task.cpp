@@ -9,43 +9,130 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
+#include <SPIFFS.h>
+#include <time.h>
 #include "../include/http_task.h"
 #include "../include/config.h"
 #include "../include/globals.h"
 #include "../include/wifi_task.h"
-#include "../include/ecg_task.h" // Added to directly access ecgBuffer
-
-// Define ECG_BUFFER_SIZE to match the value in ecg_task.cpp
-#define ECG_BUFFER_SIZE 250  // 5 seconds at 50Hz
+#include "../include/time_task.h"
+#include "../include/ecg_task.h" // Added to directly access ecgRing
+#include "../include/fall_detection_task.h" // For the impact capture blob
+#include "../include/ecg_stream.h"
+#include "../include/request_queue.h"
+#include "../include/outbox.h"
+#include "../include/http_request.h"
+#include "../include/http_response.h"
+#include "../include/power_manager.h"
 
 // Function declarations
-void sendSensorData();
-void sendHeartRateAlert(int heartRate);
-void sendLocationData();
-void sendTelegramMessage(const char* message);
-void sendPatientLocationData();
+bool sendPatientLocationData();
 void getEcgData(char* buffer, int maxSize);
+bool sendImpactCapture(const ImpactCapture &capture);
+bool sendEcgStream(const uint8_t *blocks, int length, int blockCount);
+static int postRequest(int host, const char *path, const char *contentType, const char *extraHeaders,
+                       const uint8_t *body, int length, int timeoutMs);
 
-// Laravel API settings
-const char* LARAVEL_API_URL = "https://elderguard.codecommerce.info/api";
-const char* SENSOR_DATA_ENDPOINT = "/sensor-data";
-const char* ALERT_ENDPOINT = "/alerts";
-const char* LOCATION_ENDPOINT = "/location-tracking";
-const char* PATIENT_LOCATION_ENDPOINT = "/patients/1/locations"; // New endpoint for patient specific location
+// Laravel API settings; paths are joined at compile time
+#define LARAVEL_API_HOST "elderguard.codecommerce.info"
+#define LARAVEL_API_PATH "/api"
+#define SENSOR_DATA_ENDPOINT LARAVEL_API_PATH "/sensor-data"
+#define ALERT_ENDPOINT LARAVEL_API_PATH "/alerts"
+#define LOCATION_ENDPOINT LARAVEL_API_PATH "/location-tracking"
+#define PATIENT_LOCATION_ENDPOINT LARAVEL_API_PATH "/patients/" PATIENT_ID_TEXT "/locations" // New endpoint for patient specific location
+#define FALL_CAPTURE_ENDPOINT LARAVEL_API_PATH "/fall-captures"
 
 // Telegram Bot settings
-const char* TELEGRAM_BOT_TOKEN = "7250747996:AAGZ_luXdgcnZls1QddK5z2UQ2TUVzjvgzY";
-const char* TELEGRAM_CHAT_ID = "6069199442";
-const char* TELEGRAM_API_URL = "https://api.telegram.org/bot";
+#define TELEGRAM_API_HOST "api.telegram.org"
+#define TELEGRAM_BOT_TOKEN "7250747996:AAGZ_luXdgcnZls1QddK5z2UQ2TUVzjvgzY"
+#define TELEGRAM_CHAT_ID "6069199442"
+#define TELEGRAM_SEND_ENDPOINT "/bot" TELEGRAM_BOT_TOKEN "/sendMessage"
 
 // HTTP request settings
-#define HTTP_MAX_RETRIES 3
-#define HTTP_RETRY_DELAY_MS 2000
 #define HTTP_PUBLISH_INTERVAL_MS 30000 // 30 seconds between data uploads
-#define HTTP_TIMEOUT 10000 // 10 seconds timeout for HTTP requests
+#define HTTP_TIMEOUT 10000 // 10 seconds per HTTP attempt, connect and TLS handshake included
+#define HTTP_TELEMETRY_TIMEOUT 5000 // Shorter for telemetry so it holds up an alert for less
+#define HTTP_QUEUE_CAPACITY 12
+#define HTTP_BACKOFF_BASE_MS 1000 // First retry after 1-1.5s
+#define HTTP_BACKOFF_MAX_MS 60000 // Retries at most a minute (+50% jitter) apart
+
+// Outbound request priorities, most urgent first
+#define PRIORITY_FALL_ALERT 0
+#define PRIORITY_HEALTH_ALERT 1
+#define PRIORITY_CAPTURE 2
+#define PRIORITY_NOTICE 3
+#define PRIORITY_TELEMETRY 4
+
+// How long each kind of request is worth retrying
+#define FALL_ALERT_DEADLINE_MS 600000
+#define HEALTH_ALERT_DEADLINE_MS 300000
+#define CAPTURE_DEADLINE_MS IMPACT_UPLOAD_DEADLINE_MS
+#define NOTICE_DEADLINE_MS 300000
+#define TELEMETRY_DEADLINE_MS 30000
+
+// Store-and-forward outbox on SPIFFS: 24 x 16KB holds about 20 minutes of ECG stream
+#define OUTBOX_SEGMENT_BYTES 16384
+#define OUTBOX_MAX_SEGMENTS 24
+#define OUTBOX_REPLAY_INTERVAL_MS 2000 // Between replay batches; doubles up to HTTP_BACKOFF_MAX_MS after a failure
+#define OUTBOX_REPLAY_MAX_RECORDS 8 // Records sent per replay batch
+#define OUTBOX_REPLAY_MAX_FAILURES 8 // A record the server keeps refusing is skipped
+#define OUTBOX_ALERT_MAX_AGE_S 3600 // Stored alerts older than this are dropped on replay, not sent
+
+// Requests waiting to go out
+typedef enum {
+  REQUEST_TELEGRAM,          // Fall, heart rate or medication alert, or a fall's location follow-up
+  REQUEST_HEART_RATE_ALERT,
+  REQUEST_IMPACT_CAPTURE,
+  REQUEST_ECG_STREAM,        // The batch in ecgStreamBuffer
+  REQUEST_SENSOR_DATA,       // Built from the latest data when sent
+  REQUEST_LOCATION,          // Latest fix when sent
+  REQUEST_PATIENT_LOCATION   // Latest fix when sent, patient-specific endpoint
+} OutboundRequestType;
+
+// Records kept in the outbox while they cannot be sent
+typedef enum {
+  OUTBOX_SENSOR_DATA = 1,    // Sensor data JSON body, with recorded_at
+  OUTBOX_ECG_STREAM,         // uint16 block count, then the blocks
+  OUTBOX_TELEGRAM,           // Message text
+  OUTBOX_HEART_RATE_ALERT    // int32 heart rate
+} OutboxRecordType;
+
+typedef struct {
+  OutboundRequestType type;
+  union {
+    TelegramAlert alert;
+    int heartRate;
+    ImpactCapture capture;
+  };
+} OutboundRequest;
+
+static RequestQueue<OutboundRequest, HTTP_QUEUE_CAPACITY> outboundQueue(HTTP_BACKOFF_BASE_MS, HTTP_BACKOFF_MAX_MS);
+
+static void collectUrgentRequests();
+static void queueAlert(const TelegramAlert &alert);
+static void queueRequest(const OutboundRequest &request, int priority, uint32_t deadlineMs);
+static bool attemptRequest(const OutboundRequest &request);
+static void finishRequest(const OutboundRequest &request, bool sent);
+static void processOutboundQueue();
+static void storeRequest(const OutboundRequest &request);
+static bool replayOutbox();
+static int buildSensorDataJson(char *out, int maxLength, bool recorded);
+static bool postSensorDataJson(const char *json, int length);
+
+static Outbox httpOutbox("/spiffs", "outbox-", OUTBOX_SEGMENT_BYTES, OUTBOX_MAX_SEGMENTS);
+static bool outboxReady = false;
+static int replayFailures = 0;
+static unsigned long replayIntervalMs = OUTBOX_REPLAY_INTERVAL_MS;
+unsigned long lastOutboxReplay = 0;
+
+// Replay reads a record here; also big enough to batch a run of ECG stream records
+static uint8_t replayBuffer[8192];
+
+// Periodic requests already waiting, so they are not queued twice
+static bool sensorDataQueued = false;
+static int locationRequestsQueued = 0;
 
 // Device identification
 // Using PATIENT_ID from config.h
@@ -55,102 +142,738 @@ unsigned long lastSensorDataSend = 0;
 unsigned long lastHeartRateAlertTime = 0;
 unsigned long lastLocationUpdateTime = 0;
 
-// Create a secure client that can connect to HTTPS
-WiFiClientSecure secureClient;
+// Hosts the HTTP task talks to, one kept-alive connection each
+#define HTTP_HOST_BACKEND 0
+#define HTTP_HOST_TELEGRAM 1
+#define HTTP_HOST_COUNT 2
+#define HTTPS_PORT 443
+#define HTTP_KEEPALIVE_IDLE_MS 20000 // Close before the server's idle timeout rather than find out on the next POST
+
+// Negative results of postRequest()
+#define HTTP_ERROR_CONNECT -1  // No TLS connection
+#define HTTP_ERROR_SEND -2     // The request could not be written
+#define HTTP_ERROR_RESPONSE -3 // No complete response before the timeout
+
+// A kept-alive TLS connection to one host
+typedef struct {
+  const char *host;
+  WiFiClientSecure client;
+  unsigned long lastUsed;
+  HttpConnectionStats stats;
+} HttpConnection;
+
+static HttpConnection connections[HTTP_HOST_COUNT];
+
+// Request arena: every request is built and read in these, so sending
+// allocates nothing. Only this task sends, one request at a time.
+static HttpRequest httpRequest;
+static char *const requestBody = httpRequest.getBody();
+static char responseBody[128];     // Start of the response body, for the log
+static HttpResponseParser response;
+
+// Read position in the ECG sample ring (owned by the HTTP task)
+static EcgRingCursor httpEcgCursor;
+
+#if ECG_UPLOAD_MODE == ECG_UPLOAD_STREAM
+#if ECG_UPLOAD_MAX_BLOCKS * ECG_UPLOAD_BLOCK_SAMPLES > ECG_RING_CAPACITY / 2
+#error "ECG_UPLOAD_MAX_BLOCKS blocks must fit in half the ECG ring, or a slow POST loses samples"
+#endif
+
+// Continuous ECG upload: every sample, read through the stream's own ring cursor
+static EcgBlockStream ecgStream(ECG_SAMPLE_RATE_HZ, ECG_UPLOAD_BLOCK_SAMPLES);
+// Two bytes in front of the blocks take the block count when a batch is stored in the outbox
+#define ECG_STREAM_RECORD_PREFIX 2
+#define ECG_STREAM_BATCH_BYTES (ECG_UPLOAD_MAX_BLOCKS * ecgStreamBlockMaxBytes(ECG_UPLOAD_BLOCK_SAMPLES))
+static uint8_t ecgStreamBuffer[ECG_STREAM_RECORD_PREFIX + ECG_STREAM_BATCH_BYTES];
+#if ECG_UPLOAD_BASE64
+static char ecgStreamJson[base64EncodedLength(ECG_STREAM_BATCH_BYTES) + 64];
+#endif
+
+// Encoded blocks waiting for upload, after the prefix (0 when the buffer is free)
+static int ecgStreamLength = 0;
+static int ecgStreamBlocks = 0;
+// A stream request is in the outbound queue; it sends whatever batch is in
+// the buffer when its turn comes
+static bool ecgStreamQueued = false;
+unsigned long lastEcgStreamSend = 0;
+#endif
+
+// Event bus subscriptions
+static int telegramAlertSubscriber = -1;
+static int ecgSubscriber = -1;
+static int gpsSubscriber = -1;
+static int impactCaptureSubscriber = -1;
+static int wifiSubscriber = -1;
+
+// An impact capture is queued; its blob stays held until the request finishes
+static bool impactCaptureQueued = false;
+
+// Latest ECG and GPS data received by this task
+static EcgData latestEcgData = {};
+static GpsData latestGpsData = {};
 
 void httpTask(void *pvParameters) {
   Serial.println("HTTP Task: Started");
   
-  // Configure secure client to use certificates or skip verification
-  secureClient.setInsecure(); // Skip verification for simplicity (use proper certs in production)
+  // Configure secure clients to use certificates or skip verification
+  connections[HTTP_HOST_BACKEND].host = LARAVEL_API_HOST;
+  connections[HTTP_HOST_TELEGRAM].host = TELEGRAM_API_HOST;
+  for (int i = 0; i < HTTP_HOST_COUNT; i++) {
+    connections[i].client.setInsecure(); // Skip verification for simplicity (use proper certs in production)
+  }
   
-  // Wait for WiFi to be connected before proceeding
-  while (!getWiFiConnected()) {
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    Serial.println("HTTP Task: Waiting for WiFi connection...");
+  ecgRing.initCursor(&httpEcgCursor);
+#if ECG_UPLOAD_MODE == ECG_UPLOAD_STREAM
+  ecgStream.begin(ecgRing);
+#endif
+  
+  // Alerts wake the task immediately; sensor data is picked up on the next pass
+  telegramAlertSubscriber = telegramAlertTopic.subscribe(TELEGRAM_QUEUE_HTTP, EVENT_TELEGRAM_ALERT);
+  ecgSubscriber = ecgTopic.subscribe(ECG_QUEUE_HTTP);
+  gpsSubscriber = gpsTopic.subscribe(GPS_QUEUE_HTTP);
+  impactCaptureSubscriber = impactCaptureTopic.subscribe(IMPACT_QUEUE_HTTP, EVENT_IMPACT_CAPTURE);
+  wifiSubscriber = wifiStatusTopic.subscribe(WIFI_QUEUE_HTTP, EVENT_WIFI_STATUS);
+  
+  // Anything not sent before a reboot is still in the outbox
+  if (SPIFFS.begin(true) && httpOutbox.begin()) {
+    outboxReady = true;
+    Serial.printf("HTTP Task: Outbox ready, backlog %s\n", httpOutbox.hasBacklog() ? "pending" : "empty");
+  } else {
+    Serial.println("HTTP Task: Outbox unavailable, data is lost while offline");
   }
   
-  Serial.println("HTTP Task: WiFi connected, ready to send data");
+  // No waiting for WiFi: until it connects, data goes to the outbox
+  Serial.println("HTTP Task: Ready to send data");
   
   // Main task loop
   while (true) {
     unsigned long currentTime = millis();
+    bool online = getWiFiConnected();
     
-    // Only proceed if WiFi is connected
-    if (getWiFiConnected()) {
+    // WiFi changed: start on the outbox backlog now rather than after the
+    // replay backoff, or close kept-alive connections the drop has killed
+    WiFiStatus wifiUpdate;
+    if (wifiStatusTopic.receiveLatest(wifiSubscriber, &wifiUpdate)) {
+      if (wifiUpdate.connected) {
+        replayIntervalMs = OUTBOX_REPLAY_INTERVAL_MS;
+        lastOutboxReplay = currentTime - replayIntervalMs;
+      } else {
+        for (int i = 0; i < HTTP_HOST_COUNT; i++) {
+          connections[i].client.stop();
+        }
+      }
+    }
+    
+    // Pick up the newest sensor data
+    bool newEcgData = ecgTopic.receiveLatest(ecgSubscriber, &latestEcgData);
+    gpsTopic.receiveLatest(gpsSubscriber, &latestGpsData);
+    
+    // Alerts and captures are queued even while offline; they keep until their deadline
+    collectUrgentRequests();
+    
+#if ECG_UPLOAD_MODE == ECG_UPLOAD_STREAM
+    // Stream every ECG sample. The stream's ring cursor never waits on the
+    // network: a batch still queued when the next one is due goes to the
+    // outbox, and a failed send is stored rather than retried.
+    if (currentTime - lastEcgStreamSend >= ECG_UPLOAD_INTERVAL_MS) {
+      OutboundRequest request;
+      request.type = REQUEST_ECG_STREAM;
+      if (ecgStreamLength > 0) {
+        storeRequest(request);
+        ecgStreamLength = 0;
+      }
+      ecgStreamLength = ecgStream.readBlocks(ecgRing, &ecgStreamBuffer[ECG_STREAM_RECORD_PREFIX],
+                                             ECG_STREAM_BATCH_BYTES, ECG_UPLOAD_MAX_BLOCKS, &ecgStreamBlocks);
+      if (ecgStreamLength > 0) {
+        if (!online) {
+          storeRequest(request);
+          ecgStreamLength = 0;
+        } else if (!ecgStreamQueued) {
+          ecgStreamQueued = true;
+          queueRequest(request, PRIORITY_TELEMETRY, TELEMETRY_DEADLINE_MS);
+        }
+      }
+      lastEcgStreamSend = currentTime;
+    }
+#endif
+    
+    // Send sensor data at regular intervals
+    if (!sensorDataQueued && currentTime - lastSensorDataSend >= HTTP_PUBLISH_INTERVAL_MS) {
+      OutboundRequest request;
+      request.type = REQUEST_SENSOR_DATA;
+      if (online) {
+        sensorDataQueued = true;
+        queueRequest(request, PRIORITY_TELEMETRY, TELEMETRY_DEADLINE_MS);
+      } else {
+        storeRequest(request);
+      }
+      lastSensorDataSend = currentTime;
+    }
+    
+    // Check for heart rate alerts
+    if (newEcgData) {
+      int heartRate = latestEcgData.heartRate;
+      bool validSignal = latestEcgData.validSignal;
       
-      // First priority: Check for pending Telegram alerts from fall detection
-      // This ensures fall alerts are sent as soon as possible
-      if (xSemaphoreTake(telegramAlertSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
-        if (telegramAlertUpdated && currentTelegramAlert.pending) {
-          // Send the main alert message - cast volatile char* to const char*
-          sendTelegramMessage((const char*)currentTelegramAlert.message);
-          
-          // If location data is available, send as a separate message
-          if (currentTelegramAlert.hasFallLocation && 
-              xSemaphoreTake(gpsDataSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-            
-            // Create and send the location message with Google Maps link
-            if (currentGpsData.validFix) {
-              char locationMsg[128];
-              snprintf(locationMsg, sizeof(locationMsg), 
-                      "https://maps.google.com/maps?q=%.6f,%.6f", 
-                      currentGpsData.latitude, currentGpsData.longitude);
-              
-              // Send as a separate message
-              sendTelegramMessage(locationMsg);
-            }
-            
-            xSemaphoreGive(gpsDataSemaphore);
-          }
-          
-          // Mark as processed
-          currentTelegramAlert.pending = false;
-          telegramAlertUpdated = false;
-          Serial.println("HTTP Task: Fall detection Telegram alert processed successfully");
+      // Only alert if we have a valid signal and if enough time has passed since last alert
+      if (validSignal && currentTime - lastHeartRateAlertTime > 60000) { // 1 minute cooldown
+        if (heartRate > 0 && (heartRate > 120)) { // Only high heart rate alerts for simplicity
+          OutboundRequest request;
+          request.type = REQUEST_HEART_RATE_ALERT;
+          request.heartRate = heartRate;
+          queueRequest(request, PRIORITY_HEALTH_ALERT, HEALTH_ALERT_DEADLINE_MS);
+          lastHeartRateAlertTime = currentTime;
         }
-        
-        xSemaphoreGive(telegramAlertSemaphore);
       }
+    }
+    
+    // Only proceed if WiFi is connected
+    if (online) {
       
-      // Send sensor data at regular intervals
-      if (currentTime - lastSensorDataSend >= HTTP_PUBLISH_INTERVAL_MS) {
-        sendSensorData();
-        lastSensorDataSend = currentTime;
+      // Check for location updates and safe zone violations
+      if (locationRequestsQueued == 0 && latestGpsData.validFix && (currentTime - lastLocationUpdateTime > 60000)) {
+        OutboundRequest request;
+        request.type = REQUEST_LOCATION;
+        locationRequestsQueued = 2;
+        queueRequest(request, PRIORITY_TELEMETRY, TELEMETRY_DEADLINE_MS);
+        request.type = REQUEST_PATIENT_LOCATION; // Send patient-specific location data
+        queueRequest(request, PRIORITY_TELEMETRY, TELEMETRY_DEADLINE_MS);
+        lastLocationUpdateTime = currentTime;
       }
       
-      // Check for heart rate alerts
-      if (xSemaphoreTake(ecgDataSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-        int heartRate = currentEcgData.heartRate;
-        bool validSignal = currentEcgData.validSignal;
-        
-        // Only alert if we have a valid signal and if enough time has passed since last alert
-        if (validSignal && currentTime - lastHeartRateAlertTime > 60000) { // 1 minute cooldown
-          if (heartRate > 0 && (heartRate > 120)) { // Only high heart rate alerts for simplicity
-            sendHeartRateAlert(heartRate);
-            lastHeartRateAlertTime = currentTime;
+      // Back online: close off what was stored so it can be replayed
+      if (outboxReady && httpOutbox.hasUnsealed()) {
+        httpOutbox.seal();
+      }
+    }
+    
+    // Expired requests are stored even while offline
+    processOutboundQueue();
+    
+    // Wait for the next alert, WiFi change or retry, checking again at least every second
+    uint32_t waitMs = getWiFiConnected() ? outboundQueue.msUntilNext(millis(), 1000) : 1000;
+    waitForEvents(pdMS_TO_TICKS(waitMs > 0 ? waitMs : 1));
+  }
+}
+
+/**
+ * Queue a Telegram alert by how urgent its kind is
+ */
+static void queueAlert(const TelegramAlert &alert) {
+  OutboundRequest request;
+  request.type = REQUEST_TELEGRAM;
+  request.alert = alert;
+  switch (alert.kind) {
+    case ALERT_FALL:
+      queueRequest(request, PRIORITY_FALL_ALERT, FALL_ALERT_DEADLINE_MS);
+      break;
+    case ALERT_HEALTH:
+      queueRequest(request, PRIORITY_HEALTH_ALERT, HEALTH_ALERT_DEADLINE_MS);
+      break;
+    default:
+      queueRequest(request, PRIORITY_NOTICE, NOTICE_DEADLINE_MS);
+      break;
+  }
+}
+
+/**
+ * Move alerts and impact captures from the event bus into the outbound
+ * queue
+ */
+static void collectUrgentRequests() {
+  const TelegramAlert *alert;
+  while ((alert = telegramAlertTopic.receive(telegramAlertSubscriber)) != NULL) {
+    TelegramAlert received = *alert;
+    telegramAlertTopic.release(alert);
+    queueAlert(received);
+  }
+  
+  // One capture at a time: the recorder holds a single blob
+  if (!impactCaptureQueued) {
+    const ImpactCapture *capture = impactCaptureTopic.receive(impactCaptureSubscriber);
+    if (capture != NULL) {
+      OutboundRequest request;
+      request.type = REQUEST_IMPACT_CAPTURE;
+      request.capture = *capture;
+      impactCaptureTopic.release(capture);
+      impactCaptureQueued = true;
+      queueRequest(request, PRIORITY_CAPTURE, CAPTURE_DEADLINE_MS);
+    }
+  }
+}
+
+/**
+ * Add a request to the outbound queue. If the queue is full of requests
+ * at least as urgent, this one is dropped instead.
+ */
+static void queueRequest(const OutboundRequest &request, int priority, uint32_t deadlineMs) {
+  OutboundRequest evicted;
+  int result = outboundQueue.push(request, priority, millis(), deadlineMs, &evicted);
+  if (result < 0) {
+    Serial.printf("HTTP Task: Outbound queue full, dropping request type %d\n", request.type);
+    finishRequest(request, false);
+  } else if (result > 0) {
+    Serial.printf("HTTP Task: Outbound queue full, dropped queued request type %d\n", evicted.type);
+    finishRequest(evicted, false);
+  }
+}
+
+/**
+ * Make one attempt at a request
+ *
+ * @return true if it went through
+ */
+static bool attemptRequest(const OutboundRequest &request) {
+  switch (request.type) {
+    case REQUEST_TELEGRAM:
+      return sendTelegramMessage(request.alert.message);
+    case REQUEST_HEART_RATE_ALERT:
+      return sendHeartRateAlert(request.heartRate, 0);
+    case REQUEST_IMPACT_CAPTURE:
+      return sendImpactCapture(request.capture);
+#if ECG_UPLOAD_MODE == ECG_UPLOAD_STREAM
+    case REQUEST_ECG_STREAM:
+      // The batch may have gone to the outbox while this waited
+      return ecgStreamLength == 0 ||
+             sendEcgStream(&ecgStreamBuffer[ECG_STREAM_RECORD_PREFIX], ecgStreamLength, ecgStreamBlocks);
+#endif
+    case REQUEST_SENSOR_DATA:
+      return sendSensorData();
+    case REQUEST_LOCATION:
+      return sendLocationData();
+    case REQUEST_PATIENT_LOCATION:
+      return sendPatientLocationData();
+    default:
+      return true;
+  }
+}
+
+/**
+ * Clean up after a request leaves the queue, sent or not
+ */
+static void finishRequest(const OutboundRequest &request, bool sent) {
+  // Keep what could not be sent for when the connection is back
+  if (!sent) {
+    storeRequest(request);
+  }
+  
+  switch (request.type) {
+    case REQUEST_TELEGRAM:
+      if (sent) {
+        Serial.println("HTTP Task: Telegram alert processed successfully");
+        // Follow up with the location as a separate message
+        if (request.alert.hasFallLocation && latestGpsData.validFix) {
+          TelegramAlert location;
+          location.kind = request.alert.kind;
+          location.hasFallLocation = false;
+          snprintf(location.message, sizeof(location.message),
+                  "https://maps.google.com/maps?q=%.6f,%.6f",
+                  latestGpsData.latitude, latestGpsData.longitude);
+          queueAlert(location);
+        }
+      }
+      break;
+    case REQUEST_IMPACT_CAPTURE:
+      impactCaptureQueued = false;
+      impactRecorder.releaseBlob();
+      break;
+#if ECG_UPLOAD_MODE == ECG_UPLOAD_STREAM
+    case REQUEST_ECG_STREAM:
+      // Unsent blocks are in the outbox now (or, without one, a gap in the
+      // block sequence for the backend)
+      ecgStreamLength = 0;
+      ecgStreamQueued = false;
+      break;
+#endif
+    case REQUEST_SENSOR_DATA:
+      sensorDataQueued = false;
+      break;
+    case REQUEST_LOCATION:
+    case REQUEST_PATIENT_LOCATION:
+      locationRequestsQueued--;
+      break;
+    default:
+      break;
+  }
+  
+  if (!sent) {
+    Serial.printf("HTTP Task: Gave up on request type %d\n", request.type);
+  }
+}
+
+/**
+ * Send every due request, most urgent first, one attempt each. Alerts that
+ * arrived during an attempt are picked up before the next one, so an
+ * alert waits for at most the one request already in flight. Stored
+ * records are replayed only when nothing else is due.
+ */
+static void processOutboundQueue() {
+  OutboundRequest expired;
+  while (outboundQueue.takeExpired(millis(), &expired)) {
+    finishRequest(expired, false);
+  }
+  
+  while (getWiFiConnected()) {
+    collectUrgentRequests();
+    
+    OutboundRequest *request = outboundQueue.next(millis());
+    if (request == NULL) {
+      break;
+    }
+    
+    // TLS and the upload run at full clock speed
+    powerLockAcquire(POWER_LOCK_TRANSMIT);
+    bool sent = attemptRequest(*request);
+    powerLockRelease(POWER_LOCK_TRANSMIT);
+    OutboundRequest finished = *request;
+    if (sent) {
+      outboundQueue.complete(request);
+      finishRequest(finished, true);
+    } else if (finished.type == REQUEST_ECG_STREAM) {
+      // No retry: the stream reads on and the batch is replayed from the outbox
+      outboundQueue.complete(request);
+      finishRequest(finished, false);
+    } else if (!outboundQueue.retry(request, millis())) {
+      finishRequest(finished, false);
+    }
+  }
+  
+  // Nothing live is due: drain the outbox a batch at a time
+  if (getWiFiConnected() && outboxReady && httpOutbox.hasBacklog() &&
+      millis() - lastOutboxReplay >= replayIntervalMs) {
+    powerLockAcquire(POWER_LOCK_TRANSMIT);
+    bool replayed = replayOutbox();
+    powerLockRelease(POWER_LOCK_TRANSMIT);
+    lastOutboxReplay = millis();
+    replayIntervalMs = replayed ? OUTBOX_REPLAY_INTERVAL_MS : min(replayIntervalMs * 2, (unsigned long)HTTP_BACKOFF_MAX_MS);
+  }
+}
+
+/**
+ * Keep a request that cannot be sent now in the outbox. Alerts are written
+ * to flash at once; telemetry waits in the outbox's page buffer until a
+ * page fills. Location updates are not kept: the next fix supersedes them.
+ */
+static void storeRequest(const OutboundRequest &request) {
+  if (!outboxReady) {
+    return;
+  }
+  
+  // Replay ages alerts by this, and sends it along where the backend takes a time
+  uint32_t now = getSynchronizedEpochTime();
+  bool stored;
+  switch (request.type) {
+    case REQUEST_TELEGRAM:
+      stored = httpOutbox.append(OUTBOX_TELEGRAM, request.alert.message, strlen(request.alert.message), true, now);
+      break;
+    case REQUEST_HEART_RATE_ALERT: {
+      int32_t heartRate = request.heartRate;
+      stored = httpOutbox.append(OUTBOX_HEART_RATE_ALERT, &heartRate, sizeof(heartRate), true, now);
+      break;
+    }
+#if ECG_UPLOAD_MODE == ECG_UPLOAD_STREAM
+    case REQUEST_ECG_STREAM:
+      if (ecgStreamLength == 0) {
+        return;
+      }
+      ecgStreamBuffer[0] = (uint8_t)ecgStreamBlocks;
+      ecgStreamBuffer[1] = (uint8_t)(ecgStreamBlocks >> 8);
+      stored = httpOutbox.append(OUTBOX_ECG_STREAM, ecgStreamBuffer,
+                                 ECG_STREAM_RECORD_PREFIX + ecgStreamLength, false, now);
+      break;
+#endif
+    case REQUEST_SENSOR_DATA: {
+      char json[512];
+      int length = buildSensorDataJson(json, sizeof(json), true);
+      stored = httpOutbox.append(OUTBOX_SENSOR_DATA, json, length, false, now);
+      break;
+    }
+    default:
+      return;
+  }
+  
+  if (!stored) {
+    Serial.printf("HTTP Task: Could not store request type %d in the outbox\n", request.type);
+  }
+}
+
+/**
+ * How long ago a stored record was made
+ *
+ * @return Age in seconds, or -1 if either time is unknown
+ */
+static long outboxRecordAge(uint32_t createdAt) {
+  uint32_t now = getSynchronizedEpochTime();
+  if (createdAt == 0 || now == 0 || now < createdAt) {
+    return -1;
+  }
+  return (long)(now - createdAt);
+}
+
+/**
+ * Send up to OUTBOX_REPLAY_MAX_RECORDS stored records, oldest first. A run
+ * of ECG stream records goes up as one POST. The batch stops as soon as a
+ * live request is due, and a record that fails stays in the outbox.
+ * Alerts past OUTBOX_ALERT_MAX_AGE_S are dropped; the rest say when they
+ * were raised.
+ *
+ * @return false if a record failed and replay should back off
+ */
+static bool replayOutbox() {
+  for (int records = 0; records < OUTBOX_REPLAY_MAX_RECORDS; records++) {
+    // Live requests always go first
+    collectUrgentRequests();
+    if (outboundQueue.next(millis()) != NULL) {
+      return true;
+    }
+    
+    uint8_t type;
+    int length = httpOutbox.read(&type, replayBuffer, sizeof(replayBuffer) - 1);
+    if (length == -1) {
+      return true;
+    }
+    if (length == -2) {
+      Serial.println("HTTP Task: Skipping an outbox record too large to replay");
+      httpOutbox.commit();
+      continue;
+    }
+    
+    bool sent;
+    switch (type) {
+      case OUTBOX_SENSOR_DATA:
+        sent = postSensorDataJson((const char*)replayBuffer, length);
+        break;
+#if ECG_UPLOAD_MODE == ECG_UPLOAD_STREAM
+      case OUTBOX_ECG_STREAM: {
+        // Append the blocks of the records that follow, dropping their prefixes
+        int blocks = replayBuffer[0] | (replayBuffer[1] << 8);
+        uint8_t nextType;
+        int nextLength;
+        while ((nextLength = httpOutbox.peek(&nextType)) >= 0 && nextType == OUTBOX_ECG_STREAM &&
+               length + nextLength <= (int)sizeof(replayBuffer)) {
+          if (httpOutbox.read(&nextType, &replayBuffer[length], nextLength) != nextLength ||
+              nextType != OUTBOX_ECG_STREAM) {
+            break; // Skipped over corrupt data; send what is here
           }
+          blocks += replayBuffer[length] | (replayBuffer[length + 1] << 8);
+          memmove(&replayBuffer[length], &replayBuffer[length + ECG_STREAM_RECORD_PREFIX],
+                  nextLength - ECG_STREAM_RECORD_PREFIX);
+          length += nextLength - ECG_STREAM_RECORD_PREFIX;
         }
-        
-        xSemaphoreGive(ecgDataSemaphore);
+        sent = sendEcgStream(&replayBuffer[ECG_STREAM_RECORD_PREFIX], length - ECG_STREAM_RECORD_PREFIX, blocks);
+        break;
       }
-      
-      // Check for location updates and safe zone violations
-      if (xSemaphoreTake(gpsDataSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-        if (currentGpsData.validFix && (currentTime - lastLocationUpdateTime > 60000)) {
-          sendLocationData();
-          sendPatientLocationData(); // Send patient-specific location data
-          lastLocationUpdateTime = currentTime;
+#endif
+      case OUTBOX_TELEGRAM: {
+        long age = outboxRecordAge(httpOutbox.getCreatedAt());
+        replayBuffer[length] = '\0';
+        if (age > OUTBOX_ALERT_MAX_AGE_S) {
+          Serial.printf("HTTP Task: Dropping alert raised %ld min ago: %s\n", age / 60, (const char*)replayBuffer);
+          sent = true;
+          break;
+        }
+        char message[sizeof(((TelegramAlert*)0)->message) + 48];
+        if (age >= 0) {
+          time_t raised = (time_t)httpOutbox.getCreatedAt();
+          struct tm raisedTime;
+          localtime_r(&raised, &raisedTime);
+          char clock[8];
+          strftime(clock, sizeof(clock), "%H:%M", &raisedTime);
+          snprintf(message, sizeof(message), "Delayed, raised at %s (%ld min ago): %s",
+                   clock, age / 60, (const char*)replayBuffer);
+        } else {
+          snprintf(message, sizeof(message), "Delayed, time raised unknown: %s", (const char*)replayBuffer);
         }
-        
-        xSemaphoreGive(gpsDataSemaphore);
+        sent = sendTelegramMessage(message);
+        break;
+      }
+      case OUTBOX_HEART_RATE_ALERT: {
+        int32_t heartRate;
+        memcpy(&heartRate, replayBuffer, sizeof(heartRate));
+        long age = outboxRecordAge(httpOutbox.getCreatedAt());
+        if (age > OUTBOX_ALERT_MAX_AGE_S) {
+          Serial.printf("HTTP Task: Dropping heart rate alert (%d BPM) raised %ld min ago\n", (int)heartRate, age / 60);
+          sent = true;
+          break;
+        }
+        sent = sendHeartRateAlert(heartRate, httpOutbox.getCreatedAt());
+        break;
       }
+      default:
+        sent = true; // Unknown record: nothing to send it as
+        break;
+    }
+    
+    // Only failures while connected count towards giving up on a record
+    if (!sent && getWiFiConnected()) {
+      replayFailures++;
+    }
+    if (sent || replayFailures >= OUTBOX_REPLAY_MAX_FAILURES) {
+      if (!sent) {
+        Serial.printf("HTTP Task: Skipping outbox record type %d after %d failures\n", type, replayFailures);
+      }
+      httpOutbox.commit();
+      replayFailures = 0;
     } else {
-      Serial.println("HTTP Task: WiFi not connected, skipping data upload");
+      httpOutbox.rewind();
+      return false;
     }
+  }
+  return true;
+}
+
+/**
+ * Make sure a host's kept-alive connection is open. The TLS handshake only
+ * happens when the previous connection was closed (first use, WiFi loss,
+ * server close, a failed request or HTTP_KEEPALIVE_IDLE_MS idle).
+ *
+ * @param timeoutMs Time allowed for the TCP connect and TLS handshake together
+ * @return false if it could not be opened
+ */
+static bool openConnection(HttpConnection &connection, int timeoutMs) {
+  unsigned long now = millis();
+  
+  if (connection.client.connected() && now - connection.lastUsed > HTTP_KEEPALIVE_IDLE_MS) {
+    connection.client.stop();
+  }
+  
+  if (!connection.client.connected()) {
+    // Left alone, WiFiClientSecure allows 30 s to connect and 120 s for the
+    // handshake. The handshake timeout is in whole seconds: it gets about
+    // two thirds of the time and the TCP connect the rest.
+    int handshakeSeconds = timeoutMs * 2 / 3000;
+    if (handshakeSeconds < 1) {
+      handshakeSeconds = 1;
+    }
+    connection.client.setHandshakeTimeout(handshakeSeconds);
+    unsigned long start = millis();
+    bool connected = connection.client.connect(connection.host, HTTPS_PORT, timeoutMs - handshakeSeconds * 1000);
+    unsigned long handshakeMs = millis() - start;
     
-    // Delay before next check
-    vTaskDelay(pdMS_TO_TICKS(1000)); // Check every second
+    if (connected) {
+      connection.stats.handshakes++;
+      connection.stats.lastHandshakeMs = handshakeMs;
+      connection.stats.totalHandshakeMs += handshakeMs;
+      if (handshakeMs > connection.stats.worstHandshakeMs) {
+        connection.stats.worstHandshakeMs = handshakeMs;
+      }
+    } else {
+      connection.stats.handshakeFailures++;
+      Serial.printf("HTTP Task: TLS connection to %s failed after %lu ms\n", connection.host, handshakeMs);
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * POST a body on a host's kept-alive connection and read the response.
+ * httpRequest frames the head in front of the body, so both usually go to
+ * the socket in one write. The start of the response body is kept in
+ * responseBody.
+ * The connection is closed after a failure or when the server does not
+ * keep it alive.
+ *
+ * @param host HTTP_HOST_BACKEND or HTTP_HOST_TELEGRAM
+ * @param path Path on that host
+ * @param contentType Content-Type of the body
+ * @param extraHeaders Further header lines, each ending in CRLF, or NULL
+ * @param body Request body
+ * @param length Bytes in body
+ * @param timeoutMs Time allowed for the whole attempt: connecting, sending and the response
+ * @return HTTP status code, or a negative HTTP_ERROR_* code
+ */
+static int postRequest(int host, const char *path, const char *contentType, const char *extraHeaders,
+                       const uint8_t *body, int length, int timeoutMs) {
+  HttpConnection &connection = connections[host];
+  unsigned long attemptStart = millis();
+  bool connected = openConnection(connection, timeoutMs);
+  connection.stats.requests++;
+  connection.lastUsed = millis();
+  if (!connected) {
+    return HTTP_ERROR_CONNECT;
+  }
+  
+  WiFiClientSecure &client = connection.client;
+  if (!httpRequest.frame(connection.host, path, contentType, extraHeaders, body, length)) {
+    return HTTP_ERROR_SEND;
+  }
+  // Sending and the response share what connecting left of the time.
+  // setTimeout() takes whole seconds here.
+  long remainingMs = timeoutMs - (long)(millis() - attemptStart);
+  client.setTimeout(remainingMs > 1000 ? (remainingMs + 999) / 1000 : 1);
+  
+  bool sent = client.write(httpRequest.getData(), httpRequest.getDataLength()) == (size_t)httpRequest.getDataLength();
+  if (sent && httpRequest.getTail() != NULL) {
+    sent = client.write(httpRequest.getTail(), httpRequest.getTailLength()) == (size_t)httpRequest.getTailLength();
+  }
+  if (!sent) {
+    client.stop();
+    return HTTP_ERROR_SEND;
+  }
+  
+  // Read until the response is complete, the server closes or time runs out
+  response.begin(responseBody, sizeof(responseBody));
+  uint8_t chunk[128];
+  bool trailingBytes = false;
+  while (!response.isDone() && !response.hasError()) {
+    int available = client.available();
+    if (available > 0) {
+      int n = client.read(chunk, min(available, (int)sizeof(chunk)));
+      if (n > 0) {
+        trailingBytes = response.feed(chunk, n) < n;
+        continue;
+      }
+    }
+    if (!client.connected()) {
+      response.closed();
+      break;
+    }
+    if (millis() - attemptStart >= (unsigned long)timeoutMs) {
+      break;
+    }
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+  connection.lastUsed = millis();
+  
+  // Anything unexpected leaves the stream in an unknown state
+  bool complete = response.isDone();
+  if (!complete || !response.isKeepAlive() || trailingBytes) {
+    client.stop();
+  }
+  return complete ? response.getStatus() : HTTP_ERROR_RESPONSE;
+}
+
+/**
+ * Serialize a JSON body into requestBody
+ *
+ * @return Its length, or -1 if it does not fit
+ */
+static int serializeBody(const JsonDocument &doc) {
+  if (measureJson(doc) >= HTTP_REQUEST_BODY_MAX) {
+    Serial.println("HTTP Task: JSON body too large");
+    return -1;
+  }
+  return serializeJson(doc, requestBody, HTTP_REQUEST_BODY_MAX);
+}
+
+void getHttpConnectionStats(int host, HttpConnectionStats *stats) {
+  *stats = connections[host].stats;
+}
+
+void printHttpDiagnostics() {
+  for (int i = 0; i < HTTP_HOST_COUNT; i++) {
+    const HttpConnectionStats &stats = connections[i].stats;
+    Serial.printf("HTTP: %s: %lu requests, %lu handshakes (%lu failed), handshake avg %lu ms, worst %lu ms\n",
+                  connections[i].host, (unsigned long)stats.requests, (unsigned long)stats.handshakes,
+                  (unsigned long)stats.handshakeFailures,
+                  stats.handshakes > 0 ? stats.totalHandshakeMs / stats.handshakes : 0UL,
+                  stats.worstHandshakeMs);
+  }
+  if (outboxReady) {
+    Serial.printf("HTTP: Outbox: %lu stored, %lu segments dropped, %lu corrupt\n",
+                  (unsigned long)httpOutbox.getAppendedCount(), (unsigned long)httpOutbox.getDroppedSegments(),
+                  (unsigned long)httpOutbox.getCorruptCount());
   }
 }
 
@@ -160,30 +883,22 @@ void getEcgData(char* buffer, int maxSize) {
   strcpy(buffer, "[");
   int bufPos = 1; // Position after the opening bracket
   
-  // Take semaphore for thread-safe access
-  bool success = false;
-  if (xSemaphoreTake(ecgDataSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-    // Direct access to ecgBuffer from ecg_task.h
-    // We'll always use whatever data is in the buffer, regardless of leads status
-    Serial.println("HTTP Task: Getting ECG data points from buffer");
-    
-    for (int i = 0; i < 10; i++) {
-      // Get index in circular buffer - most recent samples first
-      int idx = (bufferIndex - i - 1 + ECG_BUFFER_SIZE) % ECG_BUFFER_SIZE;
+  // Newest samples since the last upload, read without blocking the ECG task
+  // We'll always use whatever data is in the ring, regardless of leads status
+  int samples[10];
+  int sampleCount = ecgRing.readNewest(&httpEcgCursor, samples, 10);
+  bool success = sampleCount > 0;
+  
+  if (success) {
+    for (int i = 0; i < sampleCount; i++) {
+      // Most recent samples first
+      int value = samples[sampleCount - 1 - i];
       
       // Add comma if not first item
       if (i > 0) {
         buffer[bufPos++] = ',';
       }
       
-      // Get actual ECG values
-      int value = ecgBuffer[idx];
-      
-      // For debugging - print a few values
-      if (i < 3) {
-        Serial.printf("ECG buffer value %d: %d\n", i, value);
-      }
-      
       // Convert to string
       char tempStr[10];
       itoa(value, tempStr, 10);
@@ -197,11 +912,6 @@ void getEcgData(char* buffer, int maxSize) {
         break;
       }
     }
-    success = true;
-    
-    xSemaphoreGive(ecgDataSemaphore);
-  } else {
-    Serial.println("HTTP Task: Failed to acquire ecgDataSemaphore");
   }
   
   // If we couldn't get data from the buffer, use fallback values
@@ -236,325 +946,323 @@ void getEcgData(char* buffer, int maxSize) {
   // Finish with closing bracket
   buffer[bufPos++] = ']';
   buffer[bufPos] = '\0';
-  
-  // Debug output
-  Serial.print("HTTP Task: Final ECG data array: ");
-  Serial.println(buffer);
 }
 
-void sendSensorData() {
+bool sendSensorData() {
   // Check WiFi connection first before allocating memory for JSON
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("HTTP Task: WiFi not connected, skipping data upload");
-    return;
+    return false;
   }
   
+  // Serialize straight into the request arena
+  int len = buildSensorDataJson(requestBody, HTTP_REQUEST_BODY_MAX, false);
+  
+  return postSensorDataJson(requestBody, len);
+}
+
+/**
+ * Build the sensor data JSON from the latest readings
+ *
+ * @param out Output buffer
+ * @param maxLength Capacity of out
+ * @param recorded Add the wall-clock time, for a body that is stored and sent later
+ * @return Length of the JSON
+ */
+static int buildSensorDataJson(char *out, int maxLength, bool recorded) {
   // Create a StaticJsonDocument with minimal size
   StaticJsonDocument<512> doc;  // Reduced size for main document
   
   // Add required fields
   doc["patient_id"] = PATIENT_ID;
   doc["heart_rate"] = 0;
+  doc["sdnn"] = 0;
+  doc["rmssd"] = 0;
+  doc["pnn50"] = 0;
+  doc["hrv_intervals"] = 0;
   
-  // Get heart rate data if available
-  if (xSemaphoreTake(ecgDataSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-    if (currentEcgData.validSignal) {
-      doc["heart_rate"] = currentEcgData.heartRate;
-    }
-    xSemaphoreGive(ecgDataSemaphore);
+  // Get heart rate and HRV data if available
+  if (latestEcgData.validSignal) {
+    doc["heart_rate"] = latestEcgData.heartRate;
+  }
+  if (latestEcgData.hrvIntervals > 0) {
+    doc["sdnn"] = latestEcgData.sdnn;
+    doc["rmssd"] = latestEcgData.rmssd;
+    doc["pnn50"] = latestEcgData.pnn50;
+    doc["hrv_intervals"] = latestEcgData.hrvIntervals;
   }
   
-  // Access external ecgBuffer and bufferIndex variables from ECG task
-  extern int ecgBuffer[];
-  extern int bufferIndex;
-  extern bool leadsConnected;
-  
-  // DEBUG: Print status of external variables
-  Serial.println("-------------------- ECG DATA DEBUG --------------------");
-  Serial.printf("HTTP Task: leadsConnected = %s\n", leadsConnected ? "true" : "false");
-  Serial.printf("HTTP Task: bufferIndex = %d\n", bufferIndex);
-  
-  // Test if we can directly access the ECG buffer here
-  int testIndex = (bufferIndex - 1 + ECG_BUFFER_SIZE) % ECG_BUFFER_SIZE;
-  Serial.printf("HTTP Task: Direct buffer access test, ecgBuffer[%d] = %d\n", testIndex, ecgBuffer[testIndex]);
-  
+#if ECG_UPLOAD_MODE == ECG_UPLOAD_SNAPSHOT
   // Create ECG data directly as a string (more memory efficient)
   char ecgJsonBuffer[128]; // Fixed size buffer
   getEcgData(ecgJsonBuffer, sizeof(ecgJsonBuffer));
   
-  // DEBUG: Print the ECG data being sent
-  Serial.print("HTTP Task: ECG data: ");
-  Serial.println(ecgJsonBuffer);
-  Serial.println("-------------------- END DEBUG --------------------");
-  
   // Add ECG data as string
   doc["ecg_data"] = ecgJsonBuffer;
+#else
+  // The waveform goes up separately through the ECG stream
+#endif
   
   // Handle location data efficiently
   char locBuffer[80]; // Fixed size buffer
   strcpy(locBuffer, "{\"latitude\":0.0,\"longitude\":0.0}"); // Default values
   
   // Update location data if available
-  if (xSemaphoreTake(gpsDataSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-    if (currentGpsData.validFix) {
-      // Direct write to buffer with fixed format
-      sprintf(locBuffer, "{\"latitude\":%.6f,\"longitude\":%.6f}", 
-              currentGpsData.latitude, currentGpsData.longitude);
-    }
-    xSemaphoreGive(gpsDataSemaphore);
+  if (latestGpsData.validFix) {
+    // Direct write to buffer with fixed format
+    sprintf(locBuffer, "{\"latitude\":%.6f,\"longitude\":%.6f}", 
+            latestGpsData.latitude, latestGpsData.longitude);
   }
   
   // Add location as string
   doc["location"] = locBuffer;
   
-  // Serialize to buffer with fixed size
-  char jsonBuffer[512];
-  size_t len = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
-  
-  // Create HTTP client
-  HTTPClient http;
-  String url = String(LARAVEL_API_URL) + String(SENSOR_DATA_ENDPOINT);
-  
-  http.begin(secureClient, url);
-  http.setTimeout(HTTP_TIMEOUT);
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("Accept", "application/json");
+  // Sent late from the outbox: the server cannot use its receive time
+  if (recorded) {
+    doc["recorded_at"] = time(nullptr);
+  }
   
+  return serializeJson(doc, out, maxLength);
+}
+
+/**
+ * POST a sensor data JSON body, built now or replayed from the outbox
+ *
+ * @return true if the server accepted it
+ */
+static bool postSensorDataJson(const char *json, int length) {
   // Send data
-  int httpResponseCode = http.POST((uint8_t*)jsonBuffer, len);
+  int httpResponseCode = postRequest(HTTP_HOST_BACKEND, SENSOR_DATA_ENDPOINT, "application/json", NULL,
+                                     (const uint8_t*)json, length, HTTP_TELEMETRY_TIMEOUT);
+  bool success = httpResponseCode >= 200 && httpResponseCode < 300;
   
-  if (httpResponseCode >= 200 && httpResponseCode < 300) {
+  if (success) {
     Serial.printf("HTTP Task: Data sent successfully, code: %d\n", httpResponseCode);
   } else {
+    // Only the start of the response is kept
     Serial.printf("HTTP Task: Send failed, code: %d\n", httpResponseCode);
-    // Get limited response
-    String response = http.getString();
-    if (response.length() > 60) {
-      response = response.substring(0, 60) + "...";
-    }
-    Serial.println("Response: " + response);
+    Serial.printf("Response: %s\n", responseBody);
   }
   
-  http.end();
+  return success;
 }
 
-void sendHeartRateAlert(int heartRate) {
+bool sendHeartRateAlert(int heartRate, uint32_t recordedAt) {
   // Create JSON document for alert
   StaticJsonDocument<256> doc;
   doc["patient_id"] = PATIENT_ID;
   doc["alert_type"] = "high_heart_rate";
-  doc["message"] = "High heart rate detected: " + String(heartRate) + " BPM";
+  char message[48];
+  snprintf(message, sizeof(message), "High heart rate detected: %d BPM", heartRate);
+  doc["message"] = message;
   
-  // Serialize the JSON to string
-  String jsonData;
-  serializeJson(doc, jsonData);
+  // Sent late from the outbox: the server cannot use its receive time
+  if (recordedAt != 0) {
+    doc["recorded_at"] = recordedAt;
+  }
   
-  // Create HTTP client and set headers
-  HTTPClient http;
-  String url = String(LARAVEL_API_URL) + String(ALERT_ENDPOINT);
+  // Serialize the JSON into the request arena
+  int length = serializeBody(doc);
+  if (length < 0) {
+    return true; // Can never be sent; do not retry
+  }
   
-  // Use secure client for HTTPS
-  http.begin(secureClient, url);
-  http.setTimeout(HTTP_TIMEOUT);
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("Accept", "application/json");
+  // One attempt on the kept-alive connection; the outbound queue retries with backoff
+  int httpResponseCode = postRequest(HTTP_HOST_BACKEND, ALERT_ENDPOINT, "application/json", NULL,
+                                     (const uint8_t*)requestBody, length, HTTP_TIMEOUT);
+  bool success = httpResponseCode >= 200 && httpResponseCode < 300;
   
-  // Send the alert with retry logic
-  bool success = false;
-  int retries = 0;
+  if (success) {
+    Serial.printf("HTTP Task: Heart rate alert sent for: %d BPM, response code: %d\n", heartRate, httpResponseCode);
+  } else {
+    Serial.printf("HTTP Task: Failed to send heart rate alert, error code: %d\n", httpResponseCode);
+    Serial.printf("HTTP Task: Response body: %s\n", responseBody);
+  }
   
-  while (!success && retries < HTTP_MAX_RETRIES) {
-    int httpResponseCode = http.POST(jsonData);
-    String responseBody = http.getString();
-    
-    if (httpResponseCode >= 200 && httpResponseCode < 300) {
-      Serial.printf("HTTP Task: Heart rate alert sent, response code: %d\n", httpResponseCode);
-      success = true;
-    } else {
-      Serial.printf("HTTP Task: Failed to send heart rate alert, error code: %d (attempt %d/%d)\n", 
-                   httpResponseCode, retries + 1, HTTP_MAX_RETRIES);
-      Serial.println("HTTP Task: Response body: " + responseBody);
-      retries++;
-      
-      if (retries < HTTP_MAX_RETRIES) {
-        vTaskDelay(pdMS_TO_TICKS(HTTP_RETRY_DELAY_MS));
-      }
-    }
+  return success;
+}
+
+bool sendLocationData() {
+  if (!latestGpsData.validFix) {
+    return true;
   }
   
-  http.end();
+  // Create JSON for location data
+  StaticJsonDocument<256> doc;
+  doc["patient_id"] = PATIENT_ID;
+  doc["latitude"] = latestGpsData.latitude; // Use latitude key in the location object
+  doc["longitude"] = latestGpsData.longitude; // Use longitude key in the location object
+  
+  // Serialize JSON into the request arena
+  int length = serializeBody(doc);
+  if (length < 0) {
+    return true;
+  }
   
-  Serial.printf("HTTP Task: Heart rate alert sent for: %d BPM\n", heartRate);
+  // One attempt on the kept-alive connection; the outbound queue retries with backoff
+  int httpResponseCode = postRequest(HTTP_HOST_BACKEND, LOCATION_ENDPOINT, "application/json", NULL,
+                                     (const uint8_t*)requestBody, length, HTTP_TELEMETRY_TIMEOUT);
+  bool success = httpResponseCode >= 200 && httpResponseCode < 300;
+  
+  if (success) {
+    Serial.printf("HTTP Task: Location data sent, response code: %d\n", httpResponseCode);
+  } else {
+    Serial.printf("HTTP Task: Failed to send location data, error code: %d\n", httpResponseCode);
+    Serial.printf("HTTP Task: Response body: %s\n", responseBody);
+  }
+  
+  return success;
 }
 
-void sendLocationData() {
-  if (xSemaphoreTake(gpsDataSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-    if (!currentGpsData.validFix) {
-      xSemaphoreGive(gpsDataSemaphore);
-      return;
-    }
-    
-    // Create JSON for location data
-    StaticJsonDocument<256> doc;
-    doc["patient_id"] = PATIENT_ID;
-    doc["latitude"] = currentGpsData.latitude; // Use latitude key in the location object
-    doc["longitude"] = currentGpsData.longitude; // Use longitude key in the location object
-    
-    // Serialize JSON
-    String jsonData;
-    serializeJson(doc, jsonData);
-    
-    // Create HTTP client
-    HTTPClient http;
-    String url = String(LARAVEL_API_URL) + String(LOCATION_ENDPOINT);
-    
-    // Use secure client for HTTPS
-    http.begin(secureClient, url);
-    http.setTimeout(HTTP_TIMEOUT);
-    http.addHeader("Content-Type", "application/json");
-    http.addHeader("Accept", "application/json");
-    
-    // Send with retry logic
-    bool success = false;
-    int retries = 0;
-    
-    while (!success && retries < HTTP_MAX_RETRIES) {
-      int httpResponseCode = http.POST(jsonData);
-      String responseBody = http.getString();
-      
-      if (httpResponseCode >= 200 && httpResponseCode < 300) {
-        Serial.printf("HTTP Task: Location data sent, response code: %d\n", httpResponseCode);
-        success = true;
-      } else {
-        Serial.printf("HTTP Task: Failed to send location data, error code: %d (attempt %d/%d)\n", 
-                     httpResponseCode, retries + 1, HTTP_MAX_RETRIES);
-        Serial.println("HTTP Task: Response body: " + responseBody);
-        retries++;
-        
-        if (retries < HTTP_MAX_RETRIES) {
-          vTaskDelay(pdMS_TO_TICKS(HTTP_RETRY_DELAY_MS));
-        }
-      }
-    }
-    
-    http.end();
-    
-    xSemaphoreGive(gpsDataSemaphore);
+/**
+ * Upload a fall's pre/post-impact IMU capture as a binary body. The blob is
+ * sent straight from impactRecorder; see impact_recorder.h for its layout.
+ *
+ * @param capture Capture announced by the fall detection task
+ * @return true if the server accepted it
+ */
+bool sendImpactCapture(const ImpactCapture &capture) {
+  int length;
+  const uint8_t *blob = impactRecorder.getBlob(&length);
+  
+  char headers[sizeof("X-Patient-Id: " PATIENT_ID_TEXT "\r\nX-Capture-Id: 4294967295\r\n")];
+  snprintf(headers, sizeof(headers), "X-Patient-Id: " PATIENT_ID_TEXT "\r\nX-Capture-Id: %lu\r\n",
+           (unsigned long)capture.captureId);
+  
+  int httpResponseCode = postRequest(HTTP_HOST_BACKEND, FALL_CAPTURE_ENDPOINT, "application/octet-stream",
+                                     headers, blob, length, HTTP_TIMEOUT);
+  
+  if (httpResponseCode >= 200 && httpResponseCode < 300) {
+    Serial.printf("HTTP Task: Impact capture %lu sent, %d bytes\n", (unsigned long)capture.captureId, length);
+    return true;
   }
+  Serial.printf("HTTP Task: Failed to send impact capture %lu, code: %d\n",
+                (unsigned long)capture.captureId, httpResponseCode);
+  return false;
 }
 
+#if ECG_UPLOAD_MODE == ECG_UPLOAD_STREAM
+/**
+ * Upload a batch of ECG stream blocks to the sensor data endpoint, either
+ * as a raw binary body or base64 inside JSON (ECG_UPLOAD_BASE64). See
+ * ecg_stream.h for the block layout.
+ *
+ * @param blocks Encoded blocks, back to back
+ * @param length Bytes in blocks
+ * @param blockCount Number of blocks
+ * @return true if the server accepted them
+ */
+bool sendEcgStream(const uint8_t *blocks, int length, int blockCount) {
+#if ECG_UPLOAD_BASE64
+  int pos = snprintf(ecgStreamJson, sizeof(ecgStreamJson),
+                     "{\"patient_id\":%d,\"ecg_blocks\":%d,\"ecg_stream\":\"", PATIENT_ID, blockCount);
+  pos += base64Encode(blocks, length, &ecgStreamJson[pos]);
+  ecgStreamJson[pos++] = '"';
+  ecgStreamJson[pos++] = '}';
+  ecgStreamJson[pos] = '\0';
+  
+  int httpResponseCode = postRequest(HTTP_HOST_BACKEND, SENSOR_DATA_ENDPOINT, "application/json", NULL,
+                                     (const uint8_t*)ecgStreamJson, pos, HTTP_TELEMETRY_TIMEOUT);
+#else
+  char headers[sizeof("X-Patient-Id: " PATIENT_ID_TEXT "\r\nX-Ecg-Blocks: -2147483648\r\n")];
+  snprintf(headers, sizeof(headers), "X-Patient-Id: " PATIENT_ID_TEXT "\r\nX-Ecg-Blocks: %d\r\n", blockCount);
+  int httpResponseCode = postRequest(HTTP_HOST_BACKEND, SENSOR_DATA_ENDPOINT, "application/octet-stream",
+                                     headers, blocks, length, HTTP_TELEMETRY_TIMEOUT);
+#endif
+  
+  int samples = blockCount * ecgStream.getBlockSamples();
+  if (httpResponseCode >= 200 && httpResponseCode < 300) {
+    Serial.printf("HTTP Task: ECG stream sent, %d blocks, %d bytes (%.2f bytes/sample, %lu samples lost so far)\n",
+                  blockCount, length, (float)length / samples, (unsigned long)ecgStream.getDroppedCount());
+    return true;
+  }
+  Serial.printf("HTTP Task: Failed to send ECG stream, code: %d\n", httpResponseCode);
+  return false;
+}
+#endif
+
 /**
  * Send message via Telegram Bot API
  * 
  * @param message The message to send
+ * @return true if Telegram accepted it
  */
-void sendTelegramMessage(const char* message) {
+bool sendTelegramMessage(const char* message) {
   // Check if WiFi is connected
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("WiFi not connected. Cannot send Telegram message.");
-    return;
+    return false;
   }
 
   Serial.print("Sending Telegram message: ");
   Serial.println(message);
   
-  HTTPClient http;
-  
-  // Construct the complete URL
-  String url = String(TELEGRAM_API_URL) + TELEGRAM_BOT_TOKEN + "/sendMessage";
-  
-  // Use secure client for HTTPS
-  http.begin(secureClient, url);
-  http.setTimeout(HTTP_TIMEOUT);
-  http.addHeader("Content-Type", "application/json");
-  
   // Create a JSON document for properly escaping special characters
   StaticJsonDocument<384> doc;
   doc["chat_id"] = TELEGRAM_CHAT_ID;
   doc["text"] = message;  // ArduinoJson will properly escape the message
   
-  // Serialize the JSON to string
-  String payload;
-  serializeJson(doc, payload);
+  // Serialize the JSON into the request arena
+  int length = serializeBody(doc);
+  if (length < 0) {
+    return true;
+  }
   
-  // Send the request and get the response code
-  int httpResponseCode = http.POST(payload);
+  // Send on the kept-alive connection to the Telegram API
+  int httpResponseCode = postRequest(HTTP_HOST_TELEGRAM, TELEGRAM_SEND_ENDPOINT, "application/json", NULL,
+                                     (const uint8_t*)requestBody, length, HTTP_TIMEOUT);
+  bool success = httpResponseCode >= 200 && httpResponseCode < 300;
   
   if (httpResponseCode > 0) {
-    String response = http.getString();
     Serial.print("Telegram API Response: ");
     Serial.println(httpResponseCode);
-    Serial.println(response);
+    Serial.println(responseBody);
   } else {
     Serial.print("Telegram API Error: ");
     Serial.println(httpResponseCode);
   }
   
-  // Close connection
-  http.end();
-  
   // Brief delay to avoid hammering the API
   vTaskDelay(pdMS_TO_TICKS(100));
+  return success;
 }
 
 /**
  * Send location data to patient-specific location endpoint
  * Only sends if coordinates are not (0,0)
+ *
+ * @return false if the upload failed and should be retried
  */
-void sendPatientLocationData() {
-  if (xSemaphoreTake(gpsDataSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-    // Only proceed if we have a valid fix and coordinates are not (0,0)
-    if (!currentGpsData.validFix || 
-        (currentGpsData.latitude == 0.0 && currentGpsData.longitude == 0.0)) {
-      xSemaphoreGive(gpsDataSemaphore);
-      return;
-    }
-    
-    // Create JSON for location data
-    StaticJsonDocument<256> doc;
-    doc["latitude"] = currentGpsData.latitude;
-    doc["longitude"] = currentGpsData.longitude;
-    doc["timestamp"] = millis(); // Using millis as timestamp
-    
-    // Serialize JSON
-    String jsonData;
-    serializeJson(doc, jsonData);
-    
-    // Create HTTP client
-    HTTPClient http;
-    String url = String(LARAVEL_API_URL) + String(PATIENT_LOCATION_ENDPOINT);
-    
-    // Use secure client for HTTPS
-    http.begin(secureClient, url);
-    http.setTimeout(HTTP_TIMEOUT);
-    http.addHeader("Content-Type", "application/json");
-    http.addHeader("Accept", "application/json");
-    
-    // Send with retry logic
-    bool success = false;
-    int retries = 0;
-    
-    while (!success && retries < HTTP_MAX_RETRIES) {
-      int httpResponseCode = http.POST(jsonData);
-      String responseBody = http.getString();
-      
-      if (httpResponseCode >= 200 && httpResponseCode < 300) {
-        Serial.printf("HTTP Task: Patient location data sent to specific endpoint, response code: %d\n", httpResponseCode);
-        success = true;
-      } else {
-        Serial.printf("HTTP Task: Failed to send patient location data, error code: %d (attempt %d/%d)\n", 
-                     httpResponseCode, retries + 1, HTTP_MAX_RETRIES);
-        Serial.println("HTTP Task: Response body: " + responseBody);
-        retries++;
-        
-        if (retries < HTTP_MAX_RETRIES) {
-          vTaskDelay(pdMS_TO_TICKS(HTTP_RETRY_DELAY_MS));
-        }
-      }
-    }
-    
-    http.end();
-    
-    xSemaphoreGive(gpsDataSemaphore);
+bool sendPatientLocationData() {
+  // Only proceed if we have a valid fix and coordinates are not (0,0)
+  if (!latestGpsData.validFix || 
+      (latestGpsData.latitude == 0.0 && latestGpsData.longitude == 0.0)) {
+    return true;
   }
+  
+  // Create JSON for location data
+  StaticJsonDocument<256> doc;
+  doc["latitude"] = latestGpsData.latitude;
+  doc["longitude"] = latestGpsData.longitude;
+  doc["timestamp"] = millis(); // Using millis as timestamp
+  
+  // Serialize JSON into the request arena
+  int length = serializeBody(doc);
+  if (length < 0) {
+    return true;
+  }
+  
+  // One attempt on the kept-alive connection; the outbound queue retries with backoff
+  int httpResponseCode = postRequest(HTTP_HOST_BACKEND, PATIENT_LOCATION_ENDPOINT, "application/json", NULL,
+                                     (const uint8_t*)requestBody, length, HTTP_TELEMETRY_TIMEOUT);
+  bool success = httpResponseCode >= 200 && httpResponseCode < 300;
+  
+  if (success) {
+    Serial.printf("HTTP Task: Patient location data sent to specific endpoint, response code: %d\n", httpResponseCode);
+  } else {
+    Serial.printf("HTTP Task: Failed to send patient location data, error code: %d\n", httpResponseCode);
+    Serial.printf("HTTP Task: Response body: %s\n", responseBody);
+  }
+  
+  return success;
 }
\ No newline at end of file
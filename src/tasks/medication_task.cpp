@@ -101,8 +101,10 @@ void medicationTask(void *pvParameters) {
     }
     
     // Handle active notifications (continuous 15-second alert)
+    bool alerting = false;
     for(int i = 0; i < medicationCount; i++) {
       if(medications[i].notificationActive) {
+        alerting = true;
         // If 15 seconds have passed, stop the notification
         if(currentTime - medications[i].notificationStartTime >= 15000) {
           medications[i].notificationActive = false;
@@ -115,8 +117,10 @@ void medicationTask(void *pvParameters) {
       }
     }
     
-    // Yield to other tasks
-    vTaskDelay(pdMS_TO_TICKS(100)); // More responsive delay
+    // Poll every 100ms only while an alert repeats; otherwise sleep until the next check
+    unsigned long sinceCheck = millis() - lastCheckTime;
+    unsigned long waitMs = sinceCheck < 5 * 1000 ? 5 * 1000 - sinceCheck : 1;
+    vTaskDelay(pdMS_TO_TICKS(alerting ? 100 : waitMs));
   }
 }
 
@@ -314,28 +318,24 @@ void updateUpcomingMedication() {
  * Update the upcoming medication information on the display
  */
 void updateUpcomingMedicationDisplay() {
-  if(xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    if(hasUpcomingMed) {
-      // Format time with leading zeros
-      char timeStr[6];
-      sprintf(timeStr, "%02d:%02d", upcomingMedHour, upcomingMedMinute);
-      
-      // Update shared upcoming medication info
-      strncpy((char*)upcomingMedication.name, upcomingMedName, sizeof(upcomingMedication.name) - 1);
-      upcomingMedication.name[sizeof(upcomingMedication.name) - 1] = '\0';
-      strncpy((char*)upcomingMedication.timeStr, timeStr, sizeof(upcomingMedication.timeStr) - 1);
-      upcomingMedication.timeStr[sizeof(upcomingMedication.timeStr) - 1] = '\0';
-      upcomingMedication.available = true;
-    } else {
-      upcomingMedication.available = false;
-    }
-    
-    upcomingMedicationUpdated = true;
-    xSemaphoreGive(displayMutex);
-    
-    // Signal other tasks that upcoming medication info is updated
-    xSemaphoreGive(medicationSemaphore);
+  UpcomingMedication upcoming = {};
+  if(hasUpcomingMed) {
+    // Format time with leading zeros
+    char timeStr[6];
+    sprintf(timeStr, "%02d:%02d", upcomingMedHour, upcomingMedMinute);
+    
+    // Fill in upcoming medication info
+    strncpy(upcoming.name, upcomingMedName, sizeof(upcoming.name) - 1);
+    upcoming.name[sizeof(upcoming.name) - 1] = '\0';
+    strncpy(upcoming.timeStr, timeStr, sizeof(upcoming.timeStr) - 1);
+    upcoming.timeStr[sizeof(upcoming.timeStr) - 1] = '\0';
+    upcoming.available = true;
+  } else {
+    upcoming.available = false;
   }
+  
+  // Tell the screen that upcoming medication info is updated
+  upcomingMedicationTopic.publish(upcoming);
 }
 
 /**
@@ -408,68 +408,58 @@ void checkMedications() {
  * Play medication sound alert
  */
 void playMedicationSound(const char* medicationName, bool isAdvance) {
-  if(xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    currentAudioCommand.fileNumber = AUDIO_MEDICATION;
-    currentAudioCommand.repeatCount = isAdvance ? 1 : 2; // Shorter for advance notification
-    currentAudioCommand.volume = AUDIO_MAX_VOLUME;
-    audioCommandUpdated = true;
-    
-    xSemaphoreGive(displayMutex);
-    xSemaphoreGive(audioCommandSemaphore);
-  }
+  AudioCommand audioCommand;
+  audioCommand.fileNumber = AUDIO_MEDICATION;
+  audioCommand.repeatCount = isAdvance ? 1 : 2; // Shorter for advance notification
+  audioCommand.volume = AUDIO_MAX_VOLUME;
+  audioCommandTopic.publish(audioCommand);
 }
 
 /**
  * Trigger a 1-minute advance medication reminder
  */
 void triggerMedicationAdvanceReminder(const char* medicationName) {
-  // Update shared medication reminder data with mutex protection
-  if(xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    // Copy medication name to global variable
-    strncpy((char*)currentMedicationReminder.name, medicationName, sizeof(currentMedicationReminder.name) - 1);
-    currentMedicationReminder.name[sizeof(currentMedicationReminder.name) - 1] = '\0';
-    
-    currentMedicationReminder.time = time(NULL);
-    currentMedicationReminder.taken = false;
-    currentMedicationReminder.isAdvanceNotice = true; // Flag this as an advance notice
-    medicationReminderUpdated = true;
-    
-    xSemaphoreGive(displayMutex);
-    
-    // Signal other tasks
-    xSemaphoreGive(medicationSemaphore);
-    
-    Serial.printf("Medication Task: ADVANCE Reminder for %s (1 minute before)\n", medicationName);
-    
-    // Play audio alert
-    playMedicationSound(medicationName, true);
-  }
+  MedicationReminder reminder = {};
+  strncpy(reminder.name, medicationName, sizeof(reminder.name) - 1);
+  reminder.name[sizeof(reminder.name) - 1] = '\0';
+  
+  reminder.time = time(NULL);
+  reminder.taken = false;
+  reminder.isAdvanceNotice = true; // Flag this as an advance notice
+  
+  // Tell the screen
+  medicationTopic.publish(reminder);
+  
+  Serial.printf("Medication Task: ADVANCE Reminder for %s (1 minute before)\n", medicationName);
+  
+  // Play audio alert
+  playMedicationSound(medicationName, true);
 }
 
 /**
  * Trigger a medication reminder
  */
 void triggerMedicationReminder(const char* medicationName) {
-  // Update shared medication reminder data with mutex protection
-  if(xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    // Copy medication name to global variable
-    strncpy((char*)currentMedicationReminder.name, medicationName, sizeof(currentMedicationReminder.name) - 1);
-    currentMedicationReminder.name[sizeof(currentMedicationReminder.name) - 1] = '\0';
-    
-    currentMedicationReminder.time = time(NULL);
-    currentMedicationReminder.taken = false;
-    currentMedicationReminder.isAdvanceNotice = false; // This is the main notice
-    medicationReminderUpdated = true;
-    
-    xSemaphoreGive(displayMutex);
-    
-    // Signal other tasks
-    xSemaphoreGive(medicationSemaphore);
-    
-    
-    Serial.printf("Medication Task: Reminder for %s (Telegram alert triggered)\n", medicationName);
-    
-    // Play audio alert
-    playMedicationSound(medicationName, false);
-  }
+  MedicationReminder reminder = {};
+  strncpy(reminder.name, medicationName, sizeof(reminder.name) - 1);
+  reminder.name[sizeof(reminder.name) - 1] = '\0';
+  
+  reminder.time = time(NULL);
+  reminder.taken = false;
+  reminder.isAdvanceNotice = false; // This is the main notice
+  
+  // Tell the screen
+  medicationTopic.publish(reminder);
+  
+  // Let the caregiver know; the HTTP task sends it
+  TelegramAlert alert;
+  alert.kind = ALERT_NOTICE;
+  alert.hasFallLocation = false;
+  snprintf(alert.message, sizeof(alert.message), "💊 Medication reminder: %s is due now", medicationName);
+  telegramAlertTopic.publish(alert);
+  
+  Serial.printf("Medication Task: Reminder for %s (Telegram alert triggered)\n", medicationName);
+  
+  // Play audio alert
+  playMedicationSound(medicationName, false);
 }
\ No newline at end of file
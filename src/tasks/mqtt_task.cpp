@@ -12,9 +12,18 @@
 #include "../include/wifi_task.h"
 #include "../include/ecg_task.h"
 #include "../include/gps_task.h"
+#include "../include/time_task.h"
+#include "../include/fall_detection_task.h"
+#include "../include/outbox.h"
+#include "../include/ecg_stream.h"
+#include "../include/mqtt_inflight.h"
+#include "../include/puback_tap_client.h"
+#include "../include/power_manager.h"
+#include "../include/diagnostics.h"
 #include <WiFiClientSecure.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
+#include <SPIFFS.h>
 #include <time.h>
 
 // HiveMQ Cloud Serverless connection details
@@ -27,27 +36,115 @@ static constexpr char MQTT_PASS[]      = "Aland123";
 // MQTT topics
 static constexpr char TOPIC_REALTIME[] = "elderguard/patient/1/realtime";
 static constexpr char TOPIC_STATUS[]   = "elderguard/patient/1/status";
+static constexpr char TOPIC_FALL_CAPTURE[] = "elderguard/patient/1/fall_capture";
 
 // Underlying TLS client and PubSubClient
 static WiFiClientSecure tlsClient;
+
+#if MQTT_REALTIME_QOS == 1
+// Realtime messages the broker has not acknowledged yet
+static MqttInflightWindow inflight(MQTT_QOS1_RETRY_MS);
+
+static uint32_t mqttClockMs() {
+    return millis();
+}
+
+// Shows the window every byte PubSubClient reads, and writes QoS 1 packets past it
+static PubackTapClient tapClient(tlsClient, inflight, mqttClockMs);
+static PubSubClient mqttClient(tapClient);
+#else
 static PubSubClient mqttClient(tlsClient);
+#endif
 
 // Status publish interval
 static const unsigned long STATUS_INTERVAL = 30000UL;
 static unsigned long lastStatusTs = 0;
+static unsigned long lastDiagnosticsTs = 0;
+static DiagReport lastDiagnostics;        // Counters at the last diagnostics message
 static unsigned long lastConnectAttempt = 0;
 static const unsigned long CONNECT_RETRY_INTERVAL = 5000UL; // Only try to connect every 5 seconds
 
+// ECG messages kept on flash while the broker cannot be reached, replayed
+// to TOPIC_REALTIME once it can. 4 x 8KB holds about 15 minutes.
+static const uint8_t OUTBOX_REALTIME = 1;                  // Record type: TOPIC_REALTIME payload
+static const unsigned long OUTBOX_STORE_INTERVAL = 5000UL; // One stored ECG message per 5 seconds
+static const unsigned long OUTBOX_REPLAY_INTERVAL = 200UL; // Between replayed messages, so live data keeps flowing
+static Outbox mqttOutbox("/spiffs", "mqtt-", 8192, 4);
+static bool outboxReady = false;
+static unsigned long lastOutboxStoreTs = 0;
+static unsigned long lastOutboxReplayTs = 0;
+
+#if MQTT_ECG_MODE == MQTT_ECG_FRAMES
+#define ECG_FRAME_TYPE 1
+#define ECG_FRAME_HEADER_BYTES 16
+#define ECG_FRAME_SAMPLES (ECG_SAMPLE_RATE_HZ * MQTT_ECG_FRAME_MS / 1000)
+#if ECG_FRAME_SAMPLES < 10 || ECG_FRAME_SAMPLES > ECG_STREAM_MAX_BLOCK_SAMPLES
+#error "MQTT_ECG_FRAME_MS must give 10 to ECG_STREAM_MAX_BLOCK_SAMPLES samples per frame"
+#endif
+#define ECG_FRAME_MAX_BYTES (ECG_FRAME_HEADER_BYTES + ecgStreamBlockMaxBytes(ECG_FRAME_SAMPLES))
+#define REALTIME_MAX_BYTES (ECG_FRAME_MAX_BYTES > 512 ? ECG_FRAME_MAX_BYTES : 512)
+
+// Every ECG sample, cut into frames through the frame stream's own ring cursor
+static EcgBlockStream ecgFrameStream(ECG_SAMPLE_RATE_HZ, ECG_FRAME_SAMPLES);
+static uint8_t ecgFrame[ECG_FRAME_MAX_BYTES];
+static int ecgFrameLength = 0; // Encoded frame not sent yet (0 if none)
+#else
+#define REALTIME_MAX_BYTES 512
+#endif
+
+#if MQTT_REALTIME_QOS == 1
+static_assert(mqttPublishPacketBytes(sizeof(TOPIC_REALTIME) - 1, REALTIME_MAX_BYTES) <= MQTT_INFLIGHT_MAX_PACKET,
+              "A realtime message must fit one QoS 1 packet; shorten MQTT_ECG_FRAME_MS");
+#endif
+
+// Realtime topic counters, and their values at the last status message
+static MqttPublishStats publishStats = {};
+static uint32_t statusPublished = 0;
+static uint32_t statusBytes = 0;
+
+// Read position in the ECG sample ring (owned by the MQTT task)
+static EcgRingCursor mqttEcgCursor;
+
+// Event bus subscriptions and the latest message not yet published
+static int ecgSubscriber = -1;
+static int gpsSubscriber = -1;
+static int impactCaptureSubscriber = -1;
+static int wifiSubscriber = -1;
+static EcgData pendingEcgData;
+static GpsData pendingGpsData;
+static ImpactCapture pendingImpactCapture;
+#if MQTT_ECG_MODE == MQTT_ECG_JSON
+static bool ecgPending = false;
+#endif
+static bool gpsPending = false;
+static bool impactCapturePending = false;
+static unsigned long impactCaptureReceivedMs = 0;
+
 /**
  * Initialize the MQTT client
  */
 void setupMqtt() {
+    ecgRing.initCursor(&mqttEcgCursor);
+    ecgSubscriber = ecgTopic.subscribe(ECG_QUEUE_MQTT, EVENT_ECG_DATA);
+    gpsSubscriber = gpsTopic.subscribe(GPS_QUEUE_MQTT, EVENT_GPS_DATA);
+    impactCaptureSubscriber = impactCaptureTopic.subscribe(IMPACT_QUEUE_MQTT, EVENT_IMPACT_CAPTURE);
+    wifiSubscriber = wifiStatusTopic.subscribe(WIFI_QUEUE_MQTT, EVENT_WIFI_STATUS);
     tlsClient.setInsecure();
     tlsClient.setTimeout(1); // Set very short timeout to prevent blocking
     mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
     mqttClient.setKeepAlive(15); // 15 seconds keepalive
     mqttClient.setSocketTimeout(1); // 1 second socket timeout to avoid blocking
+    mqttClient.setBufferSize(512);  // JSON messages; frames and captures are streamed
+#if MQTT_ECG_MODE == MQTT_ECG_FRAMES
+    ecgFrameStream.begin(ecgRing);
+#endif
     // No incoming callbacks required
+    
+    // Messages not replayed before a reboot are picked up again
+    outboxReady = SPIFFS.begin(true) && mqttOutbox.begin();
+    if (!outboxReady) {
+        Serial.println("MQTT Task: Outbox unavailable, ECG data is lost while offline");
+    }
 }
 
 /**
@@ -65,7 +162,14 @@ bool connectMqttNonBlocking() {
     lastConnectAttempt = now;
     
     // Set a connect timeout
-    if (mqttClient.connect(MQTT_CLIENT_ID, MQTT_USER, MQTT_PASS, TOPIC_STATUS, 0, true, "{\"status\":\"offline\"}", true)) {
+    // With QoS 1 the broker keeps the session, so resent messages are matched to it
+    bool cleanSession = MQTT_REALTIME_QOS == 0;
+    // The TLS handshake runs at full clock speed
+    powerLockAcquire(POWER_LOCK_TRANSMIT);
+    bool connected = mqttClient.connect(MQTT_CLIENT_ID, MQTT_USER, MQTT_PASS, TOPIC_STATUS, 0, true,
+                                        "{\"status\":\"offline\"}", cleanSession);
+    powerLockRelease(POWER_LOCK_TRANSMIT);
+    if (connected) {
         // Publish retained "online" status
         StaticJsonDocument<128> doc;
         doc["status"] = "online";
@@ -78,17 +182,198 @@ bool connectMqttNonBlocking() {
     }
 }
 
+#if MQTT_REALTIME_QOS == 1
+/**
+ * Write a whole QoS 1 packet past PubSubClient; a short write drops the
+ * connection and the packet goes out again after the reconnect
+ *
+ * @return false if the connection was dropped
+ */
+static bool writeInflightPacket(const uint8_t *packet, int length) {
+    if (tapClient.writePacket(packet, length)) {
+        return true;
+    }
+    Serial.printf("MQTT: Short write of a %d byte QoS 1 packet, reconnecting\n", length);
+    return false;
+}
+
 /**
- * Publish ECG data to MQTT broker - with connection and timeout checks
+ * Send again every QoS 1 message that is due: all of them after a
+ * reconnect, otherwise those unacknowledged for MQTT_QOS1_RETRY_MS
+ */
+static void resendInflight() {
+    if (!tapClient.resendDue()) {
+        Serial.println("MQTT: Short write while resending, reconnecting");
+    }
+}
+#endif
+
+/**
+ * Publish one message on the realtime topic and count it. The payload is
+ * streamed, so it is not limited by the client's packet buffer. With QoS 1
+ * a message the in-flight window accepted counts as sent; the window
+ * resends it until the broker acknowledges it. A full window returns false
+ * at once and the caller keeps the message. A message too large for a
+ * QoS 1 packet is dropped and counted, since keeping it would stall the
+ * caller for good.
+ *
+ * @return false if the caller should keep the message and try again
+ */
+static bool publishRealtime(const uint8_t *payload, int length) {
+    unsigned long start = millis();
+#if MQTT_REALTIME_QOS == 1
+    // Resends first, so the broker sees messages in order
+    resendInflight();
+    const uint8_t *packet;
+    int packetLength;
+    MqttInflightResult result = inflight.add(TOPIC_REALTIME, payload, length, millis(), &packet, &packetLength);
+    if (result == MQTT_INFLIGHT_TOO_LARGE) {
+        Serial.printf("MQTT: Dropping %d byte realtime message, too large for QoS 1\n", length);
+        publishStats.oversize++;
+        return true;
+    }
+    bool published = result == MQTT_INFLIGHT_ADDED;
+    if (published) {
+        writeInflightPacket(packet, packetLength);
+    }
+#else
+    bool published = mqttClient.beginPublish(TOPIC_REALTIME, length, false) &&
+                     mqttClient.write(payload, length) == (size_t)length &&
+                     mqttClient.endPublish();
+#endif
+    unsigned long elapsed = millis() - start;
+    
+    if (published) {
+        publishStats.published++;
+        publishStats.bytes += length;
+    } else {
+        publishStats.failed++;
+    }
+    publishStats.lastPublishMs = elapsed;
+    publishStats.totalPublishMs += elapsed;
+    if (elapsed > publishStats.worstPublishMs) {
+        publishStats.worstPublishMs = elapsed;
+    }
+    return published;
+}
+
+void getMqttPublishStats(MqttPublishStats *stats) {
+    *stats = publishStats;
+#if MQTT_REALTIME_QOS == 1
+    stats->acked = inflight.getAckedCount();
+    stats->retransmits = inflight.getRetransmitCount();
+    stats->inflight = inflight.getCount();
+    stats->worstAckMs = inflight.getWorstAckMs();
+#endif
+}
+
+#if MQTT_ECG_MODE == MQTT_ECG_FRAMES
+// Saturates rather than wraps
+static void putUint16(uint8_t *out, uint32_t value) {
+    if (value > 0xFFFF) {
+        value = 0xFFFF;
+    }
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void putUint32(uint8_t *out, uint32_t value) {
+    putUint16(out, value & 0xFFFF);
+    putUint16(out + 2, value >> 16);
+}
+
+/**
+ * Encode the next ECG frame once all of its samples are in the ring. The
+ * vitals in the header are the latest ECG update.
+ *
+ * @return Frame length, or 0 if the frame is not complete yet
+ */
+static int readEcgFrame() {
+    int blocks;
+    int length = ecgFrameStream.readBlocks(ecgRing, &ecgFrame[ECG_FRAME_HEADER_BYTES],
+                                           sizeof(ecgFrame) - ECG_FRAME_HEADER_BYTES, 1, &blocks);
+    if (blocks == 0) {
+        return 0;
+    }
+    
+    ecgFrame[0] = ECG_FRAME_TYPE;
+    ecgFrame[1] = pendingEcgData.validSignal ? 1 : 0;
+    putUint16(&ecgFrame[2], pendingEcgData.heartRate > 0 ? pendingEcgData.heartRate : 0);
+    putUint32(&ecgFrame[4], (uint32_t)time(nullptr));
+    putUint16(&ecgFrame[8], (uint32_t)(pendingEcgData.sdnn * 10.0f + 0.5f));
+    putUint16(&ecgFrame[10], (uint32_t)(pendingEcgData.rmssd * 10.0f + 0.5f));
+    putUint16(&ecgFrame[12], (uint32_t)(pendingEcgData.pnn50 * 10.0f + 0.5f));
+    putUint16(&ecgFrame[14], pendingEcgData.hrvIntervals > 0 ? pendingEcgData.hrvIntervals : 0);
+    
+    publishStats.frames++;
+    return ECG_FRAME_HEADER_BYTES + length;
+}
+
+/**
+ * Publish every complete ECG frame. While disconnected, a frame is stored
+ * in the outbox every OUTBOX_STORE_INTERVAL and the rest are dropped; the
+ * stream's block numbers show the gap.
  */
 void publishEcgData() {
-    if (!mqttClient.connected() || !ecgDataUpdated) {
+    // Vitals for the next frame header
+    ecgTopic.receiveLatest(ecgSubscriber, &pendingEcgData);
+    
+    bool connected = getWiFiConnected() && mqttClient.connected();
+    
+    // Two frames per pass at most, enough to catch up after a slow publish
+    for (int i = 0; i < 2; i++) {
+        if (ecgFrameLength == 0) {
+            ecgFrameLength = readEcgFrame();
+            if (ecgFrameLength == 0) {
+                return;
+            }
+        }
+        
+        if (!connected) {
+            unsigned long now = millis();
+            if (outboxReady && now - lastOutboxStoreTs >= OUTBOX_STORE_INTERVAL) {
+                mqttOutbox.append(OUTBOX_REALTIME, ecgFrame, ecgFrameLength, false, getSynchronizedEpochTime());
+                lastOutboxStoreTs = now;
+            }
+            ecgFrameLength = 0;
+            continue;
+        }
+        
+        // A frame that failed is sent again on the next pass
+        if (!publishRealtime(ecgFrame, ecgFrameLength)) {
+            return;
+        }
+        ecgFrameLength = 0;
+    }
+}
+#else
+/**
+ * Publish ECG data to MQTT broker - with connection and timeout checks.
+ * While disconnected, a message is stored in the outbox every
+ * OUTBOX_STORE_INTERVAL instead.
+ */
+void publishEcgData() {
+    // Only the newest update matters; older ones are superseded
+    if (ecgTopic.receiveLatest(ecgSubscriber, &pendingEcgData)) {
+        ecgPending = true;
+    }
+    
+    if (!ecgPending) {
+        return;
+    }
+    
+    bool connected = getWiFiConnected() && mqttClient.connected();
+    unsigned long now = millis();
+    if (!connected && (!outboxReady || now - lastOutboxStoreTs < OUTBOX_STORE_INTERVAL)) {
         return;
     }
     
-    // Take a local copy of the current ECG data to avoid race conditions
-    int localHeartRate = currentEcgData.heartRate;
-    bool localValidSignal = currentEcgData.validSignal;
+    int localHeartRate = pendingEcgData.heartRate;
+    bool localValidSignal = pendingEcgData.validSignal;
+    float localSdnn = pendingEcgData.sdnn;
+    float localRmssd = pendingEcgData.rmssd;
+    float localPnn50 = pendingEcgData.pnn50;
+    int localHrvIntervals = pendingEcgData.hrvIntervals;
     
     // Create a static document to prevent memory fragmentation
     static StaticJsonDocument<512> doc;
@@ -96,32 +381,24 @@ void publishEcgData() {
     doc["type"] = "ecg";
     doc["heart_rate"] = localHeartRate;
     doc["valid"] = localValidSignal ? 1 : 0;
+    doc["sdnn"] = localSdnn;
+    doc["rmssd"] = localRmssd;
+    doc["pnn50"] = localPnn50;
+    doc["hrv_intervals"] = localHrvIntervals;
     doc["timestamp"] = time(nullptr);
     
-    // Add raw ECG data samples from the circular buffer
+    // Add raw ECG data samples from the sample ring
     JsonArray samples = doc.createNestedArray("ecg_data");
     
     // Add a limited number of samples to avoid excessive data
     const int numSamples = 10; // Reduced from 30 to minimize packet size
     
-    // Copy sample data to a local buffer before adding to JSON to avoid race conditions
+    // Newest samples since the last publish, read without blocking the ECG task
     int localSamples[numSamples];
-    // Safely obtain ECG buffer data
-    if (xSemaphoreTake(ecgDataSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
-        for (int i = 0; i < numSamples; i++) {
-            int idx = (bufferIndex - i - 1 + ECG_BUFFER_SIZE) % ECG_BUFFER_SIZE;
-            localSamples[i] = ecgBuffer[idx];
-        }
-        xSemaphoreGive(ecgDataSemaphore);
-    } else {
-        // If we can't get the semaphore, just use zeros
-        for (int i = 0; i < numSamples; i++) {
-            localSamples[i] = 0;
-        }
-    }
+    int sampleCount = ecgRing.readNewest(&mqttEcgCursor, localSamples, numSamples);
     
-    // Now add the local samples to the JSON document
-    for (int i = 0; i < numSamples; i++) {
+    // Most recent sample first
+    for (int i = sampleCount - 1; i >= 0; i--) {
         samples.add(localSamples[i]);
     }
     
@@ -129,37 +406,103 @@ void publishEcgData() {
     char buf[512];
     size_t n = serializeJson(doc, buf);
     
+    if (!connected) {
+        // Timestamped already, so it can be replayed as it is
+        mqttOutbox.append(OUTBOX_REALTIME, buf, n, false, getSynchronizedEpochTime());
+        lastOutboxStoreTs = now;
+        ecgPending = false;
+        return;
+    }
+    
     // Publish
-    bool published = mqttClient.publish(TOPIC_REALTIME, (uint8_t*)buf, n);
+    bool published = publishRealtime((uint8_t*)buf, n);
     if (published) {
-        ecgDataUpdated = false;
+        ecgPending = false;
     }
 }
+#endif
 
 /**
- * Publish GPS data to MQTT broker - with connection and timeout check
+ * Replay one stored message per OUTBOX_REPLAY_INTERVAL after reconnecting
  */
-void publishGpsData() {
-    if (!mqttClient.connected() || !gpsDataUpdated) {
+void replayMqttOutbox() {
+    if (!outboxReady) {
+        return;
+    }
+    
+    // Close off what was stored while disconnected so it can be read
+    if (mqttOutbox.hasUnsealed()) {
+        mqttOutbox.seal();
+    }
+    
+    unsigned long now = millis();
+    if (!mqttOutbox.hasBacklog() || now - lastOutboxReplayTs < OUTBOX_REPLAY_INTERVAL) {
         return;
     }
+    lastOutboxReplayTs = now;
     
-    // Take a local copy of GPS data to avoid race conditions
-    float localLat = 0, localLng = 0;
-    bool validGpsData = false;
+    uint8_t type;
+    static uint8_t buf[REALTIME_MAX_BYTES];
+    int n = mqttOutbox.read(&type, buf, sizeof(buf));
+    if (n < 0) {
+        mqttOutbox.commit();
+        return;
+    }
     
-    if (xSemaphoreTake(gpsDataSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
-        localLat = currentGpsData.latitude;
-        localLng = currentGpsData.longitude;
-        validGpsData = currentGpsData.validFix;
-        xSemaphoreGive(gpsDataSemaphore);
+    if (type != OUTBOX_REALTIME || publishRealtime(buf, n)) {
+        mqttOutbox.commit();
     } else {
-        // If we can't get the semaphore, skip publication
+        mqttOutbox.rewind();
+    }
+}
+
+/**
+ * Publish a JSON message larger than the client's buffer by streaming it
+ */
+static bool publishJson(const char *topic, const char *json, size_t length, bool retained) {
+    return mqttClient.beginPublish(topic, length, retained) &&
+           mqttClient.write((const uint8_t*)json, length) == length &&
+           mqttClient.endPublish();
+}
+
+/**
+ * Publish stack headroom, CPU share and sensor loop timing on the status
+ * topic. Not retained, so the retained online/offline status is kept.
+ */
+static void publishDiagnostics() {
+    static StaticJsonDocument<2048> doc;
+    static char buf[1536];
+    
+    DiagReport report;
+    getDiagnostics(&report);
+    doc.clear();
+    doc["type"] = "diagnostics";
+    writeDiagnosticsJson(doc, report, lastDiagnostics);
+    
+    size_t n = serializeJson(doc, buf);
+    if (publishJson(TOPIC_STATUS, buf, n, false)) {
+        lastDiagnostics = report;
+    }
+}
+
+/**
+ * Publish GPS data to MQTT broker - with connection and timeout check
+ */
+void publishGpsData() {
+    // Only the newest update matters; older ones are superseded
+    if (gpsTopic.receiveLatest(gpsSubscriber, &pendingGpsData)) {
+        gpsPending = true;
+    }
+    
+    if (!mqttClient.connected() || !gpsPending) {
         return;
     }
     
+    float localLat = pendingGpsData.latitude;
+    float localLng = pendingGpsData.longitude;
+    
     // Only publish if we have valid GPS data
-    if (validGpsData) {
+    if (pendingGpsData.validFix) {
         StaticJsonDocument<256> doc;
         doc["type"]      = "gps";
         doc["lat"]       = localLat;
@@ -167,10 +510,56 @@ void publishGpsData() {
         doc["timestamp"] = time(nullptr);
         char buf[256];
         size_t n = serializeJson(doc, buf);
-        bool published = mqttClient.publish(TOPIC_REALTIME, (uint8_t*)buf, n);
+        bool published = publishRealtime((uint8_t*)buf, n);
         if (published) {
-            gpsDataUpdated = false;
+            gpsPending = false;
         }
+    } else {
+        gpsPending = false;
+    }
+}
+
+/**
+ * Publish the pre/post-impact IMU capture of a fall as a binary payload.
+ * The blob is streamed straight from impactRecorder and held there until
+ * it has been sent, or until IMPACT_UPLOAD_DEADLINE_MS has passed, as on
+ * the HTTP side, so a broker that stays away does not block later captures.
+ */
+void publishImpactCapture() {
+    if (!impactCapturePending) {
+        const ImpactCapture *capture = impactCaptureTopic.receive(impactCaptureSubscriber);
+        if (capture == NULL) {
+            return;
+        }
+        pendingImpactCapture = *capture;
+        impactCaptureTopic.release(capture);
+        impactCapturePending = true;
+        impactCaptureReceivedMs = millis();
+    }
+    
+    if (millis() - impactCaptureReceivedMs >= IMPACT_UPLOAD_DEADLINE_MS) {
+        Serial.printf("MQTT Task: Impact capture %lu not published before its deadline, dropped\n",
+                      (unsigned long)pendingImpactCapture.captureId);
+        impactCapturePending = false;
+        impactRecorder.releaseBlob();
+        return;
+    }
+    
+    if (!mqttClient.connected()) {
+        return;
+    }
+    
+    int length;
+    const uint8_t *blob = impactRecorder.getBlob(&length);
+    
+    bool published = mqttClient.beginPublish(TOPIC_FALL_CAPTURE, length, false) &&
+                     mqttClient.write(blob, length) == (size_t)length &&
+                     mqttClient.endPublish();
+    if (published) {
+        Serial.printf("MQTT Task: Impact capture %lu published, %d bytes\n",
+                      (unsigned long)pendingImpactCapture.captureId, length);
+        impactCapturePending = false;
+        impactRecorder.releaseBlob();
     }
 }
 
@@ -180,16 +569,30 @@ void publishGpsData() {
 void mqttTask(void* pvParameters) {
     setupMqtt();
     
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(20);
+    const TickType_t xFrequency = pdMS_TO_TICKS(MQTT_LOOP_INTERVAL_MS);
+    
+    // Power counters at the last status message
+    PowerReport statusPower;
+    getPowerReport(&statusPower);
 
     while (true) {
-        // Ensure we yield regularly using vTaskDelayUntil instead of vTaskDelay
-        // This ensures consistent timing and prevents watchdog issues
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        // Wake as soon as ECG or GPS data is published, and at least every
+        // MQTT_LOOP_INTERVAL_MS so the MQTT client keeps servicing its connection
+        waitForEvents(xFrequency);
+        
+        // WiFi changed: connect to the broker at once, or drop a socket that is already dead
+        WiFiStatus wifiUpdate;
+        if (wifiStatusTopic.receiveLatest(wifiSubscriber, &wifiUpdate)) {
+            if (wifiUpdate.connected) {
+                lastConnectAttempt = millis() - CONNECT_RETRY_INTERVAL;
+            } else {
+                tlsClient.stop();
+            }
+        }
 
-        // Skip all MQTT operations if WiFi is not connected
+        // Skip all MQTT operations if WiFi is not connected; ECG data goes to the outbox
         if (!getWiFiConnected()) {
+            publishEcgData();
             continue;
         }
 
@@ -198,23 +601,79 @@ void mqttTask(void* pvParameters) {
         
         // Only call loop() if we're connected to avoid blocking
         if (mqttClient.connected()) {
+            powerLockAcquire(POWER_LOCK_TRANSMIT);
             mqttClient.loop();
+#if MQTT_REALTIME_QOS == 1
+            resendInflight();
+#endif
             
             // Publish data if needed - these functions have their own connection checks
             publishEcgData();
             publishGpsData();
+            publishImpactCapture();
+            replayMqttOutbox();
             
             // Send periodic status updates
             unsigned long now = millis();
             if (now - lastStatusTs >= STATUS_INTERVAL) {
                 lastStatusTs = now;
                 
-                StaticJsonDocument<128> doc;
+                // Realtime rates since the last status message
+                float seconds = STATUS_INTERVAL / 1000.0f;
+                StaticJsonDocument<896> doc;
                 doc["status"] = "online";
-                char buf[128];
+                doc["rt_msgs_per_s"] = (publishStats.published - statusPublished) / seconds;
+                doc["rt_bytes_per_s"] = (publishStats.bytes - statusBytes) / seconds;
+                doc["rt_failed"] = publishStats.failed;
+                doc["rt_publish_ms_avg"] = publishStats.published + publishStats.failed > 0 ?
+                    publishStats.totalPublishMs / (publishStats.published + publishStats.failed) : 0;
+                doc["rt_publish_ms_worst"] = publishStats.worstPublishMs;
+                WiFiStatus wifi;
+                currentWiFiStatus.load(&wifi);
+                doc["wifi_ssid"] = wifi.ssid;
+                doc["wifi_rssi"] = wifi.rssi;
+                doc["wifi_connect_ms"] = wifi.lastConnectMs;
+                doc["wifi_connect_ms_worst"] = wifi.worstConnectMs;
+                doc["wifi_fast_connect"] = wifi.fastConnect;
+                doc["wifi_roams"] = wifi.roamCount;
+#if MQTT_REALTIME_QOS == 1
+                doc["rt_acked"] = inflight.getAckedCount();
+                doc["rt_resent"] = inflight.getRetransmitCount();
+                doc["rt_inflight"] = inflight.getCount();
+                doc["rt_ack_ms_worst"] = inflight.getWorstAckMs();
+                doc["rt_oversize"] = publishStats.oversize;
+#endif
+                // Share of the interval each core was idle and uploads held full clock speed
+                PowerReport power;
+                getPowerReport(&power);
+                for (int core = 0; core < 2; core++) {
+                    uint32_t ticks = power.totalTicks[core] - statusPower.totalTicks[core];
+                    doc[core == 0 ? "idle_pct_core0" : "idle_pct_core1"] = ticks > 0 ?
+                        100.0f * (power.idleTicks[core] - statusPower.idleTicks[core]) / ticks : 0;
+                }
+                uint32_t elapsed = power.uptimeMs - statusPower.uptimeMs;
+                doc["tx_lock_pct"] = elapsed > 0 ?
+                    100.0f * (power.heldMs[POWER_LOCK_TRANSMIT] - statusPower.heldMs[POWER_LOCK_TRANSMIT]) / elapsed : 0;
+                doc["cpu_mhz"] = power.cpuMhz;
+                doc["modem_sleep"] = power.modemSleep;
+                statusPower = power;
+                statusPublished = publishStats.published;
+                statusBytes = publishStats.bytes;
+                
+                // Streamed: the status message no longer fits the client's 512-byte buffer
+                char buf[640];
                 size_t n = serializeJson(doc, buf);
-                mqttClient.publish(TOPIC_STATUS, (uint8_t*)buf, n, true);
+                publishJson(TOPIC_STATUS, buf, n, true);
+            }
+            
+            if (now - lastDiagnosticsTs >= DIAG_PUBLISH_INTERVAL_MS) {
+                lastDiagnosticsTs = now;
+                publishDiagnostics();
             }
+            powerLockRelease(POWER_LOCK_TRANSMIT);
+        } else {
+            // Broker unreachable; ECG data goes to the outbox
+            publishEcgData();
         }
         
         // Yield to other tasks
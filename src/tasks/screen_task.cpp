@@ -97,6 +97,16 @@ bool medicationAlertActive = false;
 unsigned long lastHeartBeatAnimation = 0;
 bool heartBeatState = false;
 
+// Latest data received from the event bus
+static FallEvent latestFallEvent = {};
+static GpsData latestGpsData = {};
+static WiFiStatus latestWiFiStatus = {};
+static UpcomingMedication latestUpcomingMedication = {};
+static bool hasFallEvent = false;
+static bool hasGpsData = false;
+static bool hasWiFiStatus = false;
+static bool hasUpcomingMedication = false;
+
 // Helper function to safely draw text centered on x-axis
 void drawCenteredText(const char* text, int y, int size = 1) {
     display.setTextSize(size);
@@ -151,8 +161,8 @@ void displayMainScreen() {
     // Time centered
     drawCenteredText(timeString, 2);
     // WiFi Icon right
-    if (wifiStatusUpdated) {
-        drawWifiIcon(currentWiFiStatus.rssi);
+    if (hasWiFiStatus) {
+        drawWifiIcon(latestWiFiStatus.rssi);
     } else {
         // Default icon if status unknown
         display.drawBitmap(SCREEN_WIDTH - 12, 2, wifiNone, 8, 8, SH110X_WHITE);
@@ -203,15 +213,15 @@ void displayMainScreen() {
     display.print("Next Med:");
     // Medication Info
     display.setCursor(SCREEN_WIDTH/2 + 5, 30); // Below label
-    if (upcomingMedicationUpdated && upcomingMedication.available) {
+    if (hasUpcomingMedication && latestUpcomingMedication.available) {
         // Truncate name
         char shortName[10];
-        strncpy(shortName, (const char*)upcomingMedication.name, 9);
+        strncpy(shortName, latestUpcomingMedication.name, 9);
         shortName[9] = '\0';
         display.print(shortName);
         // Time
         display.setCursor(SCREEN_WIDTH/2 + 5, 40); // Below name
-        display.print((const char*)upcomingMedication.timeStr);
+        display.print(latestUpcomingMedication.timeStr);
     } else if (medicationAlertActive && strlen(currentMedicationName) > 0) {
          // Truncate name
         char shortName[10];
@@ -239,14 +249,14 @@ void displayMainScreen() {
     display.drawBitmap(5, 53, locationIcon, 8, 8, SH110X_WHITE); // Adjusted coords
     display.setCursor(15, 54); // Adjusted coords
     display.print("GPS:");
-    if (gpsDataUpdated) {
-        display.print(currentGpsData.validFix ? "Fix" : "Search");
+    if (hasGpsData) {
+        display.print(latestGpsData.validFix ? "Fix" : "Search");
     } else {
         display.print("N/A");
     }
 
     // Fall Status (Right side of status bar)
-    if (fallDetectionUpdated && currentFallEvent.fallDetected) {
+    if (hasFallEvent && latestFallEvent.fallDetected) {
         // Flash "FALL!" with icon
         if ((millis() / 500) % 2 == 0) {
             display.drawBitmap(SCREEN_WIDTH - 45, 53, alertIcon, 8, 8, SH110X_WHITE); // Adjusted coords
@@ -328,10 +338,10 @@ void displayFallAlert() {
     drawCenteredText("DETECTED", 40, 2); // Adjusted position
 
     // --- Severity ---
-    if (fallDetectionUpdated && currentFallEvent.fallDetected && currentFallEvent.fallSeverity > 0) {
+    if (hasFallEvent && latestFallEvent.fallDetected && latestFallEvent.fallSeverity > 0) {
         display.setTextSize(1);
         char severityStr[20];
-        sprintf(severityStr, "Severity: %d", currentFallEvent.fallSeverity); // Simplified text
+        sprintf(severityStr, "Severity: %d", latestFallEvent.fallSeverity); // Simplified text
         // Position severity at the bottom
         int16_t x1, y1;
         uint16_t w, h;
@@ -389,6 +399,14 @@ void screenTask(void *pvParameters) {
     currentScreenState = SCREEN_MAIN;
     screenStateStartTime = millis();
     
+    // Alerts wake the task immediately; status data is picked up on the next pass
+    int fallSubscriber = fallTopic.subscribe(FALL_QUEUE_SCREEN, EVENT_FALL);
+    int medicationSubscriber = medicationTopic.subscribe(MEDICATION_QUEUE_SCREEN, EVENT_MEDICATION);
+    int ecgSubscriber = ecgTopic.subscribe(ECG_QUEUE_SCREEN);
+    int gpsSubscriber = gpsTopic.subscribe(GPS_QUEUE_SCREEN);
+    int wifiSubscriber = wifiStatusTopic.subscribe(WIFI_QUEUE_SCREEN);
+    int upcomingMedicationSubscriber = upcomingMedicationTopic.subscribe(UPCOMING_MEDICATION_QUEUE_SCREEN);
+    
     // Main task loop
     while (true) {
         unsigned long currentTime = millis();
@@ -414,21 +432,10 @@ void screenTask(void *pvParameters) {
             }
         }
         
-        // SAFELY Check for fall detection using semaphore (non-blocking)
-        bool hasFallUpdate = false;
-        bool isFallDetected = false;
-        
-        if (xSemaphoreTake(fallDetectionSemaphore, 0) == pdTRUE) {
-            hasFallUpdate = true;
-            // Safely copy fall detection data while holding the semaphore
-            if (fallDetectionUpdated) {
-                isFallDetected = currentFallEvent.fallDetected;
-            }
-            xSemaphoreGive(fallDetectionSemaphore);
-        }
-        
-        if (hasFallUpdate) {
-            if (isFallDetected) {
+        // Check for fall events (non-blocking); each event is delivered once
+        if (fallTopic.receiveLatest(fallSubscriber, &latestFallEvent)) {
+            hasFallEvent = true;
+            if (latestFallEvent.fallDetected) {
                 currentScreenState = SCREEN_FALL;
                 screenStateStartTime = currentTime;
             } else {
@@ -437,19 +444,16 @@ void screenTask(void *pvParameters) {
             needsDisplayUpdate = true;
         }
         
-        // SAFELY Check for ECG data using semaphore (non-blocking)
-        if (xSemaphoreTake(ecgDataSemaphore, 0) == pdTRUE) {
-            // Safely copy ECG data while holding the semaphore
+        // Check for ECG data (non-blocking)
+        EcgData ecgData;
+        if (ecgTopic.receiveLatest(ecgSubscriber, &ecgData)) {
             int prevHeartRate = currentHeartRate;
-            if (ecgDataUpdated) {
-                currentHeartRate = currentEcgData.heartRate;
-                
-                if (prevHeartRate != currentHeartRate) {
-                    lastHeartRateUpdateTime = currentTime;
-                    needsDisplayUpdate = true;
-                }
+            currentHeartRate = ecgData.heartRate;
+            
+            if (prevHeartRate != currentHeartRate) {
+                lastHeartRateUpdateTime = currentTime;
+                needsDisplayUpdate = true;
             }
-            xSemaphoreGive(ecgDataSemaphore);
         }
         
         // Force heart rate display update even if no new data
@@ -458,46 +462,37 @@ void screenTask(void *pvParameters) {
             needsDisplayUpdate = true;
         }
         
-        // SAFELY Check for medication reminders using semaphore
-        bool hasMedicationUpdate = false;
-        bool isReminderActive = false;
-        char medicationNameTemp[32] = "";
+        // Status bar data is only drawn on the next refresh
+        if (gpsTopic.receiveLatest(gpsSubscriber, &latestGpsData)) {
+            hasGpsData = true;
+        }
+        if (wifiStatusTopic.receiveLatest(wifiSubscriber, &latestWiFiStatus)) {
+            hasWiFiStatus = true;
+        }
+        if (upcomingMedicationTopic.receiveLatest(upcomingMedicationSubscriber, &latestUpcomingMedication)) {
+            hasUpcomingMedication = true;
+        }
         
-        if (xSemaphoreTake(medicationSemaphore, 0) == pdTRUE) {
-            hasMedicationUpdate = true;
-            
-            // Safely copy medication data while holding the semaphore
-            if (medicationReminderUpdated) {
-                isReminderActive = !currentMedicationReminder.taken;
+        // Check for medication reminders (non-blocking)
+        MedicationReminder reminder;
+        if (medicationTopic.receiveLatest(medicationSubscriber, &reminder)) {
+            medicationAlertActive = !reminder.taken;
+            if (medicationAlertActive) {
+                strncpy(currentMedicationName, reminder.name, sizeof(currentMedicationName) - 1);
+                currentMedicationName[sizeof(currentMedicationName) - 1] = '\0'; // Ensure null termination
                 
-                // Safely copy the medication name
-                if (isReminderActive) {
-                    strncpy(medicationNameTemp, (const char*)currentMedicationReminder.name, sizeof(medicationNameTemp)-1);
-                    medicationNameTemp[sizeof(medicationNameTemp)-1] = '\0'; // Ensure null termination
-                }
-            }
-            
-            xSemaphoreGive(medicationSemaphore);
-            
-            // Update state variables AFTER releasing the semaphore
-            if (hasMedicationUpdate) {
-                medicationAlertActive = isReminderActive;
-                if (isReminderActive) {
-                    strncpy(currentMedicationName, medicationNameTemp, sizeof(currentMedicationName));
-                    
-                    // Only switch to medication screen if it's newly active
-                    currentScreenState = SCREEN_MEDICATION;
-                    screenStateStartTime = currentTime;
-                }
-                needsDisplayUpdate = true;
+                // Only switch to medication screen if it's newly active
+                currentScreenState = SCREEN_MEDICATION;
+                screenStateStartTime = currentTime;
             }
+            needsDisplayUpdate = true;
         }
         
         // Update display at regular intervals or when new data received
         if (needsDisplayUpdate || currentTime - lastUpdateTime >= updateInterval) {
             lastUpdateTime = currentTime;
             
-            // No need to take displayMutex here since we're the only task that accesses the display directly
+            // No lock needed here since we're the only task that accesses the display directly
             
             // Update display based on current state
             switch (currentScreenState) {
@@ -515,7 +510,8 @@ void screenTask(void *pvParameters) {
             needsDisplayUpdate = false;
         }
         
-        // Give other tasks a chance to run
-        vTaskDelay(pdMS_TO_TICKS(50));
+        // Sleep until a fall or medication alert arrives, or the next refresh is due
+        unsigned long sinceUpdate = millis() - lastUpdateTime;
+        waitForEvents(pdMS_TO_TICKS(sinceUpdate < updateInterval ? updateInterval - sinceUpdate : 1));
     }
 }
\ No newline at end of file
@@ -15,29 +15,30 @@
 #include "../include/config.h"
 #include "../include/globals.h"
 
+// Time status owned by this task; other tasks read the currentTimeStatus snapshot
+static TimeStatus timeStatus;
+static int wifiSubscriber = -1;
+
 void timeTask(void *pvParameters) {
   Serial.println("Time Task: Started");
   
   // Initialize time status
-  currentTimeStatus.synchronized = false;
-  currentTimeStatus.lastSyncTimestamp = 0;
-  currentTimeStatus.currentEpoch = 0;
-  
-  // Use a temporary non-volatile buffer for string operations
-  char buffer[32];
-  strcpy(buffer, "Not synchronized");
-  memcpy((void*)currentTimeStatus.timeString, buffer, strlen(buffer) + 1);
-  
-  currentTimeStatus.lastCheck = 0;
-  
-  // Wait for WiFi connection before attempting NTP sync
+  timeStatus.synchronized = false;
+  timeStatus.lastSyncTimestamp = 0;
+  timeStatus.currentEpoch = 0;
+  strcpy(timeStatus.timeString, "Not synchronized");
+  timeStatus.lastCheck = 0;
+  currentTimeStatus.store(timeStatus);
+  
+  // Wait for WiFi connection before attempting NTP sync; woken by the WiFi task
+  wifiSubscriber = wifiStatusTopic.subscribe(WIFI_QUEUE_TIME, EVENT_WIFI_STATUS);
   Serial.println("Time Task: Waiting for WiFi connection");
   while (!getWiFiConnected()) {
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    waitForEvents(portMAX_DELAY);
   }
   
   // Setup time synchronization
-  if (setupTimeSync(&currentTimeStatus)) {
+  if (setupTimeSync(&timeStatus)) {
     Serial.println("Time Task: Time synchronization initialized successfully");
   } else {
     Serial.println("Time Task: Failed to initialize time synchronization");
@@ -45,28 +46,33 @@ void timeTask(void *pvParameters) {
   
   // Main task loop
   while (true) {
+    // Back online without a sync yet: try now instead of waiting for the interval
+    WiFiStatus wifiUpdate;
+    bool reconnected = wifiStatusTopic.receiveLatest(wifiSubscriber, &wifiUpdate) &&
+                       wifiUpdate.connected && !timeStatus.synchronized;
+    
     // Check if time needs to be synced
-    if (millis() - currentTimeStatus.lastSyncTimestamp > TIME_SYNC_INTERVAL_MS) {
+    if (reconnected || millis() - timeStatus.lastSyncTimestamp > TIME_SYNC_INTERVAL_MS) {
       // Only attempt sync if WiFi is connected
       if (getWiFiConnected()) {
-        syncTimeWithNTP(&currentTimeStatus);
+        syncTimeWithNTP(&timeStatus);
       } else {
         Serial.println("Time Task: Cannot sync time - WiFi not connected");
       }
     }
     
     // Update current time information
-    updateCurrentTime(&currentTimeStatus);
+    updateCurrentTime(&timeStatus);
     
-    // Signal other tasks that time status is updated
-    xSemaphoreGive(timeStatusSemaphore);
+    // Publish the snapshot for other tasks (never blocks)
+    currentTimeStatus.store(timeStatus);
     
-    // Delay before next check
-    vTaskDelay(pdMS_TO_TICKS(TIME_TASK_INTERVAL_MS));
+    // Delay before next check, or until WiFi changes
+    waitForEvents(pdMS_TO_TICKS(TIME_TASK_INTERVAL_MS));
   }
 }
 
-bool setupTimeSync(volatile TimeStatus *status) {
+bool setupTimeSync(TimeStatus *status) {
   Serial.println("Time Task: Setting up time synchronization");
   
   // Configure NTP time synchronization
@@ -76,7 +82,7 @@ bool setupTimeSync(volatile TimeStatus *status) {
   return syncTimeWithNTP(status);
 }
 
-bool syncTimeWithNTP(volatile TimeStatus *status) {
+bool syncTimeWithNTP(TimeStatus *status) {
   Serial.println("Time Task: Synchronizing time with NTP server");
   
   // Record sync attempt time
@@ -107,20 +113,10 @@ bool syncTimeWithNTP(volatile TimeStatus *status) {
     char timeStr[32];
     strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
     
-    // Use memcpy for volatile destination
-    memcpy((void*)status->timeString, timeStr, strlen(timeStr) + 1);
-    
-    // Update shared time status with mutex protection
-    xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100));
-    timeStatusUpdated = true;
-    xSemaphoreGive(displayMutex);
+    strcpy(status->timeString, timeStr);
     
     Serial.print("Time Task: Time synchronized: ");
-    
-    // Copy volatile data to temporary buffer for printing
-    char timeBuffer[32];
-    memcpy(timeBuffer, (const void*)status->timeString, sizeof(timeBuffer));
-    Serial.println(timeBuffer);
+    Serial.println(status->timeString);
     
     return true;
   } else {
@@ -129,7 +125,7 @@ bool syncTimeWithNTP(volatile TimeStatus *status) {
   }
 }
 
-void updateCurrentTime(volatile TimeStatus *status) {
+void updateCurrentTime(TimeStatus *status) {
   // Only update periodically to reduce overhead
   if (millis() - status->lastCheck < 1000) {
     return;
@@ -150,31 +146,31 @@ void updateCurrentTime(volatile TimeStatus *status) {
   char timeStr[32];
   strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
   
-  // Copy volatile data to temporary buffer for comparison
-  char currentTimeStr[32];
-  memcpy(currentTimeStr, (const void*)status->timeString, sizeof(currentTimeStr));
-  
-  // Only update shared status if time string has changed
-  if (strcmp(currentTimeStr, timeStr) != 0) {
-    // Use memcpy for volatile destination
-    memcpy((void*)status->timeString, timeStr, strlen(timeStr) + 1);
-    
-    // Update shared time status with mutex protection
-    xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100));
-    timeStatusUpdated = true;
-    xSemaphoreGive(displayMutex);
+  // Only update the time string if it has changed
+  if (strcmp(status->timeString, timeStr) != 0) {
+    strcpy(status->timeString, timeStr);
   }
 }
 
 time_t getCurrentEpochTime() {
-  if (!currentTimeStatus.synchronized) {
+  TimeStatus status;
+  currentTimeStatus.load(&status);
+  if (!status.synchronized) {
     Serial.println("Time Task: Warning - Getting time before synchronization");
   }
-  return currentTimeStatus.currentEpoch;
+  return status.currentEpoch;
+}
+
+uint32_t getSynchronizedEpochTime() {
+  TimeStatus status;
+  currentTimeStatus.load(&status);
+  return status.synchronized ? (uint32_t)time(nullptr) : 0;
 }
 
 char* getCurrentTimeString(char* buffer, size_t bufferSize, const char* format) {
-  time_t now = currentTimeStatus.currentEpoch;
+  TimeStatus status;
+  currentTimeStatus.load(&status);
+  time_t now = status.currentEpoch;
   struct tm timeinfo;
   localtime_r(&now, &timeinfo);
   
@@ -187,5 +183,7 @@ char* getCurrentTimeString(char* buffer, size_t bufferSize, const char* format)
 }
 
 bool isTimeSynchronized() {
-  return currentTimeStatus.synchronized;
+  TimeStatus status;
+  currentTimeStatus.load(&status);
+  return status.synchronized;
 }
\ No newline at end of file
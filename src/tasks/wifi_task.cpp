@@ -1,125 +1,445 @@
 /**
  * ElderGuard - WiFi Management Task Implementation
- * 
+ *
  * This file implements the WiFi connectivity functionality that handles
- * connecting to WiFi networks and monitoring connection status.
+ * connecting to WiFi networks and monitoring connection status. Connection
+ * results arrive as WiFi events, so the task never waits on a connect: it
+ * sleeps until the next event or timeout, reconnects as soon as the link
+ * drops and backs off exponentially while attempts keep failing. Every
+ * change is published on wifiStatusTopic, which wakes the network tasks.
+ *
+ * The networks to join are kept in NVS with the BSSID and channel of the
+ * last good connection. A reconnect first goes straight to that access
+ * point; only if that fails is there a scan, after which the best known
+ * network in range is joined. While the signal stays weak the task scans
+ * now and then and moves to a clearly stronger access point.
  */
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <Preferences.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "../include/wifi_task.h"
 #include "../include/config.h"
 #include "../include/globals.h"
+#include "../include/ap_list.h"
 
-void wifiTask(void *pvParameters) {
-  // Initialize WiFi status
-  currentWiFiStatus.connected = false;
-  currentWiFiStatus.rssi = 0;
+// WiFi status owned by this task; other tasks read the currentWiFiStatus snapshot
+static WiFiStatus wifiStatus;
+
+// Notification bits the WiFi event handler and the network API set on this task
+#define WIFI_NOTIFY_GOT_IP       (1 << 0)
+#define WIFI_NOTIFY_DISCONNECTED (1 << 1)
+#define WIFI_NOTIFY_SCAN_DONE    (1 << 2)
+#define WIFI_NOTIFY_NETWORKS     (1 << 3)
+
+// Connection state machine
+typedef enum {
+  WIFI_STATE_SCANNING,     // Looking for a known network to join
+  WIFI_STATE_CONNECTING,   // WiFi.begin() issued, waiting for an IP or a disconnect
+  WIFI_STATE_CONNECTED,
+  WIFI_STATE_BACKOFF       // Attempt failed, waiting before the next one
+} WiFiState;
+
+static TaskHandle_t notifyTask = NULL;
+static WiFiState wifiState = WIFI_STATE_BACKOFF;
+static unsigned long attemptStart = 0;
+static unsigned long backoffMs = 0;
+static unsigned long nextAttempt = 0;
+static unsigned long lastRoamScan = 0;
+
+// Known networks, stored in NVS under "wifi"/"aps"
+static AccessPointList networks;
+static Preferences networkStore;
+static char attemptSsid[AP_SSID_MAX];    // Network being joined ("" if none); looked up again on use
+static bool attemptFast = false;         // Joining the cached access point without a scan
+static ApScanResult scanResults[WIFI_SCAN_RESULTS_MAX];
+
+// Network list changes from other tasks, applied by this one
+typedef struct {
+  bool remove;
+  char ssid[AP_SSID_MAX];
+  char password[AP_PASSWORD_MAX];
+  int priority;
+} NetworkChange;
+
+static QueueHandle_t networkChanges = NULL;
+
+/**
+ * Runs in the WiFi event loop task: only hands the event to wifiTask
+ */
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  uint32_t bits = 0;
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      bits = WIFI_NOTIFY_GOT_IP;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      bits = WIFI_NOTIFY_DISCONNECTED;
+      break;
+    case ARDUINO_EVENT_WIFI_SCAN_DONE:
+      bits = WIFI_NOTIFY_SCAN_DONE;
+      break;
+    default:
+      return;
+  }
+  if (notifyTask != NULL) {
+    xTaskNotify(notifyTask, bits, eSetBits);
+  }
+}
+
+/**
+ * Update the shared WiFi snapshot and deliver a copy to subscribers
+ */
+static void publishWiFiStatus(const WiFiStatus *status) {
+  currentWiFiStatus.store(*status);
+  wifiStatusTopic.publish(*status);
+}
+
+static void saveNetworks() {
+  networkStore.putBytes("aps", networks.getBlob(), networks.getBlobSize());
+}
+
+/**
+ * Load the known networks from NVS and make sure the configured default
+ * is among them
+ */
+static void loadNetworks() {
+  networkStore.begin("wifi", false);
   
-  // Use a temporary non-volatile buffer for string operations
-  char buffer[16];
-  strcpy(buffer, "0.0.0.0");
-  memcpy((void*)currentWiFiStatus.ip, buffer, strlen(buffer) + 1);
+  size_t length = networkStore.getBytesLength("aps");
+  if (length > 0) {
+    uint8_t *blob = new uint8_t[length];
+    networkStore.getBytes("aps", blob, length);
+    if (!networks.restore(blob, length)) {
+      Serial.println("WiFi Task: Stored network list unreadable, starting afresh");
+    }
+    delete[] blob;
+  }
   
-  currentWiFiStatus.lastConnectAttempt = 0;
-  currentWiFiStatus.failureCount = 0;
-  currentWiFiStatus.lastStatusCheck = 0;
+  bool known = false;
+  for (int i = 0; i < networks.getCount(); i++) {
+    if (strcmp(networks.get(i).ssid, WIFI_SSID) == 0 && strcmp(networks.get(i).password, WIFI_PASSWORD) == 0) {
+      known = true;
+    }
+  }
+  if (!known) {
+    networks.add(WIFI_SSID, WIFI_PASSWORD, 0);
+    saveNetworks();
+  }
+  
+  Serial.printf("WiFi Task: %d known networks, fast connect %s\n", networks.getCount(),
+                networks.getFastConnect() >= 0 ? "available" : "not available");
+}
+
+/**
+ * Apply network list changes queued by other tasks
+ */
+static void applyNetworkChanges() {
+  NetworkChange change;
+  bool changed = false;
+  while (xQueueReceive(networkChanges, &change, 0) == pdTRUE) {
+    if (change.remove) {
+      changed |= networks.remove(change.ssid);
+    } else if (networks.add(change.ssid, change.password, change.priority)) {
+      changed = true;
+    } else {
+      Serial.printf("WiFi Task: Cannot add network %s, list full\n", change.ssid);
+    }
+  }
+  if (changed) {
+    saveNetworks();
+  }
+}
+
+/**
+ * A connection attempt failed: wait before the next one, doubling the
+ * wait up to WIFI_BACKOFF_MAX_MS
+ */
+static void scheduleRetry(WiFiStatus *status) {
+  status->failureCount++;
+  backoffMs = backoffMs == 0 ? WIFI_BACKOFF_MIN_MS : min(backoffMs * 2, (unsigned long)WIFI_BACKOFF_MAX_MS);
+  nextAttempt = millis() + backoffMs;
+  wifiState = WIFI_STATE_BACKOFF;
+  Serial.printf("WiFi Task: Attempt %d failed, retrying in %lu ms\n", status->failureCount, backoffMs);
+}
+
+static void startScan() {
+  WiFi.scanNetworks(true, false, false, WIFI_SCAN_MS_PER_CHANNEL);
+}
+
+/**
+ * Join one access point of a known network, skipping the channel scan
+ */
+static void joinNetwork(int index, const uint8_t *bssid, int channel, bool fast) {
+  const KnownAccessPoint &ap = networks.get(index);
+  strcpy(attemptSsid, ap.ssid);
+  attemptFast = fast;
+  wifiState = WIFI_STATE_CONNECTING;
+  WiFi.begin(ap.ssid, ap.password, channel, bssid);
+}
+
+/**
+ * Copy the finished scan out of the WiFi driver
+ *
+ * @return Number of results
+ */
+static int readScanResults() {
+  int found = WiFi.scanComplete();
+  int count = 0;
+  for (int i = 0; i < found && count < WIFI_SCAN_RESULTS_MAX; i++) {
+    ApScanResult &result = scanResults[count++];
+    strncpy(result.ssid, WiFi.SSID(i).c_str(), AP_SSID_MAX - 1);
+    result.ssid[AP_SSID_MAX - 1] = '\0';
+    memcpy(result.bssid, WiFi.BSSID(i), 6);
+    result.channel = WiFi.channel(i);
+    result.rssi = WiFi.RSSI(i);
+  }
+  WiFi.scanDelete();
+  return count;
+}
+
+/**
+ * Scan finished while connecting: join the best known network in range
+ */
+static void joinFromScan(WiFiStatus *status) {
+  int count = readScanResults();
+  int result;
+  int best = networks.selectBest(scanResults, count, &result);
+  if (best < 0) {
+    Serial.printf("WiFi Task: No known network among %d in range\n", count);
+    scheduleRetry(status);
+    return;
+  }
+  Serial.printf("WiFi Task: Joining %s on channel %d (%d dBm)\n",
+                scanResults[result].ssid, scanResults[result].channel, scanResults[result].rssi);
+  joinNetwork(best, scanResults[result].bssid, scanResults[result].channel, false);
+}
+
+/**
+ * Scan finished while connected: move to a clearly stronger access point.
+ * The target becomes the cached one and the link is dropped, so the
+ * reconnect goes straight to it.
+ */
+static void roamFromScan(WiFiStatus *status) {
+  int count = readScanResults();
+  int rssi = WiFi.RSSI();
+  int result;
+  int target = networks.selectRoamTarget(scanResults, count, WiFi.BSSID(), rssi,
+                                         WIFI_ROAM_HYSTERESIS_DB, &result);
+  if (target < 0) {
+    return;
+  }
+  Serial.printf("WiFi Task: Roaming from %d dBm to %s on channel %d (%d dBm)\n", rssi,
+                scanResults[result].ssid, scanResults[result].channel, scanResults[result].rssi);
+  networks.remember(target, scanResults[result].bssid, scanResults[result].channel);
+  status->roamCount++;
+  WiFi.disconnect();
+}
+
+/**
+ * While the signal is weak, look for a stronger access point now and then
+ */
+static void checkRoaming() {
+  unsigned long now = millis();
+  if (WiFi.RSSI() < WIFI_ROAM_RSSI_DBM && now - lastRoamScan >= WIFI_ROAM_SCAN_INTERVAL_MS) {
+    lastRoamScan = now;
+    startScan();
+  }
+}
+
+/**
+ * Connected: record how long it took and cache the access point
+ */
+static void onConnected(WiFiStatus *status, unsigned long now) {
+  wifiState = WIFI_STATE_CONNECTED;
+  backoffMs = 0;
+  status->connected = true;
+  status->failureCount = 0;
+  status->rssi = WiFi.RSSI();
+  strncpy(status->ip, WiFi.localIP().toString().c_str(), sizeof(status->ip) - 1);
+  status->ip[sizeof(status->ip) - 1] = '\0';
+  strncpy(status->ssid, WiFi.SSID().c_str(), sizeof(status->ssid) - 1);
+  status->ssid[sizeof(status->ssid) - 1] = '\0';
+  status->channel = WiFi.channel();
+  status->lastStatusCheck = now;
+  status->lastConnectMs = now - attemptStart;
+  status->fastConnect = attemptFast;
+  if (status->lastConnectMs > status->worstConnectMs) {
+    status->worstConnectMs = status->lastConnectMs;
+  }
+  Serial.printf("WiFi Task: Connected to %s in %lu ms (%s), channel %d, %d dBm, IP %s\n",
+                status->ssid, status->lastConnectMs, attemptFast ? "cached BSSID" : "after scan",
+                status->channel, status->rssi, status->ip);
+  
+  // The list may have changed while connecting
+  int index = networks.find(attemptSsid);
+  if (index >= 0 && networks.remember(index, WiFi.BSSID(), status->channel)) {
+    saveNetworks();
+  }
+  
+  // Wakes every task waiting for connectivity
+  publishWiFiStatus(status);
+}
+
+/**
+ * @return Milliseconds until the state machine has something to do
+ */
+static uint32_t msUntilNextCheck(const WiFiStatus *status) {
+  unsigned long now = millis();
+  unsigned long due;
+  switch (wifiState) {
+    case WIFI_STATE_SCANNING:
+    case WIFI_STATE_CONNECTING:
+      due = attemptStart + WIFI_CONNECT_TIMEOUT_MS;
+      break;
+    case WIFI_STATE_BACKOFF:
+      due = nextAttempt;
+      break;
+    default:
+      due = status->lastStatusCheck + WIFI_TASK_INTERVAL_MS;
+      break;
+  }
+  long wait = (long)(due - now);
+  return wait > 0 ? (uint32_t)wait : 1;
+}
+
+void wifiTask(void *pvParameters) {
+  // Initialize WiFi status
+  memset(&wifiStatus, 0, sizeof(wifiStatus));
+  strcpy(wifiStatus.ip, "0.0.0.0");
+  currentWiFiStatus.store(wifiStatus);
   
   // Setup WiFi configuration
-  setupWiFi(&currentWiFiStatus);
+  notifyTask = xTaskGetCurrentTaskHandle();
+  networkChanges = xQueueCreate(4, sizeof(NetworkChange));
+  loadNetworks();
+  setupWiFi(&wifiStatus);
   
-  // Initial connection attempt
-  connectToWiFi(&currentWiFiStatus);
+  // Initial connection attempt; the result arrives as an event
+  connectToWiFi(&wifiStatus);
   
-  // Main task loop
+  // Main task loop: sleep until a WiFi event or the next timeout
   while (true) {
-    // Check if WiFi is connected
-    if (!currentWiFiStatus.connected) {
-      // Attempt to reconnect if it's been long enough since the last attempt
-      if (millis() - currentWiFiStatus.lastConnectAttempt > WIFI_RECONNECT_INTERVAL_MS) {
-        reconnectWiFi(&currentWiFiStatus);
+    uint32_t events = waitForEvents(pdMS_TO_TICKS(msUntilNextCheck(&wifiStatus)));
+    unsigned long now = millis();
+    
+    if (events & WIFI_NOTIFY_NETWORKS) {
+      applyNetworkChanges();
+    }
+    
+    if ((events & WIFI_NOTIFY_GOT_IP) && WiFi.status() == WL_CONNECTED) {
+      if (wifiState != WIFI_STATE_CONNECTED) {
+        onConnected(&wifiStatus, now);
+      }
+    } else if (events & WIFI_NOTIFY_DISCONNECTED) {
+      if (wifiState == WIFI_STATE_CONNECTED) {
+        // Dropped (or roaming): tell everyone and reconnect straight away
+        wifiStatus.connected = false;
+        publishWiFiStatus(&wifiStatus);
+        Serial.println("WiFi Task: Connection lost, reconnecting");
+        connectToWiFi(&wifiStatus);
+      } else if (wifiState == WIFI_STATE_CONNECTING && attemptFast) {
+        // The cached access point is gone: scan now rather than back off
+        Serial.println("WiFi Task: Cached access point failed, scanning");
+        int index = networks.find(attemptSsid);
+        if (index >= 0 && networks.forget(index)) {
+          saveNetworks();
+        }
+        wifiState = WIFI_STATE_SCANNING;
+        startScan();
+      } else if (wifiState == WIFI_STATE_CONNECTING) {
+        scheduleRetry(&wifiStatus);
       }
-    } else {
-      // Update WiFi status information (RSSI, IP, etc.)
-      updateWiFiStatus(&currentWiFiStatus);
     }
     
-    // Signal other tasks that WiFi status is updated
-    xSemaphoreGive(wifiStatusSemaphore);
+    if (events & WIFI_NOTIFY_SCAN_DONE) {
+      if (wifiState == WIFI_STATE_SCANNING) {
+        joinFromScan(&wifiStatus);
+      } else if (wifiState == WIFI_STATE_CONNECTED) {
+        roamFromScan(&wifiStatus);
+      } else {
+        WiFi.scanDelete();
+      }
+    }
     
-    // Delay before next check
-    vTaskDelay(pdMS_TO_TICKS(WIFI_TASK_INTERVAL_MS));
+    switch (wifiState) {
+      case WIFI_STATE_SCANNING:
+      case WIFI_STATE_CONNECTING:
+        // No result at all: give up on this attempt
+        if (now - attemptStart >= WIFI_CONNECT_TIMEOUT_MS) {
+          WiFi.scanDelete();
+          WiFi.disconnect();
+          scheduleRetry(&wifiStatus);
+        }
+        break;
+      case WIFI_STATE_BACKOFF:
+        if ((long)(now - nextAttempt) >= 0) {
+          reconnectWiFi(&wifiStatus);
+        }
+        break;
+      case WIFI_STATE_CONNECTED:
+        // Update WiFi status information (RSSI, IP, etc.)
+        updateWiFiStatus(&wifiStatus);
+        checkRoaming();
+        break;
+    }
   }
 }
 
-void setupWiFi(volatile WiFiStatus *status) {
+void setupWiFi(WiFiStatus *status) {
   // Set WiFi mode to station (client)
   WiFi.mode(WIFI_STA);
   
+  // Reconnects are driven by this task, with backoff
+  WiFi.setAutoReconnect(false);
+  
   // Disconnect from any previous connections
   WiFi.disconnect();
   
   // Set hostname for easier identification on network
   WiFi.setHostname("ElderGuard");
   
+  // Modem sleep: the radio wakes for each DTIM beacon and when sending
+#if POWER_MODE == POWER_MODE_SAVE
+  WiFi.setSleep(WIFI_PS_MIN_MODEM);
+#else
+  WiFi.setSleep(WIFI_PS_NONE);
+#endif
+  
   // Wait a moment for WiFi to initialize
   delay(100);
+  
+  // Registered last so the disconnect above is not taken for a failed attempt
+  WiFi.onEvent(onWiFiEvent);
 }
 
-bool connectToWiFi(volatile WiFiStatus *status) {
+void connectToWiFi(WiFiStatus *status) {
   // Record connection attempt time
   status->lastConnectAttempt = millis();
+  attemptStart = status->lastConnectAttempt;
   
-  // Begin connection attempt
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-  
-  // Wait for connection or timeout
-  unsigned long startTime = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - startTime < WIFI_CONNECT_TIMEOUT_MS) {
-    delay(500);
-  }
-  
-  // Check if connected
-  if (WiFi.status() == WL_CONNECTED) {
-    // Update status information
-    status->connected = true;
-    status->rssi = WiFi.RSSI();
-    
-    // Use a temporary buffer for string operations
-    char buffer[16];
-    strcpy(buffer, WiFi.localIP().toString().c_str());
-    memcpy((void*)status->ip, buffer, strlen(buffer) + 1);
-    
-    status->failureCount = 0;
-    
-    // Update shared WiFi status
-    xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100));
-    wifiStatusUpdated = true;
-    xSemaphoreGive(displayMutex);
-    
-    return true;
+  // Straight to the last access point if it is cached, otherwise scan first
+  int fast = networks.getFastConnect();
+  if (fast >= 0) {
+    const KnownAccessPoint &ap = networks.get(fast);
+    joinNetwork(fast, ap.bssid, ap.channel, true);
   } else {
-    // Update failure information
-    status->connected = false;
-    status->failureCount++;
-    
-    // Update shared WiFi status
-    xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100));
-    wifiStatusUpdated = true;
-    xSemaphoreGive(displayMutex);
-    
-    return false;
+    attemptSsid[0] = '\0';
+    attemptFast = false;
+    wifiState = WIFI_STATE_SCANNING;
+    startScan();
   }
 }
 
-bool reconnectWiFi(volatile WiFiStatus *status) {
+void reconnectWiFi(WiFiStatus *status) {
   // Just use the connect function for reconnection
-  return connectToWiFi(status);
+  connectToWiFi(status);
 }
 
-void updateWiFiStatus(volatile WiFiStatus *status) {
+void updateWiFiStatus(WiFiStatus *status) {
   // Only update status periodically to avoid excessive overhead
   if (millis() - status->lastStatusCheck < WIFI_TASK_INTERVAL_MS) {
     return;
@@ -127,17 +447,8 @@ void updateWiFiStatus(volatile WiFiStatus *status) {
   
   status->lastStatusCheck = millis();
   
-  // Check current connection status
+  // A drop is reported by the disconnect event
   if (WiFi.status() != WL_CONNECTED) {
-    // If we thought we were connected but we're not anymore
-    if (status->connected) {
-      status->connected = false;
-      
-      // Update shared WiFi status
-      xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100));
-      wifiStatusUpdated = true;
-      xSemaphoreGive(displayMutex);
-    }
     return;
   }
   
@@ -145,26 +456,55 @@ void updateWiFiStatus(volatile WiFiStatus *status) {
   int newRssi = WiFi.RSSI();
   String newIp = WiFi.localIP().toString();
   
-  // Copy volatile data to temporary buffer for comparison
-  char currentIp[16];
-  memcpy(currentIp, (const void*)status->ip, sizeof(currentIp));
-  
   // Only update if there's been a significant change in RSSI or IP
-  if (abs(status->rssi - newRssi) > 5 || strcmp(currentIp, newIp.c_str()) != 0) {
+  if (abs(status->rssi - newRssi) > 5 || strcmp(status->ip, newIp.c_str()) != 0) {
     status->rssi = newRssi;
+    strncpy(status->ip, newIp.c_str(), sizeof(status->ip) - 1);
+    status->ip[sizeof(status->ip) - 1] = '\0';
     
-    // Use a temporary buffer for string operations
-    char buffer[16];
-    strcpy(buffer, newIp.c_str());
-    memcpy((void*)status->ip, buffer, strlen(buffer) + 1);
-    
-    // Update shared WiFi status with mutex protection
-    xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100));
-    wifiStatusUpdated = true;
-    xSemaphoreGive(displayMutex);
+    // Publish updated WiFi status
+    publishWiFiStatus(status);
+  }
+}
+
+/**
+ * Hand a network list change to the WiFi task
+ */
+static bool queueNetworkChange(const NetworkChange &change) {
+  if (networkChanges == NULL || xQueueSend(networkChanges, &change, 0) != pdTRUE) {
+    return false;
+  }
+  xTaskNotify(notifyTask, WIFI_NOTIFY_NETWORKS, eSetBits);
+  return true;
+}
+
+bool addWiFiNetwork(const char *ssid, const char *password, int priority) {
+  NetworkChange change;
+  if (strlen(ssid) >= sizeof(change.ssid) || strlen(password) >= sizeof(change.password)) {
+    return false;
+  }
+  change.remove = false;
+  strcpy(change.ssid, ssid);
+  strcpy(change.password, password);
+  change.priority = priority;
+  return queueNetworkChange(change);
+}
+
+bool removeWiFiNetwork(const char *ssid) {
+  NetworkChange change;
+  if (strlen(ssid) >= sizeof(change.ssid)) {
+    return false;
   }
+  change.remove = true;
+  strcpy(change.ssid, ssid);
+  change.password[0] = '\0';
+  change.priority = 0;
+  return queueNetworkChange(change);
 }
 
 bool getWiFiConnected() {
-  return currentWiFiStatus.connected;
+  // Safe from any task: reads the lock-free snapshot
+  WiFiStatus status;
+  currentWiFiStatus.load(&status);
+  return status.connected;
 }
\ No newline at end of file
@@ -0,0 +1,282 @@
+/**
+ * ElderGuard - Fall detector replay and scoring for the native tests
+ *
+ * Loads recorded IMU traces, replays them through FallDetector and scores
+ * a labelled dataset: a fall trace counts as detected when the detector
+ * confirms at least one fall in it, any other trace as a false alarm when
+ * it does. A parameter grid is swept over the dataset on all host cores.
+ *
+ * Two trace formats are read:
+ *
+ *   CSV     One sample per line, "time_ms,ax,ay,az,gx,gy,gz" with
+ *           acceleration in m/s^2 and angular rate in rad/s. Lines
+ *           starting with '#' are comments; "# label=fall" marks a fall
+ *           trace and "# rate=100" gives the sample rate. A header line
+ *           that does not start with a number is skipped.
+ *
+ *   Binary  Little-endian: "EGIM", uint32 sample rate, uint32 label
+ *           (1 = fall), uint32 sample count, then per sample uint32
+ *           time_ms and six floats in the CSV order.
+ *
+ * A trace must start with the wearer at rest: the first
+ * FALL_REPLAY_CALIBRATION_MS calibrate the detector as on the device.
+ */
+
+#ifndef FALL_REPLAY_H
+#define FALL_REPLAY_H
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fall_detector.h"
+
+#define FALL_REPLAY_CALIBRATION_MS 500
+
+static const char FALL_REPLAY_MAGIC[4] = {'E', 'G', 'I', 'M'};
+
+typedef struct {
+    uint32_t timeMs;
+    float ax, ay, az;
+    float gx, gy, gz;
+} FallReplaySample;
+
+typedef struct {
+    std::string name;
+    int sampleRateHz;
+    bool fall;                   // Label: the trace holds a real fall
+    std::vector<FallReplaySample> samples;
+} FallReplayTrace;
+
+// Confusion counts over a dataset, one decision per trace
+typedef struct {
+    int truePositives;           // Falls detected
+    int falseNegatives;          // Falls missed
+    int trueNegatives;           // Other traces with no fall raised
+    int falsePositives;          // Other traces that raised a fall
+    uint64_t samples;            // Samples replayed
+} FallReplayScore;
+
+static inline float fallReplaySensitivity(const FallReplayScore &score) {
+    int falls = score.truePositives + score.falseNegatives;
+    return falls > 0 ? (float)score.truePositives / falls : 0;
+}
+
+static inline float fallReplaySpecificity(const FallReplayScore &score) {
+    int others = score.trueNegatives + score.falsePositives;
+    return others > 0 ? (float)score.trueNegatives / others : 0;
+}
+
+/**
+ * @return Whether the file was read and held at least one sample
+ */
+static inline bool loadFallReplayCsv(const char *path, FallReplayTrace *trace) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    trace->name = path;
+    trace->sampleRateHz = 0;
+    trace->fall = false;
+    trace->samples.clear();
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == '#') {
+            const char *value;
+            if ((value = strstr(line, "label=")) != NULL) {
+                trace->fall = strncmp(value + 6, "fall", 4) == 0 || value[6] == '1';
+            } else if ((value = strstr(line, "rate=")) != NULL) {
+                trace->sampleRateHz = atoi(value + 5);
+            }
+            continue;
+        }
+        FallReplaySample s;
+        unsigned long timeMs;
+        if (sscanf(line, "%lu,%f,%f,%f,%f,%f,%f", &timeMs, &s.ax, &s.ay, &s.az, &s.gx, &s.gy, &s.gz) == 7) {
+            s.timeMs = (uint32_t)timeMs;
+            trace->samples.push_back(s);
+        }
+    }
+    fclose(file);
+
+    // Without a rate comment, take it from the sample clock
+    size_t count = trace->samples.size();
+    if (trace->sampleRateHz <= 0 && count > 1) {
+        uint32_t spanMs = trace->samples[count - 1].timeMs - trace->samples[0].timeMs;
+        trace->sampleRateHz = spanMs > 0 ? (int)((count - 1) * 1000 / spanMs) : 0;
+    }
+    return count > 0 && trace->sampleRateHz > 0;
+}
+
+/**
+ * @return Whether the file was read completely
+ */
+static inline bool loadFallReplayBinary(const char *path, FallReplayTrace *trace) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    char magic[4];
+    uint32_t header[3];
+    bool ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+              memcmp(magic, FALL_REPLAY_MAGIC, sizeof(magic)) == 0 &&
+              fread(header, sizeof(uint32_t), 3, file) == 3 && header[0] > 0;
+    if (ok) {
+        trace->name = path;
+        trace->sampleRateHz = (int)header[0];
+        trace->fall = header[1] == 1;
+        trace->samples.resize(header[2]);
+        for (uint32_t i = 0; ok && i < header[2]; i++) {
+            FallReplaySample &s = trace->samples[i];
+            float values[6];
+            ok = fread(&s.timeMs, sizeof(uint32_t), 1, file) == 1 &&
+                 fread(values, sizeof(float), 6, file) == 6;
+            s.ax = values[0];
+            s.ay = values[1];
+            s.az = values[2];
+            s.gx = values[3];
+            s.gy = values[4];
+            s.gz = values[5];
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+/**
+ * @return Whether the whole trace was written
+ */
+static inline bool saveFallReplayBinary(const char *path, const FallReplayTrace &trace) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    uint32_t header[3] = {(uint32_t)trace.sampleRateHz, trace.fall ? 1u : 0u, (uint32_t)trace.samples.size()};
+    bool ok = fwrite(FALL_REPLAY_MAGIC, 1, sizeof(FALL_REPLAY_MAGIC), file) == sizeof(FALL_REPLAY_MAGIC) &&
+              fwrite(header, sizeof(uint32_t), 3, file) == 3;
+    for (size_t i = 0; ok && i < trace.samples.size(); i++) {
+        const FallReplaySample &s = trace.samples[i];
+        float values[6] = {s.ax, s.ay, s.az, s.gx, s.gy, s.gz};
+        ok = fwrite(&s.timeMs, sizeof(uint32_t), 1, file) == 1 &&
+             fwrite(values, sizeof(float), 6, file) == 6;
+    }
+    return fclose(file) == 0 && ok;
+}
+
+/**
+ * Load a trace by extension: ".csv" is CSV, anything else binary
+ */
+static inline bool loadFallReplayTrace(const char *path, FallReplayTrace *trace) {
+    size_t length = strlen(path);
+    if (length > 4 && strcmp(&path[length - 4], ".csv") == 0) {
+        return loadFallReplayCsv(path, trace);
+    }
+    return loadFallReplayBinary(path, trace);
+}
+
+/**
+ * Replay one trace from a fresh detector
+ *
+ * @return Falls confirmed
+ */
+static inline int replayFallTrace(const FallReplayTrace &trace, const FallDetectorConfig &config) {
+    FallDetector detector(trace.sampleRateHz);
+    detector.setConfig(config);
+
+    // Calibrate from the rest at the start, as the task does at boot
+    float sum[6] = {0, 0, 0, 0, 0, 0};
+    int rest = 0;
+    uint32_t firstMs = trace.samples.empty() ? 0 : trace.samples[0].timeMs;
+    for (; rest < (int)trace.samples.size(); rest++) {
+        const FallReplaySample &s = trace.samples[rest];
+        if (s.timeMs - firstMs >= FALL_REPLAY_CALIBRATION_MS) {
+            break;
+        }
+        sum[0] += s.ax;
+        sum[1] += s.ay;
+        sum[2] += s.az;
+        sum[3] += s.gx;
+        sum[4] += s.gy;
+        sum[5] += s.gz;
+    }
+    if (rest > 0) {
+        detector.calibrate(sum[0] / rest, sum[1] / rest, sum[2] / rest, sum[3] / rest, sum[4] / rest, sum[5] / rest);
+    }
+
+    int falls = 0;
+    for (size_t i = 0; i < trace.samples.size(); i++) {
+        const FallReplaySample &s = trace.samples[i];
+        if (detector.processSample(s.ax, s.ay, s.az, s.gx, s.gy, s.gz, s.timeMs, NULL) == FALL_RESULT_FALL) {
+            falls++;
+        }
+    }
+    return falls;
+}
+
+static inline FallReplayScore scoreFallReplay(const std::vector<FallReplayTrace> &traces,
+                                              const FallDetectorConfig &config) {
+    FallReplayScore score = {};
+    for (size_t i = 0; i < traces.size(); i++) {
+        bool detected = replayFallTrace(traces[i], config) > 0;
+        if (traces[i].fall) {
+            detected ? score.truePositives++ : score.falseNegatives++;
+        } else {
+            detected ? score.falsePositives++ : score.trueNegatives++;
+        }
+        score.samples += traces[i].samples.size();
+    }
+    return score;
+}
+
+/**
+ * Score every configuration over the dataset, spread over threads
+ *
+ * @param scores Receives one score per configuration
+ * @param threads Worker threads; 0 uses every host core
+ * @return Samples replayed per second per thread
+ */
+static inline double sweepFallReplay(const std::vector<FallReplayTrace> &traces,
+                                     const std::vector<FallDetectorConfig> &configs,
+                                     std::vector<FallReplayScore> *scores, unsigned threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads > configs.size()) {
+        threads = (unsigned)configs.size();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+    scores->assign(configs.size(), FallReplayScore());
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        size_t index;
+        while ((index = next++) < configs.size()) {
+            (*scores)[index] = scoreFallReplay(traces, configs[index]);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i].join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t samples = 0;
+    for (size_t i = 0; i < scores->size(); i++) {
+        samples += (*scores)[i].samples;
+    }
+    return seconds > 0 ? samples / seconds / threads : 0;
+}
+
+#endif // FALL_REPLAY_H
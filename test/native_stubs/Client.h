@@ -0,0 +1,41 @@
+/**
+ * ElderGuard - Arduino Client stand-in for the native tests
+ *
+ * The connection interface PubackTapClient wraps, without Stream and Print
+ * behind it. IPAddress is only passed through.
+ */
+
+#ifndef NATIVE_STUB_CLIENT_H
+#define NATIVE_STUB_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class IPAddress {
+public:
+    IPAddress() : address(0) {}
+    explicit IPAddress(uint32_t address) : address(address) {}
+    operator uint32_t() const { return address; }
+
+private:
+    uint32_t address;
+};
+
+class Client {
+public:
+    virtual ~Client() {}
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t *buf, size_t size) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t *buf, size_t size) = 0;
+    virtual int peek() = 0;
+    virtual void flush() = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+    virtual operator bool() = 0;
+};
+
+#endif // NATIVE_STUB_CLIENT_H
@@ -0,0 +1,31 @@
+/**
+ * ElderGuard - FreeRTOS stand-in for the native tests
+ *
+ * Only what the header-only primitives under test (seqlock.h and
+ * event_bus.h) use. On the host every thread runs preemptively, so
+ * suspending the scheduler is a no-op, a critical section is a spinlock
+ * and a tick is one millisecond.
+ */
+
+#ifndef NATIVE_STUB_FREERTOS_H
+#define NATIVE_STUB_FREERTOS_H
+
+#include <stdint.h>
+#include <atomic>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+typedef struct {
+    std::atomic_flag locked = ATOMIC_FLAG_INIT;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+#endif // NATIVE_STUB_FREERTOS_H
@@ -0,0 +1,71 @@
+/**
+ * ElderGuard - FreeRTOS queue API stand-in for the native tests
+ *
+ * A fixed-depth copy queue with the same non-blocking and timed semantics.
+ */
+
+#ifndef NATIVE_STUB_QUEUE_H
+#define NATIVE_STUB_QUEUE_H
+
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "FreeRTOS.h"
+
+typedef struct {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::vector<uint8_t> items;
+    int itemSize;
+    int depth;
+    int head;
+    int count;
+} NativeQueue;
+
+typedef NativeQueue *QueueHandle_t;
+
+static inline QueueHandle_t xQueueCreate(UBaseType_t depth, UBaseType_t itemSize) {
+  NativeQueue *queue = new NativeQueue();
+  queue->items.resize(depth * itemSize);
+  queue->itemSize = itemSize;
+  queue->depth = depth;
+  queue->head = 0;
+  queue->count = 0;
+  return queue;
+}
+
+static inline void vQueueDelete(QueueHandle_t queue) {
+  delete queue;
+}
+
+static inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> guard(queue->lock);
+  if (!queue->changed.wait_for(guard, std::chrono::milliseconds(wait),
+                               [queue] { return queue->count < queue->depth; })) {
+    return pdFALSE;
+  }
+  int tail = (queue->head + queue->count) % queue->depth;
+  memcpy(&queue->items[tail * queue->itemSize], item, queue->itemSize);
+  queue->count++;
+  guard.unlock();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+static inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> guard(queue->lock);
+  if (!queue->changed.wait_for(guard, std::chrono::milliseconds(wait),
+                               [queue] { return queue->count > 0; })) {
+    return pdFALSE;
+  }
+  memcpy(item, &queue->items[queue->head * queue->itemSize], queue->itemSize);
+  queue->head = (queue->head + 1) % queue->depth;
+  queue->count--;
+  guard.unlock();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+#endif // NATIVE_STUB_QUEUE_H
@@ -0,0 +1,71 @@
+/**
+ * ElderGuard - FreeRTOS task API stand-in for the native tests
+ *
+ * Each host thread gets its own notification value the first time it
+ * asks for its task handle.
+ */
+
+#ifndef NATIVE_STUB_TASK_H
+#define NATIVE_STUB_TASK_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include "FreeRTOS.h"
+
+typedef struct {
+    std::mutex lock;
+    std::condition_variable changed;
+    uint32_t bits;
+} NativeTask;
+
+typedef NativeTask *TaskHandle_t;
+
+typedef enum {
+    eNoAction,
+    eSetBits
+} eNotifyAction;
+
+static inline void vTaskSuspendAll() {}
+static inline BaseType_t xTaskResumeAll() { return 0; }
+
+static inline void taskENTER_CRITICAL(portMUX_TYPE *mux) {
+  while (mux->locked.test_and_set(std::memory_order_acquire)) {
+  }
+}
+
+static inline void taskEXIT_CRITICAL(portMUX_TYPE *mux) {
+  mux->locked.clear(std::memory_order_release);
+}
+
+static inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+  static thread_local NativeTask task;
+  return &task;
+}
+
+static inline BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+  {
+    std::lock_guard<std::mutex> guard(task->lock);
+    if (action == eSetBits) {
+      task->bits |= value;
+    }
+  }
+  task->changed.notify_all();
+  return pdTRUE;
+}
+
+static inline BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value,
+                                         TickType_t wait) {
+  NativeTask *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> guard(task->lock);
+  task->bits &= ~clearOnEntry;
+  bool notified = task->changed.wait_for(guard, std::chrono::milliseconds(wait),
+                                         [task] { return task->bits != 0; });
+  if (value != NULL) {
+    *value = task->bits;
+  }
+  task->bits &= ~clearOnExit;
+  return notified ? pdTRUE : pdFALSE;
+}
+
+#endif // NATIVE_STUB_TASK_H
@@ -0,0 +1,94 @@
+/**
+ * ElderGuard - Synthetic ECG for the native tests
+ *
+ * Sum-of-Gaussians beats (P, QRS, T) on a wandering baseline with a little
+ * noise, at a chosen RR sequence. The R peak of each beat is known exactly,
+ * so detector timing can be checked against it.
+ */
+
+#ifndef SYNTHETIC_ECG_H
+#define SYNTHETIC_ECG_H
+
+#include <math.h>
+#include <stdint.h>
+
+typedef struct {
+    int sampleRateHz;
+    int baseline;                // ADC counts
+    int rAmplitude;              // R wave height in ADC counts
+    float wanderAmplitude;       // Baseline wander in ADC counts
+    float wanderHz;
+    int noise;                   // Uniform noise, +/- ADC counts
+} SyntheticEcgConfig;
+
+static inline SyntheticEcgConfig syntheticEcgDefaults(int sampleRateHz) {
+    SyntheticEcgConfig config;
+    config.sampleRateHz = sampleRateHz;
+    config.baseline = 1900;
+    config.rAmplitude = 800;
+    config.wanderAmplitude = 60.0f;
+    config.wanderHz = 0.3f;
+    config.noise = 10;
+    return config;
+}
+
+static inline float syntheticWave(float t, float centre, float width, float height) {
+    float d = (t - centre) / width;
+    return height * expf(-0.5f * d * d);
+}
+
+/**
+ * Fill samples with beats whose R peaks fall at rPeakMs[]
+ *
+ * @param config Signal shape
+ * @param rPeakMs R peak times in ms, ascending
+ * @param beats Number of R peaks
+ * @param samples Output, count samples from t = 0
+ * @param count Number of samples
+ */
+static inline void syntheticEcg(const SyntheticEcgConfig &config, const uint32_t *rPeakMs, int beats,
+                                int *samples, int count) {
+    uint32_t noise = 12345;
+    int beat = 0;
+    for (int i = 0; i < count; i++) {
+        float t = i * 1000.0f / config.sampleRateHz;
+        float value = config.baseline + config.wanderAmplitude * sinf(2.0f * (float)M_PI * config.wanderHz * t / 1000.0f);
+
+        // Beats close enough to contribute: the previous, current and next
+        while (beat + 1 < beats && rPeakMs[beat + 1] < t) {
+            beat++;
+        }
+        for (int b = beat - 1; b <= beat + 1; b++) {
+            if (b < 0 || b >= beats) {
+                continue;
+            }
+            float r = (float)rPeakMs[b];
+            value += syntheticWave(t, r - 160.0f, 25.0f, 0.15f * config.rAmplitude);   // P
+            value += syntheticWave(t, r - 25.0f, 8.0f, -0.1f * config.rAmplitude);     // Q
+            value += syntheticWave(t, r, 10.0f, config.rAmplitude);                    // R
+            value += syntheticWave(t, r + 25.0f, 8.0f, -0.2f * config.rAmplitude);     // S
+            value += syntheticWave(t, r + 250.0f, 45.0f, 0.3f * config.rAmplitude);    // T
+        }
+
+        noise = noise * 1103515245 + 12345;
+        if (config.noise > 0) {
+            value += (int)((noise >> 16) % (2 * config.noise + 1)) - config.noise;
+        }
+        samples[i] = (int)lroundf(value);
+    }
+}
+
+/**
+ * R peaks every rrMs starting at firstMs
+ *
+ * @return Number of peaks written
+ */
+static inline int syntheticConstantRr(uint32_t firstMs, uint32_t rrMs, uint32_t durationMs, uint32_t *rPeakMs, int maxBeats) {
+    int beats = 0;
+    for (uint32_t t = firstMs; t < durationMs && beats < maxBeats; t += rrMs) {
+        rPeakMs[beats++] = t;
+    }
+    return beats;
+}
+
+#endif // SYNTHETIC_ECG_H
@@ -0,0 +1,138 @@
+/**
+ * ElderGuard - Synthetic IMU traces for the native tests
+ *
+ * Accelerometer (m/s^2) and gyro (rad/s) samples for a few labelled
+ * motions, generated at any sample rate from the same continuous-time
+ * description so a detector can be compared across rates. The true roll
+ * angle is returned with every sample.
+ */
+
+#ifndef SYNTHETIC_IMU_H
+#define SYNTHETIC_IMU_H
+
+#include <math.h>
+#include <stdint.h>
+
+#define SYNTHETIC_GRAVITY 9.80665f
+
+typedef enum {
+    SYNTHETIC_STILL,             // Upright and at rest
+    SYNTHETIC_FALL,              // Tumbling free fall, impact, lying on the side
+    SYNTHETIC_STUMBLE,           // Short dip and a light thump, stays upright
+    SYNTHETIC_SIT_DOWN,          // Drop onto a chair, leans back a little, fidgets
+    SYNTHETIC_SLOW_LOWERING      // Long low-g phase with no impact
+} SyntheticMotion;
+
+typedef struct {
+    SyntheticMotion motion;
+    int sampleRateHz;
+    uint32_t startMs;            // When the motion starts
+    float freefallG;             // Acceleration magnitude during the fall phase (g)
+    uint32_t freefallMs;
+    float impactG;               // Along gravity during the impact
+    float shockG;                // Sideways during the impact
+    uint32_t impactMs;
+    float tumbleDegPerS;         // Roll rate during the fall phase
+    uint32_t getUpMs;            // 0 = stays down; otherwise time the person stands up
+    float jitter;                // Accelerometer noise amplitude (m/s^2)
+} SyntheticImuConfig;
+
+typedef struct {
+    float ax, ay, az;
+    float gx, gy, gz;
+    float trueRoll;              // Degrees
+} SyntheticImuSample;
+
+static inline SyntheticImuConfig syntheticImuDefaults(SyntheticMotion motion, int sampleRateHz) {
+    SyntheticImuConfig config;
+    config.motion = motion;
+    config.sampleRateHz = sampleRateHz;
+    config.startMs = 1000;
+    config.freefallG = 0.3f;
+    config.freefallMs = 400;
+    config.impactG = 3.0f;
+    config.shockG = 2.0f;
+    config.impactMs = 50;
+    config.tumbleDegPerS = 200.0f;
+    config.getUpMs = 0;
+    config.jitter = 0.1f;
+    switch (motion) {
+        case SYNTHETIC_STUMBLE:
+            config.freefallG = 0.5f;
+            config.freefallMs = 100;
+            config.impactG = 2.0f;
+            config.shockG = 0;
+            config.tumbleDegPerS = 0;
+            break;
+        case SYNTHETIC_SIT_DOWN:
+            config.freefallG = 0.5f;
+            config.freefallMs = 120;
+            config.impactG = 2.0f;
+            config.shockG = 0;
+            config.impactMs = 30;
+            config.tumbleDegPerS = 0;
+            break;
+        case SYNTHETIC_SLOW_LOWERING:
+            config.freefallG = 0.5f;
+            config.freefallMs = 1500;
+            config.tumbleDegPerS = 0;
+            break;
+        default:
+            break;
+    }
+    return config;
+}
+
+/**
+ * Fill count samples from t = 0
+ */
+static inline void syntheticImu(const SyntheticImuConfig &config, SyntheticImuSample *samples, int count) {
+    const float dt = 1.0f / config.sampleRateHz;
+    const float degToRad = 0.017453292f;
+    uint32_t noise = 12345;
+    float roll = 0;
+
+    for (int i = 0; i < count; i++) {
+        float t = i * 1000.0f / config.sampleRateHz;
+        float since = t - config.startMs;
+        noise = noise * 1103515245 + 12345;
+        float jitter = ((int)((noise >> 16) % 41) - 20) / 20.0f * config.jitter;
+
+        SyntheticImuSample &s = samples[i];
+        s.ax = 0;
+        s.gx = s.gy = s.gz = 0;
+        float magnitude = 1.0f;
+        float shock = 0;
+
+        bool active = config.motion != SYNTHETIC_STILL && since >= 0;
+        if (active && since < config.freefallMs) {
+            magnitude = config.freefallG;
+            s.gx = config.tumbleDegPerS * degToRad;
+        } else if (active && config.motion != SYNTHETIC_SLOW_LOWERING &&
+                   since < config.freefallMs + config.impactMs) {
+            magnitude = config.impactG;
+            shock = config.shockG * SYNTHETIC_GRAVITY;
+        } else if (active && config.motion == SYNTHETIC_SIT_DOWN) {
+            // Lean back 10 degrees over 100ms, then fidget
+            float after = since - config.freefallMs - config.impactMs;
+            if (after < 100) {
+                s.gx = 100.0f * degToRad;
+            } else {
+                magnitude += 0.08f * sinf(t * 0.02f);
+            }
+        } else if (active && config.getUpMs > 0 && t >= config.getUpMs && roll > 0) {
+            s.gx = -80.0f * degToRad;
+        }
+
+        roll += s.gx * dt;
+        if (roll < 0) {
+            roll = 0;
+        }
+        s.ay = magnitude * SYNTHETIC_GRAVITY * sinf(roll) + shock + jitter;
+        s.az = magnitude * SYNTHETIC_GRAVITY * cosf(roll);
+        s.gx += jitter * 0.01f;
+        s.trueRoll = roll / degToRad;
+    }
+}
+
+#endif // SYNTHETIC_IMU_H
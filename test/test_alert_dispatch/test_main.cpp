@@ -0,0 +1,171 @@
+/**
+ * ElderGuard - Alert dispatch native tests
+ *
+ * A sampler thread runs the ECG task's block loop: wait for the next block
+ * period, run the detector and publish a heart rate alert every few
+ * blocks. A second thread plays the HTTP task, taking alerts off the topic
+ * and then sitting in a slow delivery, or never taking them at all. The
+ * sampler's worst-case period must stay within budget either way.
+ */
+
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unity.h>
+#include "globals.h"
+#include "ecg_processor.h"
+#include "../synthetic_ecg.h"
+
+#define BLOCK_PERIOD_MS (ECG_BLOCK_SIZE * 1000 / ECG_SAMPLE_RATE_HZ)
+#define RUN_BLOCKS 30
+#define ALERT_EVERY_BLOCKS 3
+#define DELIVERY_MS (3 * BLOCK_PERIOD_MS) // A POST running into its timeout, scaled down
+#define PERIOD_JITTER_MS (BLOCK_PERIOD_MS / 2) // Host scheduling, not the firmware's
+#define PUBLISH_BUDGET_US 5000
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct {
+    long worstPeriodUs;
+    long worstBusyUs;
+    long worstPublishUs;
+    int published;
+    int queued;
+} SamplerResult;
+
+static int ecgSignal[RUN_BLOCKS * ECG_BLOCK_SIZE];
+
+void setUp() {
+  uint32_t peaks[16];
+  int beats = syntheticConstantRr(400, 750, RUN_BLOCKS * BLOCK_PERIOD_MS, peaks, 16);
+  syntheticEcg(syntheticEcgDefaults(ECG_SAMPLE_RATE_HZ), peaks, beats, ecgSignal, RUN_BLOCKS * ECG_BLOCK_SIZE);
+}
+
+void tearDown() {}
+
+static long elapsedUs(Clock::time_point from, Clock::time_point to) {
+  return (long)std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+// The ECG task loop, with vTaskDelayUntil() as sleep_until()
+static SamplerResult runSampler(TelegramAlertTopic &topic) {
+  SamplerResult result = {};
+  EcgProcessor processor(ECG_SAMPLE_RATE_HZ, ECG_DETECTOR_MODE);
+  EcgBeat beats[4];
+
+  Clock::time_point next = Clock::now();
+  Clock::time_point lastWake = next;
+  for (int block = 0; block < RUN_BLOCKS; block++) {
+    next += std::chrono::milliseconds(BLOCK_PERIOD_MS);
+    std::this_thread::sleep_until(next);
+    Clock::time_point wake = Clock::now();
+    if (block > 0) {
+      result.worstPeriodUs = std::max(result.worstPeriodUs, elapsedUs(lastWake, wake));
+    }
+    lastWake = wake;
+
+    processor.processBlock(&ecgSignal[block * ECG_BLOCK_SIZE], ECG_BLOCK_SIZE, beats, 4);
+
+    if (block % ALERT_EVERY_BLOCKS == 0) {
+      TelegramAlert alert;
+      alert.kind = ALERT_HEALTH;
+      alert.hasFallLocation = false;
+      snprintf(alert.message, sizeof(alert.message),
+               "HEART RATE DROP DETECTED!\nPrevious: %d BPM\nCurrent: %d BPM", 80, 50 - block);
+      Clock::time_point postStart = Clock::now();
+      result.queued += topic.publish(alert);
+      result.worstPublishUs = std::max(result.worstPublishUs, elapsedUs(postStart, Clock::now()));
+      result.published++;
+    }
+
+    result.worstBusyUs = std::max(result.worstBusyUs, elapsedUs(wake, Clock::now()));
+  }
+  return result;
+}
+
+static void reportResult(const char *name, const SamplerResult &result) {
+  char line[128];
+  snprintf(line, sizeof(line), "%s: worst period %ld us, busy %ld us, publish %ld us (budget %d ms)",
+           name, result.worstPeriodUs, result.worstBusyUs, result.worstPublishUs, BLOCK_PERIOD_MS);
+  TEST_MESSAGE(line);
+}
+
+static void assertWithinBudget(const SamplerResult &result) {
+  TEST_ASSERT_LESS_THAN(PUBLISH_BUDGET_US, result.worstPublishUs);
+  TEST_ASSERT_LESS_THAN(BLOCK_PERIOD_MS * 1000L, result.worstBusyUs);
+  TEST_ASSERT_LESS_OR_EQUAL((BLOCK_PERIOD_MS + PERIOD_JITTER_MS) * 1000L, result.worstPeriodUs);
+}
+
+static void test_period_holds_while_an_alert_is_delivered() {
+  static TelegramAlertTopic topic;
+  std::atomic<bool> subscribed(false), stop(false);
+  std::atomic<int> delivered(0), wrongKind(0);
+
+  // Same depth and notification as the HTTP task
+  std::thread http([&] {
+    int subscriber = topic.subscribe(TELEGRAM_QUEUE_HTTP, EVENT_TELEGRAM_ALERT);
+    subscribed = true;
+    while (!stop) {
+      waitForEvents(pdMS_TO_TICKS(20));
+      const TelegramAlert *alert;
+      while ((alert = topic.receive(subscriber)) != NULL) {
+        TelegramAlert received = *alert;
+        topic.release(alert);
+        wrongKind += received.kind != ALERT_HEALTH;
+        std::this_thread::sleep_for(std::chrono::milliseconds(DELIVERY_MS));
+        delivered++;
+      }
+    }
+  });
+  while (!subscribed) {
+    std::this_thread::yield();
+  }
+
+  SamplerResult result = runSampler(topic);
+  stop = true;
+  http.join();
+
+  reportResult("slow delivery", result);
+  assertWithinBudget(result);
+  TEST_ASSERT_EQUAL(result.published, result.queued);
+  // Delivery ran alongside sampling, not inside it
+  TEST_ASSERT_GREATER_THAN(0, delivered.load());
+  TEST_ASSERT_EQUAL(0, wrongKind.load());
+  TEST_ASSERT_LESS_THAN(DELIVERY_MS * 1000L, result.worstPeriodUs);
+}
+
+static void test_period_holds_while_the_network_hangs() {
+  static TelegramAlertTopic topic;
+  std::atomic<bool> subscribed(false), stop(false);
+
+  // Subscribed but stuck in a request for the whole run
+  std::thread http([&] {
+    topic.subscribe(TELEGRAM_QUEUE_HTTP, EVENT_TELEGRAM_ALERT);
+    subscribed = true;
+    while (!stop) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  });
+  while (!subscribed) {
+    std::this_thread::yield();
+  }
+
+  SamplerResult result = runSampler(topic);
+  stop = true;
+  http.join();
+
+  reportResult("hung network", result);
+  assertWithinBudget(result);
+  // The oldest undelivered alerts make way; the slots always cover the
+  // subscriber's depth, so publishing itself never fails
+  TEST_ASSERT_EQUAL(result.published, result.queued);
+  TEST_ASSERT_EQUAL_UINT32(0, topic.getDropped());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_period_holds_while_an_alert_is_delivered);
+  RUN_TEST(test_period_holds_while_the_network_hangs);
+  return UNITY_END();
+}
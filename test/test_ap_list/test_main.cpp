@@ -0,0 +1,193 @@
+/**
+ * ElderGuard - AccessPointList native tests
+ *
+ * Network choice from scans, roaming, the cached access point and the
+ * stored blob, including the index shifts a removal causes.
+ */
+
+#include <string.h>
+#include <unity.h>
+#include "ap_list.h"
+
+static AccessPointList *networks;
+
+void setUp() {
+  networks = new AccessPointList();
+}
+
+void tearDown() {
+  delete networks;
+}
+
+static ApScanResult scanResult(const char *ssid, int bssidTail, int channel, int rssi) {
+  ApScanResult result;
+  memset(&result, 0, sizeof(result));
+  strcpy(result.ssid, ssid);
+  result.bssid[5] = (uint8_t)bssidTail;
+  result.channel = (uint8_t)channel;
+  result.rssi = (int8_t)rssi;
+  return result;
+}
+
+static void test_add_update_and_limits() {
+  TEST_ASSERT_TRUE(networks->add("home", "pw", 1));
+  TEST_ASSERT_TRUE(networks->add("clinic", "pw2", 5));
+  TEST_ASSERT_TRUE(networks->add("home", "pw", 2));
+  TEST_ASSERT_EQUAL(2, networks->getCount());
+  TEST_ASSERT_EQUAL(2, networks->get(0).priority);
+  TEST_ASSERT_EQUAL(1, networks->find("clinic"));
+  TEST_ASSERT_EQUAL(-1, networks->find("other"));
+
+  // 32 characters fit, 33 do not
+  TEST_ASSERT_TRUE(networks->add("01234567890123456789012345678901", "x", 0));
+  TEST_ASSERT_FALSE(networks->add("012345678901234567890123456789012", "x", 0));
+
+  char ssid[16];
+  for (int i = networks->getCount(); i < AP_LIST_MAX; i++) {
+    snprintf(ssid, sizeof(ssid), "net%d", i);
+    TEST_ASSERT_TRUE(networks->add(ssid, "pw", 0));
+  }
+  TEST_ASSERT_FALSE(networks->add("one-too-many", "pw", 0));
+  // Updating a known network still works with the list full
+  TEST_ASSERT_TRUE(networks->add("home", "pw", 3));
+}
+
+static void test_best_network_from_a_scan() {
+  networks->add("home", "pw", 1);
+  networks->add("clinic", "pw2", 5);
+  ApScanResult results[4] = {
+    scanResult("other", 1, 1, -30),
+    scanResult("home", 2, 6, -50),
+    scanResult("clinic", 3, 11, -85),
+    scanResult("home", 4, 1, -60),
+  };
+
+  // The preferred network is too weak to use: the strongest usable one wins
+  int result;
+  TEST_ASSERT_EQUAL(0, networks->selectBest(results, 4, &result));
+  TEST_ASSERT_EQUAL(1, result);
+
+  // Usable: priority beats signal
+  results[2].rssi = -70;
+  TEST_ASSERT_EQUAL(1, networks->selectBest(results, 4, &result));
+  TEST_ASSERT_EQUAL(2, result);
+
+  // Nothing known in range
+  TEST_ASSERT_EQUAL(-1, networks->selectBest(results, 1, &result));
+  TEST_ASSERT_EQUAL(-1, result);
+}
+
+static void test_roam_target_needs_the_hysteresis() {
+  networks->add("home", "pw", 1);
+  networks->add("clinic", "pw2", 5);
+  ApScanResult results[3] = {
+    scanResult("home", 2, 6, -75),
+    scanResult("home", 4, 1, -60),
+    scanResult("clinic", 3, 11, -70),
+  };
+  uint8_t current[6] = { 0, 0, 0, 0, 0, 2 };
+
+  int result;
+  TEST_ASSERT_EQUAL(0, networks->selectRoamTarget(results, 3, current, -75, 8, &result));
+  TEST_ASSERT_EQUAL(1, result);
+
+  // 7 dB stronger is not enough for a hysteresis of 8
+  TEST_ASSERT_EQUAL(-1, networks->selectRoamTarget(results, 3, current, -67, 8, &result));
+  TEST_ASSERT_EQUAL(0, networks->selectRoamTarget(results, 3, current, -68, 8, &result));
+
+  // The access point in use is never a target
+  results[1].bssid[5] = 2;
+  TEST_ASSERT_EQUAL(1, networks->selectRoamTarget(results, 3, current, -80, 8, &result));
+  TEST_ASSERT_EQUAL(2, result);
+}
+
+static void test_fast_connect_remember_and_forget() {
+  networks->add("home", "pw", 1);
+  networks->add("clinic", "pw2", 5);
+  const uint8_t bssid[6] = { 1, 2, 3, 4, 5, 6 };
+  TEST_ASSERT_EQUAL(-1, networks->getFastConnect());
+
+  TEST_ASSERT_TRUE(networks->remember(1, bssid, 11));
+  TEST_ASSERT_FALSE(networks->remember(1, bssid, 11));
+  TEST_ASSERT_EQUAL(1, networks->getFastConnect());
+  TEST_ASSERT_EQUAL_MEMORY(bssid, networks->get(1).bssid, 6);
+  TEST_ASSERT_EQUAL(11, networks->get(1).channel);
+
+  // forget() reports a change only once, so it is stored only once
+  TEST_ASSERT_TRUE(networks->forget(1));
+  TEST_ASSERT_FALSE(networks->forget(1));
+  TEST_ASSERT_EQUAL(-1, networks->getFastConnect());
+
+  // A new password drops the cached access point
+  networks->remember(1, bssid, 11);
+  TEST_ASSERT_TRUE(networks->add("clinic", "pw2", 2));
+  TEST_ASSERT_EQUAL(1, networks->getFastConnect());
+  TEST_ASSERT_TRUE(networks->add("clinic", "new", 2));
+  TEST_ASSERT_EQUAL(-1, networks->getFastConnect());
+}
+
+// What the WiFi task does when a network is removed mid-attempt: the
+// attempt is tracked by SSID and looked up again afterwards
+static void test_removal_shifts_indices() {
+  networks->add("a", "pw", 0);
+  networks->add("b", "pw", 0);
+  networks->add("c", "pw", 0);
+  const uint8_t bssid[6] = { 9, 9, 9, 9, 9, 9 };
+  networks->remember(2, bssid, 6);
+
+  int attempt = networks->find("c");
+  TEST_ASSERT_TRUE(networks->remove("a"));
+
+  // The old index now points past the list; the name still finds "c"
+  TEST_ASSERT_EQUAL(2, networks->getCount());
+  TEST_ASSERT_EQUAL(1, networks->find("c"));
+  TEST_ASSERT_NOT_EQUAL(attempt, networks->find("c"));
+  TEST_ASSERT_EQUAL(1, networks->getFastConnect());
+  TEST_ASSERT_EQUAL_STRING("c", networks->get(networks->getFastConnect()).ssid);
+
+  // Removing the network being joined leaves nothing to remember it in
+  TEST_ASSERT_TRUE(networks->remove("c"));
+  TEST_ASSERT_EQUAL(-1, networks->find("c"));
+  TEST_ASSERT_EQUAL(-1, networks->getFastConnect());
+  TEST_ASSERT_FALSE(networks->remove("c"));
+}
+
+static void test_blob_round_trip_and_rejects() {
+  networks->add("home", "pw", 1);
+  networks->add("clinic", "pw2", 5);
+  const uint8_t bssid[6] = { 1, 2, 3, 4, 5, 6 };
+  networks->remember(0, bssid, 6);
+
+  AccessPointList restored;
+  TEST_ASSERT_TRUE(restored.restore(networks->getBlob(), networks->getBlobSize()));
+  TEST_ASSERT_EQUAL(2, restored.getCount());
+  TEST_ASSERT_EQUAL(0, restored.getFastConnect());
+  TEST_ASSERT_EQUAL_STRING("clinic", restored.get(1).ssid);
+  TEST_ASSERT_EQUAL_STRING("pw2", restored.get(1).password);
+
+  // Wrong size, another layout version, or an out-of-range count
+  TEST_ASSERT_FALSE(restored.restore(networks->getBlob(), 3));
+  uint8_t blob[sizeof(AccessPointList)];
+  int size = networks->getBlobSize();
+  TEST_ASSERT_LESS_OR_EQUAL((int)sizeof(blob), size);
+  memcpy(blob, networks->getBlob(), size);
+  blob[0] ^= 1;
+  TEST_ASSERT_FALSE(restored.restore(blob, size));
+  memcpy(blob, networks->getBlob(), size);
+  blob[4] = AP_LIST_MAX + 1;
+  TEST_ASSERT_FALSE(restored.restore(blob, size));
+
+  // A failed restore leaves the list as it was
+  TEST_ASSERT_EQUAL(2, restored.getCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_add_update_and_limits);
+  RUN_TEST(test_best_network_from_a_scan);
+  RUN_TEST(test_roam_target_needs_the_hysteresis);
+  RUN_TEST(test_fast_connect_remember_and_forget);
+  RUN_TEST(test_removal_shifts_indices);
+  RUN_TEST(test_blob_round_trip_and_rejects);
+  return UNITY_END();
+}
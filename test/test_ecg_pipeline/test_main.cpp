@@ -0,0 +1,231 @@
+/**
+ * ElderGuard - ECG block pipeline replay tests
+ *
+ * Recordings are replayed block by block through EcgPipeline, the entry
+ * point the ECG task calls for every captured block, with the firmware's
+ * sample rate, block size, detector and HRV window. A recording is a text
+ * file of raw ADC samples, one per line; lines starting with '#' are
+ * comments. The tests write recordings of known RR sequences and check the
+ * heart rate, HRV and drop alerts that come out. Setting
+ * ECG_REPLAY_RECORDING to a recording of the same rate also replays it and
+ * reports what the pipeline made of it:
+ *
+ *   ECG_REPLAY_RECORDING=ecg.txt pio test -e native -f test_ecg_pipeline -v
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <unity.h>
+#include "ecg_pipeline.h"
+#include "config.h"
+#include "../synthetic_ecg.h"
+
+#define RECORDING_PATH "/tmp/elderguard_ecg_recording.txt"
+
+typedef struct {
+    int validBeats;        // Beats with an RR interval
+    int drops;
+    HeartRateDrop lastDrop;
+} ReplayResult;
+
+// The ECG task's state, fresh for each test
+static EcgSampleRing *ring;
+static EcgProcessor *processor;
+static HrvEngine *hrv;
+static EcgPipeline *pipeline;
+
+void setUp() {
+  ring = new EcgSampleRing();
+  processor = new EcgProcessor(ECG_SAMPLE_RATE_HZ, ECG_DETECTOR_MODE);
+  hrv = new HrvEngine(HRV_WINDOW_MS);
+  pipeline = new EcgPipeline(*ring, *processor, *hrv);
+}
+
+void tearDown() {
+  delete pipeline;
+  delete hrv;
+  delete processor;
+  delete ring;
+}
+
+static void writeRecording(const char *path, const std::vector<uint32_t> &rPeakMs, uint32_t durationMs) {
+  std::vector<int> samples(durationMs * ECG_SAMPLE_RATE_HZ / 1000);
+  syntheticEcg(syntheticEcgDefaults(ECG_SAMPLE_RATE_HZ), rPeakMs.data(), (int)rPeakMs.size(),
+               samples.data(), (int)samples.size());
+  FILE *file = fopen(path, "w");
+  TEST_ASSERT_NOT_NULL(file);
+  fprintf(file, "# ElderGuard ECG recording, %d Hz\n", ECG_SAMPLE_RATE_HZ);
+  for (size_t i = 0; i < samples.size(); i++) {
+    fprintf(file, "%d\n", samples[i]);
+  }
+  fclose(file);
+}
+
+static bool loadRecording(const char *path, std::vector<int> *samples) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    return false;
+  }
+  char line[64];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (line[0] != '#' && line[0] != '\n') {
+      samples->push_back(atoi(line));
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+// Feed samples in capture-sized blocks, as the ECG task does
+static ReplayResult replay(const std::vector<int> &samples, size_t from, size_t to) {
+  ReplayResult result = {};
+  EcgBeat beats[ECG_MAX_BEATS_PER_BLOCK];
+  for (size_t i = from; i + ECG_BLOCK_SIZE <= to; i += ECG_BLOCK_SIZE) {
+    int n = pipeline->processBlock(&samples[i], ECG_BLOCK_SIZE, beats, ECG_MAX_BEATS_PER_BLOCK);
+    for (int b = 0; b < n; b++) {
+      result.validBeats += beats[b].rrInterval > 0;
+    }
+    if (pipeline->takeHeartRateDrop(&result.lastDrop)) {
+      result.drops++;
+    }
+  }
+  return result;
+}
+
+// R peaks from 500 ms on with RR intervals from rrAt(beat)
+template <typename F>
+static std::vector<uint32_t> peaksFor(uint32_t durationMs, F rrAt) {
+  std::vector<uint32_t> peaks;
+  uint32_t t = 500;
+  for (int beat = 0; t < durationMs; beat++) {
+    peaks.push_back(t);
+    t += rrAt(beat, t);
+  }
+  return peaks;
+}
+
+static void test_replay_reports_heart_rate_and_hrv() {
+  // Respiratory sinus arrhythmia: 800 ms +/- 40 ms over eight beats
+  const uint32_t durationMs = 150000;
+  std::vector<uint32_t> peaks = peaksFor(durationMs, [](int beat, uint32_t) {
+    return (uint32_t)lround(800 + 40 * sin(2 * M_PI * beat / 8));
+  });
+  writeRecording(RECORDING_PATH, peaks, durationMs);
+  std::vector<int> samples;
+  TEST_ASSERT_TRUE(loadRecording(RECORDING_PATH, &samples));
+
+  ReplayResult result = replay(samples, 0, samples.size());
+
+  // Expected metrics straight from the RR sequence
+  double sum = 0, sumSquares = 0, sumSquaredDiffs = 0;
+  int intervals = (int)peaks.size() - 1;
+  for (int i = 1; i <= intervals; i++) {
+    double rr = (double)peaks[i] - peaks[i - 1];
+    sum += rr;
+    sumSquares += rr * rr;
+    if (i > 1) {
+      double diff = rr - ((double)peaks[i - 1] - peaks[i - 2]);
+      sumSquaredDiffs += diff * diff;
+    }
+  }
+  double mean = sum / intervals;
+  double sdnn = sqrt(sumSquares / intervals - mean * mean);
+  double rmssd = sqrt(sumSquaredDiffs / (intervals - 1));
+
+  TEST_ASSERT_INT_WITHIN(2, 75, processor->getHeartRate());
+  TEST_ASSERT_INT_WITHIN(4, intervals, result.validBeats);
+
+  HrvMetrics metrics;
+  hrv->getMetrics(&metrics);
+  TEST_ASSERT_GREATER_OR_EQUAL(HRV_MIN_INTERVALS, metrics.intervals);
+  TEST_ASSERT_FLOAT_WITHIN(3.0, sdnn, metrics.sdnn);
+  TEST_ASSERT_FLOAT_WITHIN(3.0, rmssd, metrics.rmssd);
+  TEST_ASSERT_LESS_THAN(5.0f, metrics.pnn50);
+
+  // Every sample reached the ring, and nothing looked like a drop
+  TEST_ASSERT_EQUAL_UINT32(samples.size() / ECG_BLOCK_SIZE * ECG_BLOCK_SIZE, ring->getHead());
+  TEST_ASSERT_EQUAL(0, result.drops);
+}
+
+static void test_heart_rate_drop_is_reported_once() {
+  // 100 BPM, then 60 BPM from 75 s, past the first alert cooldown
+  const uint32_t durationMs = 110000;
+  std::vector<uint32_t> peaks = peaksFor(durationMs, [](int, uint32_t t) {
+    return t < 75000 ? 600u : 1000u;
+  });
+  writeRecording(RECORDING_PATH, peaks, durationMs);
+  std::vector<int> samples;
+  TEST_ASSERT_TRUE(loadRecording(RECORDING_PATH, &samples));
+
+  ReplayResult result = replay(samples, 0, samples.size());
+
+  TEST_ASSERT_EQUAL(1, result.drops);
+  TEST_ASSERT_INT_WITHIN(3, 100, result.lastDrop.previousBpm);
+  TEST_ASSERT_LESS_THAN(result.lastDrop.previousBpm - HEART_RATE_DROP_THRESHOLD, result.lastDrop.currentBpm);
+  TEST_ASSERT_GREATER_THAN(75000, result.lastDrop.timeMs);
+  TEST_ASSERT_LESS_THAN(75000 + HEART_RATE_STABLE_MS, result.lastDrop.timeMs);
+  TEST_ASSERT_INT_WITHIN(2, 60, processor->getHeartRate());
+
+  HeartRateDrop drop;
+  TEST_ASSERT_FALSE(pipeline->takeHeartRateDrop(&drop));
+}
+
+static void test_leads_off_clears_the_heart_rate() {
+  const uint32_t durationMs = 60000;
+  std::vector<uint32_t> peaks = peaksFor(durationMs, [](int, uint32_t) { return 800u; });
+  writeRecording(RECORDING_PATH, peaks, durationMs);
+  std::vector<int> samples;
+  TEST_ASSERT_TRUE(loadRecording(RECORDING_PATH, &samples));
+
+  // 25 s connected, 5 s of leads off, then connected again
+  size_t offFrom = 25 * ECG_SAMPLE_RATE_HZ;
+  size_t offTo = 30 * ECG_SAMPLE_RATE_HZ;
+  replay(samples, 0, offFrom);
+  TEST_ASSERT_INT_WITHIN(2, 75, processor->getHeartRate());
+
+  uint32_t clockBefore = processor->getSampleTimeMs();
+  int cleared = 0;
+  for (size_t i = offFrom; i < offTo; i += ECG_BLOCK_SIZE) {
+    cleared += pipeline->leadsOff(&samples[i], ECG_BLOCK_SIZE);
+  }
+  TEST_ASSERT_EQUAL(1, cleared);
+  TEST_ASSERT_EQUAL(0, processor->getHeartRate());
+  TEST_ASSERT_EQUAL_UINT32(5000, processor->getSampleTimeMs() - clockBefore);
+  TEST_ASSERT_EQUAL_UINT32(offTo, ring->getHead());
+
+  // Back on: the rate returns and the gap is not taken for a drop
+  ReplayResult result = replay(samples, offTo, samples.size());
+  TEST_ASSERT_INT_WITHIN(2, 75, processor->getHeartRate());
+  TEST_ASSERT_EQUAL(0, result.drops);
+}
+
+static void test_replay_recording_from_file() {
+  const char *path = getenv("ECG_REPLAY_RECORDING");
+  if (path == NULL) {
+    TEST_IGNORE_MESSAGE("ECG_REPLAY_RECORDING not set");
+    return;
+  }
+  std::vector<int> samples;
+  TEST_ASSERT_TRUE_MESSAGE(loadRecording(path, &samples), "cannot read ECG_REPLAY_RECORDING");
+  ReplayResult result = replay(samples, 0, samples.size());
+
+  HrvMetrics metrics;
+  hrv->getMetrics(&metrics);
+  char line[200];
+  snprintf(line, sizeof(line),
+           "%s: %d s, %d beats, HR %d BPM, SDNN %.1f ms, RMSSD %.1f ms, pNN50 %.1f%% over %d intervals, %d drops",
+           path, (int)(samples.size() / ECG_SAMPLE_RATE_HZ), result.validBeats, processor->getHeartRate(),
+           metrics.sdnn, metrics.rmssd, metrics.pnn50, metrics.intervals, result.drops);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_replay_reports_heart_rate_and_hrv);
+  RUN_TEST(test_heart_rate_drop_is_reported_once);
+  RUN_TEST(test_leads_off_clears_the_heart_rate);
+  RUN_TEST(test_replay_recording_from_file);
+  return UNITY_END();
+}
@@ -0,0 +1,150 @@
+/**
+ * ElderGuard - EcgProcessor native tests
+ *
+ * Runs both QRS detectors over synthetic ECG and reports their throughput
+ * on the host.
+ */
+
+#include <chrono>
+#include <unity.h>
+#include "ecg_processor.h"
+#include "../synthetic_ecg.h"
+
+#define RATE_HZ 250
+#define BLOCK_SIZE 25
+#define DURATION_S 60
+
+static int signal[DURATION_S * RATE_HZ];
+static uint32_t rPeaks[DURATION_S * 4];
+static int rPeakCount;
+
+void setUp() {
+  SyntheticEcgConfig config = syntheticEcgDefaults(RATE_HZ);
+  rPeakCount = syntheticConstantRr(500, 800, DURATION_S * 1000, rPeaks, DURATION_S * 4);
+  syntheticEcg(config, rPeaks, rPeakCount, signal, DURATION_S * RATE_HZ);
+}
+
+void tearDown() {}
+
+/**
+ * Run a whole recording through a processor in blocks
+ *
+ * @return Number of beats found
+ */
+static int runDetector(EcgProcessor &processor, int blockSize, EcgBeat *allBeats, int maxBeats) {
+  int found = 0;
+  EcgBeat beats[ECG_MAX_BEATS_PER_BLOCK];
+  for (int i = 0; i < DURATION_S * RATE_HZ; i += blockSize) {
+    int n = processor.processBlock(&signal[i], blockSize, beats, ECG_MAX_BEATS_PER_BLOCK);
+    for (int b = 0; b < n && found < maxBeats; b++) {
+      allBeats[found++] = beats[b];
+    }
+  }
+  return found;
+}
+
+static void checkDetector(EcgDetectorMode mode) {
+  EcgProcessor processor(RATE_HZ, mode);
+  static EcgBeat beats[DURATION_S * 4];
+  int found = runDetector(processor, BLOCK_SIZE, beats, DURATION_S * 4);
+
+  // Both detectors need a couple of seconds to learn the signal
+  TEST_ASSERT_INT_WITHIN(3, rPeakCount, found);
+  TEST_ASSERT_INT_WITHIN(2, 75, processor.getHeartRate());
+
+  uint32_t rrSum = 0;
+  int validRr = 0;
+  for (int i = 0; i < found; i++) {
+    if (beats[i].timeMs > 5000 && beats[i].rrInterval > 0) {
+      rrSum += beats[i].rrInterval;
+      validRr++;
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(rPeakCount - 10, validRr);
+  TEST_ASSERT_INT_WITHIN(5, 800, rrSum / validRr);
+}
+
+static void test_legacy_detects_every_beat() {
+  checkDetector(ECG_DETECTOR_LEGACY);
+}
+
+static void test_pan_tompkins_detects_every_beat() {
+  checkDetector(ECG_DETECTOR_PAN_TOMPKINS);
+}
+
+static void test_result_does_not_depend_on_block_size() {
+  EcgDetectorMode modes[2] = { ECG_DETECTOR_LEGACY, ECG_DETECTOR_PAN_TOMPKINS };
+  for (int m = 0; m < 2; m++) {
+    static EcgBeat whole[DURATION_S * 4];
+    static EcgBeat single[DURATION_S * 4];
+    EcgProcessor blocks(RATE_HZ, modes[m]);
+    EcgProcessor samples(RATE_HZ, modes[m]);
+    int wholeCount = runDetector(blocks, 250, whole, DURATION_S * 4);
+    int singleCount = runDetector(samples, 1, single, DURATION_S * 4);
+
+    TEST_ASSERT_EQUAL_INT(wholeCount, singleCount);
+    for (int i = 0; i < wholeCount; i++) {
+      TEST_ASSERT_EQUAL_UINT32(whole[i].timeMs, single[i].timeMs);
+      TEST_ASSERT_EQUAL_UINT32(whole[i].rrInterval, single[i].rrInterval);
+      TEST_ASSERT_EQUAL_INT(whole[i].heartRate, single[i].heartRate);
+    }
+  }
+}
+
+static void test_heart_rate_times_out_without_beats() {
+  EcgProcessor processor(RATE_HZ, ECG_DETECTOR_PAN_TOMPKINS);
+  EcgBeat beats[ECG_MAX_BEATS_PER_BLOCK];
+  processor.processBlock(signal, 20 * RATE_HZ, beats, ECG_MAX_BEATS_PER_BLOCK);
+  TEST_ASSERT_GREATER_THAN(0, processor.getHeartRate());
+
+  static int flat[10 * RATE_HZ];
+  for (int i = 0; i < 10 * RATE_HZ; i++) {
+    flat[i] = 1900;
+  }
+  processor.processBlock(flat, 10 * RATE_HZ, beats, ECG_MAX_BEATS_PER_BLOCK);
+  TEST_ASSERT_EQUAL_INT(0, processor.getHeartRate());
+}
+
+static void test_skip_samples_advances_clock() {
+  EcgProcessor processor(RATE_HZ, ECG_DETECTOR_PAN_TOMPKINS);
+  EcgBeat beats[ECG_MAX_BEATS_PER_BLOCK];
+  processor.processBlock(signal, RATE_HZ, beats, ECG_MAX_BEATS_PER_BLOCK);
+  processor.skipSamples(RATE_HZ / 2);
+  TEST_ASSERT_EQUAL_UINT32(1500, processor.getSampleTimeMs());
+
+  processor.reset();
+  TEST_ASSERT_EQUAL_UINT32(0, processor.getSampleTimeMs());
+  TEST_ASSERT_EQUAL_INT(0, processor.getHeartRate());
+}
+
+static void test_throughput() {
+  EcgDetectorMode modes[2] = { ECG_DETECTOR_LEGACY, ECG_DETECTOR_PAN_TOMPKINS };
+  const char *names[2] = { "Legacy", "Pan-Tompkins" };
+  const int passes = 20;
+  for (int m = 0; m < 2; m++) {
+    EcgProcessor processor(RATE_HZ, modes[m]);
+    EcgBeat beats[ECG_MAX_BEATS_PER_BLOCK];
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+      for (int i = 0; i < DURATION_S * RATE_HZ; i += BLOCK_SIZE) {
+        processor.processBlock(&signal[i], BLOCK_SIZE, beats, ECG_MAX_BEATS_PER_BLOCK);
+      }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    char message[96];
+    snprintf(message, sizeof(message), "%s: %.1f Msamples/s", names[m],
+             passes * DURATION_S * RATE_HZ / seconds / 1e6);
+    TEST_MESSAGE(message);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_legacy_detects_every_beat);
+  RUN_TEST(test_pan_tompkins_detects_every_beat);
+  RUN_TEST(test_result_does_not_depend_on_block_size);
+  RUN_TEST(test_heart_rate_times_out_without_beats);
+  RUN_TEST(test_skip_samples_advances_clock);
+  RUN_TEST(test_throughput);
+  return UNITY_END();
+}
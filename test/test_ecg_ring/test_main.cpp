@@ -0,0 +1,130 @@
+/**
+ * ElderGuard - EcgSampleRing native tests
+ *
+ * Samples carry their own sequence number (mod 4096) so every read can be
+ * checked for gaps, duplicates and torn data.
+ */
+
+#include <atomic>
+#include <thread>
+#include <unity.h>
+#include "ecg_ring.h"
+
+static EcgSampleRing *ring;
+
+void setUp() {
+  ring = new EcgSampleRing();
+}
+
+void tearDown() {
+  delete ring;
+}
+
+static void writeSequence(uint32_t start, int count) {
+  int values[64];
+  while (count > 0) {
+    int n = count < 64 ? count : 64;
+    for (int i = 0; i < n; i++) {
+      values[i] = (int)((start + i) & 4095);
+    }
+    ring->write(values, n);
+    start += n;
+    count -= n;
+  }
+}
+
+static void test_consumers_read_independently() {
+  EcgRingCursor fast, slow;
+  ring->initCursor(&fast);
+  writeSequence(0, 100);
+  ring->initCursor(&slow);
+  writeSequence(100, 50);
+
+  int out[200];
+  TEST_ASSERT_EQUAL_INT(150, ring->read(&fast, out, 200));
+  for (int i = 0; i < 150; i++) {
+    TEST_ASSERT_EQUAL_INT(i, out[i]);
+  }
+
+  // A cursor only sees samples written after it was placed
+  TEST_ASSERT_EQUAL_INT(20, ring->read(&slow, out, 20));
+  TEST_ASSERT_EQUAL_INT(100, out[0]);
+  TEST_ASSERT_EQUAL_INT(30, ring->read(&slow, out, 200));
+  TEST_ASSERT_EQUAL_INT(120, out[0]);
+  TEST_ASSERT_EQUAL_INT(0, ring->read(&slow, out, 200));
+  TEST_ASSERT_EQUAL_UINT32(0, slow.dropped);
+}
+
+static void test_overrun_skips_and_counts() {
+  EcgRingCursor cursor;
+  ring->initCursor(&cursor);
+  writeSequence(0, ECG_RING_CAPACITY + 300);
+
+  static int out[ECG_RING_CAPACITY];
+  int got = ring->read(&cursor, out, ECG_RING_CAPACITY);
+  TEST_ASSERT_EQUAL_INT(ECG_RING_CAPACITY, got);
+  TEST_ASSERT_EQUAL_UINT32(300, cursor.dropped);
+  TEST_ASSERT_EQUAL_INT(300, out[0]);
+  TEST_ASSERT_EQUAL_INT((ECG_RING_CAPACITY + 299) & 4095, out[got - 1]);
+}
+
+static void test_read_newest_skips_without_counting() {
+  EcgRingCursor cursor;
+  ring->initCursor(&cursor);
+  writeSequence(0, 500);
+
+  int out[10];
+  TEST_ASSERT_EQUAL_INT(10, ring->readNewest(&cursor, out, 10));
+  TEST_ASSERT_EQUAL_INT(490, out[0]);
+  TEST_ASSERT_EQUAL_INT(499, out[9]);
+  TEST_ASSERT_EQUAL_UINT32(0, cursor.dropped);
+  TEST_ASSERT_EQUAL_UINT32(500, cursor.next);
+}
+
+// A reader racing the writer sees every sample once, in order, unless it
+// counts it as dropped
+static void test_concurrent_reader_sees_no_torn_samples() {
+  const uint32_t total = 2000000;
+  std::atomic<bool> done(false);
+  EcgRingCursor cursor;
+  ring->initCursor(&cursor);
+
+  std::thread writer([&]() {
+    writeSequence(0, total);
+    done.store(true);
+  });
+
+  uint32_t expected = 0;
+  uint32_t received = 0;
+  int errors = 0;
+  int out[300];
+  while (true) {
+    bool finished = done.load();
+    uint32_t droppedBefore = cursor.dropped;
+    int got = ring->read(&cursor, out, 300);
+    expected += cursor.dropped - droppedBefore;
+    for (int i = 0; i < got; i++) {
+      if (out[i] != (int)(expected & 4095)) {
+        errors++;
+      }
+      expected++;
+    }
+    received += got;
+    if (finished && got == 0) {
+      break;
+    }
+  }
+  writer.join();
+
+  TEST_ASSERT_EQUAL_INT(0, errors);
+  TEST_ASSERT_EQUAL_UINT32(total, received + cursor.dropped);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_consumers_read_independently);
+  RUN_TEST(test_overrun_skips_and_counts);
+  RUN_TEST(test_read_newest_skips_without_counting);
+  RUN_TEST(test_concurrent_reader_sees_no_torn_samples);
+  return UNITY_END();
+}
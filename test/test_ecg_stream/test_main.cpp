@@ -0,0 +1,233 @@
+/**
+ * ElderGuard - EcgBlockStream native tests
+ *
+ * Blocks are decoded as the backend would and compared with the samples
+ * written to the ring, including across ring overruns.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+#include "ecg_stream.h"
+
+#define RATE_HZ 250
+#define BLOCK_SAMPLES 250
+
+static EcgSampleRing *ring;
+static uint8_t out[4 * ecgStreamBlockMaxBytes(ECG_STREAM_MAX_BLOCK_SAMPLES)];
+
+// A decoded block
+typedef struct {
+    int rateHz;
+    int count;
+    uint32_t sequence;
+    uint32_t firstSample;
+    uint32_t lost;
+    int samples[ECG_STREAM_MAX_BLOCK_SAMPLES];
+    int bytes;
+} DecodedBlock;
+
+void setUp() {
+  ring = new EcgSampleRing();
+}
+
+void tearDown() {
+  delete ring;
+}
+
+// A beat-like shape so deltas range from small to large
+static int sampleAt(uint32_t n) {
+  float t = n / (float)RATE_HZ;
+  float phase = fmodf(t, 0.8f) - 0.4f;
+  return 2048 + (int)(600 * expf(-phase * phase / 0.0005f)) + (int)(20 * sinf(t * 6));
+}
+
+static void writeSamples(uint32_t *next, int count) {
+  int values[25];
+  while (count > 0) {
+    int n = count < 25 ? count : 25;
+    for (int i = 0; i < n; i++) {
+      values[i] = sampleAt((*next)++);
+    }
+    ring->write(values, n);
+    count -= n;
+  }
+}
+
+static uint32_t getUint32(const uint8_t *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void decodeBlock(const uint8_t *p, DecodedBlock *block) {
+  TEST_ASSERT_EQUAL_MEMORY("EGEB", p, 4);
+  TEST_ASSERT_EQUAL(1, p[4]);
+  block->rateHz = p[6] | p[7] << 8;
+  block->count = p[8] | p[9] << 8;
+  block->sequence = getUint32(&p[12]);
+  block->firstSample = getUint32(&p[16]);
+  block->lost = getUint32(&p[20]);
+
+  int pos = ECG_STREAM_HEADER_BYTES;
+  int value = (int16_t)(p[pos] | p[pos + 1] << 8);
+  pos += 2;
+  block->samples[0] = value;
+  for (int i = 1; i < block->count; i++) {
+    uint32_t zigzag = 0;
+    int shift = 0;
+    uint8_t c;
+    do {
+      c = p[pos++];
+      zigzag |= (uint32_t)(c & 0x7F) << shift;
+      shift += 7;
+    } while (c & 0x80);
+    value += (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+    block->samples[i] = value;
+  }
+  block->bytes = pos;
+}
+
+static void test_blocks_round_trip() {
+  EcgBlockStream stream(RATE_HZ, BLOCK_SAMPLES);
+  stream.begin(*ring);
+  uint32_t written = 0, expectedFirst = 0;
+  int totalBlocks = 0;
+  long totalBytes = 0;
+
+  for (int pass = 0; pass < 40; pass++) {
+    writeSamples(&written, 500);
+    int blocks;
+    int length = stream.readBlocks(*ring, out, sizeof(out), 4, &blocks);
+    TEST_ASSERT_EQUAL(2, blocks);
+
+    int pos = 0;
+    for (int b = 0; b < blocks; b++) {
+      DecodedBlock block;
+      decodeBlock(&out[pos], &block);
+      TEST_ASSERT_EQUAL(RATE_HZ, block.rateHz);
+      TEST_ASSERT_EQUAL(BLOCK_SAMPLES, block.count);
+      TEST_ASSERT_EQUAL_UINT32(totalBlocks, block.sequence);
+      TEST_ASSERT_EQUAL_UINT32(expectedFirst, block.firstSample);
+      TEST_ASSERT_EQUAL_UINT32(0, block.lost);
+      for (int i = 0; i < block.count; i++) {
+        TEST_ASSERT_EQUAL(sampleAt(block.firstSample + i), block.samples[i]);
+      }
+      TEST_ASSERT_LESS_OR_EQUAL(ecgStreamBlockMaxBytes(BLOCK_SAMPLES), block.bytes);
+      pos += block.bytes;
+      expectedFirst += block.count;
+      totalBlocks++;
+    }
+    TEST_ASSERT_EQUAL(length, pos);
+    totalBytes += length;
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(totalBlocks, stream.getBlockCount());
+  TEST_ASSERT_EQUAL_UINT32(0, stream.getDroppedCount());
+  // Delta coding keeps a 12-bit signal well under two bytes per sample
+  TEST_ASSERT_LESS_THAN(totalBlocks * BLOCK_SAMPLES * 3 / 2, totalBytes);
+}
+
+static void test_overrun_is_reported_and_blocks_stay_contiguous() {
+  EcgBlockStream stream(RATE_HZ, BLOCK_SAMPLES);
+  stream.begin(*ring);
+  uint32_t written = 0, expectedFirst = 0, expectedSequence = 0, lost = 0;
+
+  for (int pass = 0; pass < 10; pass++) {
+    // A partial block, then an overrun on pass 5
+    writeSamples(&written, pass == 5 ? ECG_RING_CAPACITY + 600 : 375);
+    int blocks;
+    int length = stream.readBlocks(*ring, out, sizeof(out), 4, &blocks);
+
+    int pos = 0;
+    for (int b = 0; b < blocks; b++) {
+      DecodedBlock block;
+      decodeBlock(&out[pos], &block);
+      TEST_ASSERT_EQUAL_UINT32(expectedSequence++, block.sequence);
+      TEST_ASSERT_EQUAL_UINT32(expectedFirst + block.lost, block.firstSample);
+      for (int i = 0; i < block.count; i++) {
+        TEST_ASSERT_EQUAL(sampleAt(block.firstSample + i), block.samples[i]);
+      }
+      lost += block.lost;
+      expectedFirst = block.firstSample + block.count;
+      pos += block.bytes;
+    }
+    TEST_ASSERT_EQUAL(length, pos);
+  }
+
+  // Only the 600 overwritten samples and the 125 of the abandoned partial
+  // block are lost; the stream catches up instead of overrunning again
+  TEST_ASSERT_EQUAL_UINT32(600 + 125, lost);
+  TEST_ASSERT_EQUAL_UINT32(stream.getDroppedCount(), lost);
+}
+
+static void test_limits_are_respected() {
+  EcgBlockStream stream(RATE_HZ, BLOCK_SAMPLES);
+  stream.begin(*ring);
+  uint32_t written = 0;
+  writeSamples(&written, 4 * BLOCK_SAMPLES);
+
+  // Room for one worst-case block only
+  int blocks;
+  int length = stream.readBlocks(*ring, out, ecgStreamBlockMaxBytes(BLOCK_SAMPLES), 4, &blocks);
+  TEST_ASSERT_EQUAL(1, blocks);
+  TEST_ASSERT_GREATER_THAN(0, length);
+
+  length = stream.readBlocks(*ring, out, sizeof(out), 2, &blocks);
+  TEST_ASSERT_EQUAL(2, blocks);
+
+  // Nothing fits: nothing is read, so the last block waits in the ring
+  length = stream.readBlocks(*ring, out, ecgStreamBlockMaxBytes(BLOCK_SAMPLES) - 1, 4, &blocks);
+  TEST_ASSERT_EQUAL(0, blocks);
+  TEST_ASSERT_EQUAL(0, length);
+
+  length = stream.readBlocks(*ring, out, sizeof(out), 4, &blocks);
+  TEST_ASSERT_EQUAL(1, blocks);
+  DecodedBlock block;
+  decodeBlock(out, &block);
+  TEST_ASSERT_EQUAL_UINT32(3, block.sequence);
+  TEST_ASSERT_EQUAL_UINT32(3 * BLOCK_SAMPLES, block.firstSample);
+}
+
+static void test_worst_case_block_fits_the_bound() {
+  EcgBlockStream stream(RATE_HZ, BLOCK_SAMPLES);
+  stream.begin(*ring);
+  int values[BLOCK_SAMPLES];
+  for (int i = 0; i < BLOCK_SAMPLES; i++) {
+    values[i] = i % 2 ? 32767 : -32768;
+  }
+  ring->write(values, BLOCK_SAMPLES);
+
+  int blocks;
+  int length = stream.readBlocks(*ring, out, sizeof(out), 1, &blocks);
+  TEST_ASSERT_EQUAL(1, blocks);
+  TEST_ASSERT_EQUAL(ecgStreamBlockMaxBytes(BLOCK_SAMPLES), length);
+  DecodedBlock block;
+  decodeBlock(out, &block);
+  TEST_ASSERT_EQUAL_INT_ARRAY(values, block.samples, BLOCK_SAMPLES);
+}
+
+static void test_base64_rfc4648_vectors() {
+  static const char *const INPUTS[] = { "", "f", "fo", "foo", "foob", "fooba", "foobar" };
+  static const char *const EXPECTED[] = { "", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy" };
+  for (int i = 0; i < 7; i++) {
+    char encoded[16];
+    int length = (int)strlen(INPUTS[i]);
+    int n = base64Encode((const uint8_t *)INPUTS[i], length, encoded);
+    TEST_ASSERT_EQUAL(base64EncodedLength(length), n);
+    TEST_ASSERT_EQUAL_STRING(EXPECTED[i], encoded);
+  }
+
+  const uint8_t binary[] = { 0x00, 0xFF, 0xFE, 0x80 };
+  char encoded[16];
+  base64Encode(binary, sizeof(binary), encoded);
+  TEST_ASSERT_EQUAL_STRING("AP/+gA==", encoded);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_blocks_round_trip);
+  RUN_TEST(test_overrun_is_reported_and_blocks_stay_contiguous);
+  RUN_TEST(test_limits_are_respected);
+  RUN_TEST(test_worst_case_block_fits_the_bound);
+  RUN_TEST(test_base64_rfc4648_vectors);
+  return UNITY_END();
+}
@@ -0,0 +1,106 @@
+/**
+ * ElderGuard - Fall classifier native tests
+ *
+ * Golden values for the int8 kernel: quantization as the exporter in
+ * tools/train_fall_classifier.py does it, the integer logit, and the
+ * shipped model's decisions worked out by hand. Regenerating the model
+ * changes only the last of these.
+ */
+
+#include <unity.h>
+#include "fall_classifier.h"
+#include "fall_classifier_model.h"
+
+void setUp() {}
+void tearDown() {}
+
+static FallFeatures features(float sma, float jerk, float stillness, float orientationDelta) {
+  FallFeatures f;
+  f.sma = sma;
+  f.jerk = jerk;
+  f.stillness = stillness;
+  f.orientationDelta = orientationDelta;
+  return f;
+}
+
+// The logit computed directly from the model constants
+static int32_t referenceScore(const int8_t *quantized) {
+  int32_t score = FALL_CLASSIFIER_BIAS;
+  for (int i = 0; i < FALL_CLASSIFIER_FEATURES; i++) {
+    score += FALL_CLASSIFIER_WEIGHTS[i] * quantized[i];
+  }
+  return score;
+}
+
+static void test_scales_match_the_exporter() {
+  // tools/train_fall_classifier.py FEATURE_SCALES
+  TEST_ASSERT_EQUAL_FLOAT(32.0f, FALL_FEATURE_SCALES[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, FALL_FEATURE_SCALES[1]);
+  TEST_ASSERT_EQUAL_FLOAT(256.0f, FALL_FEATURE_SCALES[2]);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, FALL_FEATURE_SCALES[3]);
+}
+
+static void test_quantization() {
+  // The feature line in the exporter's documentation
+  int8_t quantized[FALL_CLASSIFIER_FEATURES];
+  quantizeFallFeatures(features(1.061f, 483.2f, 0.0060f, 80.0f), quantized);
+  const int8_t expected[] = { 34, 127, 2, 80 };
+  TEST_ASSERT_EQUAL_INT8_ARRAY(expected, quantized, FALL_CLASSIFIER_FEATURES);
+
+  // Halves round away from zero, as in the exporter
+  quantizeFallFeatures(features(0.015625f, 3.0f, -0.005859375f, -2.5f), quantized);
+  const int8_t halves[] = { 1, 2, -2, -3 };
+  TEST_ASSERT_EQUAL_INT8_ARRAY(halves, quantized, FALL_CLASSIFIER_FEATURES);
+
+  // Both ends saturate
+  quantizeFallFeatures(features(4.0f, -300.0f, 1.0f, -180.0f), quantized);
+  const int8_t saturated[] = { 127, -128, 127, -128 };
+  TEST_ASSERT_EQUAL_INT8_ARRAY(saturated, quantized, FALL_CLASSIFIER_FEATURES);
+
+  quantizeFallFeatures(features(0, 0, 0, 0), quantized);
+  const int8_t zero[] = { 0, 0, 0, 0 };
+  TEST_ASSERT_EQUAL_INT8_ARRAY(zero, quantized, FALL_CLASSIFIER_FEATURES);
+}
+
+static void test_score_is_the_int8_dot_product() {
+  const FallFeatures cases[] = {
+    features(0, 0, 0, 0),
+    features(1.061f, 483.2f, 0.0060f, 80.0f),
+    features(1.2f, 180.0f, 0.05f, 12.0f),
+    features(4.0f, 300.0f, 1.0f, 180.0f),
+    features(-4.0f, -300.0f, -1.0f, -180.0f),
+    features(4.0f, -300.0f, 1.0f, -180.0f),
+  };
+  for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    int8_t quantized[FALL_CLASSIFIER_FEATURES];
+    quantizeFallFeatures(cases[i], quantized);
+    TEST_ASSERT_EQUAL_INT32(referenceScore(quantized), scoreFall(cases[i]));
+  }
+  TEST_ASSERT_EQUAL_INT32(FALL_CLASSIFIER_BIAS, scoreFall(features(0, 0, 0, 0)));
+}
+
+// Worked by hand for weights { -1, 1, -3, 4 } and bias -120
+static void test_shipped_model_golden() {
+  // Tumbling fall, lying still: -34 + 127 - 6 + 320 - 120
+  TEST_ASSERT_EQUAL_INT32(287, scoreFall(features(1.061f, 483.2f, 0.0060f, 80.0f)));
+
+  // Hard sit-down, upright and fidgeting: q = { 38, 90, 13, 12 }
+  TEST_ASSERT_EQUAL_INT32(-59, scoreFall(features(1.2f, 180.0f, 0.05f, 12.0f)));
+
+  // A logit of exactly 0 is a fall; one quantization step less is not
+  TEST_ASSERT_EQUAL_INT32(0, scoreFall(features(0, 0, 0, 30.0f)));
+  TEST_ASSERT_EQUAL_INT32(-4, scoreFall(features(0, 0, 0, 29.4f)));
+
+  // Saturated inputs: -127 + 127 - 381 + 508 - 120 and 128 - 128 + 384 - 512 - 120
+  TEST_ASSERT_EQUAL_INT32(7, scoreFall(features(4.0f, 300.0f, 1.0f, 180.0f)));
+  TEST_ASSERT_EQUAL_INT32(-248, scoreFall(features(-4.0f, -300.0f, -1.0f, -180.0f)));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_scales_match_the_exporter);
+  RUN_TEST(test_quantization);
+  RUN_TEST(test_score_is_the_int8_dot_product);
+  RUN_TEST(test_shipped_model_golden);
+  return UNITY_END();
+}
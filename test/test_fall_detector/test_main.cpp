@@ -0,0 +1,159 @@
+/**
+ * ElderGuard - FallDetector native tests
+ *
+ * Decisions on synthetic traces, compared across the sample rates the
+ * fall detection task supports.
+ */
+
+#include <unity.h>
+#include "fall_detector.h"
+#include "../synthetic_imu.h"
+
+#define MAX_SECONDS 120
+#define MAX_RATE_HZ 200
+
+static const int RATES_HZ[] = { 50, 100, 125, 200 };
+static const int RATE_COUNT = sizeof(RATES_HZ) / sizeof(RATES_HZ[0]);
+
+static SyntheticImuSample trace[MAX_SECONDS * MAX_RATE_HZ];
+
+// Results seen over a replay
+typedef struct {
+    int falls;
+    int rejected;
+    int escalations;
+    int recovered;
+    uint32_t firstFallMs;
+    uint32_t firstEscalationMs;
+    uint32_t recoveredMs;
+} ReplayResult;
+
+void setUp() {}
+void tearDown() {}
+
+static ReplayResult replay(const SyntheticImuConfig &config, const FallDetectorConfig &detectorConfig, int seconds) {
+  int count = seconds * config.sampleRateHz;
+  syntheticImu(config, trace, count);
+
+  FallDetector detector(config.sampleRateHz);
+  detector.setConfig(detectorConfig);
+  detector.calibrate(0, 0, SYNTHETIC_GRAVITY, 0, 0, 0);
+
+  ReplayResult result = {};
+  for (int i = 0; i < count; i++) {
+    const SyntheticImuSample &s = trace[i];
+    uint32_t timeMs = (uint32_t)((uint64_t)i * 1000 / config.sampleRateHz);
+    FallDetection detection;
+    switch (detector.processSample(s.ax, s.ay, s.az, s.gx, s.gy, s.gz, timeMs, &detection)) {
+      case FALL_RESULT_FALL:
+        if (result.falls++ == 0) {
+          result.firstFallMs = timeMs;
+        }
+        break;
+      case FALL_RESULT_REJECTED:
+        result.rejected++;
+        break;
+      case FALL_RESULT_ESCALATE:
+        if (result.escalations++ == 0) {
+          result.firstEscalationMs = timeMs;
+        }
+        break;
+      case FALL_RESULT_RECOVERED:
+        result.recovered++;
+        result.recoveredMs = timeMs;
+        break;
+      default:
+        break;
+    }
+  }
+  return result;
+}
+
+static FallDetectorConfig rulesOnly() {
+  FallDetectorConfig config = FallDetector::defaultConfig();
+  config.useClassifier = false;
+  return config;
+}
+
+static void test_fall_is_confirmed_at_every_rate() {
+  for (int r = 0; r < RATE_COUNT; r++) {
+    SyntheticImuConfig config = syntheticImuDefaults(SYNTHETIC_FALL, RATES_HZ[r]);
+    ReplayResult result = replay(config, FallDetector::defaultConfig(), 5);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, result.falls, "fall not confirmed");
+    // The classifier decides verifyWindow after the impact
+    TEST_ASSERT_UINT32_WITHIN(50, 1000 + 450 + 1000, result.firstFallMs);
+  }
+}
+
+// The impact-pattern check must not loosen as the rate goes up: a stumble
+// rejected at the 50Hz reference rate is rejected at every rate
+static void test_pattern_check_does_not_depend_on_rate() {
+  for (int r = 0; r < RATE_COUNT; r++) {
+    SyntheticImuConfig stumble = syntheticImuDefaults(SYNTHETIC_STUMBLE, RATES_HZ[r]);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, replay(stumble, rulesOnly(), 4).falls, "stumble passed the rules");
+
+    SyntheticImuConfig fall = syntheticImuDefaults(SYNTHETIC_FALL, RATES_HZ[r]);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, replay(fall, rulesOnly(), 4).falls, "fall failed the rules");
+  }
+}
+
+// A hard sit-down passes the impact rules; the classifier rejects it
+static void test_sitting_down_hard_is_rejected() {
+  for (int r = 0; r < RATE_COUNT; r++) {
+    SyntheticImuConfig config = syntheticImuDefaults(SYNTHETIC_SIT_DOWN, RATES_HZ[r]);
+    config.impactG = 3.0f;
+    config.freefallMs = 300;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, replay(config, rulesOnly(), 5).falls, "sit-down failed the rules");
+
+    ReplayResult result = replay(config, FallDetector::defaultConfig(), 5);
+    TEST_ASSERT_EQUAL_INT(0, result.falls);
+    TEST_ASSERT_EQUAL_INT(1, result.rejected);
+  }
+}
+
+static void test_no_impact_returns_to_monitoring() {
+  SyntheticImuConfig config = syntheticImuDefaults(SYNTHETIC_SLOW_LOWERING, 100);
+  ReplayResult result = replay(config, rulesOnly(), 5);
+  TEST_ASSERT_EQUAL_INT(0, result.falls);
+  TEST_ASSERT_EQUAL_INT(0, result.rejected);
+}
+
+static void test_lying_still_escalates_until_limit() {
+  SyntheticImuConfig config = syntheticImuDefaults(SYNTHETIC_FALL, 100);
+  FallDetectorConfig detectorConfig = FallDetector::defaultConfig();
+  ReplayResult result = replay(config, detectorConfig, MAX_SECONDS);
+
+  TEST_ASSERT_EQUAL_INT(1, result.falls);
+  // Motionless: the first escalation comes early, then every escalationTime
+  TEST_ASSERT_UINT32_WITHIN(1000, result.firstFallMs + detectorConfig.motionlessEscalationTime,
+                            result.firstEscalationMs);
+  int expected = 1 + (MAX_SECONDS * 1000 - result.firstEscalationMs) / detectorConfig.escalationTime;
+  if (expected > detectorConfig.maxEscalations) {
+    expected = detectorConfig.maxEscalations;
+  }
+  TEST_ASSERT_EQUAL_INT(expected, result.escalations);
+  TEST_ASSERT_EQUAL_INT(0, result.recovered);
+}
+
+static void test_getting_up_cancels_the_fall() {
+  SyntheticImuConfig config = syntheticImuDefaults(SYNTHETIC_FALL, 100);
+  config.getUpMs = 8000;
+  FallDetectorConfig detectorConfig = FallDetector::defaultConfig();
+  ReplayResult result = replay(config, detectorConfig, 20);
+
+  TEST_ASSERT_EQUAL_INT(1, result.falls);
+  TEST_ASSERT_EQUAL_INT(1, result.recovered);
+  // Upright within about a second of standing, then recoveryTime
+  TEST_ASSERT_UINT32_WITHIN(1500, 8000 + detectorConfig.recoveryTime, result.recoveredMs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fall_is_confirmed_at_every_rate);
+  RUN_TEST(test_pattern_check_does_not_depend_on_rate);
+  RUN_TEST(test_sitting_down_hard_is_rejected);
+  RUN_TEST(test_no_impact_returns_to_monitoring);
+  RUN_TEST(test_lying_still_escalates_until_limit);
+  RUN_TEST(test_getting_up_cancels_the_fall);
+  return UNITY_END();
+}
@@ -0,0 +1,247 @@
+/**
+ * ElderGuard - Fall replay runner native tests
+ *
+ * Trace loading, scoring and the parallel parameter sweep of
+ * test/fall_replay.h, on a labelled synthetic dataset. Setting
+ * FALL_REPLAY_DATASET to a file listing one trace path per line also
+ * scores and sweeps that dataset:
+ *
+ *   FALL_REPLAY_DATASET=traces.txt pio test -e native -f test_fall_replay -v
+ */
+
+#include <unistd.h>
+#include <unity.h>
+#include "../fall_replay.h"
+#include "../synthetic_imu.h"
+
+#define TRACE_SECONDS 20
+#define TRACE_CSV_PATH "/tmp/elderguard_fall_replay.csv"
+#define TRACE_BINARY_PATH "/tmp/elderguard_fall_replay.bin"
+
+static const int RATES_HZ[] = { 50, 100, 125, 200 };
+static const int RATE_COUNT = sizeof(RATES_HZ) / sizeof(RATES_HZ[0]);
+
+static SyntheticImuSample synthetic[TRACE_SECONDS * 200];
+
+void setUp() {}
+void tearDown() {}
+
+static FallReplayTrace syntheticTrace(const SyntheticImuConfig &config, bool fall) {
+  int count = TRACE_SECONDS * config.sampleRateHz;
+  syntheticImu(config, synthetic, count);
+
+  FallReplayTrace trace;
+  trace.name = "synthetic";
+  trace.sampleRateHz = config.sampleRateHz;
+  trace.fall = fall;
+  trace.samples.resize(count);
+  for (int i = 0; i < count; i++) {
+    const SyntheticImuSample &s = synthetic[i];
+    FallReplaySample &r = trace.samples[i];
+    r.timeMs = (uint32_t)((uint64_t)i * 1000 / config.sampleRateHz);
+    r.ax = s.ax;
+    r.ay = s.ay;
+    r.az = s.az;
+    r.gx = s.gx;
+    r.gy = s.gy;
+    r.gz = s.gz;
+  }
+  return trace;
+}
+
+// Falls and near-misses at every supported rate
+static std::vector<FallReplayTrace> syntheticDataset() {
+  std::vector<FallReplayTrace> traces;
+  for (int r = 0; r < RATE_COUNT; r++) {
+    traces.push_back(syntheticTrace(syntheticImuDefaults(SYNTHETIC_FALL, RATES_HZ[r]), true));
+    // A softer fall with less tumble, after which the person gets up
+    SyntheticImuConfig soft = syntheticImuDefaults(SYNTHETIC_FALL, RATES_HZ[r]);
+    soft.impactG = 2.5f;
+    soft.tumbleDegPerS = 120.0f;
+    soft.getUpMs = 6000;
+    traces.push_back(syntheticTrace(soft, true));
+    traces.push_back(syntheticTrace(syntheticImuDefaults(SYNTHETIC_STILL, RATES_HZ[r]), false));
+    traces.push_back(syntheticTrace(syntheticImuDefaults(SYNTHETIC_STUMBLE, RATES_HZ[r]), false));
+    traces.push_back(syntheticTrace(syntheticImuDefaults(SYNTHETIC_SIT_DOWN, RATES_HZ[r]), false));
+    traces.push_back(syntheticTrace(syntheticImuDefaults(SYNTHETIC_SLOW_LOWERING, RATES_HZ[r]), false));
+  }
+  return traces;
+}
+
+static std::vector<FallDetectorConfig> parameterGrid() {
+  static const float FREEFALL_THRESHOLDS[] = { 4.0f, 5.0f, 6.0f, 7.0f };
+  static const float IMPACT_THRESHOLDS[] = { 12.0f, 16.0f, 20.0f, 30.0f };
+  static const uint32_t MIN_FREEFALL_DURATIONS[] = { 50, 70, 100, 150 };
+  static const uint32_t MAX_FREEFALL_WINDOWS[] = { 300, 450, 600 };
+
+  std::vector<FallDetectorConfig> configs;
+  for (float freefall : FREEFALL_THRESHOLDS) {
+    for (float impact : IMPACT_THRESHOLDS) {
+      for (uint32_t minFreefall : MIN_FREEFALL_DURATIONS) {
+        for (uint32_t window : MAX_FREEFALL_WINDOWS) {
+          FallDetectorConfig config = FallDetector::defaultConfig();
+          config.freefallThreshold = freefall;
+          config.impactThreshold = impact;
+          config.minFreefallDuration = minFreefall;
+          config.maxFreefallWindow = window;
+          configs.push_back(config);
+        }
+      }
+    }
+  }
+  return configs;
+}
+
+static void assertSameTrace(const FallReplayTrace &expected, const FallReplayTrace &actual) {
+  TEST_ASSERT_EQUAL(expected.sampleRateHz, actual.sampleRateHz);
+  TEST_ASSERT_EQUAL(expected.fall, actual.fall);
+  TEST_ASSERT_EQUAL(expected.samples.size(), actual.samples.size());
+  for (size_t i = 0; i < expected.samples.size(); i++) {
+    TEST_ASSERT_EQUAL_UINT32(expected.samples[i].timeMs, actual.samples[i].timeMs);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.samples[i].ay, actual.samples[i].ay);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.samples[i].gx, actual.samples[i].gx);
+  }
+}
+
+static void test_binary_trace_round_trips() {
+  FallReplayTrace trace = syntheticTrace(syntheticImuDefaults(SYNTHETIC_FALL, 100), true);
+  TEST_ASSERT_TRUE(saveFallReplayBinary(TRACE_BINARY_PATH, trace));
+
+  FallReplayTrace loaded;
+  TEST_ASSERT_TRUE(loadFallReplayTrace(TRACE_BINARY_PATH, &loaded));
+  assertSameTrace(trace, loaded);
+  TEST_ASSERT_EQUAL(replayFallTrace(trace, FallDetector::defaultConfig()),
+                    replayFallTrace(loaded, FallDetector::defaultConfig()));
+  remove(TRACE_BINARY_PATH);
+}
+
+static void test_csv_trace_is_read() {
+  FallReplayTrace trace = syntheticTrace(syntheticImuDefaults(SYNTHETIC_FALL, 125), true);
+  FILE *file = fopen(TRACE_CSV_PATH, "w");
+  TEST_ASSERT_NOT_NULL(file);
+  fprintf(file, "# label=fall\ntime_ms,ax,ay,az,gx,gy,gz\n");
+  for (size_t i = 0; i < trace.samples.size(); i++) {
+    const FallReplaySample &s = trace.samples[i];
+    fprintf(file, "%lu,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n", (unsigned long)s.timeMs, s.ax, s.ay, s.az, s.gx, s.gy, s.gz);
+  }
+  fclose(file);
+
+  // No rate comment: the rate comes from the time column
+  FallReplayTrace loaded;
+  TEST_ASSERT_TRUE(loadFallReplayTrace(TRACE_CSV_PATH, &loaded));
+  assertSameTrace(trace, loaded);
+  TEST_ASSERT_EQUAL(1, replayFallTrace(loaded, FallDetector::defaultConfig()));
+  remove(TRACE_CSV_PATH);
+}
+
+static void test_missing_or_bad_files_are_rejected() {
+  FallReplayTrace trace;
+  TEST_ASSERT_FALSE(loadFallReplayTrace("/tmp/elderguard_no_such_trace.bin", &trace));
+
+  FILE *file = fopen(TRACE_BINARY_PATH, "wb");
+  fputs("not a trace", file);
+  fclose(file);
+  TEST_ASSERT_FALSE(loadFallReplayTrace(TRACE_BINARY_PATH, &trace));
+
+  // Header promises more samples than the file holds
+  FallReplayTrace shortTrace = syntheticTrace(syntheticImuDefaults(SYNTHETIC_STILL, 50), false);
+  TEST_ASSERT_TRUE(saveFallReplayBinary(TRACE_BINARY_PATH, shortTrace));
+  TEST_ASSERT_EQUAL(0, truncate(TRACE_BINARY_PATH, 100));
+  TEST_ASSERT_FALSE(loadFallReplayTrace(TRACE_BINARY_PATH, &trace));
+  remove(TRACE_BINARY_PATH);
+}
+
+static void test_default_config_scores_the_synthetic_dataset() {
+  std::vector<FallReplayTrace> traces = syntheticDataset();
+  FallReplayScore score = scoreFallReplay(traces, FallDetector::defaultConfig());
+
+  TEST_ASSERT_EQUAL(2 * RATE_COUNT, score.truePositives + score.falseNegatives);
+  TEST_ASSERT_EQUAL(4 * RATE_COUNT, score.trueNegatives + score.falsePositives);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, fallReplaySensitivity(score));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, fallReplaySpecificity(score));
+
+  // An impact nothing reaches misses every fall and raises nothing
+  FallDetectorConfig numb = FallDetector::defaultConfig();
+  numb.impactThreshold = 1000.0f;
+  score = scoreFallReplay(traces, numb);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, fallReplaySensitivity(score));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, fallReplaySpecificity(score));
+}
+
+static void test_sweep_matches_serial_scoring() {
+  std::vector<FallReplayTrace> traces = syntheticDataset();
+  std::vector<FallDetectorConfig> configs = parameterGrid();
+  std::vector<FallReplayScore> scores;
+  double perCore = sweepFallReplay(traces, configs, &scores, 0);
+
+  TEST_ASSERT_EQUAL(configs.size(), scores.size());
+  int perfect = 0;
+  for (size_t i = 0; i < configs.size(); i += 7) {
+    FallReplayScore serial = scoreFallReplay(traces, configs[i]);
+    TEST_ASSERT_EQUAL(serial.truePositives, scores[i].truePositives);
+    TEST_ASSERT_EQUAL(serial.falsePositives, scores[i].falsePositives);
+    TEST_ASSERT_TRUE(serial.samples == scores[i].samples);
+  }
+  for (size_t i = 0; i < scores.size(); i++) {
+    if (fallReplaySensitivity(scores[i]) == 1.0f && fallReplaySpecificity(scores[i]) == 1.0f) {
+      perfect++;
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(0, perfect);
+
+  char message[128];
+  snprintf(message, sizeof(message), "%d configs on %u cores, %d perfect, %.2f Msamples/s per core",
+           (int)configs.size(), std::thread::hardware_concurrency(), perfect, perCore / 1e6);
+  TEST_MESSAGE(message);
+}
+
+// Scores a recorded dataset when one is given; otherwise nothing to do
+static void test_recorded_dataset() {
+  const char *list = getenv("FALL_REPLAY_DATASET");
+  if (list == NULL) {
+    TEST_IGNORE_MESSAGE("FALL_REPLAY_DATASET not set");
+    return;
+  }
+  FILE *file = fopen(list, "r");
+  TEST_ASSERT_NOT_NULL_MESSAGE(file, list);
+
+  std::vector<FallReplayTrace> traces;
+  char path[512];
+  while (fgets(path, sizeof(path), file) != NULL) {
+    path[strcspn(path, "\r\n")] = '\0';
+    if (path[0] == '\0' || path[0] == '#') {
+      continue;
+    }
+    FallReplayTrace trace;
+    TEST_ASSERT_TRUE_MESSAGE(loadFallReplayTrace(path, &trace), path);
+    traces.push_back(trace);
+  }
+  fclose(file);
+
+  std::vector<FallDetectorConfig> configs = parameterGrid();
+  configs.insert(configs.begin(), FallDetector::defaultConfig());
+  std::vector<FallReplayScore> scores;
+  double perCore = sweepFallReplay(traces, configs, &scores, 0);
+
+  char message[160];
+  for (size_t i = 0; i < configs.size(); i++) {
+    snprintf(message, sizeof(message), "%sfreefall %.1f impact %.1f min %lu window %lu: sensitivity %.3f specificity %.3f",
+             i == 0 ? "default " : "", configs[i].freefallThreshold, configs[i].impactThreshold,
+             (unsigned long)configs[i].minFreefallDuration, (unsigned long)configs[i].maxFreefallWindow,
+             fallReplaySensitivity(scores[i]), fallReplaySpecificity(scores[i]));
+    TEST_MESSAGE(message);
+  }
+  snprintf(message, sizeof(message), "%d traces, %.2f Msamples/s per core", (int)traces.size(), perCore / 1e6);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_binary_trace_round_trips);
+  RUN_TEST(test_csv_trace_is_read);
+  RUN_TEST(test_missing_or_bad_files_are_rejected);
+  RUN_TEST(test_default_config_scores_the_synthetic_dataset);
+  RUN_TEST(test_sweep_matches_serial_scoring);
+  RUN_TEST(test_recorded_dataset);
+  return UNITY_END();
+}
@@ -0,0 +1,110 @@
+/**
+ * ElderGuard - HrvEngine native tests
+ *
+ * The running sums are checked against metrics computed directly from the
+ * intervals in the window.
+ */
+
+#include <math.h>
+#include <unity.h>
+#include "hrv_engine.h"
+
+static HrvEngine hrv(HRV_MIN_WINDOW_MS);
+
+void setUp() {
+  hrv.reset();
+}
+
+void tearDown() {}
+
+static void test_metrics_match_direct_computation() {
+  const uint32_t rr[] = { 800, 820, 790, 900, 760, 810, 805, 870, 780, 800 };
+  const int n = sizeof(rr) / sizeof(rr[0]);
+  uint32_t t = 0;
+  for (int i = 0; i < n; i++) {
+    t += rr[i];
+    hrv.addInterval(t, rr[i]);
+  }
+
+  double mean = 0;
+  for (int i = 0; i < n; i++) {
+    mean += rr[i];
+  }
+  mean /= n;
+  double variance = 0, squaredDiffs = 0;
+  int nn50 = 0;
+  for (int i = 0; i < n; i++) {
+    variance += (rr[i] - mean) * (rr[i] - mean);
+    if (i > 0) {
+      double diff = (double)rr[i] - rr[i - 1];
+      squaredDiffs += diff * diff;
+      nn50 += fabs(diff) > 50;
+    }
+  }
+
+  HrvMetrics metrics;
+  hrv.getMetrics(&metrics);
+  TEST_ASSERT_EQUAL_INT(n, metrics.intervals);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, sqrt(variance / (n - 1)), metrics.sdnn);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, sqrt(squaredDiffs / (n - 1)), metrics.rmssd);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f * nn50 / (n - 1), metrics.pnn50);
+}
+
+static void test_gap_has_no_successive_difference() {
+  hrv.addInterval(1000, 800);
+  hrv.addInterval(1800, 800);
+  // A missed beat: the next interval does not start at 1800
+  hrv.addInterval(3400, 900);
+  hrv.addInterval(4300, 900);
+
+  HrvMetrics metrics;
+  hrv.getMetrics(&metrics);
+  TEST_ASSERT_EQUAL_INT(4, metrics.intervals);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, metrics.rmssd);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, metrics.pnn50);
+  TEST_ASSERT_GREATER_THAN_FLOAT(50.0f, metrics.sdnn);
+}
+
+static void test_window_expires_old_intervals() {
+  uint32_t t = 0;
+  for (int i = 0; i < 100; i++) {
+    uint32_t rr = i < 50 ? 600 : 1000;
+    t += rr;
+    hrv.addInterval(t, rr);
+  }
+  hrv.expire(t + HRV_MIN_WINDOW_MS - 50 * 1000 + 1);
+
+  // Only the 1000ms intervals are left; the step between the two runs
+  // went with the last 600ms interval
+  HrvMetrics metrics;
+  hrv.getMetrics(&metrics);
+  TEST_ASSERT_EQUAL_INT(50, metrics.intervals);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, metrics.sdnn);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, metrics.rmssd);
+
+  hrv.expire(t + HRV_MIN_WINDOW_MS + 1);
+  hrv.getMetrics(&metrics);
+  TEST_ASSERT_EQUAL_INT(0, metrics.intervals);
+}
+
+static void test_capacity_evicts_oldest() {
+  static HrvEngine wide(HRV_MAX_WINDOW_MS);
+  uint32_t t = 0;
+  for (int i = 0; i < HRV_MAX_INTERVALS + 10; i++) {
+    t += 300;
+    wide.addInterval(t, 300);
+  }
+  TEST_ASSERT_EQUAL_INT(HRV_MAX_INTERVALS, wide.getIntervalCount());
+  HrvMetrics metrics;
+  wide.getMetrics(&metrics);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, metrics.sdnn);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_metrics_match_direct_computation);
+  RUN_TEST(test_gap_has_no_successive_difference);
+  RUN_TEST(test_window_expires_old_intervals);
+  RUN_TEST(test_capacity_evicts_oldest);
+  return UNITY_END();
+}
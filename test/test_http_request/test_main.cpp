@@ -0,0 +1,234 @@
+/**
+ * ElderGuard - HTTP request framing native tests and soak
+ *
+ * Framing of the head against the body, and a soak: a simulated day of the
+ * HTTP task's traffic framed in one HttpRequest and answered through one
+ * HttpResponseParser, with the global allocator counting every call. The
+ * send path must not touch the heap at all, so the free heap and the
+ * largest free block on the device can only be lowered by other code.
+ */
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "http_request.h"
+#include "http_response.h"
+
+#define SOAK_HOURS 24
+#define SOAK_PERIOD_MS 5000              // Sensor data interval of the HTTP task
+#define SOAK_REQUESTS_PER_HOUR (3600000 / SOAK_PERIOD_MS)
+#define STREAM_BODY_BYTES 2400           // ECG stream batch, too large for the arena
+#define MAX_READ 128                     // Read size of the HTTP task
+
+// Heap calls made while tracking is on
+static bool tracking = false;
+static unsigned long allocations = 0;
+static unsigned long frees = 0;
+
+void *operator new(size_t size) {
+  if (tracking) {
+    allocations++;
+  }
+  void *block = malloc(size > 0 ? size : 1);
+  if (block == NULL) {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *block) noexcept {
+  if (tracking && block != NULL) {
+    frees++;
+  }
+  free(block);
+}
+
+void operator delete[](void *block) noexcept {
+  operator delete(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+  operator delete(block);
+}
+
+void operator delete[](void *block, size_t) noexcept {
+  operator delete(block);
+}
+
+static HttpRequest request;
+static HttpResponseParser response;
+static char responseBody[128];
+
+void setUp() {}
+void tearDown() {}
+
+// The bytes a socket would have received: the first write, then the tail
+static int wireBytes(char *out, int capacity) {
+  int length = request.getDataLength() + request.getTailLength();
+  TEST_ASSERT_LESS_THAN(capacity, length);
+  memcpy(out, request.getData(), request.getDataLength());
+  if (request.getTail() != NULL) {
+    memcpy(out + request.getDataLength(), request.getTail(), request.getTailLength());
+  }
+  out[length] = '\0';
+  return length;
+}
+
+// Feed a response in reads of the sizes a TLS connection hands out
+static void readResponse(const char *text, uint32_t *seed) {
+  response.begin(responseBody, sizeof(responseBody));
+  int length = strlen(text);
+  int pos = 0;
+  while (pos < length && !response.isDone() && !response.hasError()) {
+    *seed = *seed * 1103515245u + 12345u;
+    int n = 1 + (int)((*seed >> 16) % MAX_READ);
+    if (n > length - pos) {
+      n = length - pos;
+    }
+    pos += response.feed((const uint8_t *)&text[pos], n);
+  }
+}
+
+static void test_body_in_the_arena_goes_with_the_head() {
+  char *body = request.getBody();
+  int length = snprintf(body, HTTP_REQUEST_BODY_MAX, "{\"heart_rate\":72}");
+  TEST_ASSERT_TRUE(request.frame("api.example.com", "/api/sensor-data", "application/json",
+                                 "X-Patient-Id: 1\r\n", (const uint8_t *)body, length));
+  TEST_ASSERT_NULL(request.getTail());
+
+  char wire[512];
+  wireBytes(wire, sizeof(wire));
+  TEST_ASSERT_EQUAL_STRING("POST /api/sensor-data HTTP/1.1\r\n"
+                           "Host: api.example.com\r\n"
+                           "User-Agent: ElderGuard\r\n"
+                           "Accept: application/json\r\n"
+                           "Connection: keep-alive\r\n"
+                           "Content-Type: application/json\r\n"
+                           "Content-Length: 17\r\n"
+                           "X-Patient-Id: 1\r\n"
+                           "\r\n"
+                           "{\"heart_rate\":72}", wire);
+  // The head ends right where the body slot starts
+  TEST_ASSERT_TRUE(request.getData() + request.getDataLength() - length == (const uint8_t *)body);
+}
+
+static void test_outside_body_is_copied_in_or_sent_after_the_head() {
+  static char small[] = "{\"text\":\"Fall detected\"}";
+  TEST_ASSERT_TRUE(request.frame("tg.example.com", "/send", "application/json", NULL,
+                                 (const uint8_t *)small, strlen(small)));
+  TEST_ASSERT_NULL(request.getTail());
+  char wire[STREAM_BODY_BYTES + 512];
+  wireBytes(wire, sizeof(wire));
+  TEST_ASSERT_NOT_NULL(strstr(wire, "Content-Length: 24\r\n\r\n{\"text\":\"Fall detected\"}"));
+
+  // Exactly one arena's worth is still copied; one byte more is not
+  static uint8_t large[HTTP_REQUEST_BODY_MAX + 1];
+  memset(large, 'x', sizeof(large));
+  TEST_ASSERT_TRUE(request.frame("h", "/p", "application/octet-stream", NULL, large, HTTP_REQUEST_BODY_MAX));
+  TEST_ASSERT_NULL(request.getTail());
+  TEST_ASSERT_TRUE(request.frame("h", "/p", "application/octet-stream", NULL, large, sizeof(large)));
+  TEST_ASSERT_TRUE(request.getTail() == large);
+  TEST_ASSERT_EQUAL((int)sizeof(large), request.getTailLength());
+  int length = wireBytes(wire, sizeof(wire));
+  TEST_ASSERT_EQUAL(request.getDataLength() + (int)sizeof(large), length);
+  TEST_ASSERT_NOT_NULL(strstr(wire, "Content-Length: 769\r\n\r\nxxx"));
+}
+
+static void test_headers_longer_than_the_head_slot_are_refused() {
+  char headers[HTTP_REQUEST_HEAD_MAX];
+  memset(headers, 'a', sizeof(headers) - 3);
+  strcpy(&headers[sizeof(headers) - 3], "\r\n");
+  const char *body = "{}";
+  TEST_ASSERT_FALSE(request.frame("h", "/p", "application/json", headers, (const uint8_t *)body, 2));
+  TEST_ASSERT_NULL(request.getData());
+  TEST_ASSERT_EQUAL(0, request.getDataLength());
+}
+
+static void test_a_day_of_requests_allocates_nothing() {
+  static uint8_t streamBody[STREAM_BODY_BYTES];
+  memset(streamBody, 'A', sizeof(streamBody));
+  const char *telemetryResponse = "HTTP/1.1 201 Created\r\nContent-Type: application/json\r\n"
+                                  "Content-Length: 27\r\nConnection: keep-alive\r\n\r\n"
+                                  "{\"status\":\"ok\",\"id\":123456}";
+  const char *alertResponse = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                              "b\r\n{\"ok\":true,\r\n11\r\n\"result\":{\"id\":7}}\r\n0\r\n\r\n";
+  const char *errorResponse = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n"
+                              "Content-Length: 5\r\n\r\nretry";
+
+  // The counters see allocations at all
+  tracking = true;
+  int *volatile probe = new int(0);
+  delete probe;
+  tracking = false;
+  TEST_ASSERT_EQUAL(1, allocations);
+  TEST_ASSERT_EQUAL(1, frees);
+  allocations = 0;
+  frees = 0;
+
+  uint32_t seed = 1;
+  unsigned long requests = 0;
+  tracking = true;
+  for (int hour = 0; hour < SOAK_HOURS; hour++) {
+    unsigned long allocationsBefore = allocations;
+    for (int i = 0; i < SOAK_REQUESTS_PER_HOUR; i++) {
+      // Sensor data, built in the body slot
+      char *body = request.getBody();
+      int length = snprintf(body, HTTP_REQUEST_BODY_MAX,
+                            "{\"patient_id\":1,\"heart_rate\":%d,\"lat\":52.%06d,\"lng\":13.%06d}",
+                            60 + i % 40, i * 37 % 1000000, i * 91 % 1000000);
+      TEST_ASSERT_TRUE(request.frame("api.example.com", "/api/sensor-data", "application/json",
+                                     "X-Patient-Id: 1\r\n", (const uint8_t *)body, length));
+      readResponse(i % 97 == 0 ? errorResponse : telemetryResponse, &seed);
+      TEST_ASSERT_TRUE(response.isDone());
+
+      // An ECG stream batch from its own buffer every other period
+      if (i % 2 == 0) {
+        TEST_ASSERT_TRUE(request.frame("api.example.com", "/api/ecg-stream", "application/octet-stream",
+                                       "X-Patient-Id: 1\r\nX-Ecg-Blocks: 8\r\n", streamBody, sizeof(streamBody)));
+        TEST_ASSERT_NOT_NULL(request.getTail());
+        readResponse(telemetryResponse, &seed);
+        TEST_ASSERT_EQUAL(201, response.getStatus());
+        requests++;
+      }
+
+      // A Telegram alert now and then
+      if (i % 120 == 0) {
+        const char *alert = "{\"chat_id\":\"1\",\"text\":\"Heart rate dropped from 80 to 55 BPM\"}";
+        TEST_ASSERT_TRUE(request.frame("api.telegram.org", "/bot0/sendMessage", "application/json", NULL,
+                                       (const uint8_t *)alert, strlen(alert)));
+        readResponse(alertResponse, &seed);
+        TEST_ASSERT_EQUAL(200, response.getStatus());
+        TEST_ASSERT_TRUE(response.isKeepAlive());
+        requests++;
+      }
+      requests++;
+    }
+
+    char message[80];
+    snprintf(message, sizeof(message), "hour %d: %lu heap allocations", hour + 1, allocations - allocationsBefore);
+    TEST_ASSERT_EQUAL_MESSAGE(0, allocations - allocationsBefore, message);
+  }
+  tracking = false;
+
+  char summary[120];
+  snprintf(summary, sizeof(summary), "%d h soak: %lu requests, %lu allocations, %lu frees",
+           SOAK_HOURS, requests, allocations, frees);
+  TEST_MESSAGE(summary);
+  TEST_ASSERT_EQUAL(0, allocations);
+  TEST_ASSERT_EQUAL(0, frees);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_body_in_the_arena_goes_with_the_head);
+  RUN_TEST(test_outside_body_is_copied_in_or_sent_after_the_head);
+  RUN_TEST(test_headers_longer_than_the_head_slot_are_refused);
+  RUN_TEST(test_a_day_of_requests_allocates_nothing);
+  return UNITY_END();
+}
@@ -0,0 +1,115 @@
+/**
+ * ElderGuard - HTTP response parser native tests
+ *
+ * Every response is fed in reads of every size from one byte up, the way
+ * it arrives from a TLS connection, and must parse the same each time.
+ */
+
+#include <string.h>
+#include <unity.h>
+#include "http_response.h"
+
+#define MAX_READ 64
+
+static HttpResponseParser response;
+static char body[16];
+
+void setUp() {}
+void tearDown() {}
+
+// Feed text in reads of at most step bytes until the response ends
+static void feedInReads(const char *text, int step) {
+  int length = strlen(text);
+  int pos = 0;
+  while (pos < length && !response.isDone() && !response.hasError()) {
+    int n = length - pos < step ? length - pos : step;
+    pos += response.feed((const uint8_t *)&text[pos], n);
+  }
+}
+
+static void test_content_length_body_is_cut_to_the_buffer() {
+  for (int step = 1; step <= MAX_READ; step++) {
+    response.begin(body, sizeof(body));
+    feedInReads("HTTP/1.1 201 Created\r\ncontent-length: 20\r\nServer: x\r\n\r\n{\"ok\":true,\"id\":123}", step);
+    TEST_ASSERT_TRUE(response.isDone());
+    TEST_ASSERT_EQUAL(201, response.getStatus());
+    TEST_ASSERT_TRUE(response.isKeepAlive());
+    TEST_ASSERT_EQUAL_STRING("{\"ok\":true,\"id\"", body);
+  }
+}
+
+static void test_chunked_body_after_an_interim_response() {
+  for (int step = 1; step <= MAX_READ; step++) {
+    response.begin(body, sizeof(body));
+    feedInReads("HTTP/1.1 100 Continue\r\n\r\n"
+                "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "4;x=y\r\nabcd\r\n3\r\nefg\r\n0\r\nX-T: 1\r\n\r\n", step);
+    TEST_ASSERT_TRUE(response.isDone());
+    TEST_ASSERT_EQUAL(200, response.getStatus());
+    TEST_ASSERT_TRUE(response.isKeepAlive());
+    TEST_ASSERT_EQUAL_STRING("abcdefg", body);
+  }
+}
+
+static void test_connection_close() {
+  for (int step = 1; step <= MAX_READ; step++) {
+    // HTTP/1.0 without a length: the body runs until the server closes
+    response.begin(body, sizeof(body));
+    feedInReads("HTTP/1.0 500 Oops\r\nConnection: close\r\n\r\nerr", step);
+    TEST_ASSERT_FALSE(response.isDone());
+    response.closed();
+    TEST_ASSERT_TRUE(response.isDone());
+    TEST_ASSERT_FALSE(response.isKeepAlive());
+    TEST_ASSERT_EQUAL(500, response.getStatus());
+    TEST_ASSERT_EQUAL_STRING("err", body);
+
+    // Closed before Content-Length bytes arrived
+    response.begin(body, sizeof(body));
+    feedInReads("HTTP/1.1 422 X\r\nContent-Length: 5\r\nConnection: Close\r\n\r\nab", step);
+    response.closed();
+    TEST_ASSERT_TRUE(response.hasError());
+
+    // No body at all
+    response.begin(body, sizeof(body));
+    feedInReads("HTTP/1.1 204 No Content\r\nConnection: keep-alive\r\n\r\n", step);
+    TEST_ASSERT_TRUE(response.isDone());
+    TEST_ASSERT_TRUE(response.isKeepAlive());
+  }
+}
+
+static void test_bytes_after_the_response_are_left_unused() {
+  const char *text = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nhiHTTP";
+  response.begin(body, sizeof(body));
+  int used = response.feed((const uint8_t *)text, strlen(text));
+  TEST_ASSERT_TRUE(response.isDone());
+  TEST_ASSERT_EQUAL((int)strlen(text) - 4, used);
+  TEST_ASSERT_EQUAL_STRING("hi", body);
+}
+
+static void test_bad_status_line_and_long_headers() {
+  response.begin(body, sizeof(body));
+  response.feed((const uint8_t *)"garbage\r\n", 9);
+  TEST_ASSERT_TRUE(response.hasError());
+
+  // A header line longer than HTTP_LINE_MAX is cut, not overrun
+  char longValue[HTTP_LINE_MAX * 3];
+  memset(longValue, 'a', sizeof(longValue));
+  const char *head = "HTTP/1.1 200 OK\r\nX: ";
+  const char *rest = "\r\nContent-Length: 0\r\n\r\n";
+  response.begin(body, sizeof(body));
+  response.feed((const uint8_t *)head, strlen(head));
+  response.feed((const uint8_t *)longValue, sizeof(longValue));
+  response.feed((const uint8_t *)rest, strlen(rest));
+  TEST_ASSERT_TRUE(response.isDone());
+  TEST_ASSERT_EQUAL(200, response.getStatus());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_content_length_body_is_cut_to_the_buffer);
+  RUN_TEST(test_chunked_body_after_an_interim_response);
+  RUN_TEST(test_connection_close);
+  RUN_TEST(test_bytes_after_the_response_are_left_unused);
+  RUN_TEST(test_bad_status_line_and_long_headers);
+  return UNITY_END();
+}
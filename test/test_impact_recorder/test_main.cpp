@@ -0,0 +1,244 @@
+/**
+ * ElderGuard - ImpactRecorder native tests
+ *
+ * The pre/post-impact window, the blob layout decoded back to the samples
+ * that went in, and the hold/release accounting between the recorder and
+ * its uploaders.
+ */
+
+#include <string.h>
+#include <vector>
+#include <unity.h>
+#include "impact_recorder.h"
+
+#define RATE_HZ 100
+#define PRE_MS 2000
+#define POST_MS 3000
+#define PRE_SAMPLES (PRE_MS * RATE_HZ / 1000)
+#define POST_SAMPLES (POST_MS * RATE_HZ / 1000)
+#define ACCEL_LSB_PER_G 16384
+#define GYRO_LSB_PER_10DPS 1310
+
+typedef struct {
+    uint16_t sampleRateHz;
+    uint16_t count;
+    uint16_t impactIndex;
+    uint16_t accelLsbPerG;
+    uint16_t gyroLsbPer10Dps;
+    uint32_t timestampMs;
+    uint32_t captureId;
+    std::vector<ImpactSample> samples;
+} DecodedCapture;
+
+// Too large for the stack, and fresh for each test
+static ImpactRecorder *recorder;
+
+void setUp() {
+  recorder = new ImpactRecorder(RATE_HZ, PRE_MS, POST_MS, ACCEL_LSB_PER_G, GYRO_LSB_PER_10DPS);
+}
+
+void tearDown() {
+  delete recorder;
+}
+
+// Every axis of sample n carries n, so a decoded sample says where it came from
+static ImpactSample sampleAt(uint32_t n) {
+  ImpactSample sample;
+  for (int axis = 0; axis < IMPACT_AXES; axis++) {
+    sample.axes[axis] = (int16_t)(n * (axis + 1) - 1000 * axis);
+  }
+  return sample;
+}
+
+static uint16_t getUint16(const uint8_t *in) {
+  return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t getUint32(const uint8_t *in) {
+  return getUint16(in) | ((uint32_t)getUint16(in + 2) << 16);
+}
+
+static DecodedCapture decodeBlob() {
+  int length;
+  const uint8_t *blob = recorder->getBlob(&length);
+  TEST_ASSERT_GREATER_OR_EQUAL(IMPACT_HEADER_BYTES + IMPACT_AXES * 2, length);
+  TEST_ASSERT_LESS_OR_EQUAL(IMPACT_BLOB_MAX_BYTES, length);
+  TEST_ASSERT_EQUAL(0, memcmp(blob, "EGIC", 4));
+  TEST_ASSERT_EQUAL(1, blob[4]);
+  TEST_ASSERT_EQUAL(IMPACT_AXES, blob[5]);
+
+  DecodedCapture capture;
+  capture.sampleRateHz = getUint16(&blob[6]);
+  capture.count = getUint16(&blob[8]);
+  capture.impactIndex = getUint16(&blob[10]);
+  capture.accelLsbPerG = getUint16(&blob[12]);
+  capture.gyroLsbPer10Dps = getUint16(&blob[14]);
+  capture.timestampMs = getUint32(&blob[16]);
+  capture.captureId = getUint32(&blob[20]);
+
+  int pos = IMPACT_HEADER_BYTES;
+  ImpactSample sample;
+  for (int axis = 0; axis < IMPACT_AXES; axis++) {
+    sample.axes[axis] = (int16_t)getUint16(&blob[pos]);
+    pos += 2;
+  }
+  capture.samples.push_back(sample);
+
+  for (int i = 1; i < capture.count; i++) {
+    for (int axis = 0; axis < IMPACT_AXES; axis++) {
+      uint32_t zigzag = 0;
+      int shift = 0;
+      int bytes = 0;
+      uint8_t byte;
+      do {
+        TEST_ASSERT_LESS_THAN(length, pos);
+        byte = blob[pos++];
+        zigzag |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+        bytes++;
+      } while (byte & 0x80);
+      TEST_ASSERT_LESS_OR_EQUAL(IMPACT_MAX_DELTA_BYTES, bytes);
+      int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+      sample.axes[axis] = (int16_t)(sample.axes[axis] + delta);
+    }
+    capture.samples.push_back(sample);
+  }
+
+  // Nothing is left over after the last delta
+  TEST_ASSERT_EQUAL(length, pos);
+  return capture;
+}
+
+static void assertSamplesFrom(const DecodedCapture &capture, uint32_t first) {
+  for (size_t i = 0; i < capture.samples.size(); i++) {
+    ImpactSample expected = sampleAt(first + i);
+    TEST_ASSERT_EQUAL_INT16_ARRAY(expected.axes, capture.samples[i].axes, IMPACT_AXES);
+  }
+}
+
+// Add samples from n on; return how many went in before a capture completed
+static int addUntilComplete(uint32_t *n, int limit) {
+  for (int added = 1; added <= limit; added++) {
+    if (recorder->addSample(sampleAt((*n)++))) {
+      return added;
+    }
+  }
+  return -1;
+}
+
+static void test_window_spans_pre_and_post_impact() {
+  uint32_t n = 0;
+  TEST_ASSERT_EQUAL(-1, addUntilComplete(&n, 700));
+
+  uint32_t impact = recorder->getSampleCount() - 1;
+  TEST_ASSERT_TRUE(recorder->trigger(impact, 123456));
+  TEST_ASSERT_EQUAL(POST_SAMPLES, addUntilComplete(&n, 1000));
+  TEST_ASSERT_EQUAL_UINT32(1, recorder->getCaptureCount());
+
+  DecodedCapture capture = decodeBlob();
+  TEST_ASSERT_EQUAL(RATE_HZ, capture.sampleRateHz);
+  TEST_ASSERT_EQUAL(PRE_SAMPLES + 1 + POST_SAMPLES, capture.count);
+  TEST_ASSERT_EQUAL(PRE_SAMPLES, capture.impactIndex);
+  TEST_ASSERT_EQUAL(ACCEL_LSB_PER_G, capture.accelLsbPerG);
+  TEST_ASSERT_EQUAL(GYRO_LSB_PER_10DPS, capture.gyroLsbPer10Dps);
+  TEST_ASSERT_EQUAL_UINT32(123456, capture.timestampMs);
+  TEST_ASSERT_EQUAL_UINT32(1, capture.captureId);
+  assertSamplesFrom(capture, impact - PRE_SAMPLES);
+}
+
+static void test_impact_marked_late_or_right_after_boot() {
+  // Soon after boot there is less than the pre-impact window
+  uint32_t n = 0;
+  addUntilComplete(&n, 50);
+  TEST_ASSERT_TRUE(recorder->trigger(30, 1000));
+  // The post-impact window runs from the impact, not from the trigger
+  TEST_ASSERT_EQUAL(POST_SAMPLES - 19, addUntilComplete(&n, 1000));
+
+  DecodedCapture capture = decodeBlob();
+  TEST_ASSERT_EQUAL(30 + 1 + POST_SAMPLES, capture.count);
+  TEST_ASSERT_EQUAL(30, capture.impactIndex);
+  assertSamplesFrom(capture, 0);
+  recorder->releaseBlob();
+
+  // An impact whose post-impact window has already gone by is missed
+  uint32_t impact = recorder->getSampleCount() - 1;
+  addUntilComplete(&n, POST_SAMPLES);
+  TEST_ASSERT_FALSE(recorder->trigger(impact, 2000));
+  TEST_ASSERT_EQUAL_UINT32(1, recorder->getMissedCount());
+  TEST_ASSERT_TRUE(recorder->trigger(impact + 1, 2000));
+}
+
+static void test_hold_blocks_triggers_until_every_reader_releases() {
+  uint32_t n = 0;
+  addUntilComplete(&n, 300);
+  TEST_ASSERT_TRUE(recorder->trigger(recorder->getSampleCount() - 1, 1000));
+
+  // A second impact while the first capture is still recording is missed
+  addUntilComplete(&n, 10);
+  TEST_ASSERT_FALSE(recorder->trigger(recorder->getSampleCount() - 1, 1100));
+  TEST_ASSERT_EQUAL_UINT32(1, recorder->getMissedCount());
+  TEST_ASSERT_GREATER_THAN(0, addUntilComplete(&n, 1000));
+
+  // Two uploaders hold the blob; the next capture waits for both
+  recorder->holdBlob(2);
+  addUntilComplete(&n, 5);
+  TEST_ASSERT_FALSE(recorder->trigger(recorder->getSampleCount() - 1, 5000));
+  recorder->releaseBlob();
+  TEST_ASSERT_FALSE(recorder->trigger(recorder->getSampleCount() - 1, 5000));
+  TEST_ASSERT_EQUAL_UINT32(3, recorder->getMissedCount());
+
+  // Releasing more often than held does not leave credit for the next hold
+  recorder->releaseBlob();
+  recorder->releaseBlob();
+  uint32_t impact = recorder->getSampleCount() - 1;
+  TEST_ASSERT_TRUE(recorder->trigger(impact, 5000));
+  TEST_ASSERT_EQUAL(POST_SAMPLES, addUntilComplete(&n, 1000));
+  recorder->holdBlob(1);
+  TEST_ASSERT_FALSE(recorder->trigger(recorder->getSampleCount() - 1, 9000));
+
+  // The held blob is the second capture, untouched by the samples since
+  addUntilComplete(&n, 20);
+  DecodedCapture capture = decodeBlob();
+  TEST_ASSERT_EQUAL_UINT32(2, capture.captureId);
+  TEST_ASSERT_EQUAL_UINT32(5000, capture.timestampMs);
+  assertSamplesFrom(capture, impact - PRE_SAMPLES);
+}
+
+static void test_full_ring_of_extreme_deltas_fits_the_blob() {
+  // The whole ring as the window, every step full scale
+  delete recorder;
+  recorder = new ImpactRecorder(RATE_HZ, 10000, 10000, ACCEL_LSB_PER_G, GYRO_LSB_PER_10DPS);
+
+  ImpactSample low, high;
+  for (int axis = 0; axis < IMPACT_AXES; axis++) {
+    low.axes[axis] = -32768;
+    high.axes[axis] = 32767;
+  }
+  for (int i = 0; i < IMPACT_RING_CAPACITY; i++) {
+    recorder->addSample(i % 2 ? high : low);
+  }
+  TEST_ASSERT_TRUE(recorder->trigger(recorder->getSampleCount() - 1, 1));
+  int added = 0;
+  while (!recorder->addSample(added % 2 ? high : low)) {
+    added++;
+  }
+
+  DecodedCapture capture = decodeBlob();
+  TEST_ASSERT_EQUAL(IMPACT_RING_CAPACITY, capture.count);
+  for (size_t i = 1; i < capture.samples.size(); i++) {
+    TEST_ASSERT_NOT_EQUAL(capture.samples[i - 1].axes[0], capture.samples[i].axes[0]);
+    TEST_ASSERT_TRUE(capture.samples[i].axes[5] == -32768 || capture.samples[i].axes[5] == 32767);
+  }
+  int length;
+  recorder->getBlob(&length);
+  TEST_ASSERT_EQUAL(IMPACT_BLOB_MAX_BYTES, length);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_window_spans_pre_and_post_impact);
+  RUN_TEST(test_impact_marked_late_or_right_after_boot);
+  RUN_TEST(test_hold_blocks_triggers_until_every_reader_releases);
+  RUN_TEST(test_full_ring_of_extreme_deltas_fits_the_blob);
+  return UNITY_END();
+}
@@ -0,0 +1,208 @@
+/**
+ * ElderGuard - MQTT in-flight window native tests
+ *
+ * Packets are checked byte for byte against the MQTT 3.1.1 PUBLISH layout,
+ * and broker traffic is fed back both in one piece and a byte at a time.
+ */
+
+#include <string.h>
+#include <unity.h>
+#include "mqtt_inflight.h"
+
+#define TOPIC "elderguard/patient/1/realtime"
+#define TOPIC_LENGTH 29
+#define RETRY_MS 10000
+
+static uint8_t payload[MQTT_INFLIGHT_MAX_PACKET];
+
+void setUp() {
+  for (int i = 0; i < (int)sizeof(payload); i++) {
+    payload[i] = (uint8_t)(i * 7);
+  }
+}
+
+void tearDown() {}
+
+static const uint8_t *addPacket(MqttInflightWindow &window, int length, uint32_t nowMs, int *packetLength) {
+  const uint8_t *packet = NULL;
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_ADDED, window.add(TOPIC, payload, length, nowMs, &packet, packetLength));
+  TEST_ASSERT_NOT_NULL(packet);
+  return packet;
+}
+
+// Offset of the packet id in a PUBLISH with a two-byte remaining length
+static uint16_t packetIdOf(const uint8_t *packet) {
+  int pos = 1 + 2 + 2 + TOPIC_LENGTH;
+  return (uint16_t)(packet[pos] << 8 | packet[pos + 1]);
+}
+
+static void feed(MqttInflightWindow &window, const uint8_t *data, int length, uint32_t nowMs, bool byteByByte) {
+  if (!byteByByte) {
+    window.receive(data, length, nowMs);
+    return;
+  }
+  for (int i = 0; i < length; i++) {
+    window.receive(&data[i], 1, nowMs);
+  }
+}
+
+static void test_publish_packet_layout() {
+  MqttInflightWindow window(RETRY_MS);
+  int length;
+  const uint8_t *packet = addPacket(window, 300, 100, &length);
+
+  // Remaining length 2 + 29 + 2 + 300 = 333 = 0xCD 0x02
+  TEST_ASSERT_EQUAL(1 + 2 + 333, length);
+  TEST_ASSERT_EQUAL(mqttPublishPacketBytes(TOPIC_LENGTH, 300), length);
+  TEST_ASSERT_EQUAL_HEX8(0x32, packet[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xCD, packet[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x02, packet[2]);
+  TEST_ASSERT_EQUAL(0, packet[3]);
+  TEST_ASSERT_EQUAL(TOPIC_LENGTH, packet[4]);
+  TEST_ASSERT_EQUAL_MEMORY(TOPIC, &packet[5], TOPIC_LENGTH);
+  TEST_ASSERT_EQUAL(1, packetIdOf(packet));
+  TEST_ASSERT_EQUAL_MEMORY(payload, &packet[5 + TOPIC_LENGTH + 2], 300);
+
+  // Short packets take a one-byte remaining length
+  const uint8_t *small = NULL;
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_ADDED, window.add("t", payload, 5, 100, &small, &length));
+  TEST_ASSERT_EQUAL(mqttPublishPacketBytes(1, 5), length);
+  TEST_ASSERT_EQUAL(2 + 1 + 2 + 5, small[1]);
+  TEST_ASSERT_EQUAL(2, small[2 + 2 + 1] << 8 | small[2 + 2 + 2]);
+}
+
+static void test_full_window_and_too_large_are_told_apart() {
+  MqttInflightWindow window(RETRY_MS);
+  const uint8_t *packet = NULL;
+  int length;
+
+  // Largest payload that fits, then one byte more
+  int largest = MQTT_INFLIGHT_MAX_PACKET - mqttPublishPacketBytes(TOPIC_LENGTH, 0) - 1;
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_MAX_PACKET, mqttPublishPacketBytes(TOPIC_LENGTH, largest));
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_TOO_LARGE, window.add(TOPIC, payload, largest + 1, 0, &packet, &length));
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_TOO_LARGE, window.add(TOPIC, payload, -1, 0, &packet, &length));
+  TEST_ASSERT_EQUAL(0, window.getCount());
+
+  addPacket(window, largest, 0, &length);
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_MAX_PACKET, length);
+  for (int i = 1; i < MQTT_INFLIGHT_WINDOW; i++) {
+    addPacket(window, 10, 0, &length);
+  }
+  TEST_ASSERT_TRUE(window.isFull());
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_FULL, window.add(TOPIC, payload, 10, 0, &packet, &length));
+  // Still too large with the window full: waiting would not help it
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_TOO_LARGE, window.add(TOPIC, payload, largest + 1, 0, &packet, &length));
+}
+
+static void test_pubacks_are_picked_out_of_broker_traffic() {
+  for (int byteByByte = 0; byteByByte < 2; byteByByte++) {
+    MqttInflightWindow window(RETRY_MS);
+    int length;
+    for (int i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+      addPacket(window, 300, 100, &length);
+    }
+
+    // CONNACK, PINGRESP, an incoming PUBLISH full of PUBACK type bytes,
+    // then the PUBACK for packet 2
+    uint8_t traffic[256];
+    int n = 0;
+    traffic[n++] = 0x20; traffic[n++] = 2; traffic[n++] = 0; traffic[n++] = 0;
+    traffic[n++] = 0xD0; traffic[n++] = 0;
+    traffic[n++] = 0x30; traffic[n++] = 0xC8; traffic[n++] = 0x01;
+    for (int i = 0; i < 200; i++) {
+      traffic[n++] = 0x40;
+    }
+    traffic[n++] = 0x40; traffic[n++] = 2; traffic[n++] = 0; traffic[n++] = 2;
+    feed(window, traffic, n, 350, byteByByte);
+
+    TEST_ASSERT_EQUAL(MQTT_INFLIGHT_WINDOW - 1, window.getCount());
+    TEST_ASSERT_EQUAL_UINT32(1, window.getAckedCount());
+    TEST_ASSERT_EQUAL_UINT32(250, window.getWorstAckMs());
+
+    // Unknown and repeated ids change nothing
+    const uint8_t stray[] = { 0x40, 2, 0, 2, 0x40, 2, 0x12, 0x34 };
+    feed(window, stray, sizeof(stray), 400, byteByByte);
+    TEST_ASSERT_EQUAL(MQTT_INFLIGHT_WINDOW - 1, window.getCount());
+
+    const uint8_t rest[] = { 0x40, 2, 0, 1, 0x40, 2, 0, 3, 0x40, 2, 0, 4 };
+    feed(window, rest, sizeof(rest), 500, byteByByte);
+    TEST_ASSERT_EQUAL(0, window.getCount());
+    TEST_ASSERT_EQUAL_UINT32(4, window.getAckedCount());
+    TEST_ASSERT_EQUAL_UINT32(400, window.getWorstAckMs());
+  }
+}
+
+static void test_unacknowledged_packets_are_sent_again() {
+  MqttInflightWindow window(RETRY_MS);
+  int length;
+  addPacket(window, 50, 1000, &length);
+  addPacket(window, 60, 2000, &length);
+
+  // Not due before retryMs
+  TEST_ASSERT_NULL(window.nextRetransmit(1000 + RETRY_MS - 1, &length));
+
+  // Oldest first, with DUP set
+  const uint8_t *packet = window.nextRetransmit(1000 + RETRY_MS, &length);
+  TEST_ASSERT_NOT_NULL(packet);
+  TEST_ASSERT_EQUAL_HEX8(0x3A, packet[0]);
+  TEST_ASSERT_EQUAL(mqttPublishPacketBytes(TOPIC_LENGTH, 50), length);
+  TEST_ASSERT_NULL(window.nextRetransmit(1000 + RETRY_MS, &length));
+  packet = window.nextRetransmit(2000 + RETRY_MS, &length);
+  TEST_ASSERT_NOT_NULL(packet);
+  TEST_ASSERT_EQUAL(mqttPublishPacketBytes(TOPIC_LENGTH, 60), length);
+  TEST_ASSERT_EQUAL_UINT32(2, window.getRetransmitCount());
+
+  // After a reconnect everything is due at once, in the original order
+  window.reconnected();
+  packet = window.nextRetransmit(2000 + RETRY_MS, &length);
+  TEST_ASSERT_EQUAL(1, (packet[1 + 1 + 2 + TOPIC_LENGTH] << 8) | packet[1 + 1 + 2 + TOPIC_LENGTH + 1]);
+  packet = window.nextRetransmit(2000 + RETRY_MS, &length);
+  TEST_ASSERT_EQUAL(2, (packet[1 + 1 + 2 + TOPIC_LENGTH] << 8) | packet[1 + 1 + 2 + TOPIC_LENGTH + 1]);
+  TEST_ASSERT_NULL(window.nextRetransmit(2000 + RETRY_MS, &length));
+}
+
+static void test_reconnect_restarts_the_framing() {
+  MqttInflightWindow window(RETRY_MS);
+  int length;
+  addPacket(window, 10, 0, &length);
+
+  // A packet cut off by the lost connection
+  const uint8_t partial[] = { 0x30, 0x10, 0x40, 0x02 };
+  window.receive(partial, sizeof(partial), 10);
+  window.reconnected();
+
+  const uint8_t ack[] = { 0x40, 2, 0, 1 };
+  window.receive(ack, sizeof(ack), 20);
+  TEST_ASSERT_EQUAL(0, window.getCount());
+}
+
+static void test_packet_ids_skip_zero() {
+  MqttInflightWindow window(RETRY_MS);
+  int length;
+  uint8_t ack[4] = { 0x40, 2, 0, 0 };
+  uint16_t last = 0;
+  for (int i = 0; i < 0x10002; i++) {
+    const uint8_t *packet = addPacket(window, 200, 0, &length);
+    uint16_t id = packetIdOf(packet);
+    TEST_ASSERT_NOT_EQUAL(0, id);
+    if (last != 0) {
+      TEST_ASSERT_EQUAL(last == 0xFFFF ? 1 : last + 1, id);
+    }
+    last = id;
+    ack[2] = (uint8_t)(id >> 8);
+    ack[3] = (uint8_t)id;
+    window.receive(ack, sizeof(ack), 0);
+  }
+  TEST_ASSERT_EQUAL(0, window.getCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_publish_packet_layout);
+  RUN_TEST(test_full_window_and_too_large_are_told_apart);
+  RUN_TEST(test_pubacks_are_picked_out_of_broker_traffic);
+  RUN_TEST(test_unacknowledged_packets_are_sent_again);
+  RUN_TEST(test_reconnect_restarts_the_framing);
+  RUN_TEST(test_packet_ids_skip_zero);
+  return UNITY_END();
+}
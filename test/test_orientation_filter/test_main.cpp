@@ -0,0 +1,161 @@
+/**
+ * ElderGuard - OrientationFilter native tests
+ *
+ * Accuracy against the true attitude of synthetic IMU traces, compared
+ * with the accelerometer-only angles the filter replaced, and the filter's
+ * update rate on the host.
+ */
+
+#include <chrono>
+#include <unity.h>
+#include "orientation_filter.h"
+#include "../synthetic_imu.h"
+
+#define RATE_HZ 100
+#define RAD_TO_DEG 57.29578f
+
+static SyntheticImuSample trace[10 * RATE_HZ];
+
+void setUp() {}
+void tearDown() {}
+
+static void test_reset_matches_accelerometer_angles() {
+  OrientationFilter filter(RATE_HZ);
+  filter.reset(3, -4, 5);
+  OrientationAngles angles;
+  filter.getAngles(&angles);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, atan2f(3, sqrtf(41)) * RAD_TO_DEG, angles.pitch);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, atan2f(-4, sqrtf(34)) * RAD_TO_DEG, angles.roll);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, atan2f(5, 5) * RAD_TO_DEG, angles.yaw);
+
+  // Upside down is a special case of the shortest rotation
+  filter.reset(0, 0, -SYNTHETIC_GRAVITY);
+  float gx, gy, gz;
+  filter.getGravity(&gx, &gy, &gz);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, -1.0f, gz);
+}
+
+// Gyro rotations move the angles the same way tilting the accelerometer does
+static void test_gyro_sign_matches_accelerometer() {
+  const float rate = 45.0f / RAD_TO_DEG;
+  for (int axis = 0; axis < 2; axis++) {
+    OrientationFilter filter(RATE_HZ, 0.0f);
+    filter.reset(0, 0, SYNTHETIC_GRAVITY);
+    for (int i = 0; i < RATE_HZ; i++) {
+      filter.update(axis == 0 ? rate : 0, axis == 1 ? rate : 0, 0, 0, 0, SYNTHETIC_GRAVITY);
+    }
+    OrientationAngles angles;
+    filter.getAngles(&angles);
+    if (axis == 0) {
+      TEST_ASSERT_FLOAT_WITHIN(0.5f, 45.0f, angles.roll);
+    } else {
+      TEST_ASSERT_FLOAT_WITHIN(0.5f, -45.0f, angles.pitch);
+    }
+  }
+}
+
+static void test_accelerometer_corrects_drift() {
+  OrientationFilter filter(RATE_HZ);
+  filter.reset(0, 0, SYNTHETIC_GRAVITY);
+  // At rest at 30 degrees roll, starting from the wrong attitude
+  float ay = SYNTHETIC_GRAVITY * sinf(30.0f / RAD_TO_DEG);
+  float az = SYNTHETIC_GRAVITY * cosf(30.0f / RAD_TO_DEG);
+  for (int i = 0; i < 10 * RATE_HZ; i++) {
+    filter.update(0, 0, 0, 0, ay, az);
+  }
+  OrientationAngles angles;
+  filter.getAngles(&angles);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 30.0f, angles.roll);
+  TEST_ASSERT_EQUAL_UINT32(0, filter.getGyroOnlySamples());
+}
+
+static void test_gyro_bias_is_removed() {
+  OrientationFilter filter(RATE_HZ, 0.0f);
+  filter.reset(0, 0, SYNTHETIC_GRAVITY);
+  filter.setGyroBias(0.02f, -0.01f, 0.03f);
+  for (int i = 0; i < 10 * RATE_HZ; i++) {
+    filter.update(0.02f, -0.01f, 0.03f, 0, 0, SYNTHETIC_GRAVITY);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, filter.getQ0());
+}
+
+// The accuracy test the filter was added for: through a tumbling fall the
+// accelerometer no longer sees gravity, the fused estimate still follows
+static void test_tracks_attitude_through_a_fall() {
+  SyntheticImuConfig config = syntheticImuDefaults(SYNTHETIC_FALL, RATE_HZ);
+  config.freefallG = 0.15f;
+  const int count = 3 * RATE_HZ;
+  syntheticImu(config, trace, count);
+
+  OrientationFilter filter(RATE_HZ);
+  filter.reset(0, 0, SYNTHETIC_GRAVITY);
+  const float legacyAlpha = powf(0.8f, 50.0f / RATE_HZ);
+  float legacyRoll = 0;
+  float filterError = 0, legacyError = 0, worstFilterError = 0, worstLegacyError = 0;
+  int scored = 0;
+
+  for (int i = 0; i < count; i++) {
+    const SyntheticImuSample &s = trace[i];
+    filter.update(s.gx, s.gy, s.gz, s.ax, s.ay, s.az);
+    float accelRoll = atan2f(s.ay, sqrtf(s.ax * s.ax + s.az * s.az)) * RAD_TO_DEG;
+    legacyRoll = legacyAlpha * legacyRoll + (1 - legacyAlpha) * accelRoll;
+
+    if (i >= (int)config.startMs * RATE_HZ / 1000) {
+      OrientationAngles angles;
+      filter.getAngles(&angles);
+      float error = fabsf(angles.roll - s.trueRoll);
+      filterError += error;
+      float legacy = fabsf(legacyRoll - s.trueRoll);
+      legacyError += legacy;
+      worstFilterError = error > worstFilterError ? error : worstFilterError;
+      worstLegacyError = legacy > worstLegacyError ? legacy : worstLegacyError;
+      scored++;
+    }
+  }
+
+  TEST_ASSERT_LESS_THAN_FLOAT(0.5f, filterError / scored);
+  TEST_ASSERT_LESS_THAN_FLOAT(2.0f, worstFilterError);
+  // The accelerometer-only low-pass lags the tumble by several times as much
+  TEST_ASSERT_GREATER_THAN_FLOAT(5 * worstFilterError, worstLegacyError);
+  TEST_ASSERT_GREATER_THAN_FLOAT(5 * filterError, legacyError);
+  TEST_ASSERT_GREATER_THAN(30, (int)filter.getGyroOnlySamples());
+
+  char message[128];
+  snprintf(message, sizeof(message), "roll error mean %.2f max %.2f deg, accelerometer-only mean %.2f max %.2f deg",
+           filterError / scored, worstFilterError, legacyError / scored, worstLegacyError);
+  TEST_MESSAGE(message);
+}
+
+static void test_throughput() {
+  SyntheticImuConfig config = syntheticImuDefaults(SYNTHETIC_FALL, RATE_HZ);
+  const int count = 10 * RATE_HZ;
+  syntheticImu(config, trace, count);
+  OrientationFilter filter(RATE_HZ);
+  const int passes = 2000;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int p = 0; p < passes; p++) {
+    for (int i = 0; i < count; i++) {
+      const SyntheticImuSample &s = trace[i];
+      filter.update(s.gx, s.gy, s.gz, s.ax, s.ay, s.az);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.0f, filter.getQ0() * filter.getQ0() + filter.getQ1() * filter.getQ1() +
+                                        filter.getQ2() * filter.getQ2() + filter.getQ3() * filter.getQ3());
+
+  char message[64];
+  snprintf(message, sizeof(message), "%.1f Mupdates/s", passes * count / seconds / 1e6);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reset_matches_accelerometer_angles);
+  RUN_TEST(test_gyro_sign_matches_accelerometer);
+  RUN_TEST(test_accelerometer_corrects_drift);
+  RUN_TEST(test_gyro_bias_is_removed);
+  RUN_TEST(test_tracks_attitude_through_a_fall);
+  RUN_TEST(test_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,266 @@
+/**
+ * ElderGuard - Outbox native tests
+ *
+ * Runs against a scratch directory in /tmp through the same stdio calls
+ * the device makes on SPIFFS.
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unity.h>
+#include "outbox.h"
+
+#define OUTBOX_DIR "/tmp/elderguard_outbox"
+
+static void clearDirectory() {
+  mkdir(OUTBOX_DIR, 0755);
+  DIR *dir = opendir(OUTBOX_DIR);
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] != '.') {
+      char path[300];
+      snprintf(path, sizeof(path), "%s/%s", OUTBOX_DIR, entry->d_name);
+      remove(path);
+    }
+  }
+  closedir(dir);
+}
+
+static int countFiles() {
+  int count = 0;
+  DIR *dir = opendir(OUTBOX_DIR);
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    count += entry->d_name[0] != '.';
+  }
+  closedir(dir);
+  return count;
+}
+
+void setUp() {
+  clearDirectory();
+}
+
+void tearDown() {}
+
+static int appendNumbered(Outbox &outbox, int index, int padding, bool durable) {
+  char record[300];
+  int length = snprintf(record, sizeof(record), "rec-%04d-%0*d", index, padding, 0);
+  TEST_ASSERT_TRUE(outbox.append((uint8_t)(index % 3 + 1), record, length, durable, 1000 + index));
+  return length;
+}
+
+// Reads every sealed record and checks it is the next one of appendNumbered()
+static int readNumbered(Outbox &outbox, int expectedFirst) {
+  uint8_t type;
+  uint8_t out[320];
+  int length, count = 0;
+  while ((length = outbox.read(&type, out, sizeof(out) - 1)) >= 0) {
+    out[length] = '\0';
+    int index = atoi((const char *)&out[4]);
+    TEST_ASSERT_EQUAL(expectedFirst + count, index);
+    TEST_ASSERT_EQUAL(index % 3 + 1, type);
+    TEST_ASSERT_EQUAL_UINT32(1000 + index, outbox.getCreatedAt());
+    count++;
+  }
+  return count;
+}
+
+static void test_records_round_trip_once_sealed() {
+  // One segment holds them all
+  Outbox outbox(OUTBOX_DIR, "t-", 8192, 8);
+  TEST_ASSERT_TRUE(outbox.begin());
+  for (int i = 0; i < 20; i++) {
+    appendNumbered(outbox, i, i * 10, i % 5 == 0);
+  }
+
+  // Nothing is replayed from the segment still being written
+  TEST_ASSERT_TRUE(outbox.hasUnsealed());
+  TEST_ASSERT_EQUAL(0, readNumbered(outbox, 0));
+
+  outbox.seal();
+  TEST_ASSERT_FALSE(outbox.hasUnsealed());
+  TEST_ASSERT_TRUE(outbox.hasBacklog());
+  TEST_ASSERT_EQUAL(20, readNumbered(outbox, 0));
+  TEST_ASSERT_EQUAL_UINT32(20, outbox.getAppendedCount());
+  TEST_ASSERT_EQUAL_UINT32(0, outbox.getCorruptCount());
+  TEST_ASSERT_EQUAL_UINT32(0, outbox.getDroppedSegments());
+}
+
+static void test_rewind_reboot_and_commit() {
+  Outbox outbox(OUTBOX_DIR, "t-", 1024, 8);
+  outbox.begin();
+  for (int i = 0; i < 20; i++) {
+    appendNumbered(outbox, i, 40, false);
+  }
+  outbox.seal();
+
+  TEST_ASSERT_EQUAL(20, readNumbered(outbox, 0));
+  outbox.rewind();
+  TEST_ASSERT_EQUAL(20, readNumbered(outbox, 0));
+
+  // Not committed: a reboot replays everything again
+  Outbox rebooted(OUTBOX_DIR, "t-", 1024, 8);
+  TEST_ASSERT_TRUE(rebooted.begin());
+  TEST_ASSERT_TRUE(rebooted.hasBacklog());
+  TEST_ASSERT_EQUAL(20, readNumbered(rebooted, 0));
+  rebooted.commit();
+  TEST_ASSERT_FALSE(rebooted.hasBacklog());
+  TEST_ASSERT_EQUAL(0, countFiles());
+
+  // Appends after the reboot go to a new segment and read back in order
+  appendNumbered(rebooted, 20, 0, true);
+  rebooted.seal();
+  TEST_ASSERT_EQUAL(1, readNumbered(rebooted, 20));
+}
+
+static void test_partial_commit_keeps_the_rest() {
+  Outbox outbox(OUTBOX_DIR, "t-", 512, 8);
+  outbox.begin();
+  for (int i = 0; i < 30; i++) {
+    appendNumbered(outbox, i, 20, false);
+  }
+  outbox.seal();
+
+  uint8_t type;
+  uint8_t out[320];
+  for (int i = 0; i < 12; i++) {
+    TEST_ASSERT_GREATER_THAN(0, outbox.read(&type, out, sizeof(out)));
+  }
+  outbox.commit();
+  TEST_ASSERT_GREATER_THAN(0, outbox.read(&type, out, sizeof(out)));
+  outbox.rewind();
+
+  TEST_ASSERT_EQUAL(18, readNumbered(outbox, 12));
+}
+
+static void test_size_cap_drops_the_oldest_segments() {
+  Outbox outbox(OUTBOX_DIR, "c-", 512, 3);
+  outbox.begin();
+  for (int i = 0; i < 60; i++) {
+    appendNumbered(outbox, i, 40, false);
+  }
+  TEST_ASSERT_GREATER_THAN_UINT32(0, outbox.getDroppedSegments());
+  outbox.seal();
+  TEST_ASSERT_LESS_OR_EQUAL(3, countFiles());
+
+  // What is left is the newest records, still in order and complete
+  uint8_t type;
+  uint8_t out[320];
+  int length = outbox.read(&type, out, sizeof(out) - 1);
+  TEST_ASSERT_GREATER_THAN(0, length);
+  out[length] = '\0';
+  int first = atoi((const char *)&out[4]);
+  TEST_ASSERT_GREATER_THAN(0, first);
+  outbox.rewind();
+  TEST_ASSERT_EQUAL(60 - first, readNumbered(outbox, first));
+}
+
+static void test_corrupt_data_is_skipped() {
+  Outbox outbox(OUTBOX_DIR, "t-", 1024, 8);
+  outbox.begin();
+  outbox.append(2, "hello", 5, true, 7);
+  outbox.append(2, "world", 5, true, 8);
+  outbox.seal();
+  outbox.append(2, "after", 5, true, 9);
+  outbox.seal();
+
+  // Flip a payload byte of the first record
+  FILE *file = fopen(OUTBOX_DIR "/t-00000000", "r+b");
+  TEST_ASSERT_NOT_NULL(file);
+  fseek(file, OUTBOX_RECORD_HEADER_BYTES + 1, SEEK_SET);
+  fputc('X', file);
+  fclose(file);
+
+  // The rest of that segment cannot be trusted; the next one is intact
+  uint8_t type;
+  uint8_t out[32];
+  int length = outbox.read(&type, out, sizeof(out));
+  TEST_ASSERT_EQUAL(5, length);
+  TEST_ASSERT_EQUAL_MEMORY("after", out, 5);
+  TEST_ASSERT_EQUAL_UINT32(9, outbox.getCreatedAt());
+  TEST_ASSERT_EQUAL_UINT32(1, outbox.getCorruptCount());
+  TEST_ASSERT_EQUAL(-1, outbox.read(&type, out, sizeof(out)));
+}
+
+static void test_oversize_records() {
+  Outbox outbox(OUTBOX_DIR, "t-", 512, 4);
+  outbox.begin();
+  static uint8_t big[600];
+  TEST_ASSERT_FALSE(outbox.append(1, big, sizeof(big), true, 0));
+
+  outbox.append(1, big, 100, false, 0);
+  outbox.append(1, "small", 5, false, 0);
+  outbox.seal();
+
+  // Too large for this reader: reported and stepped over
+  uint8_t type;
+  uint8_t out[32];
+  TEST_ASSERT_EQUAL(100, outbox.peek(&type));
+  TEST_ASSERT_EQUAL(-2, outbox.read(&type, out, sizeof(out)));
+  TEST_ASSERT_EQUAL(5, outbox.read(&type, out, sizeof(out)));
+  TEST_ASSERT_EQUAL_MEMORY("small", out, 5);
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t *data, int length) {
+  for (int i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return crc;
+}
+
+// Segments written before records carried their creation time
+static void test_untimed_records_are_still_read() {
+  uint8_t page[OUTBOX_PAGE_BYTES];
+  memset(page, 0xFF, sizeof(page));
+  const char *payload = "legacy";
+  int length = 6;
+  uint8_t covered[3] = { 4, (uint8_t)length, 0 };
+  uint32_t crc = ~crc32(crc32(0xFFFFFFFF, covered, 3), (const uint8_t *)payload, length);
+  page[0] = 0xA5;
+  page[1] = 4;
+  page[2] = (uint8_t)length;
+  page[3] = 0;
+  for (int i = 0; i < 4; i++) {
+    page[4 + i] = (uint8_t)(crc >> (8 * i));
+  }
+  memcpy(&page[8], payload, length);
+  FILE *file = fopen(OUTBOX_DIR "/t-00000005", "wb");
+  fwrite(page, 1, sizeof(page), file);
+  fclose(file);
+
+  Outbox outbox(OUTBOX_DIR, "t-", 1024, 8);
+  TEST_ASSERT_TRUE(outbox.begin());
+  outbox.append(3, "timed", 5, true, 42);
+  outbox.seal();
+
+  uint8_t type;
+  uint8_t out[32];
+  TEST_ASSERT_EQUAL(length, outbox.read(&type, out, sizeof(out)));
+  TEST_ASSERT_EQUAL(4, type);
+  TEST_ASSERT_EQUAL_MEMORY(payload, out, length);
+  TEST_ASSERT_EQUAL_UINT32(0, outbox.getCreatedAt());
+
+  TEST_ASSERT_EQUAL(5, outbox.read(&type, out, sizeof(out)));
+  TEST_ASSERT_EQUAL(3, type);
+  TEST_ASSERT_EQUAL_UINT32(42, outbox.getCreatedAt());
+  TEST_ASSERT_EQUAL_UINT32(0, outbox.getCorruptCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_round_trip_once_sealed);
+  RUN_TEST(test_rewind_reboot_and_commit);
+  RUN_TEST(test_partial_commit_keeps_the_rest);
+  RUN_TEST(test_size_cap_drops_the_oldest_segments);
+  RUN_TEST(test_corrupt_data_is_skipped);
+  RUN_TEST(test_oversize_records);
+  RUN_TEST(test_untimed_records_are_still_read);
+  return UNITY_END();
+}
@@ -0,0 +1,158 @@
+/**
+ * ElderGuard - Pan-Tompkins detector native tests
+ */
+
+#include <unity.h>
+#include "pan_tompkins.h"
+#include "ecg_processor.h"
+#include "hrv_engine.h"
+#include "../synthetic_ecg.h"
+
+#define RATE_HZ 250
+#define DURATION_S 300
+#define MAX_BEATS (DURATION_S * 4)
+
+static int signal[DURATION_S * RATE_HZ];
+static uint32_t rPeaks[MAX_BEATS];
+
+void setUp() {}
+void tearDown() {}
+
+/**
+ * Detector output positions, in samples from the start of the recording
+ *
+ * @return Number of detections
+ */
+static int detect(const int *samples, int count, uint32_t *found, int maxFound) {
+  PanTompkinsDetector detector(RATE_HZ);
+  int n = 0;
+  for (int i = 0; i < count; i++) {
+    PanTompkinsPeak peak;
+    if (detector.processSample(samples[i], &peak) && n < maxFound) {
+      found[n++] = (uint32_t)i - peak.samplesAgo;
+    }
+  }
+  return n;
+}
+
+static void test_nothing_reported_while_learning() {
+  SyntheticEcgConfig config = syntheticEcgDefaults(RATE_HZ);
+  int beats = syntheticConstantRr(300, 800, 10000, rPeaks, MAX_BEATS);
+  syntheticEcg(config, rPeaks, beats, signal, 10 * RATE_HZ);
+
+  PanTompkinsDetector detector(RATE_HZ);
+  for (int i = 0; i < 2 * RATE_HZ; i++) {
+    PanTompkinsPeak peak;
+    TEST_ASSERT_FALSE(detector.processSample(signal[i], &peak));
+  }
+}
+
+// Beats are reported at the R wave, so a constant-rate recording gives
+// constant intervals despite baseline wander and a P wave
+static void test_constant_rr_has_no_jitter() {
+  SyntheticEcgConfig config = syntheticEcgDefaults(RATE_HZ);
+  int beats = syntheticConstantRr(500, 800, DURATION_S * 1000, rPeaks, MAX_BEATS);
+  syntheticEcg(config, rPeaks, beats, signal, DURATION_S * RATE_HZ);
+
+  EcgProcessor processor(RATE_HZ, ECG_DETECTOR_PAN_TOMPKINS);
+  static HrvEngine hrv(HRV_MAX_WINDOW_MS);
+  hrv.reset();
+  EcgBeat found[ECG_MAX_BEATS_PER_BLOCK];
+  for (int i = 0; i < DURATION_S * RATE_HZ; i += 25) {
+    int n = processor.processBlock(&signal[i], 25, found, ECG_MAX_BEATS_PER_BLOCK);
+    for (int b = 0; b < n; b++) {
+      if (found[b].rrInterval > 0) {
+        hrv.addInterval(found[b].timeMs, found[b].rrInterval);
+      }
+    }
+  }
+
+  HrvMetrics metrics;
+  hrv.getMetrics(&metrics);
+  TEST_ASSERT_INT_WITHIN(5, beats - 1, metrics.intervals);
+  TEST_ASSERT_LESS_THAN_FLOAT(2.0f, metrics.sdnn);
+  TEST_ASSERT_LESS_THAN_FLOAT(2.0f, metrics.rmssd);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, metrics.pnn50);
+}
+
+static void test_reported_peak_tracks_r_wave() {
+  SyntheticEcgConfig config = syntheticEcgDefaults(RATE_HZ);
+  config.wanderAmplitude = 150.0f;
+  // Alternating short and long intervals shift the integrator peak differently
+  int beats = 0;
+  for (uint32_t t = 500; t < 60000 && beats < MAX_BEATS; t += beats % 2 ? 650 : 950) {
+    rPeaks[beats++] = t;
+  }
+  syntheticEcg(config, rPeaks, beats, signal, 60 * RATE_HZ);
+
+  static uint32_t found[MAX_BEATS];
+  int n = detect(signal, 60 * RATE_HZ, found, MAX_BEATS);
+  TEST_ASSERT_INT_WITHIN(3, beats, n);
+
+  // Match each detection to the nearest true R peak; the offset is the
+  // constant bandpass delay, within a sample
+  int minOffset = 1000, maxOffset = -1000;
+  int matched = 0;
+  for (int i = 0; i < n; i++) {
+    int sampleMs = found[i] * 1000 / RATE_HZ;
+    for (int b = 0; b < beats; b++) {
+      int offset = sampleMs - (int)rPeaks[b];
+      if (offset > -100 && offset < 100) {
+        minOffset = offset < minOffset ? offset : minOffset;
+        maxOffset = offset > maxOffset ? offset : maxOffset;
+        matched++;
+        break;
+      }
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(n, matched);
+  TEST_ASSERT_LESS_OR_EQUAL_INT(1000 / RATE_HZ, maxOffset - minOffset);
+}
+
+static void test_tall_t_wave_is_not_a_beat() {
+  SyntheticEcgConfig config = syntheticEcgDefaults(RATE_HZ);
+  int beats = syntheticConstantRr(500, 1000, 60000, rPeaks, MAX_BEATS);
+  syntheticEcg(config, rPeaks, beats, signal, 60 * RATE_HZ);
+  // Raise the T wave to 60% of R
+  for (int i = 0; i < 60 * RATE_HZ; i++) {
+    float t = i * 1000.0f / RATE_HZ;
+    for (int b = 0; b < beats; b++) {
+      signal[i] += (int)syntheticWave(t, rPeaks[b] + 250.0f, 45.0f, 0.3f * config.rAmplitude);
+    }
+  }
+
+  static uint32_t found[MAX_BEATS];
+  int n = detect(signal, 60 * RATE_HZ, found, MAX_BEATS);
+  TEST_ASSERT_INT_WITHIN(2, beats, n);
+}
+
+static void test_searchback_recovers_small_beat() {
+  SyntheticEcgConfig config = syntheticEcgDefaults(RATE_HZ);
+  int beats = syntheticConstantRr(500, 800, 30000, rPeaks, MAX_BEATS);
+  syntheticEcg(config, rPeaks, beats, signal, 30 * RATE_HZ);
+  // One beat at 40% height, below the primary thresholds
+  uint32_t small = rPeaks[20];
+  for (int i = (small - 200) * RATE_HZ / 1000; i < (int)(small + 400) * RATE_HZ / 1000; i++) {
+    float t = i * 1000.0f / RATE_HZ;
+    signal[i] -= (int)(0.6f * syntheticWave(t, (float)small, 10.0f, config.rAmplitude));
+  }
+
+  static uint32_t found[MAX_BEATS];
+  int n = detect(signal, 30 * RATE_HZ, found, MAX_BEATS);
+  bool recovered = false;
+  for (int i = 0; i < n; i++) {
+    int offset = (int)(found[i] * 1000 / RATE_HZ) - (int)small;
+    recovered |= offset > -100 && offset < 100;
+  }
+  TEST_ASSERT_TRUE(recovered);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_nothing_reported_while_learning);
+  RUN_TEST(test_constant_rr_has_no_jitter);
+  RUN_TEST(test_reported_peak_tracks_r_wave);
+  RUN_TEST(test_tall_t_wave_is_not_a_beat);
+  RUN_TEST(test_searchback_recovers_small_beat);
+  return UNITY_END();
+}
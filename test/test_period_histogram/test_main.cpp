@@ -0,0 +1,115 @@
+/**
+ * ElderGuard - PeriodHistogram native tests
+ *
+ * Wakeups at known offsets from the nominal period land in the buckets
+ * getBucketLimitPct() describes, including across a 32-bit clock wrap.
+ */
+
+#include <unity.h>
+#include "period_histogram.h"
+
+#define PERIOD_US 100000
+
+void setUp() {}
+void tearDown() {}
+
+// Wake once at 0, then once more pct percent of the period later
+static int bucketFor(uint32_t pct) {
+  PeriodHistogram histogram;
+  histogram.setPeriod(PERIOD_US);
+  histogram.wake(0);
+  histogram.wake(pct * PERIOD_US / 100);
+  for (int bucket = 0; bucket < PERIOD_HISTOGRAM_BUCKETS; bucket++) {
+    if (histogram.getCount(bucket) == 1) {
+      return bucket;
+    }
+  }
+  return -1;
+}
+
+static void test_bucket_bounds() {
+  const int limits[] = { 50, 90, 110, 150, 200, 400, 0 };
+  for (int bucket = 0; bucket < PERIOD_HISTOGRAM_BUCKETS; bucket++) {
+    TEST_ASSERT_EQUAL(limits[bucket], PeriodHistogram::getBucketLimitPct(bucket));
+  }
+
+  // Each upper bound belongs to the next bucket
+  TEST_ASSERT_EQUAL(0, bucketFor(0));
+  TEST_ASSERT_EQUAL(0, bucketFor(49));
+  TEST_ASSERT_EQUAL(1, bucketFor(50));
+  TEST_ASSERT_EQUAL(1, bucketFor(89));
+  TEST_ASSERT_EQUAL(2, bucketFor(90));
+  TEST_ASSERT_EQUAL(2, bucketFor(100));
+  TEST_ASSERT_EQUAL(3, bucketFor(110));
+  TEST_ASSERT_EQUAL(4, bucketFor(150));
+  TEST_ASSERT_EQUAL(5, bucketFor(200));
+  TEST_ASSERT_EQUAL(5, bucketFor(399));
+  TEST_ASSERT_EQUAL(6, bucketFor(400));
+  TEST_ASSERT_EQUAL(6, bucketFor(40000));
+}
+
+static void test_periods_and_busy_time() {
+  PeriodHistogram histogram;
+  histogram.setPeriod(PERIOD_US);
+
+  // A wait() before any wake() is ignored
+  histogram.wait(5);
+  histogram.wake(0);
+  histogram.wait(2000);
+  histogram.wake(100000);
+  histogram.wait(101000);
+  // Woken early, and a wakeup without a wait
+  histogram.wake(140000);
+  histogram.wake(300000);
+  histogram.wait(310000);
+  // A second wait() for the same wakeup counts nothing
+  histogram.wait(390000);
+  histogram.wake(1300000);
+
+  TEST_ASSERT_EQUAL_UINT32(4, histogram.getWakeups());
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getCount(0));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getCount(2));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getCount(4));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getCount(6));
+  TEST_ASSERT_EQUAL_UINT32(1000000, histogram.getWorstPeriodUs());
+  TEST_ASSERT_EQUAL_UINT32(10000, histogram.getWorstBusyUs());
+  TEST_ASSERT_TRUE(histogram.getBusyUs() == 2000 + 1000 + 10000);
+}
+
+static void test_clock_wrap() {
+  PeriodHistogram histogram;
+  histogram.setPeriod(PERIOD_US);
+  uint32_t start = 0xFFFFFFFFu - 30000;
+  histogram.wake(start);
+  histogram.wake(start + PERIOD_US);
+  histogram.wait(start + PERIOD_US + 50000);
+
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getCount(2));
+  TEST_ASSERT_EQUAL_UINT32(PERIOD_US, histogram.getWorstPeriodUs());
+  TEST_ASSERT_EQUAL_UINT32(50000, histogram.getWorstBusyUs());
+}
+
+static void test_nothing_binned_without_a_period() {
+  PeriodHistogram histogram;
+  histogram.wake(0);
+  histogram.wake(100000);
+  histogram.wait(150000);
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.getWakeups());
+  // Busy time does not depend on the period
+  TEST_ASSERT_EQUAL_UINT32(50000, histogram.getWorstBusyUs());
+
+  // Set later: binning starts from the next wakeup
+  histogram.setPeriod(PERIOD_US);
+  histogram.wake(200000);
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getWakeups());
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getCount(2));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bucket_bounds);
+  RUN_TEST(test_periods_and_busy_time);
+  RUN_TEST(test_clock_wrap);
+  RUN_TEST(test_nothing_binned_without_a_period);
+  return UNITY_END();
+}
@@ -0,0 +1,382 @@
+/**
+ * ElderGuard - PubackTapClient native tests
+ *
+ * The MQTT task's QoS 1 path against a scripted broker: a Client that
+ * parses what it is sent, and drops or delays PUBACKs, takes short writes
+ * and loses its connection on cue. Each loop step does what the task's
+ * loop does: reconnect through the tap if the connection is gone (as
+ * PubSubClient::connect() would), read everything the broker sent (as
+ * PubSubClient::loop() does) and resend what is due.
+ */
+
+#include <deque>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "puback_tap_client.h"
+
+#define RETRY_MS 10000
+#define TOPIC "elderguard/patient/1/realtime"
+
+typedef struct {
+    uint16_t packetId;
+    bool dup;
+    std::string payload;
+} ReceivedPublish;
+
+static uint32_t nowMs;
+
+static uint32_t clockMs() {
+  return nowMs;
+}
+
+// The broker end of the connection
+class FakeBroker : public Client {
+public:
+    int connects = 0;
+    int acceptBytes = -1;        // Bytes taken before writes come up short, or -1
+    int dropAcks = 0;            // PUBACKs to leave unsent
+    uint32_t ackDelayMs = 0;     // Time before a PUBACK is sent
+    std::vector<ReceivedPublish> publishes;
+
+    // Send PUBACKs whose delay is over
+    void deliverDue() {
+        while (!delayed.empty() && (int32_t)(nowMs - delayed.front().dueMs) >= 0) {
+            queuePuback(delayed.front().packetId);
+            delayed.pop_front();
+        }
+    }
+
+    int connect(IPAddress, uint16_t) override { return open(); }
+    int connect(const char *, uint16_t) override { return open(); }
+
+    size_t write(uint8_t value) override { return write(&value, 1); }
+    size_t write(const uint8_t *buf, size_t size) override {
+        if (!isOpen) {
+            return 0;
+        }
+        if (acceptBytes >= 0 && size > (size_t)acceptBytes) {
+            size = acceptBytes;
+        }
+        if (acceptBytes >= 0) {
+            acceptBytes -= size;
+        }
+        for (size_t i = 0; i < size; i++) {
+            partial.push_back(buf[i]);
+            parsePacket();
+        }
+        return size;
+    }
+
+    int available() override { return toClient.size(); }
+    int read() override {
+        if (toClient.empty()) {
+            return -1;
+        }
+        int value = toClient.front();
+        toClient.pop_front();
+        return value;
+    }
+    int read(uint8_t *buf, size_t size) override {
+        if (toClient.empty()) {
+            return -1;
+        }
+        size_t count = 0;
+        while (count < size && !toClient.empty()) {
+            buf[count++] = toClient.front();
+            toClient.pop_front();
+        }
+        return count;
+    }
+    int peek() override { return toClient.empty() ? -1 : toClient.front(); }
+    void flush() override {}
+
+    // Whatever was on the wire either way is lost with the connection
+    void stop() override {
+        isOpen = false;
+        partial.clear();
+        toClient.clear();
+        delayed.clear();
+    }
+    uint8_t connected() override { return isOpen; }
+    operator bool() override { return isOpen; }
+
+private:
+    struct DelayedAck {
+        uint32_t dueMs;
+        uint16_t packetId;
+    };
+
+    bool isOpen = false;
+    std::vector<uint8_t> partial;
+    std::deque<uint8_t> toClient;
+    std::deque<DelayedAck> delayed;
+
+    int open() {
+        isOpen = true;
+        connects++;
+        // CONNACK, session present
+        const uint8_t connack[] = { 0x20, 0x02, 0x01, 0x00 };
+        toClient.insert(toClient.end(), connack, connack + sizeof(connack));
+        return 1;
+    }
+
+    void queuePuback(uint16_t packetId) {
+        const uint8_t puback[] = { 0x40, 0x02, (uint8_t)(packetId >> 8), (uint8_t)packetId };
+        toClient.insert(toClient.end(), puback, puback + sizeof(puback));
+    }
+
+    // Take a packet off the front of partial once all of it is in
+    void parsePacket() {
+        uint32_t remaining = 0;
+        size_t pos = 1;
+        int shift = 0;
+        do {
+            if (pos >= partial.size()) {
+                return;
+            }
+            remaining |= (uint32_t)(partial[pos] & 0x7F) << shift;
+            shift += 7;
+        } while (partial[pos++] & 0x80);
+        if (partial.size() < pos + remaining) {
+            return;
+        }
+
+        TEST_ASSERT_EQUAL_HEX8(0x32, partial[0] & ~0x08);
+        int topicLength = (partial[pos] << 8) | partial[pos + 1];
+        TEST_ASSERT_EQUAL(0, memcmp(&partial[pos + 2], TOPIC, topicLength));
+        size_t idAt = pos + 2 + topicLength;
+        ReceivedPublish publish;
+        publish.packetId = (uint16_t)((partial[idAt] << 8) | partial[idAt + 1]);
+        publish.dup = (partial[0] & 0x08) != 0;
+        publish.payload.assign(partial.begin() + idAt + 2, partial.begin() + pos + remaining);
+        publishes.push_back(publish);
+        partial.clear();
+
+        if (dropAcks > 0) {
+            dropAcks--;
+        } else if (ackDelayMs > 0) {
+            delayed.push_back({ nowMs + ackDelayMs, publish.packetId });
+        } else {
+            queuePuback(publish.packetId);
+        }
+    }
+};
+
+static FakeBroker *broker;
+static MqttInflightWindow *inflight;
+static PubackTapClient *tap;
+
+void setUp() {
+  nowMs = 1000;
+  broker = new FakeBroker();
+  inflight = new MqttInflightWindow(RETRY_MS);
+  tap = new PubackTapClient(*broker, *inflight, clockMs);
+}
+
+void tearDown() {
+  delete tap;
+  delete inflight;
+  delete broker;
+}
+
+// One pass of the MQTT task's loop; bytes are read one at a time, as PubSubClient does
+static bool loopOnce() {
+  if (!tap->connected()) {
+    tap->connect("broker", 8883);
+  }
+  broker->deliverDue();
+  while (tap->available() > 0) {
+    tap->read();
+  }
+  return tap->resendDue();
+}
+
+// publishRealtime(): resends first, then the new message
+static MqttInflightResult publish(const char *payload, bool *written) {
+  tap->resendDue();
+  const uint8_t *packet;
+  int length;
+  MqttInflightResult result = inflight->add(TOPIC, (const uint8_t *)payload, strlen(payload), nowMs,
+                                            &packet, &length);
+  *written = result == MQTT_INFLIGHT_ADDED && tap->writePacket(packet, length);
+  return result;
+}
+
+static void assertPublish(size_t index, const char *payload, bool dup) {
+  TEST_ASSERT_LESS_THAN(broker->publishes.size(), index);
+  TEST_ASSERT_EQUAL_STRING(payload, broker->publishes[index].payload.c_str());
+  TEST_ASSERT_EQUAL(dup, broker->publishes[index].dup);
+}
+
+static void test_pubacks_read_by_the_mqtt_client_empty_the_window() {
+  loopOnce();
+  bool written;
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_ADDED, publish("a", &written));
+  TEST_ASSERT_TRUE(written);
+  publish("b", &written);
+  publish("c", &written);
+  TEST_ASSERT_EQUAL(3, inflight->getCount());
+
+  // A bulk read sees the PUBACKs as well as single-byte reads do
+  uint8_t buf[5];
+  TEST_ASSERT_EQUAL(5, tap->read(buf, sizeof(buf)));
+  loopOnce();
+  TEST_ASSERT_EQUAL(0, inflight->getCount());
+  TEST_ASSERT_EQUAL_UINT32(3, inflight->getAckedCount());
+  TEST_ASSERT_EQUAL_UINT32(0, inflight->getRetransmitCount());
+  TEST_ASSERT_EQUAL(3, (int)broker->publishes.size());
+  assertPublish(0, "a", false);
+  assertPublish(2, "c", false);
+  TEST_ASSERT_EQUAL(1, broker->connects);
+}
+
+static void test_lost_puback_is_resent_after_the_retry_time() {
+  loopOnce();
+  broker->dropAcks = 1;
+  bool written;
+  publish("a", &written);
+  publish("b", &written);
+  loopOnce();
+  TEST_ASSERT_EQUAL(1, inflight->getCount());
+
+  nowMs += RETRY_MS - 1;
+  loopOnce();
+  TEST_ASSERT_EQUAL(2, (int)broker->publishes.size());
+
+  nowMs += 1;
+  loopOnce();
+  loopOnce();
+  TEST_ASSERT_EQUAL(3, (int)broker->publishes.size());
+  assertPublish(2, "a", true);
+  TEST_ASSERT_EQUAL(broker->publishes[0].packetId, broker->publishes[2].packetId);
+  TEST_ASSERT_EQUAL(0, inflight->getCount());
+  TEST_ASSERT_EQUAL_UINT32(1, inflight->getRetransmitCount());
+}
+
+static void test_late_puback_is_waited_for_not_resent() {
+  loopOnce();
+  broker->ackDelayMs = RETRY_MS / 2;
+  bool written;
+  publish("a", &written);
+
+  nowMs += RETRY_MS / 2 - 1;
+  loopOnce();
+  TEST_ASSERT_EQUAL(1, inflight->getCount());
+  nowMs += 1;
+  loopOnce();
+  TEST_ASSERT_EQUAL(0, inflight->getCount());
+  TEST_ASSERT_EQUAL_UINT32(RETRY_MS / 2, inflight->getWorstAckMs());
+
+  nowMs += RETRY_MS;
+  loopOnce();
+  TEST_ASSERT_EQUAL(1, (int)broker->publishes.size());
+  TEST_ASSERT_EQUAL_UINT32(0, inflight->getRetransmitCount());
+}
+
+static void test_short_write_reconnects_and_resends_in_order() {
+  loopOnce();
+  broker->dropAcks = 1;
+  bool written;
+  publish("first", &written);
+  TEST_ASSERT_TRUE(written);
+
+  // Half a packet would leave the broker mid-packet, so the tap hangs up
+  broker->acceptBytes = 10;
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_ADDED, publish("second", &written));
+  TEST_ASSERT_FALSE(written);
+  TEST_ASSERT_FALSE(broker->connected());
+  TEST_ASSERT_EQUAL(1, (int)broker->publishes.size());
+  TEST_ASSERT_EQUAL(2, inflight->getCount());
+
+  // The reconnect makes both due at once, oldest first
+  broker->acceptBytes = -1;
+  TEST_ASSERT_TRUE(loopOnce());
+  TEST_ASSERT_EQUAL(2, broker->connects);
+  TEST_ASSERT_EQUAL(3, (int)broker->publishes.size());
+  assertPublish(1, "first", true);
+  assertPublish(2, "second", true);
+  loopOnce();
+  TEST_ASSERT_EQUAL(0, inflight->getCount());
+  TEST_ASSERT_EQUAL(3, (int)broker->publishes.size());
+}
+
+static void test_short_write_while_resending_tries_again_on_the_next_connection() {
+  loopOnce();
+  broker->dropAcks = 3;
+  bool written;
+  publish("a", &written);
+  publish("b", &written);
+  publish("c", &written);
+  broker->stop();
+
+  // The second resend comes up short: the rest wait for the next connection
+  const int firstResend = mqttPublishPacketBytes(strlen(TOPIC), 1);
+  broker->acceptBytes = firstResend + 3;
+  TEST_ASSERT_FALSE(loopOnce());
+  TEST_ASSERT_FALSE(broker->connected());
+  TEST_ASSERT_EQUAL(4, (int)broker->publishes.size());
+  assertPublish(3, "a", true);
+
+  broker->acceptBytes = -1;
+  TEST_ASSERT_TRUE(loopOnce());
+  loopOnce();
+  TEST_ASSERT_EQUAL(3, broker->connects);
+  TEST_ASSERT_EQUAL(7, (int)broker->publishes.size());
+  assertPublish(4, "a", true);
+  assertPublish(5, "b", true);
+  assertPublish(6, "c", true);
+  TEST_ASSERT_EQUAL(0, inflight->getCount());
+}
+
+static void test_connection_lost_mid_puback_restarts_the_framing() {
+  loopOnce();
+  bool written;
+  publish("a", &written);
+  // Half of the PUBACK is read, then the connection drops
+  tap->read();
+  tap->read();
+  broker->stop();
+  TEST_ASSERT_EQUAL(1, inflight->getCount());
+
+  // The CONNACK on the new connection is not taken for the rest of it
+  loopOnce();
+  loopOnce();
+  TEST_ASSERT_EQUAL(0, inflight->getCount());
+  TEST_ASSERT_EQUAL(2, (int)broker->publishes.size());
+  assertPublish(1, "a", true);
+}
+
+static void test_full_window_waits_for_the_broker() {
+  loopOnce();
+  broker->dropAcks = MQTT_INFLIGHT_WINDOW;
+  bool written;
+  for (int i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    TEST_ASSERT_EQUAL(MQTT_INFLIGHT_ADDED, publish("x", &written));
+  }
+  loopOnce();
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_FULL, publish("y", &written));
+  TEST_ASSERT_FALSE(written);
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_WINDOW, (int)broker->publishes.size());
+
+  // The retry gets the PUBACKs and makes room
+  nowMs += RETRY_MS;
+  loopOnce();
+  loopOnce();
+  TEST_ASSERT_EQUAL(0, inflight->getCount());
+  TEST_ASSERT_EQUAL(MQTT_INFLIGHT_ADDED, publish("y", &written));
+  TEST_ASSERT_TRUE(written);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_pubacks_read_by_the_mqtt_client_empty_the_window);
+  RUN_TEST(test_lost_puback_is_resent_after_the_retry_time);
+  RUN_TEST(test_late_puback_is_waited_for_not_resent);
+  RUN_TEST(test_short_write_reconnects_and_resends_in_order);
+  RUN_TEST(test_short_write_while_resending_tries_again_on_the_next_connection);
+  RUN_TEST(test_connection_lost_mid_puback_restarts_the_framing);
+  RUN_TEST(test_full_window_waits_for_the_broker);
+  return UNITY_END();
+}
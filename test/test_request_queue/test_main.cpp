@@ -0,0 +1,194 @@
+/**
+ * ElderGuard - RequestQueue native tests
+ *
+ * Priority order, eviction when full, backoff with jitter and deadlines,
+ * with the clock also run across a 32-bit wrap.
+ */
+
+#include <unity.h>
+#include "request_queue.h"
+
+#define BASE_MS 1000
+#define MAX_MS 8000
+
+typedef struct {
+    int id;
+} Request;
+
+typedef RequestQueue<Request, 4> Queue;
+
+void setUp() {}
+void tearDown() {}
+
+static void push(Queue &queue, int id, int priority, uint32_t nowMs, uint32_t timeoutMs) {
+  Request request = { id };
+  TEST_ASSERT_EQUAL(0, queue.push(request, priority, nowMs, timeoutMs, NULL));
+}
+
+// Take the next due request, check it and remove it
+static void completeNext(Queue &queue, uint32_t nowMs, int expectedId) {
+  Request *request = queue.next(nowMs);
+  TEST_ASSERT_NOT_NULL(request);
+  TEST_ASSERT_EQUAL(expectedId, request->id);
+  queue.complete(request);
+}
+
+static void test_most_urgent_first_then_fifo() {
+  Queue queue(BASE_MS, MAX_MS);
+  push(queue, 1, 2, 0, 30000);
+  push(queue, 2, 0, 0, 30000);
+  push(queue, 3, 1, 0, 30000);
+  push(queue, 4, 0, 0, 30000);
+  TEST_ASSERT_EQUAL(4, queue.getCount());
+
+  completeNext(queue, 0, 2);
+  completeNext(queue, 0, 4);
+  completeNext(queue, 0, 3);
+  completeNext(queue, 0, 1);
+  TEST_ASSERT_NULL(queue.next(0));
+  TEST_ASSERT_EQUAL(0, queue.getCount());
+}
+
+static void test_waiting_request_lets_a_less_urgent_one_go() {
+  Queue queue(BASE_MS, MAX_MS);
+  push(queue, 1, 0, 0, 30000);
+  push(queue, 2, 3, 0, 30000);
+
+  Request *alert = queue.next(0);
+  TEST_ASSERT_TRUE(queue.retry(alert, 0));
+  TEST_ASSERT_EQUAL(1, queue.getAttempts(alert));
+
+  // The alert is backing off, so telemetry goes; once due the alert wins again
+  completeNext(queue, 0, 2);
+  uint32_t wait = queue.msUntilNext(0, 60000);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(BASE_MS, wait);
+  TEST_ASSERT_NULL(queue.next(wait - 1));
+  push(queue, 3, 3, wait, 30000);
+  completeNext(queue, wait, 1);
+  completeNext(queue, wait, 3);
+}
+
+static void test_full_queue_evicts_the_newest_least_urgent() {
+  Queue queue(BASE_MS, MAX_MS);
+  push(queue, 1, 1, 0, 30000);
+  push(queue, 2, 3, 0, 30000);
+  push(queue, 3, 3, 0, 30000);
+  push(queue, 4, 2, 0, 30000);
+
+  Request evicted = { 0 };
+  Request alert = { 5 };
+  TEST_ASSERT_EQUAL(1, queue.push(alert, 0, 0, 30000, &evicted));
+  TEST_ASSERT_EQUAL(3, evicted.id);
+  TEST_ASSERT_EQUAL_UINT32(1, queue.getEvictedCount());
+
+  // Equal priority never evicts, and neither does a less urgent request
+  Request telemetry = { 6 };
+  evicted.id = 0;
+  TEST_ASSERT_EQUAL(1, queue.push(telemetry, 2, 0, 30000, &evicted));
+  TEST_ASSERT_EQUAL(2, evicted.id);
+  TEST_ASSERT_EQUAL(-1, queue.push(telemetry, 2, 0, 30000, &evicted));
+  TEST_ASSERT_EQUAL(-1, queue.push(telemetry, 3, 0, 30000, NULL));
+  TEST_ASSERT_EQUAL_UINT32(2, queue.getEvictedCount());
+
+  completeNext(queue, 0, 5);
+  completeNext(queue, 0, 1);
+  completeNext(queue, 0, 4);
+  completeNext(queue, 0, 6);
+}
+
+static void test_backoff_doubles_to_the_cap_with_jitter() {
+  Queue queue(BASE_MS, MAX_MS);
+  push(queue, 1, 0, 0, 0xFFFFFFF);
+
+  uint32_t now = 0;
+  uint32_t expected = BASE_MS;
+  for (int attempt = 1; attempt <= 8; attempt++) {
+    Request *request = queue.next(now);
+    TEST_ASSERT_NOT_NULL(request);
+    TEST_ASSERT_TRUE(queue.retry(request, now));
+    TEST_ASSERT_EQUAL(attempt, queue.getAttempts(request));
+
+    // The delay, plus up to half of it again
+    uint32_t wait = queue.msUntilNext(now, 0xFFFFFFFF);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(expected, wait);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(expected + expected / 2, wait);
+    TEST_ASSERT_NULL(queue.next(now + wait - 1));
+    now += wait;
+    if (expected < MAX_MS) {
+      expected *= 2;
+    }
+  }
+}
+
+static void test_jitter_spreads_requests_that_failed_together() {
+  Queue queue(BASE_MS, MAX_MS);
+  for (int id = 1; id <= 4; id++) {
+    push(queue, id, 0, 0, 60000);
+  }
+  // Fail all four at once and look at when each comes back
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(queue.retry(queue.next(0), 0));
+  }
+  uint32_t first = queue.msUntilNext(0, 0xFFFFFFFF);
+  int dueTogether = 0;
+  Request *request;
+  while ((request = queue.next(first)) != NULL) {
+    queue.complete(request);
+    dueTogether++;
+  }
+  TEST_ASSERT_LESS_THAN(4, dueTogether);
+}
+
+static void test_deadlines() {
+  Queue queue(BASE_MS, MAX_MS);
+
+  // A retry that would land after the deadline hands the request back
+  push(queue, 1, 0, 0, 2000);
+  Request *request = queue.next(0);
+  TEST_ASSERT_TRUE(queue.retry(request, 0));
+  uint32_t now = queue.msUntilNext(0, 60000);
+  request = queue.next(now);
+  TEST_ASSERT_NOT_NULL(request);
+  TEST_ASSERT_FALSE(queue.retry(request, now));
+  TEST_ASSERT_EQUAL(0, queue.getCount());
+
+  // An untried request expires once its deadline has passed
+  push(queue, 2, 3, 100, 500);
+  Request expired = { 0 };
+  TEST_ASSERT_FALSE(queue.takeExpired(600, &expired));
+  TEST_ASSERT_TRUE(queue.takeExpired(601, &expired));
+  TEST_ASSERT_EQUAL(2, expired.id);
+  TEST_ASSERT_EQUAL(0, queue.getCount());
+}
+
+static void test_clock_wrap() {
+  Queue queue(BASE_MS, MAX_MS);
+  uint32_t start = 0xFFFFFFFFu - 500;
+  push(queue, 1, 0, start, 10000);
+  push(queue, 2, 1, start, 10000);
+
+  Request *request = queue.next(start);
+  TEST_ASSERT_EQUAL(1, request->id);
+  TEST_ASSERT_TRUE(queue.retry(request, start));
+  completeNext(queue, start, 2);
+  uint32_t wait = queue.msUntilNext(start, 60000);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(BASE_MS, wait);
+  TEST_ASSERT_NULL(queue.next(start + wait - 1));
+
+  // Due after the wrap, and not expired by it
+  Request expired;
+  TEST_ASSERT_FALSE(queue.takeExpired(start + wait, &expired));
+  completeNext(queue, start + wait, 1);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_most_urgent_first_then_fifo);
+  RUN_TEST(test_waiting_request_lets_a_less_urgent_one_go);
+  RUN_TEST(test_full_queue_evicts_the_newest_least_urgent);
+  RUN_TEST(test_backoff_doubles_to_the_cap_with_jitter);
+  RUN_TEST(test_jitter_spreads_requests_that_failed_together);
+  RUN_TEST(test_deadlines);
+  RUN_TEST(test_clock_wrap);
+  return UNITY_END();
+}
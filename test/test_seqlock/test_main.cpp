@@ -0,0 +1,111 @@
+/**
+ * ElderGuard - SeqLock native tests
+ *
+ * Each record written is self-consistent (every field derived from one
+ * counter), so a torn read shows up as a record whose fields disagree.
+ */
+
+#include <atomic>
+#include <thread>
+#include <unity.h>
+#include "seqlock.h"
+
+typedef struct {
+    uint32_t counter;
+    uint32_t inverted;
+    float scaled;
+    uint8_t low;
+    bool odd;
+    char tag[11];
+} Record;
+
+static Record makeRecord(uint32_t counter) {
+  Record record;
+  memset(&record, 0, sizeof(record));
+  record.counter = counter;
+  record.inverted = ~counter;
+  record.scaled = (float)(counter & 0xFFFF) * 0.5f;
+  record.low = (uint8_t)counter;
+  record.odd = counter & 1;
+  snprintf(record.tag, sizeof(record.tag), "%lu", (unsigned long)counter);
+  return record;
+}
+
+static bool isConsistent(const Record &record) {
+  Record expected = makeRecord(record.counter);
+  return memcmp(&expected, &record, sizeof(Record)) == 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_load_returns_latest_store() {
+  SeqLock<Record> lock;
+  Record out;
+  lock.load(&out);
+  TEST_ASSERT_EQUAL_UINT32(0, out.counter);
+
+  lock.store(makeRecord(41));
+  lock.store(makeRecord(42));
+  lock.load(&out);
+  TEST_ASSERT_TRUE(isConsistent(out));
+  TEST_ASSERT_EQUAL_UINT32(42, out.counter);
+  TEST_ASSERT_EQUAL_UINT32(2, lock.getWrites());
+  TEST_ASSERT_EQUAL_UINT32(0, lock.getRetries());
+}
+
+static void test_concurrent_readers_never_see_torn_records() {
+  static SeqLock<Record> lock;
+  const uint32_t writes = 3000000;
+  std::atomic<bool> done(false);
+  std::atomic<int> torn(0);
+  std::atomic<int> backwards(0);
+
+  std::thread writer([&]() {
+    for (uint32_t i = 1; i <= writes; i++) {
+      lock.store(makeRecord(i));
+    }
+    done.store(true);
+  });
+
+  std::thread readers[2];
+  for (int r = 0; r < 2; r++) {
+    readers[r] = std::thread([&]() {
+      uint32_t last = 0;
+      while (!done.load()) {
+        Record out;
+        lock.load(&out);
+        if (!isConsistent(out)) {
+          torn++;
+        }
+        if (out.counter < last) {
+          backwards++;
+        }
+        last = out.counter;
+      }
+    });
+  }
+
+  writer.join();
+  for (int r = 0; r < 2; r++) {
+    readers[r].join();
+  }
+
+  Record out;
+  lock.load(&out);
+  TEST_ASSERT_EQUAL_INT(0, torn.load());
+  TEST_ASSERT_EQUAL_INT(0, backwards.load());
+  TEST_ASSERT_EQUAL_UINT32(writes, out.counter);
+  TEST_ASSERT_EQUAL_UINT32(writes, lock.getWrites());
+
+  char message[64];
+  snprintf(message, sizeof(message), "%lu reader retries", (unsigned long)lock.getRetries());
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_load_returns_latest_store);
+  RUN_TEST(test_concurrent_readers_never_see_torn_records);
+  return UNITY_END();
+}
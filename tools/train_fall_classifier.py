@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""
+ElderGuard - Fall Classifier Training and Export
+
+Trains the int8 logistic model used by src/processing/fall_classifier.cpp
+and writes include/fall_classifier_model.h.
+
+Input is a CSV with the columns
+
+    sma,jerk,stillness,orientation,label
+
+one row per fall candidate, label 1 for a real fall and 0 for anything
+else. The device prints these values for every candidate that reaches the
+classifier:
+
+    Fall Detection Task: Classifier sma=1.061 jerk=483.2 stillness=0.0060 orientation=80.0 score=290 fall
+
+so a dataset is built by logging trial falls and near-misses (sitting down
+hard, dropping onto a bed) and labelling each line.
+
+Usage:
+    python3 tools/train_fall_classifier.py candidates.csv [-o include/fall_classifier_model.h]
+"""
+
+import argparse
+import csv
+import math
+import sys
+
+FEATURES = ["sma", "jerk", "stillness", "orientation"]
+
+# Quantized input = round(feature * scale), clamped to int8. Chosen so the
+# useful range of each feature fills most of the int8 range.
+FEATURE_SCALES = [32.0, 0.5, 256.0, 1.0]
+
+
+def quantize(value, scale):
+    # Halves round away from zero as roundf() does on the device; round()
+    # would round them to even
+    scaled = math.copysign(math.floor(abs(value * scale) + 0.5), value)
+    return max(-128, min(127, int(scaled)))
+
+
+def load(path):
+    inputs, labels = [], []
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            inputs.append([quantize(float(row[name]), scale)
+                           for name, scale in zip(FEATURES, FEATURE_SCALES)])
+            labels.append(int(row["label"]))
+    if not inputs:
+        sys.exit("no rows in " + path)
+    return inputs, labels
+
+
+def train(inputs, labels, epochs=5000, rate=0.1, l2=1e-3):
+    """Logistic regression by batch gradient descent on standardized inputs."""
+    n, d = len(inputs), len(FEATURES)
+    mean = [sum(x[j] for x in inputs) / n for j in range(d)]
+    std = [math.sqrt(sum((x[j] - mean[j]) ** 2 for x in inputs) / n) or 1.0 for j in range(d)]
+    z = [[(x[j] - mean[j]) / std[j] for j in range(d)] for x in inputs]
+
+    w, b = [0.0] * d, 0.0
+    for _ in range(epochs):
+        gw, gb = [l2 * wj for wj in w], 0.0
+        for x, y in zip(z, labels):
+            logit = b + sum(wj * xj for wj, xj in zip(w, x))
+            p = 1.0 / (1.0 + math.exp(-max(-30.0, min(30.0, logit))))
+            for j in range(d):
+                gw[j] += (p - y) * x[j] / n
+            gb += (p - y) / n
+        w = [wj - rate * g for wj, g in zip(w, gw)]
+        b -= rate * gb
+
+    # Fold the standardization back into weights on the raw int8 inputs
+    weights = [w[j] / std[j] for j in range(d)]
+    bias = b - sum(weights[j] * mean[j] for j in range(d))
+    return weights, bias
+
+
+def export_int8(weights, bias):
+    """Scale the logit so the largest weight is 127; the sign decides, so the scale is free."""
+    scale = 127.0 / max(abs(w) for w in weights) if any(weights) else 1.0
+    return [int(round(w * scale)) for w in weights], int(round(bias * scale))
+
+
+def score(inputs, weights, bias):
+    return bias + sum(w * x for w, x in zip(weights, inputs))
+
+
+def write_header(path, weights, bias, rows, accuracy):
+    scales = ", ".join("%.1ff" % s for s in FEATURE_SCALES)
+    with open(path, "w") as f:
+        f.write("""/**
+ * ElderGuard - Fall Classifier Model
+ *
+ * Generated by tools/train_fall_classifier.py; regenerate rather than edit.
+ * Only included by fall_classifier.cpp and its native test.
+ *
+ * Trained on %d labelled candidates, %.1f%% correct with int8 weights.
+ */
+
+#ifndef FALL_CLASSIFIER_MODEL_H
+#define FALL_CLASSIFIER_MODEL_H
+
+#include <stdint.h>
+
+// Quantized input = round(feature * scale), clamped to int8
+static constexpr float FALL_FEATURE_SCALES[4] = { %s };
+
+// sma, jerk, stillness, orientationDelta
+static constexpr int8_t FALL_CLASSIFIER_WEIGHTS[4] = { %s };
+static constexpr int32_t FALL_CLASSIFIER_BIAS = %d;
+
+#endif // FALL_CLASSIFIER_MODEL_H
+""" % (rows, accuracy, scales, ", ".join(str(w) for w in weights), bias))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    parser.add_argument("csv", help="labelled candidates")
+    parser.add_argument("-o", "--output", default="include/fall_classifier_model.h")
+    args = parser.parse_args()
+
+    inputs, labels = load(args.csv)
+    weights, bias = export_int8(*train(inputs, labels))
+
+    # Evaluate exactly as the firmware does: integer logit, fall when >= 0
+    tp = sum(1 for x, y in zip(inputs, labels) if y == 1 and score(x, weights, bias) >= 0)
+    tn = sum(1 for x, y in zip(inputs, labels) if y == 0 and score(x, weights, bias) < 0)
+    falls = sum(labels)
+    others = len(labels) - falls
+    accuracy = 100.0 * (tp + tn) / len(labels)
+
+    print("weights %s bias %d" % (weights, bias))
+    print("sensitivity %d/%d, specificity %d/%d, accuracy %.1f%%" % (tp, falls, tn, others, accuracy))
+    write_header(args.output, weights, bias, len(labels), accuracy)
+    print("wrote " + args.output)
+
+
+if __name__ == "__main__":
+    main()